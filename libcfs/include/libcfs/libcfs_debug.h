@@ -53,6 +53,7 @@ extern unsigned int libcfs_console_max_delay;
 extern unsigned int libcfs_console_min_delay;
 extern unsigned int libcfs_console_backoff;
 extern unsigned int libcfs_debug_binary;
+extern unsigned int libcfs_debug_deferred;
 extern char *libcfs_debug_file_path;
 
 struct task_struct;
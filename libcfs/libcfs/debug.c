@@ -235,6 +235,11 @@ MODULE_PARM_DESC(libcfs_console_backoff, "Lustre kernel debug console backoff fa
 
 unsigned int libcfs_debug_binary = 1;
 
+unsigned int libcfs_debug_deferred;
+module_param(libcfs_debug_deferred, uint, 0644);
+MODULE_PARM_DESC(libcfs_debug_deferred,
+		 "Format debug log messages only when the log is dumped (0 to disable)");
+
 unsigned int libcfs_catastrophe;
 EXPORT_SYMBOL(libcfs_catastrophe);
 
@@ -40,6 +40,7 @@
 #include <linux/ctype.h>
 #include <linux/fs.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/pagemap.h>
 #include <linux/poll.h>
 #include <linux/uaccess.h>
@@ -229,6 +230,7 @@ cfs_trace_get_tage_try(struct cfs_trace_cpu_data *tcd, unsigned long len)
 		}
 
 		tage->used = 0;
+		tage->deferred = 0;
 		tage->cpu = smp_processor_id();
 		tage->type = tcd->tcd_type;
 		list_add_tail(&tage->linkage, &tcd->tcd_pages);
@@ -299,6 +301,7 @@ static struct cfs_trace_page *cfs_trace_get_tage(struct cfs_trace_cpu_data *tcd,
 	if (tcd->tcd_cur_pages > 0) {
 		tage = cfs_tage_from_list(tcd->tcd_pages.next);
 		tage->used = 0;
+		tage->deferred = 0;
 		cfs_tage_to_tail(tage, &tcd->tcd_pages);
 	}
 	return tage;
@@ -551,6 +554,74 @@ static inline const char *debug_format(const char *fmt,
 	return fmt;
 }
 
+#ifdef CONFIG_BINARY_PRINTF
+/*
+ * Save the record with @format and the arguments in @ap instead of the
+ * formatted message, vbin_printf() copies the strings and formats the pointer
+ * extensions which dereference their argument.  @format must outlive the
+ * record, see cfs_trace_module_notify().
+ *
+ * Return 0 if the record is saved, or a negative error if it does not fit in
+ * a page and the message must be formatted now.
+ */
+static int cfs_trace_log_deferred(struct cfs_trace_cpu_data *tcd,
+				  struct ptldebug_header *header,
+				  const char *file, const char *fn,
+				  const char *format, va_list ap)
+{
+	struct cfs_trace_deferred *ctd;
+	struct cfs_trace_page *tage;
+	int file_len = strlen(file) + 1;
+	int fn_len = strlen(fn) + 1;
+	int known_size = sizeof(*header) + file_len + fn_len;
+	int needed = 64; /* seeded with average arguments size */
+	int offset;
+	int max_nob;
+	va_list aq;
+	char *buf;
+	int retry;
+
+	for (retry = 0; retry < 2; retry++) {
+		if (known_size + sizeof(long) - 1 + sizeof(*ctd) + needed >
+		    PAGE_SIZE)
+			return -E2BIG;
+
+		tage = cfs_trace_get_tage(tcd, known_size + sizeof(long) - 1 +
+					  sizeof(*ctd) + needed);
+		if (!tage)
+			return -ENOMEM;
+
+		buf = (char *)page_address(tage->page) + tage->used;
+		offset = PTR_ALIGN(buf + known_size, sizeof(long)) - buf;
+		ctd = (struct cfs_trace_deferred *)(buf + offset);
+		max_nob = PAGE_SIZE - tage->used - offset - sizeof(*ctd);
+
+		va_copy(aq, ap);
+		needed = vbin_printf(ctd->ctd_args, max_nob / sizeof(u32),
+				     format, aq) * sizeof(u32);
+		va_end(aq);
+
+		if (needed <= max_nob)
+			break;
+	}
+	if (retry == 2)
+		return -E2BIG;
+
+	ctd->ctd_format = format;
+	header->ph_flags |= PH_FLAG_DEFERRED;
+	header->ph_len = offset + sizeof(*ctd) + needed;
+	memcpy(buf, header, sizeof(*header));
+	memcpy(buf + sizeof(*header), file, file_len);
+	memcpy(buf + sizeof(*header) + file_len, fn, fn_len);
+
+	tage->used += header->ph_len;
+	tage->deferred = 1;
+	__LASSERT(tage->used <= PAGE_SIZE);
+
+	return 0;
+}
+#endif
+
 void libcfs_debug_msg(struct libcfs_debug_msg_data *msgdata,
 		      const char *format, ...)
 {
@@ -595,6 +666,22 @@ void libcfs_debug_msg(struct libcfs_debug_msg_data *msgdata,
 		goto console;
 	}
 
+#ifdef CONFIG_BINARY_PRINTF
+	/* a rewritten format only lives until the end of this call */
+	if (libcfs_debug_deferred && libcfs_debug_binary && fn && !dfb &&
+	    (header.ph_mask & libcfs_printk) == 0) {
+		int rc;
+
+		va_start(ap, format);
+		rc = cfs_trace_log_deferred(tcd, &header, file, fn, format, ap);
+		va_end(ap);
+		if (rc == 0) {
+			cfs_trace_put_tcd(tcd);
+			goto out;
+		}
+	}
+#endif
+
 	known_size = strlen(file) + 1;
 	if (fn)
 		known_size += strlen(fn) + 1;
@@ -833,6 +920,148 @@ static void put_pages_back(struct page_collection *pc)
                 put_pages_back_on_all_cpus(pc);
 }
 
+#ifdef CONFIG_BINARY_PRINTF
+/* append the @len bytes record at @rec to the pages on @list */
+static int cfs_trace_render_copy(struct list_head *list,
+				 struct cfs_trace_page *src,
+				 const char *rec, int len, gfp_t gfp)
+{
+	struct cfs_trace_page *tage = NULL;
+
+	if (!list_empty(list))
+		tage = cfs_tage_from_list(list->prev);
+
+	if (!tage || tage->used + len > PAGE_SIZE) {
+		tage = cfs_tage_alloc(gfp);
+		if (!tage)
+			return -ENOMEM;
+
+		tage->used = 0;
+		tage->deferred = 0;
+		tage->cpu = src->cpu;
+		tage->type = src->type;
+		list_add_tail(&tage->linkage, list);
+	}
+
+	memcpy(page_address(tage->page) + tage->used, rec, len);
+	tage->used += len;
+
+	return 0;
+}
+
+/* format the deferred records of @src into new pages added to @list */
+static int cfs_trace_render_page(struct list_head *list,
+				 struct cfs_trace_page *src, char *buf,
+				 gfp_t gfp)
+{
+	char *p = page_address(src->page);
+	char *end = p + src->used;
+
+	while (p < end) {
+		struct ptldebug_header *hdr = (struct ptldebug_header *)p;
+		struct cfs_trace_deferred *ctd;
+		char *fn;
+		int known_size;
+		int len;
+		int rc;
+
+		if (!(hdr->ph_flags & PH_FLAG_DEFERRED)) {
+			rc = cfs_trace_render_copy(list, src, p, hdr->ph_len,
+						   gfp);
+			if (rc)
+				return rc;
+			p += hdr->ph_len;
+			continue;
+		}
+
+		fn = p + sizeof(*hdr) + strlen(p + sizeof(*hdr)) + 1;
+		known_size = fn + strlen(fn) + 1 - p;
+		ctd = PTR_ALIGN((void *)(p + known_size), sizeof(long));
+
+		memcpy(buf, p, known_size);
+		len = bstr_printf(buf + known_size, PAGE_SIZE - known_size,
+				  ctd->ctd_format, ctd->ctd_args);
+		len = min_t(int, len, PAGE_SIZE - known_size - 1);
+
+		hdr = (struct ptldebug_header *)buf;
+		hdr->ph_flags &= ~PH_FLAG_DEFERRED;
+		hdr->ph_len = known_size + len;
+		rc = cfs_trace_render_copy(list, src, buf, hdr->ph_len, gfp);
+		if (rc)
+			return rc;
+
+		p += ((struct ptldebug_header *)p)->ph_len;
+	}
+
+	return 0;
+}
+
+/*
+ * Replace the pages of @pc holding deferred records with pages holding the
+ * formatted messages, keeping the order of the records.
+ */
+static void cfs_trace_render_pages(struct page_collection *pc, gfp_t gfp)
+{
+	struct cfs_trace_page *tage;
+	struct cfs_trace_page *tmp;
+	char *buf = NULL;
+	int rc;
+
+	list_for_each_entry_safe(tage, tmp, &pc->pc_pages, linkage) {
+		LIST_HEAD(rendered);
+
+		if (!tage->deferred)
+			continue;
+
+		if (!buf) {
+			buf = kmalloc(PAGE_SIZE, gfp | __GFP_NOWARN);
+			if (!buf)
+				rc = -ENOMEM;
+		}
+		if (buf)
+			rc = cfs_trace_render_page(&rendered, tage, buf, gfp);
+		if (rc && printk_ratelimit())
+			pr_warn("Lustre: cannot format deferred debug messages: rc = %d\n",
+				rc);
+
+		list_splice_tail(&rendered, &tage->linkage);
+		list_del(&tage->linkage);
+		cfs_tage_free(tage);
+	}
+	kfree(buf);
+}
+
+/*
+ * The formats of the deferred records are in the text of the modules which
+ * logged them, format the records before a module is unloaded.
+ */
+static int cfs_trace_module_notify(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	struct page_collection pc;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	down_write(&cfs_tracefile_sem);
+	collect_pages(&pc);
+	cfs_trace_render_pages(&pc, GFP_KERNEL);
+	put_pages_back(&pc);
+	up_write(&cfs_tracefile_sem);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cfs_trace_module_nb = {
+	.notifier_call = cfs_trace_module_notify,
+};
+#else
+static inline void cfs_trace_render_pages(struct page_collection *pc,
+					  gfp_t gfp)
+{
+}
+#endif
+
 #ifdef LNET_DUMP_ON_PANIC
 void cfs_trace_debug_print(void)
 {
@@ -842,6 +1071,8 @@ void cfs_trace_debug_print(void)
 	struct page *page;
 
 	collect_pages(&pc);
+	/* the console gets messages, not the format and arguments */
+	cfs_trace_render_pages(&pc, GFP_ATOMIC);
 	list_for_each_entry_safe(tage, tmp, &pc.pc_pages, linkage) {
 		char *p, *file, *fn;
 
@@ -927,6 +1158,8 @@ int cfs_tracefile_dump_all_pages(char *filename)
 		rc = 0;
 		goto close;
 	}
+	cfs_trace_render_pages(&pc, libcfs_panic_in_progress ? GFP_ATOMIC :
+							       GFP_KERNEL);
 
 	/* ok, for now, just write the pages.  in the future we'll be building
 	 * iobufs with the pages and calling generic_direct_IO */
@@ -1166,12 +1399,16 @@ static int tracefiled(void *arg)
 		schedule_timeout_interruptible(cfs_time_seconds(1));
 		if (kthread_should_stop())
 			last_loop = 1;
+		/* don't race with cfs_trace_module_notify() */
+		down_read(&cfs_tracefile_sem);
 		collect_pages(&pc);
-		if (list_empty(&pc.pc_pages))
+		cfs_trace_render_pages(&pc, GFP_KERNEL);
+		if (list_empty(&pc.pc_pages)) {
+			up_read(&cfs_tracefile_sem);
 			continue;
+		}
 
 		filp = NULL;
-		down_read(&cfs_tracefile_sem);
 		if (cfs_tracefile[0] != 0) {
 			filp = filp_open(cfs_tracefile,
 					 O_CREAT | O_RDWR | O_LARGEFILE,
@@ -1347,6 +1584,9 @@ int cfs_tracefile_init(int max_pages)
 		tcd->tcd_shutting_down = 0;
 	}
 	daemon_pages_max = max_pages;
+#ifdef CONFIG_BINARY_PRINTF
+	register_module_notifier(&cfs_trace_module_nb);
+#endif
 
 	return 0;
 
@@ -1403,6 +1643,9 @@ static void cfs_trace_cleanup(void)
 
 void cfs_tracefile_exit(void)
 {
+#ifdef CONFIG_BINARY_PRINTF
+	unregister_module_notifier(&cfs_trace_module_nb);
+#endif
 	cfs_trace_stop_thread();
 	cfs_trace_flush_pages();
 	cfs_trace_cleanup();
@@ -161,6 +161,24 @@ struct cfs_trace_page {
 	 * type(context) of this page
 	 */
 	unsigned short		type;
+	/*
+	 * the page holds records whose formatting has been deferred
+	 */
+	unsigned int		deferred:1;
+};
+
+/*
+ * Kernel internal flag of the records saved with their format and arguments,
+ * rather than the formatted message, when libcfs_debug_deferred is set.
+ * Such a record is followed by struct cfs_trace_deferred aligned to a long,
+ * it is formatted by cfs_trace_render_pages() before leaving the kernel.
+ */
+#define PH_FLAG_DEFERRED	0x80000000
+
+struct cfs_trace_deferred {
+	const char		*ctd_format;
+	/* arguments saved by vbin_printf() */
+	u32			ctd_args[];
 };
 
 int cfs_tcd_owns_tage(struct cfs_trace_cpu_data *tcd,
@@ -1169,6 +1169,98 @@ AC_DEFUN([LN_HAVE_IN_DEV_FOR_EACH_IFA_RTNL], [
 	])
 ]) # LN_HAVE_IN_DEV_FOR_EACH_IFA_RTNL
 
+#
+# LN_HAVE_NAPI_BUSY_LOOP_PREFER
+#
+# Linux 5.11 added the prefer_busy_poll and budget arguments of
+# napi_busy_loop()
+#
+AC_DEFUN([LN_SRC_HAVE_NAPI_BUSY_LOOP_PREFER], [
+	LB2_LINUX_TEST_SRC([napi_busy_loop_prefer], [
+		#include <net/busy_poll.h>
+	],[
+		napi_busy_loop(0, NULL, NULL, false, BUSY_POLL_BUDGET);
+	],[-Werror])
+])
+AC_DEFUN([LN_HAVE_NAPI_BUSY_LOOP_PREFER], [
+	LB2_MSG_LINUX_TEST_RESULT([if 'napi_busy_loop()' has 'prefer_busy_poll'],
+	[napi_busy_loop_prefer], [
+		AC_DEFINE(HAVE_NAPI_BUSY_LOOP_PREFER, 1,
+			['napi_busy_loop()' has 'prefer_busy_poll'])
+	])
+]) # LN_HAVE_NAPI_BUSY_LOOP_PREFER
+
+#
+# LN_HAVE_MSGHDR_MSG_UBUF
+#
+# Linux 6.0 added msghdr::msg_ubuf, to pass the ubuf_info notified when
+# the socket has finished with the pages of a MSG_ZEROCOPY send
+#
+AC_DEFUN([LN_SRC_HAVE_MSGHDR_MSG_UBUF], [
+	LB2_LINUX_TEST_SRC([msghdr_msg_ubuf], [
+		#include <linux/socket.h>
+		#include <linux/skbuff.h>
+	],[
+		struct msghdr msg = { .msg_ubuf = NULL };
+		struct ubuf_info uarg = { .flags = SKBFL_DONT_ORPHAN };
+
+		(void)msg;
+		(void)uarg;
+	],[-Werror])
+])
+AC_DEFUN([LN_HAVE_MSGHDR_MSG_UBUF], [
+	LB2_MSG_LINUX_TEST_RESULT([if 'struct msghdr' has 'msg_ubuf'],
+	[msghdr_msg_ubuf], [
+		AC_DEFINE(HAVE_MSGHDR_MSG_UBUF, 1,
+			['struct msghdr' has 'msg_ubuf'])
+	])
+]) # LN_HAVE_MSGHDR_MSG_UBUF
+
+#
+# LN_HAVE_ITER_DEST
+#
+# Linux 6.1 added ITER_SOURCE and ITER_DEST as the iov_iter directions
+#
+AC_DEFUN([LN_SRC_HAVE_ITER_DEST], [
+	LB2_LINUX_TEST_SRC([iter_dest], [
+		#include <linux/uio.h>
+	],[
+		struct iov_iter iter;
+
+		iov_iter_bvec(&iter, ITER_DEST, NULL, 0, 0);
+	],[-Werror])
+])
+AC_DEFUN([LN_HAVE_ITER_DEST], [
+	LB2_MSG_LINUX_TEST_RESULT([if 'ITER_DEST' is defined],
+	[iter_dest], [
+		AC_DEFINE(HAVE_ITER_DEST, 1,
+			['ITER_DEST' is defined])
+	])
+]) # LN_HAVE_ITER_DEST
+
+#
+# LN_HAVE_UBUF_INFO_OPS
+#
+# Linux 6.10 moved the completion callback of struct ubuf_info to
+# struct ubuf_info_ops
+#
+AC_DEFUN([LN_SRC_HAVE_UBUF_INFO_OPS], [
+	LB2_LINUX_TEST_SRC([ubuf_info_ops], [
+		#include <linux/skbuff.h>
+	],[
+		struct ubuf_info uarg = { .ops = NULL };
+
+		(void)uarg;
+	],[-Werror])
+])
+AC_DEFUN([LN_HAVE_UBUF_INFO_OPS], [
+	LB2_MSG_LINUX_TEST_RESULT([if 'struct ubuf_info' has 'ops'],
+	[ubuf_info_ops], [
+		AC_DEFINE(HAVE_UBUF_INFO_OPS, 1,
+			['struct ubuf_info' has 'ops'])
+	])
+]) # LN_HAVE_UBUF_INFO_OPS
+
 #
 # LN_USR_RDMA
 #
@@ -1203,6 +1295,14 @@ AC_DEFUN([LN_PROG_LINUX_SRC], [
 	LN_SRC_CONFIG_SOCK_GETNAME
 	# 5.3 and 4.18.0-193.el8
 	LN_SRC_HAVE_IN_DEV_FOR_EACH_IFA_RTNL
+	# 5.11
+	LN_SRC_HAVE_NAPI_BUSY_LOOP_PREFER
+	# 6.0
+	LN_SRC_HAVE_MSGHDR_MSG_UBUF
+	# 6.1
+	LN_SRC_HAVE_ITER_DEST
+	# 6.10
+	LN_SRC_HAVE_UBUF_INFO_OPS
 ])
 
 AC_DEFUN([LN_PROG_LINUX_RESULTS], [
@@ -1220,6 +1320,14 @@ AC_DEFUN([LN_PROG_LINUX_RESULTS], [
 	LN_CONFIG_SOCK_GETNAME
 	# 5.3 and 4.18.0-193.el8
 	LN_HAVE_IN_DEV_FOR_EACH_IFA_RTNL
+	# 5.11
+	LN_HAVE_NAPI_BUSY_LOOP_PREFER
+	# 6.0
+	LN_HAVE_MSGHDR_MSG_UBUF
+	# 6.1
+	LN_HAVE_ITER_DEST
+	# 6.10
+	LN_HAVE_UBUF_INFO_OPS
 ])
 
 #
@@ -602,6 +602,7 @@ extern unsigned int lnet_recovery_interval;
 extern unsigned int lnet_recovery_limit;
 extern unsigned int lnet_peer_discovery_disabled;
 extern unsigned int lnet_drop_asym_route;
+extern unsigned int lnet_select_policy;
 extern unsigned int lnet_max_recovery_ping_interval;
 extern unsigned int lnet_max_recovery_ping_count;
 extern unsigned int router_sensitivity_percentage;
@@ -1279,6 +1280,55 @@ lnet_inc_healthv(atomic_t *healthv, int value)
 	lnet_atomic_add_unless_max(healthv, value, LNET_MAX_HEALTH_VALUE);
 }
 
+/* weight of a new sample in the moving average of the send latency */
+#define LNET_RTT_EWMA_SHIFT	3
+/* longer than any transaction timeout, keeps the selection cost in 64 bits */
+#define LNET_RTT_MAX_US		(256 * USEC_PER_SEC)
+
+/*
+ * Fold a send completion time into the moving average of an NI or peer NI.
+ * Updates are not serialized, a sample racing with another one may be lost,
+ * which does not matter for an estimate. 0 means no sample yet.
+ */
+static inline void
+lnet_rtt_update(atomic_t *rtt, s64 sample_us)
+{
+	int old = atomic_read(rtt);
+	int sample = clamp_t(s64, sample_us, 1, LNET_RTT_MAX_US);
+
+	if (!old)
+		atomic_set(rtt, sample);
+	else
+		atomic_set(rtt, max(old + (sample - old) /
+					  (1 << LNET_RTT_EWMA_SHIFT), 1));
+}
+
+/*
+ * Expected completion time of a new message sent over an interface with
+ * the given latency and bytes already queued: each LNET_MTU queued ahead of
+ * it costs about one more round trip. Picking the lowest cost spreads bulk
+ * traffic over the interfaces in inverse proportion to their latency.
+ */
+static inline u64
+lnet_select_cost(int rtt_us, u64 txqnob)
+{
+	return ((u64)rtt_us * (txqnob + LNET_MTU)) >> LNET_MTU_BITS;
+}
+
+static inline u64
+lnet_ni_select_cost(struct lnet_ni *ni)
+{
+	return lnet_select_cost(atomic_read(&ni->ni_rtt_us),
+				atomic64_read(&ni->ni_txqnob));
+}
+
+static inline u64
+lnet_lpni_select_cost(struct lnet_peer_ni *lpni)
+{
+	return lnet_select_cost(atomic_read(&lpni->lpni_rtt_us),
+				READ_ONCE(lpni->lpni_txqnob));
+}
+
 static inline int
 lnet_get_list_len(struct list_head *list)
 {
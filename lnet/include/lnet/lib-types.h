@@ -36,6 +36,7 @@ int libcfs_strid(struct lnet_processid *id, const char *str);
 int cfs_match_nid_net(struct lnet_nid *nid, u32 net,
 		      struct list_head *net_num_list,
 		      struct list_head *addr);
+int cfs_net_type_ip_addr(u32 net_type);
 
 /* Max payload size */
 #define LNET_MAX_PAYLOAD	LNET_MTU
@@ -50,6 +51,17 @@ int cfs_match_nid_net(struct lnet_nid *nid, u32 net,
 #define LNET_MAX_HEALTH_VALUE 1000
 #define LNET_MAX_SELECTION_PRIORITY UINT_MAX
 
+/*
+ * How the local and peer NIs are chosen among the healthiest ones with the
+ * same selection priority: on available credits, or on the expected
+ * completion time derived from the measured send latency and queued bytes.
+ */
+enum lnet_select_policy {
+	LNET_SELECT_POLICY_CREDITS = 0,
+	LNET_SELECT_POLICY_LATENCY = 1,
+	LNET_SELECT_POLICY_MAX
+};
+
 /* forward refs */
 struct lnet_libmd;
 
@@ -105,6 +117,9 @@ struct lnet_msg {
 	 */
 	ktime_t			msg_deadline;
 
+	/* When the message was handed to the LND, to measure the latency */
+	ktime_t			msg_tx_start;
+
 	/* The message health status. */
 	enum lnet_msg_hstatus	msg_health_status;
 	/* This is a recovery message */
@@ -644,6 +659,10 @@ enum lnet_net_local_ni_msg_stats_attrs {
  *							ping (NLA_U32)
  * @LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_NEXT_PING:	Number of next pings
  *							(NLA_U64)
+ * @LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_RTT:		Average send latency
+ *							in usecs (NLA_U32)
+ * @LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_QUEUED:		Bytes queued for
+ *							sending (NLA_U64)
  */
 enum lnet_net_local_ni_health_stats_attrs {
 	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_UNSPEC = 0,
@@ -659,6 +678,8 @@ enum lnet_net_local_ni_health_stats_attrs {
 	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_ERROR,
 	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_PING_COUNT,
 	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_NEXT_PING,
+	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_RTT,
+	LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_QUEUED,
 	__LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_MAX_PLUS_ONE,
 };
 #define LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_MAX (__LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_MAX_PLUS_ONE - 1)
@@ -924,6 +945,11 @@ enum lnet_peer_ni_list_stats {
  * @LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_NEXT_PING:	timestamp for next ping
  *							sent by remote peer
  *							(NLA_S64)
+ * @LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_RTT:		average send latency
+ *							to remote peer in usecs
+ *							(NLA_U32)
+ * @LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_QUEUED:		bytes queued for
+ *							remote peer (NLA_U64)
  */
 enum lnet_peer_ni_list_health_stats {
 	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_UNSPEC = 0,
@@ -936,6 +962,8 @@ enum lnet_peer_ni_list_health_stats {
 	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_NETWORK_TIMEOUT,
 	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_PING_COUNT,
 	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_NEXT_PING,
+	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_RTT,
+	LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_QUEUED,
 
 	__LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_MAX_PLUS_ONE,
 };
@@ -1168,6 +1196,12 @@ struct lnet_ni {
 	/* the relative selection priority of this NI */
 	__u32			ni_sel_priority;
 
+	/* bytes of the messages holding a tx credit of this NI */
+	atomic64_t		ni_txqnob;
+
+	/* moving average of the send completion time in microseconds */
+	atomic_t		ni_rtt_us;
+
 	/*
 	 * equivalent interface to use
 	 */
@@ -1286,6 +1320,8 @@ struct lnet_peer_ni {
 	struct kref		lpni_kref;
 	/* health value for the peer */
 	atomic_t		lpni_healthv;
+	/* moving average of the send completion time in microseconds */
+	atomic_t		lpni_rtt_us;
 	/* recovery ping mdh */
 	struct lnet_handle_md	lpni_recovery_ping_mdh;
 	/* When to send the next recovery ping */
@@ -1763,10 +1799,31 @@ struct lnet_ud_net_descr {
  *  1. net descriptor
  *  2. address range descriptor
  */
+/* number of values of a byte, the range of compiled UDSP expressions */
+#define LNET_UD_MATCH_VALUES	256
+
+/* A UDSP NID descriptor compiled into bitmaps, so matching a NID takes a
+ * few bit tests instead of walking the range expressions. Descriptors with
+ * values out of the bitmaps are matched on their expressions.
+ */
+struct lnet_ud_nid_match {
+	/* net numbers matched */
+	DECLARE_BITMAP(um_net_num, LNET_UD_MATCH_VALUES);
+	/* byte values matched for each byte of an IPv4 address, most
+	 * significant first, or values of a numeric address in the first
+	 */
+	unsigned long um_addr[4][BITS_TO_LONGS(LNET_UD_MATCH_VALUES)];
+	/* expressions compiled in um_addr, 0 for a net rule */
+	int um_addr_exprs;
+	/* the bitmaps are valid */
+	bool um_compiled;
+};
+
 struct lnet_ud_nid_descr {
 	struct lnet_ud_net_descr ud_net_id;
 	struct list_head ud_addr_range;
 	__u32 ud_mem_size;
+	struct lnet_ud_nid_match ud_match;
 };
 
 /* a UDSP rule can have up to three user defined NID descriptors
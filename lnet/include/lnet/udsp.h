@@ -19,7 +19,8 @@
 
 /**
  * lnet_udsp_add_policy
- *	Add a policy \new in position \idx
+ *	Add a policy \new in position \idx and apply it on the
+ *	constructs it matches
  *	Must be called with api_mutex held
  */
 int lnet_udsp_add_policy(struct lnet_udsp *new, int idx);
@@ -130,4 +131,17 @@ int lnet_udsp_demarshal_add(void *bulk, __u32 bulk_size);
 void lnet_udsp_get_construct_info(struct lnet_ioctl_construct_udsp_info *info,
 				  struct lnet_nid *nid);
 
+/**
+ * lnet_udsp_stats_print
+ *	Print the UDSP matching and application counters in \buf
+ *	Return the length printed
+ */
+int lnet_udsp_stats_print(char *buf, int len);
+
+/**
+ * lnet_udsp_stats_reset
+ *	Reset the UDSP matching and application counters
+ */
+void lnet_udsp_stats_reset(void);
+
 #endif /* UDSP_H */
@@ -20,9 +20,11 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_LAT_HIST	(1 << 1)	/* RPC latency histograms */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_LAT_HIST)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -45,6 +47,7 @@
 #define LSTIO_TEST_ADD		0xC26		/* add test (to batch) */
 #define LSTIO_BATCH_QUERY	0xC27		/* query batch status */
 #define LSTIO_STAT_QUERY	0xC30		/* get stats */
+#define LSTIO_LAT_QUERY		0xC31		/* get latency histograms */
 
 /*
  * sparse kernel source annotations
@@ -430,7 +433,15 @@ struct lstio_stat_args {
 
 enum lst_test_type {
 	LST_TEST_BULK	= 1,
-	LST_TEST_PING	= 2
+	LST_TEST_PING	= 2,
+	LST_TEST_STREAM	= 3
+};
+
+struct lstio_lat_args {
+	/* IN/OUT: nodes and result buffer, as for LSTIO_STAT_QUERY */
+	struct lstio_stat_args	lstio_lat_stat;
+	/* IN: enum lst_test_type of the RPCs */
+	int			lstio_lat_type;
 };
 
 /* create a test in a batch */
@@ -492,6 +503,25 @@ struct lst_test_ping_param {
 	int png_flags;		/* reserved flags */
 };
 
+/* data checksums of the stream test, as the obd_cksum algorithms */
+enum lst_stream_cksum {
+	LST_STREAM_CKSUM_NONE	= 0,
+	LST_STREAM_CKSUM_ADLER	= 1,
+	LST_STREAM_CKSUM_CRC32	= 2,
+	LST_STREAM_CKSUM_CRC32C	= 3,
+	LST_STREAM_CKSUM_MAX
+};
+
+/* largest transfer of the stream test, as a 16MB Lustre bulk RPC */
+#define LST_STREAM_MAX_SIZE	(16 << 20)
+
+struct lst_test_stream_param {
+	int stm_min_size;	/* smallest transfer (bytes) */
+	int stm_max_size;	/* largest transfer (bytes) */
+	int stm_read_pct;	/* % of transfers which are reads */
+	int stm_cksum;		/* enum lst_stream_cksum */
+};
+
 /* Both struct srpc_counters and struct sfw_counters are sent over the wire */
 struct srpc_counters {
 	__u32 errors;
@@ -512,6 +542,20 @@ struct sfw_counters {
 	__u32 ping_errors;
 } __attribute__((packed));
 
+/* log2 buckets of usecs: bucket 0 counts 0 usecs, bucket i counts
+ * [2^(i - 1), 2^i) usecs and the last one anything longer
+ */
+#define LST_LAT_BUCKETS		28
+
+/* Round trip times of the test RPCs of one type sent by a node since the
+ * session started, sent over the wire in place of the counters.
+ */
+struct sfw_lat_hist {
+	__u32 lat_buckets[LST_LAT_BUCKETS];
+	/** longest round trip since the previous query, in usecs */
+	__u32 lat_max_us;
+} __attribute__((packed));
+
 #define LNET_SELFTEST_GENL_NAME		"lnet_selftest"
 #define LNET_SELFTEST_GENL_VERSION	0x1
 
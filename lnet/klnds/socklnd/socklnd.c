@@ -2211,6 +2211,7 @@ ksocknal_base_shutdown(void)
 				LASSERT(list_empty(&sched->kss_tx_conns));
 				LASSERT(list_empty(&sched->kss_rx_conns));
 				LASSERT(list_empty(&sched->kss_zombie_noop_txs));
+				LASSERT(llist_empty(&sched->kss_zc_done_txs));
 				LASSERT(sched->kss_nconns == 0);
 			}
 		}
@@ -2312,6 +2313,7 @@ ksocknal_base_startup(void)
 		INIT_LIST_HEAD(&sched->kss_rx_conns);
 		INIT_LIST_HEAD(&sched->kss_tx_conns);
 		INIT_LIST_HEAD(&sched->kss_zombie_noop_txs);
+		init_llist_head(&sched->kss_zc_done_txs);
 		init_waitqueue_head(&sched->kss_waitq);
         }
 
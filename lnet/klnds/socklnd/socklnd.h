@@ -27,6 +27,7 @@
 #include <linux/kthread.h>
 #include <linux/kmod.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/pagemap.h>
@@ -38,6 +39,7 @@
 #include <linux/uio.h>
 #include <linux/unistd.h>
 #include <linux/hashtable.h>
+#include <net/busy_poll.h>
 #include <net/sock.h>
 #include <net/tcp.h>
 
@@ -71,6 +73,22 @@
 # define SOCKNAL_RISK_KMAP_DEADLOCK  1
 #endif
 
+/* zero-copy sends completed by the local socket rather than by a ZC-ACK
+ * from the peer, see ksocknal_lib_zc_start()
+ */
+#if defined(HAVE_MSGHDR_MSG_UBUF) && defined(HAVE_ITER_DEST)
+# define SOCKNAL_ZC_LOCAL            1
+#else
+# define SOCKNAL_ZC_LOCAL            0
+#endif
+
+/* busy polling schedulers poll the NAPI context of their last receive */
+#if defined(CONFIG_NET_RX_BUSY_POLL) && defined(HAVE_NAPI_BUSY_LOOP_PREFER)
+# define SOCKNAL_NAPI_POLL           1
+#else
+# define SOCKNAL_NAPI_POLL           0
+#endif
+
 enum ksocklnd_ni_lnd_tunables_attr {
 	LNET_NET_SOCKLND_TUNABLES_ATTR_UNSPEC = 0,
 
@@ -91,6 +109,10 @@ struct ksock_sched {
 	struct list_head kss_tx_conns;
 	/* zombie noop tx list */
 	struct list_head kss_zombie_noop_txs;
+	/* txs whose zero-copy payload the socket has finished with */
+	struct llist_head kss_zc_done_txs;
+	/* NAPI context of the last receive, for busy polling */
+	unsigned int kss_napi_id;
 	/* where scheduler sleeps */
 	wait_queue_head_t kss_waitq;
 	/* # connections assigned to this scheduler */
@@ -103,6 +125,21 @@ struct ksock_sched {
 	int kss_cpt;
 };
 
+/* log2 buckets of usecs, the last one counts anything longer */
+#define KSOCK_LAT_BUCKETS		16
+
+/* per-CPU scheduler latency stats, see the rx_latency module parameter */
+struct ksock_rx_lat {
+	/* from data_ready to the scheduler picking up the conn */
+	unsigned long ksl_hist[KSOCK_LAT_BUCKETS];
+	/* busy polls that found something to do */
+	unsigned long ksl_poll_hits;
+	/* busy polls that ran out of time */
+	unsigned long ksl_poll_misses;
+};
+
+DECLARE_PER_CPU(struct ksock_rx_lat, ksocknal_rx_lat);
+
 #define KSOCK_CPT_SHIFT			16
 #define KSOCK_THREAD_ID(cpt, sid)	(((cpt) << KSOCK_CPT_SHIFT) | (sid))
 #define KSOCK_THREAD_CPT(id)		((id) >> KSOCK_CPT_SHIFT)
@@ -148,6 +185,11 @@ struct ksock_tunables {
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
+#if SOCKNAL_ZC_LOCAL
+	int		 *ksnd_zc_msg_zerocopy;	/* complete ZC sends locally */
+#endif
+	unsigned int	 *ksnd_busy_poll;	/* usecs to poll before sleep */
+	int		 *ksnd_busy_poll_cpt;	/* CPT to busy poll, -1: all */
 #ifdef SOCKNAL_BACKOFF
         int              *ksnd_backoff_init;    /* initial TCP backoff */
         int              *ksnd_backoff_max;     /* maximum TCP backoff */
@@ -265,6 +307,7 @@ struct ksock_tx {			/* transmit packet */
 	unsigned short	tx_zc_capable:1; /* payload is large enough for ZC */
 	unsigned short	tx_zc_checked:1; /* Have I checked if I should ZC? */
 	unsigned short	tx_nonblk:1;	/* it's a non-blocking ACK */
+	unsigned short	tx_zc_local:1;	/* ZC send completed by the socket */
 	struct bio_vec *tx_kiov;	/* packet page frags */
 	struct ksock_conn *tx_conn;	/* owning conn */
 	struct lnet_msg	*tx_lnetmsg;	/* lnet message for lnet_finalize() */
@@ -272,6 +315,10 @@ struct ksock_tx {			/* transmit packet */
 	struct ksock_msg tx_msg;	/* socklnd message buffer */
 	int		tx_desc_size;	/* size of this descriptor */
 	enum lnet_msg_hstatus tx_hstatus; /* health status of tx */
+#if SOCKNAL_ZC_LOCAL
+	struct ubuf_info tx_zc_uarg;	/* socket's hold on the payload */
+#endif
+	struct llist_node tx_zc_done;	/* on kss_zc_done_txs */
 	struct kvec	tx_hdr;		/* virt hdr */
 	struct bio_vec	tx_payload[0];	/* paged payload */
 };
@@ -324,6 +371,7 @@ struct ksock_conn {
         __u8                  ksnc_rx_ready;    /* data ready to read */
         __u8                  ksnc_rx_scheduled;/* being progressed */
         __u8                  ksnc_rx_state;    /* what is being read */
+	ktime_t			ksnc_rx_ready_time; /* when queued for rx */
         int                   ksnc_rx_nob_left; /* # bytes to next hdr/body */
         int                   ksnc_rx_nob_wanted; /* bytes actually wanted */
 	int                   ksnc_rx_niov;     /* # kvec frags */
@@ -679,6 +727,19 @@ extern int ksocknal_tunables_init(void);
 extern void ksocknal_tunables_setup(struct lnet_ni *ni);
 
 extern void ksocknal_lib_csum_tx(struct ksock_tx *tx);
+#if SOCKNAL_ZC_LOCAL
+extern bool ksocknal_lib_zc_start(struct ksock_tx *tx);
+extern void ksocknal_lib_zc_put(struct ksock_tx *tx);
+#else
+static inline bool ksocknal_lib_zc_start(struct ksock_tx *tx)
+{
+	return false;
+}
+
+static inline void ksocknal_lib_zc_put(struct ksock_tx *tx)
+{
+}
+#endif
 
 extern int ksocknal_lib_memory_pressure(struct ksock_conn *conn);
 
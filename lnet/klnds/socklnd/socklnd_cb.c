@@ -48,6 +48,7 @@ ksocknal_alloc_tx(int type, int size)
 	tx->tx_zc_aborted = 0;
 	tx->tx_zc_capable = 0;
 	tx->tx_zc_checked = 0;
+	tx->tx_zc_local = 0;
 	tx->tx_hstatus = LNET_MSG_STATUS_OK;
 	tx->tx_desc_size  = size;
 
@@ -376,6 +377,13 @@ ksocknal_receive(struct ksock_conn *conn, struct page **rx_scratch_pgs,
 		}
 	}
 
+#if SOCKNAL_NAPI_POLL
+	/* remember the NAPI context for busy polling while ksnc_sock is
+	 * still pinned by our connsock ref
+	 */
+	WRITE_ONCE(conn->ksnc_scheduler->kss_napi_id,
+		   READ_ONCE(conn->ksnc_sock->sk->sk_napi_id));
+#endif
 	ksocknal_connsock_decref(conn);
 	RETURN(rc);
 }
@@ -467,6 +475,10 @@ ksocknal_check_zc_req(struct ksock_tx *tx)
             !conn->ksnc_zc_capable)
                 return;
 
+	/* no ZC-ACK needed if the socket tells when it is done with it */
+	if (ksocknal_lib_zc_start(tx))
+		return;
+
         /* assign cookie and queue tx to pending list, it will be released when
          * a matching ack is received. See ksocknal_handle_zcack() */
 
@@ -500,6 +512,11 @@ ksocknal_uncheck_zc_req(struct ksock_tx *tx)
 
 	tx->tx_zc_checked = 0;
 
+	if (tx->tx_zc_local) {
+		ksocknal_lib_zc_put(tx);
+		return;
+	}
+
 	spin_lock(&peer_ni->ksnp_lock);
 
 	if (tx->tx_msg.ksm_zc_cookies[0] == 0) {
@@ -540,6 +557,9 @@ ksocknal_process_transmit(struct ksock_conn *conn, struct ksock_tx *tx,
 		/* Sent everything OK */
 		LASSERT(rc == 0);
 
+		if (tx->tx_zc_local)
+			ksocknal_lib_zc_put(tx);
+
 		return 0;
 	}
 
@@ -1423,6 +1443,78 @@ ksocknal_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
 	return 0;
 }
 
+static void
+ksocknal_sched_rx_latency(struct ksock_conn *conn)
+{
+	s64 usecs = ktime_us_delta(ktime_get(), conn->ksnc_rx_ready_time);
+	int bucket = min_t(int, fls64(max_t(s64, usecs, 0)),
+			   KSOCK_LAT_BUCKETS - 1);
+
+	this_cpu_inc(ksocknal_rx_lat.ksl_hist[bucket]);
+	conn->ksnc_rx_ready_time = 0;
+}
+
+/* lockless, for busy polling; the caller rechecks under kss_lock */
+static bool
+ksocknal_sched_has_work(struct ksock_sched *sched)
+{
+	return !list_empty(&sched->kss_rx_conns) ||
+	       !list_empty(&sched->kss_tx_conns) ||
+	       !llist_empty(&sched->kss_zc_done_txs) ||
+	       ksocknal_data.ksnd_shuttingdown;
+}
+
+struct ksock_sched_poll {
+	struct ksock_sched	*ksp_sched;
+	ktime_t			 ksp_end;
+};
+
+static bool
+ksocknal_sched_poll_end(void *arg, unsigned long start)
+{
+	struct ksock_sched_poll *poll = arg;
+
+	return ksocknal_sched_has_work(poll->ksp_sched) || need_resched() ||
+	       ktime_after(ktime_get(), poll->ksp_end);
+}
+
+/* Spin for up to busy_poll usecs before going to sleep, so new data is
+ * picked up without waiting for a wakeup.  Drive the NAPI context of the
+ * last receive meanwhile, so that data does not wait for an interrupt
+ * either.  Returns true if there is something to do.
+ */
+static bool
+ksocknal_sched_busy_poll(struct ksock_sched *sched)
+{
+	unsigned int usecs = READ_ONCE(*ksocknal_tunables.ksnd_busy_poll);
+	int cpt = READ_ONCE(*ksocknal_tunables.ksnd_busy_poll_cpt);
+#if SOCKNAL_NAPI_POLL
+	unsigned int napi_id = READ_ONCE(sched->kss_napi_id);
+#endif
+	struct ksock_sched_poll poll = { .ksp_sched = sched };
+
+	if (usecs == 0 || (cpt >= 0 && cpt != sched->kss_cpt))
+		return false;
+
+	poll.ksp_end = ktime_add_us(ktime_get(), usecs);
+
+#if SOCKNAL_NAPI_POLL
+	if (napi_id >= MIN_NAPI_ID)
+		napi_busy_loop(napi_id, ksocknal_sched_poll_end, &poll,
+			       false, BUSY_POLL_BUDGET);
+#endif
+	while (!ksocknal_sched_poll_end(&poll, 0))
+		cpu_relax();
+
+	if (ksocknal_sched_has_work(sched)) {
+		this_cpu_inc(ksocknal_rx_lat.ksl_poll_hits);
+		return true;
+	}
+
+	this_cpu_inc(ksocknal_rx_lat.ksl_poll_misses);
+	return false;
+}
+
 static inline int
 ksocknal_sched_cansleep(struct ksock_sched *sched)
 {
@@ -1432,7 +1524,8 @@ ksocknal_sched_cansleep(struct ksock_sched *sched)
 
 	rc = (!ksocknal_data.ksnd_shuttingdown &&
 	      list_empty(&sched->kss_rx_conns) &&
-	      list_empty(&sched->kss_tx_conns));
+	      list_empty(&sched->kss_tx_conns) &&
+	      llist_empty(&sched->kss_zc_done_txs));
 
 	spin_unlock_bh(&sched->kss_lock);
 	return rc;
@@ -1485,6 +1578,9 @@ int ksocknal_scheduler(void *arg)
 			LASSERT(conn->ksnc_rx_scheduled);
 			LASSERT(conn->ksnc_rx_ready);
 
+			if (conn->ksnc_rx_ready_time)
+				ksocknal_sched_rx_latency(conn);
+
 			/* clear rx_ready in case receive isn't complete.
 			 * Do it BEFORE we call process_recv, since
 			 * data_ready can set it any time after we release
@@ -1590,11 +1686,28 @@ int ksocknal_scheduler(void *arg)
 
 			did_something = true;
 		}
+
+		if (!llist_empty(&sched->kss_zc_done_txs)) {
+			struct llist_node *done;
+			struct ksock_tx *tmp;
+
+			done = llist_del_all(&sched->kss_zc_done_txs);
+			spin_unlock_bh(&sched->kss_lock);
+
+			/* the socket has finished with their payload */
+			llist_for_each_entry_safe(tx, tmp, done, tx_zc_done)
+				ksocknal_tx_decref(tx);
+
+			spin_lock_bh(&sched->kss_lock);
+			did_something = true;
+		}
+
 		if (!did_something ||	/* nothing to do */
 		    need_resched()) {	/* hogging CPU? */
 			spin_unlock_bh(&sched->kss_lock);
 
-			if (!did_something) {   /* wait for something to do */
+			if (!did_something &&	/* wait for something to do */
+			    !ksocknal_sched_busy_poll(sched)) {
 				rc = wait_event_interruptible_exclusive(
 					sched->kss_waitq,
 					!ksocknal_sched_cansleep(sched));
@@ -1632,6 +1745,7 @@ void ksocknal_read_callback(struct ksock_conn *conn)
 		list_add_tail(&conn->ksnc_rx_list,
 				  &sched->kss_rx_conns);
 		conn->ksnc_rx_scheduled = 1;
+		conn->ksnc_rx_ready_time = ktime_get();
 		/* extra ref for scheduler */
 		ksocknal_conn_addref(conn);
 
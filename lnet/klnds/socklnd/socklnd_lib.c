@@ -107,6 +107,99 @@ ksocknal_lib_sendpage(struct socket *sock, struct bio_vec *kiov, int msgflg)
 #endif
 }
 
+#if SOCKNAL_ZC_LOCAL
+/* Called by the stack when the last skb holding the payload pages of tx has
+ * been freed, maybe in softirq context, and by ksocknal_lib_zc_put().  The
+ * tx can't be finalized from here, it is released by its scheduler.
+ */
+static void
+ksocknal_lib_zc_complete(struct sk_buff *skb, struct ubuf_info *uarg,
+			 bool zerocopy_success)
+{
+	struct ksock_tx *tx = container_of(uarg, struct ksock_tx, tx_zc_uarg);
+	struct ksock_sched *sched = tx->tx_conn->ksnc_scheduler;
+
+	if (!refcount_dec_and_test(&uarg->refcnt))
+		return;
+
+	if (llist_add(&tx->tx_zc_done, &sched->kss_zc_done_txs))
+		wake_up(&sched->kss_waitq);
+}
+
+#ifdef HAVE_UBUF_INFO_OPS
+static const struct ubuf_info_ops ksocknal_lib_zc_ops = {
+	.complete	= ksocknal_lib_zc_complete,
+};
+#endif
+
+/* Send the payload of tx with MSG_ZEROCOPY, so the pages are released when
+ * the stack has finished with them rather than when the peer ZC-ACKs them.
+ * Returns false if tx has to use ZC-ACKs.
+ */
+bool
+ksocknal_lib_zc_start(struct ksock_tx *tx)
+{
+	struct ubuf_info *uarg = &tx->tx_zc_uarg;
+	int i;
+
+	if (!*ksocknal_tunables.ksnd_zc_msg_zerocopy)
+		return false;
+
+	/* the stack takes its own page references */
+	for (i = 0; i < tx->tx_nkiov; i++)
+		if (!sendpage_ok(tx->tx_kiov[i].bv_page))
+			return false;
+
+	memset(uarg, 0, sizeof(*uarg));
+#ifdef HAVE_UBUF_INFO_OPS
+	uarg->ops = &ksocknal_lib_zc_ops;
+#else
+	uarg->callback = ksocknal_lib_zc_complete;
+#endif
+	uarg->flags = SKBFL_ZEROCOPY_FRAG | SKBFL_DONT_ORPHAN;
+	/* sender's reference, dropped by ksocknal_lib_zc_put() */
+	refcount_set(&uarg->refcnt, 1);
+
+	/* released by the scheduler once uarg is complete */
+	ksocknal_tx_addref(tx);
+	tx->tx_zc_local = 1;
+
+	return true;
+}
+
+/* the payload of tx has been queued on the socket, or never will be */
+void
+ksocknal_lib_zc_put(struct ksock_tx *tx)
+{
+	LASSERT(tx->tx_zc_local);
+
+	tx->tx_zc_local = 0;
+	ksocknal_lib_zc_complete(NULL, &tx->tx_zc_uarg, true);
+}
+
+static int
+ksocknal_lib_send_zc(struct ksock_conn *conn, struct ksock_tx *tx)
+{
+	struct msghdr msg = {
+		.msg_flags	= MSG_DONTWAIT | MSG_ZEROCOPY,
+		.msg_ubuf	= &tx->tx_zc_uarg,
+	};
+	int nob;
+	int i;
+
+	for (nob = i = 0; i < tx->tx_nkiov; i++)
+		nob += tx->tx_kiov[i].bv_len;
+
+	if (!list_empty(&conn->ksnc_tx_queue) || nob < tx->tx_resid)
+		msg.msg_flags |= MSG_MORE;
+
+	iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, tx->tx_kiov, tx->tx_nkiov,
+		      nob);
+
+	return sock_sendmsg(conn->ksnc_sock, &msg);
+}
+#endif /* SOCKNAL_ZC_LOCAL */
+
 int
 ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
 		       struct kvec *scratchiov)
@@ -119,6 +212,12 @@ ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
 	/* Not NOOP message */
 	LASSERT(tx->tx_lnetmsg != NULL);
 
+#if SOCKNAL_ZC_LOCAL
+	/* all the fragments in one go, the socket holds on to the pages */
+	if (tx->tx_zc_local)
+		return ksocknal_lib_send_zc(conn, tx);
+#endif
+
 	/* NB we can't trust socket ops to either consume our iovs
 	 * or leave them alone. */
 	if (tx->tx_msg.ksm_zc_cookies[0] != 0) {
@@ -282,6 +381,54 @@ ksocknal_lib_kiov_vmap(struct bio_vec *kiov, int niov,
 	return addr;
 }
 
+static void
+ksocknal_lib_csum_rx_kiov(struct ksock_conn *conn, struct bio_vec *kiov,
+			  unsigned int niov, int nob)
+{
+	unsigned int i;
+	int fragnob;
+	void *base;
+
+	for (i = 0; nob > 0; i++, nob -= fragnob) {
+		LASSERT(i < niov);
+
+		base = kmap(kiov[i].bv_page) + kiov[i].bv_offset;
+		fragnob = min_t(int, kiov[i].bv_len, nob);
+
+		conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
+						   base, fragnob);
+
+		kunmap(kiov[i].bv_page);
+	}
+}
+
+#ifdef HAVE_ITER_DEST
+/* receive straight into the payload pages, none of them need mapping */
+static int
+ksocknal_lib_recv_bvec(struct ksock_conn *conn)
+{
+	struct bio_vec *kiov = conn->ksnc_rx_kiov;
+	unsigned int niov = conn->ksnc_rx_nkiov;
+	struct msghdr msg = { .msg_flags = 0 };
+	unsigned int i;
+	int nob;
+	int rc;
+
+	for (nob = i = 0; i < niov; i++)
+		nob += kiov[i].bv_len;
+
+	LASSERT(nob <= conn->ksnc_rx_nob_wanted);
+
+	iov_iter_bvec(&msg.msg_iter, ITER_DEST, kiov, niov, nob);
+	rc = sock_recvmsg(conn->ksnc_sock, &msg, MSG_DONTWAIT);
+
+	if (conn->ksnc_msg.ksm_csum != 0)
+		ksocknal_lib_csum_rx_kiov(conn, kiov, niov, rc);
+
+	return rc;
+}
+#endif
+
 int
 ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 		       struct kvec *scratchiov)
@@ -304,10 +451,7 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
         int          nob;
         int          i;
         int          rc;
-        void        *base;
         void        *addr;
-        int          sum;
-        int          fragnob;
 	int n;
 
         /* NB we can't trust socket ops to either consume our iovs
@@ -317,12 +461,16 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 		n = 1;
 
 	} else {
+#ifdef HAVE_ITER_DEST
+		return ksocknal_lib_recv_bvec(conn);
+#else
 		for (nob = i = 0; i < niov; i++) {
 			nob += scratchiov[i].iov_len = kiov[i].bv_len;
 			scratchiov[i].iov_base = kmap(kiov[i].bv_page) +
 						 kiov[i].bv_offset;
 		}
 		n = niov;
+#endif
 	}
 
 	LASSERT (nob <= conn->ksnc_rx_nob_wanted);
@@ -330,26 +478,13 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 	rc = kernel_recvmsg(conn->ksnc_sock, &msg, scratchiov, n, nob,
 			    MSG_DONTWAIT);
 
-	if (conn->ksnc_msg.ksm_csum != 0) {
-		for (i = 0, sum = rc; sum > 0; i++, sum -= fragnob) {
-			LASSERT(i < niov);
-
-			/* Dang! have to kmap again because I have nowhere to
-			 * stash the mapped address.  But by doing it while the
-			 * page is still mapped, the kernel just bumps the map
-			 * count and returns me the address it stashed.
-			 */
-			base = kmap(kiov[i].bv_page) + kiov[i].bv_offset;
-			fragnob = kiov[i].bv_len;
-			if (fragnob > sum)
-				fragnob = sum;
-
-			conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
-							   base, fragnob);
-
-			kunmap(kiov[i].bv_page);
-		}
-	}
+	/* Dang! have to kmap again because I have nowhere to stash the
+	 * mapped address.  But by doing it while the page is still mapped,
+	 * the kernel just bumps the map count and returns me the address it
+	 * stashed.
+	 */
+	if (conn->ksnc_msg.ksm_csum != 0)
+		ksocknal_lib_csum_rx_kiov(conn, kiov, niov, rc);
 
 	if (addr != NULL) {
 		ksocknal_lib_kiov_vunmap(addr);
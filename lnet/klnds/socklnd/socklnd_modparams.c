@@ -139,6 +139,40 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+#if SOCKNAL_ZC_LOCAL
+static int zc_msg_zerocopy = 1;
+module_param(zc_msg_zerocopy, int, 0644);
+MODULE_PARM_DESC(zc_msg_zerocopy, "use MSG_ZEROCOPY completions instead of ZC-ACKs");
+#endif
+
+static unsigned int busy_poll;
+module_param(busy_poll, uint, 0644);
+MODULE_PARM_DESC(busy_poll, "usecs to busy poll before sleeping, 0 to disable");
+
+static int busy_poll_cpt = -1;
+module_param(busy_poll_cpt, int, 0644);
+MODULE_PARM_DESC(busy_poll_cpt, "CPT whose schedulers busy poll, -1 for all");
+
+DEFINE_PER_CPU(struct ksock_rx_lat, ksocknal_rx_lat);
+
+static int rx_latency;
+static int param_get_rx_latency(char *buf, cfs_kernel_param_arg_t *kp);
+static int param_set_rx_latency(const char *val, cfs_kernel_param_arg_t *kp);
+#ifdef HAVE_KERNEL_PARAM_OPS
+static const struct kernel_param_ops param_ops_rx_latency = {
+	.set = param_set_rx_latency,
+	.get = param_get_rx_latency,
+};
+
+#define param_check_rx_latency(name, p) \
+	__param_check(name, p, int)
+module_param(rx_latency, rx_latency, 0644);
+#else
+module_param_call(rx_latency, param_set_rx_latency, param_get_rx_latency,
+		  &rx_latency, 0644);
+#endif
+MODULE_PARM_DESC(rx_latency, "scheduler wakeup latency, write to reset");
+
 static unsigned int conns_per_peer = DEFAULT_CONNS_PER_PEER;
 module_param(conns_per_peer, uint, 0644);
 MODULE_PARM_DESC(conns_per_peer, "number of connections per peer");
@@ -213,6 +247,46 @@ static int param_set_tos(const char *val, cfs_kernel_param_arg_t *kp)
 	return 0;
 }
 
+static int param_get_rx_latency(char *buf, cfs_kernel_param_arg_t *kp)
+{
+	struct ksock_rx_lat sum = { { 0 } };
+	struct ksock_rx_lat *lat;
+	int len;
+	int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		lat = per_cpu_ptr(&ksocknal_rx_lat, cpu);
+		for (i = 0; i < KSOCK_LAT_BUCKETS; i++)
+			sum.ksl_hist[i] += READ_ONCE(lat->ksl_hist[i]);
+		sum.ksl_poll_hits += READ_ONCE(lat->ksl_poll_hits);
+		sum.ksl_poll_misses += READ_ONCE(lat->ksl_poll_misses);
+	}
+
+	len = scnprintf(buf, PAGE_SIZE,
+			"busy_poll_hits: %lu\nbusy_poll_misses: %lu\n",
+			sum.ksl_poll_hits, sum.ksl_poll_misses);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "%-10s %s\n",
+			 "usecs", "count");
+	/* bucket i counts [2^(i - 1), 2^i) usecs */
+	for (i = 0; i < KSOCK_LAT_BUCKETS; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%-10lu %lu\n",
+				 i ? 1UL << (i - 1) : 0, sum.ksl_hist[i]);
+
+	return len;
+}
+
+static int param_set_rx_latency(const char *val, cfs_kernel_param_arg_t *kp)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&ksocknal_rx_lat, cpu), 0,
+		       sizeof(struct ksock_rx_lat));
+
+	return 0;
+}
+
 #ifdef HAVE_ETHTOOL_LINK_SETTINGS
 static int ksocklnd_ni_get_eth_intf_speed(struct lnet_ni *ni)
 {
@@ -328,6 +402,11 @@ int ksocknal_tunables_init(void)
 	ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
 	ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
 	ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+#if SOCKNAL_ZC_LOCAL
+	ksocknal_tunables.ksnd_zc_msg_zerocopy    = &zc_msg_zerocopy;
+#endif
+	ksocknal_tunables.ksnd_busy_poll          = &busy_poll;
+	ksocknal_tunables.ksnd_busy_poll_cpt      = &busy_poll_cpt;
 	if (conns_per_peer > ((1 << SOCKNAL_CONN_COUNT_MAX_BITS)-1)) {
 		CWARN("socklnd conns_per_peer is capped at %u.\n",
 		      (1 << SOCKNAL_CONN_COUNT_MAX_BITS)-1);
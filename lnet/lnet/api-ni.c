@@ -247,6 +247,25 @@ module_param_call(lnet_response_tracking, response_tracking_set, param_get_int,
 MODULE_PARM_DESC(lnet_response_tracking,
 		 "(0|1|2|3) LNet Internal Only|GET Reply only|PUT ACK only|Full Tracking (default)");
 
+unsigned int lnet_select_policy = LNET_SELECT_POLICY_CREDITS;
+static int select_policy_set(const char *val, cfs_kernel_param_arg_t *kp);
+
+#ifdef HAVE_KERNEL_PARAM_OPS
+static struct kernel_param_ops param_ops_select_policy = {
+	.set = select_policy_set,
+	.get = param_get_int,
+};
+
+#define param_check_select_policy(name, p)  \
+	__param_check(name, p, int)
+module_param(lnet_select_policy, select_policy, 0644);
+#else
+module_param_call(lnet_select_policy, select_policy_set, param_get_int,
+		  &lnet_select_policy, 0644);
+#endif
+MODULE_PARM_DESC(lnet_select_policy,
+		 "(0|1) Multi-Rail selection on credits (default)|latency and queued bytes");
+
 int lock_prim_nid = 1;
 module_param(lock_prim_nid, int, 0444);
 MODULE_PARM_DESC(lock_prim_nid,
@@ -596,6 +615,29 @@ response_tracking_set(const char *val, cfs_kernel_param_arg_t *kp)
 	return 0;
 }
 
+static int
+select_policy_set(const char *val, cfs_kernel_param_arg_t *kp)
+{
+	int rc;
+	unsigned long new_value;
+
+	rc = kstrtoul(val, 0, &new_value);
+	if (rc) {
+		CERROR("Invalid value for 'lnet_select_policy'\n");
+		return -EINVAL;
+	}
+
+	if (new_value >= LNET_SELECT_POLICY_MAX) {
+		CWARN("Invalid value (%lu) for 'lnet_select_policy'\n",
+		      new_value);
+		return -EINVAL;
+	}
+
+	lnet_select_policy = new_value;
+
+	return 0;
+}
+
 static const char *
 lnet_get_routes(void)
 {
@@ -4660,12 +4702,8 @@ report_discover_err:
 		__u32 bulk_size = ioc_udsp->iou_hdr.ioc_len;
 
 		mutex_lock(&the_lnet.ln_api_mutex);
+		/* the new policy is applied as it is added */
 		rc = lnet_udsp_demarshal_add(arg, bulk_size);
-		if (!rc) {
-			rc = lnet_udsp_apply_policies(NULL, false);
-			CDEBUG(D_NET, "policy application returned %d\n", rc);
-			rc = 0;
-		}
 		mutex_unlock(&the_lnet.ln_api_mutex);
 
 		return rc;
@@ -5325,6 +5363,14 @@ static const struct ln_key_list local_ni_health_stats_list = {
 			.lkp_value	= "next_ping",
 			.lkp_data_type	= NLA_U64
 		},
+		[LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_RTT] = {
+			.lkp_value	= "rtt_us",
+			.lkp_data_type	= NLA_U32
+		},
+		[LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_QUEUED] = {
+			.lkp_value	= "queued_bytes",
+			.lkp_data_type	= NLA_U64
+		},
 	},
 };
 
@@ -5736,6 +5782,11 @@ skip_udsp:
 				nla_put_u64_64bit(msg, LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_NEXT_PING,
 						  ni->ni_next_ping,
 						  LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_PAD);
+				nla_put_u32(msg, LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_RTT,
+					    atomic_read(&ni->ni_rtt_us));
+				nla_put_u64_64bit(msg, LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_QUEUED,
+						  atomic64_read(&ni->ni_txqnob),
+						  LNET_NET_LOCAL_NI_HEALTH_STATS_ATTR_PAD);
 				nla_nest_end(msg, health_attr);
 				nla_nest_end(msg, health_stats);
 skip_msg_stats:
@@ -7423,6 +7474,14 @@ static const struct ln_key_list lnet_peer_ni_list_health = {
 			.lkp_value			= "next_ping",
 			.lkp_data_type			= NLA_S64,
 		},
+		[LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_RTT]	= {
+			.lkp_value			= "rtt_us",
+			.lkp_data_type			= NLA_U32,
+		},
+		[LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_QUEUED]	= {
+			.lkp_value			= "queued_bytes",
+			.lkp_data_type			= NLA_U64,
+		},
 	},
 };
 
@@ -7694,6 +7753,13 @@ skip_state:
 					    LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_NEXT_PING,
 					    lpni->lpni_next_ping,
 					    LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_PAD);
+				nla_put_u32(msg,
+					    LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_RTT,
+					    atomic_read(&lpni->lpni_rtt_us));
+				nla_put_u64_64bit(msg,
+						  LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_QUEUED,
+						  READ_ONCE(lpni->lpni_txqnob),
+						  LNET_PEER_NI_LIST_HEALTH_STATS_ATTR_PAD);
 				nla_nest_end(msg, health_stats);
 				nla_nest_end(msg, health_list);
 			}
@@ -716,6 +716,7 @@ lnet_ni_send(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT(nid_is_lo0(&ni->ni_nid) ||
 		(msg->msg_txcredit && msg->msg_peertxcredit));
 
+	msg->msg_tx_start = ktime_get();
 	rc = (ni->ni_net->net_lnd->lnd_send)(ni, priv, msg);
 	if (rc < 0) {
 		msg->msg_no_resend = true;
@@ -907,6 +908,7 @@ lnet_post_send_locked(struct lnet_msg *msg, int do_send)
 		msg->msg_txcredit = 1;
 		tq->tq_credits--;
 		atomic_dec(&ni->ni_tx_credits);
+		atomic64_add(msg->msg_len, &ni->ni_txqnob);
 
 		if (tq->tq_credits < tq->tq_credits_min)
 			tq->tq_credits_min = tq->tq_credits;
@@ -1061,6 +1063,7 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 
 		tq->tq_credits++;
 		atomic_inc(&ni->ni_tx_credits);
+		atomic64_sub(msg->msg_len, &ni->ni_txqnob);
 		if (tq->tq_credits <= 0) {
 			msg2 = list_first_entry(&tq->tq_delayed,
 						struct lnet_msg, msg_list);
@@ -1292,8 +1295,10 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, struct lnet_nid *dst_nid,
 	 * to the chosen net. If a peer_ni is preferred when using the
 	 * best_ni to communicate, we use that one. If there is no
 	 * preferred peer_ni, or there are multiple preferred peer_ni,
-	 * the available transmit credits are used. If the transmit
-	 * credits are equal, we round-robin over the peer_ni.
+	 * the available transmit credits are used, preceded by the
+	 * expected completion time with the latency selection policy.
+	 * If the transmit credits are equal, we round-robin over the
+	 * peer_ni.
 	 */
 	struct lnet_peer_ni *lpni = NULL;
 	int best_lpni_credits = (best_lpni) ? best_lpni->lpni_txcredits :
@@ -1352,6 +1357,18 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, struct lnet_nid *dst_nid,
 		else if (best_lpni_is_preferred && !lpni_is_preferred)
 			continue;
 
+		if (lnet_select_policy == LNET_SELECT_POLICY_LATENCY) {
+			u64 lpni_cost = lnet_lpni_select_cost(lpni);
+			u64 best_cost = lnet_lpni_select_cost(best_lpni);
+
+			CDEBUG(D_NET, "cost:[%llu, %llu]\n",
+			       lpni_cost, best_cost);
+			if (lpni_cost > best_cost)
+				continue;
+			else if (lpni_cost < best_cost)
+				goto select_lpni;
+		}
+
 		if (lpni->lpni_txcredits < best_lpni_credits)
 			/* We already have a peer that has more credits
 			 * available than this one. No need to consider
@@ -1677,7 +1694,9 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 
 		/*
 		 * Select on health, selection policy, direct dma prio,
-		 * shorter distance, available credits, then round-robin.
+		 * shorter distance, expected completion time with the
+		 * latency selection policy, available credits, then
+		 * round-robin.
 		 */
 		if (best_ni)
 			CDEBUG(D_NET, "compare ni %s [f:%s, c:%d, d:%d, s:%d, p:%u, g:%u, h:%d] with best_ni %s [f:%s, c:%d, d:%d, s:%d, p:%u, g:%u, h:%d]\n",
@@ -1718,6 +1737,17 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 		else if (distance < shortest_distance)
 			goto select_ni;
 
+		if (lnet_select_policy == LNET_SELECT_POLICY_LATENCY) {
+			u64 ni_cost = lnet_ni_select_cost(ni);
+			u64 best_cost = lnet_ni_select_cost(best_ni);
+
+			CDEBUG(D_NET, "cost:[%llu, %llu]\n", ni_cost, best_cost);
+			if (ni_cost > best_cost)
+				continue;
+			else if (ni_cost < best_cost)
+				goto select_ni;
+		}
+
 		if (ni_credits < best_credits)
 			continue;
 		else if (ni_credits > best_credits)
@@ -848,6 +848,14 @@ lnet_health_check(struct lnet_msg *msg)
 
 	switch (hstatus) {
 	case LNET_MSG_STATUS_OK:
+		/* sample the send latency for the latency selection policy */
+		if (msg->msg_tx_committed && !lo && msg->msg_tx_start) {
+			s64 rtt_us = ktime_us_delta(now, msg->msg_tx_start);
+
+			lnet_rtt_update(&ni->ni_rtt_us, rtt_us);
+			lnet_rtt_update(&lpni->lpni_rtt_us, rtt_us);
+		}
+
 		/*
 		 * increment the local ni health whether we successfully
 		 * received or sent a message on it.
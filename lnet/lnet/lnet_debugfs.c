@@ -13,6 +13,7 @@
 
 #include <libcfs/libcfs.h>
 #include <lnet/lib-lnet.h>
+#include <lnet/udsp.h>
 
 #define LNET_LOFFT_BITS		(sizeof(loff_t) * 8)
 /* NB: max allowed LNET_CPT_BITS is 8 on 64-bit system and 2 on 32-bit system
@@ -190,6 +191,25 @@ out_no_ctrs:
 	return rc;
 }
 
+static int proc_lnet_udsp_stats(struct ctl_table *table, int write,
+				void __user *buffer, size_t *lenp,
+				loff_t *ppos)
+{
+	char tmpstr[512]; /* 8 named s64 */
+	int len;
+
+	if (write) {
+		lnet_udsp_stats_reset();
+		return 0;
+	}
+
+	len = lnet_udsp_stats_print(tmpstr, sizeof(tmpstr));
+	if (*ppos >= len)
+		return 0;
+
+	return cfs_trace_copyout_string(buffer, *lenp, tmpstr + *ppos, "\n");
+}
+
 static int
 proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 		 size_t *lenp, loff_t *ppos)
@@ -927,6 +947,11 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_lnet_stats,
 	},
+	{
+		.procname	= "udsp_stats",
+		.mode		= 0644,
+		.proc_handler	= &proc_lnet_udsp_stats,
+	},
 	{
 		.procname	= "routes",
 		.mode		= 0444,
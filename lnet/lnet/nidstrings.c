@@ -1142,6 +1142,25 @@ cfs_match_nid_net(struct lnet_nid *nid, __u32 net_type,
 }
 EXPORT_SYMBOL(cfs_match_nid_net);
 
+/**
+ * Tell how the addresses of NIDs of type \a net_type are matched.
+ *
+ * \retval 1 if they are IPv4 addresses matched byte by byte
+ * \retval 0 if they are numbers matched as a whole
+ * \retval -ENOENT if \a net_type is unknown
+ */
+int
+cfs_net_type_ip_addr(__u32 net_type)
+{
+	struct netstrfns *nf = type2net_info(net_type);
+
+	if (!nf)
+		return -ENOENT;
+
+	return nf->nf_match_addr == cfs_ip_addr_match;
+}
+EXPORT_SYMBOL(cfs_net_type_ip_addr);
+
 static struct netstrfns *
 libcfs_lnd2netstrfns(__u32 lnd)
 {
@@ -104,6 +104,26 @@ enum udsp_apply {
 
 #define RULE_NOT_APPLICABLE -1
 
+/* peers examined between releases of the net lock when applying a rule */
+#define UDSP_PEERS_PER_LOCK	256
+
+static struct lnet_udsp_stats {
+	/* NID and net matches evaluated */
+	atomic64_t	lus_matches;
+	/* ... of which walked the expressions of an uncompiled rule */
+	atomic64_t	lus_slow_matches;
+	/* rules added or deleted, and applied to the peers */
+	atomic64_t	lus_applies;
+	/* peer NIs examined, and matched, when applying a rule */
+	atomic64_t	lus_lpni_scanned;
+	atomic64_t	lus_lpni_matched;
+	/* net lock releases while applying a rule */
+	atomic64_t	lus_lock_breaks;
+	/* total and longest time applying a rule */
+	atomic64_t	lus_apply_usecs;
+	atomic64_t	lus_apply_max_usecs;
+} lnet_udsp_stats;
+
 static inline bool
 lnet_udsp_is_net_rule(struct lnet_ud_nid_descr *match)
 {
@@ -195,6 +215,136 @@ lnet_udsp_criteria_present(struct lnet_ud_nid_descr *descr)
 	return (descr->ud_net_id.udn_net_type != 0);
 }
 
+static bool
+lnet_udsp_compile_expr(struct cfs_expr_list *el, unsigned long *bitmap)
+{
+	struct cfs_range_expr *re;
+	u32 i;
+
+	list_for_each_entry(re, &el->el_exprs, re_link) {
+		if (re->re_hi >= LNET_UD_MATCH_VALUES ||
+		    re->re_lo > re->re_hi || !re->re_stride)
+			return false;
+		for (i = re->re_lo; i <= re->re_hi; i += re->re_stride)
+			__set_bit(i, bitmap);
+	}
+
+	return true;
+}
+
+/*
+ * Compile the NID descriptor into bitmaps of the net numbers and address
+ * bytes it matches. The descriptor is left uncompiled, and matched on its
+ * expressions, if a value does not fit in the bitmaps.
+ */
+static void
+lnet_udsp_compile_descr(struct lnet_ud_nid_descr *descr)
+{
+	struct list_head *net_range = &descr->ud_net_id.udn_net_num_range;
+	struct lnet_ud_nid_match *um = &descr->ud_match;
+	struct cfs_expr_list *el;
+	int nexprs = 0;
+	int ip;
+
+	memset(um, 0, sizeof(*um));
+	if (!lnet_udsp_criteria_present(descr))
+		return;
+
+	ip = cfs_net_type_ip_addr(descr->ud_net_id.udn_net_type);
+	if (ip < 0)
+		return;
+
+	/* as cfs_match_net(), no net numbers only matches net number 0 */
+	if (list_empty(net_range))
+		__set_bit(0, um->um_net_num);
+	else if (!lnet_udsp_compile_expr(list_first_entry(net_range,
+							  struct cfs_expr_list,
+							  el_link),
+					 um->um_net_num))
+		return;
+
+	list_for_each_entry(el, &descr->ud_addr_range, el_link) {
+		if (nexprs == ARRAY_SIZE(um->um_addr) ||
+		    !lnet_udsp_compile_expr(el, um->um_addr[nexprs]))
+			return;
+		nexprs++;
+		/* numeric addresses are matched on the first expression */
+		if (!ip)
+			break;
+	}
+
+	/* IPv4 addresses never match without an expression per byte */
+	if (ip && nexprs && nexprs != ARRAY_SIZE(um->um_addr))
+		return;
+
+	um->um_addr_exprs = nexprs;
+	um->um_compiled = true;
+}
+
+static void
+lnet_udsp_compile(struct lnet_udsp *udsp)
+{
+	lnet_udsp_compile_descr(&udsp->udsp_src);
+	lnet_udsp_compile_descr(&udsp->udsp_dst);
+	lnet_udsp_compile_descr(&udsp->udsp_rte);
+}
+
+static inline bool
+lnet_udsp_match_net_compiled(struct lnet_ud_nid_descr *descr, __u32 net_id)
+{
+	__u32 net_num = LNET_NETNUM(net_id);
+
+	return LNET_NETTYP(net_id) == descr->ud_net_id.udn_net_type &&
+	       net_num < LNET_UD_MATCH_VALUES &&
+	       test_bit(net_num, descr->ud_match.um_net_num);
+}
+
+static bool
+lnet_udsp_match_net(struct lnet_ud_nid_descr *descr, __u32 net_id)
+{
+	atomic64_inc(&lnet_udsp_stats.lus_matches);
+	if (!descr->ud_match.um_compiled) {
+		atomic64_inc(&lnet_udsp_stats.lus_slow_matches);
+		return cfs_match_net(net_id, descr->ud_net_id.udn_net_type,
+				     &descr->ud_net_id.udn_net_num_range);
+	}
+
+	return lnet_udsp_match_net_compiled(descr, net_id);
+}
+
+static bool
+lnet_udsp_match_nid(struct lnet_ud_nid_descr *descr, struct lnet_nid *nid)
+{
+	struct lnet_ud_nid_match *um = &descr->ud_match;
+	__u32 addr;
+	int i;
+
+	atomic64_inc(&lnet_udsp_stats.lus_matches);
+	/* the bitmaps only hold 4 byte addresses */
+	if (!um->um_compiled || !nid_is_nid4(nid)) {
+		atomic64_inc(&lnet_udsp_stats.lus_slow_matches);
+		return cfs_match_nid_net(nid, descr->ud_net_id.udn_net_type,
+					 &descr->ud_net_id.udn_net_num_range,
+					 &descr->ud_addr_range);
+	}
+
+	if (!um->um_addr_exprs ||
+	    !lnet_udsp_match_net_compiled(descr, LNET_NID_NET(nid)))
+		return false;
+
+	addr = LNET_NIDADDR(lnet_nid_to_nid4(nid));
+	if (um->um_addr_exprs == 1)
+		return addr < LNET_UD_MATCH_VALUES &&
+		       test_bit(addr, um->um_addr[0]);
+
+	for (i = 0; i < um->um_addr_exprs; i++) {
+		if (!test_bit((addr >> (24 - 8 * i)) & 0xff, um->um_addr[i]))
+			return false;
+	}
+
+	return true;
+}
+
 static int
 lnet_udsp_apply_rule_on_ni(struct udsp_info *udi)
 {
@@ -203,11 +353,7 @@ lnet_udsp_apply_rule_on_ni(struct udsp_info *udi)
 	struct lnet_ud_nid_descr *ni_match = udi->udi_match;
 	__u32 priority = (udi->udi_revert) ? -1 : udi->udi_priority;
 
-	rc = cfs_match_nid_net(
-		&ni->ni_nid,
-		ni_match->ud_net_id.udn_net_type,
-		&ni_match->ud_net_id.udn_net_num_range,
-		&ni_match->ud_addr_range);
+	rc = lnet_udsp_match_nid(ni_match, &ni->ni_nid);
 	if (!rc)
 		return 0;
 
@@ -248,22 +394,14 @@ lnet_udsp_apply_rte_list_on_net(struct lnet_net *net,
 					if (!lnet_get_net_locked(lpni->lpni_peer_net->lpn_net_id))
 						continue;
 					gw_nid = &lpni->lpni_nid;
-					rc = cfs_match_nid_net(
-						gw_nid,
-						rte_action->ud_net_id.udn_net_type,
-						&rte_action->ud_net_id.udn_net_num_range,
-						&rte_action->ud_addr_range);
+					rc = lnet_udsp_match_nid(rte_action, gw_nid);
 					if (rc)
 						break;
 				}
 				/* match gw primary nid on a remote network */
 				if (!rc) {
 					gw_nid = gw_prim_nid;
-					rc = cfs_match_nid_net(
-						gw_nid,
-						rte_action->ud_net_id.udn_net_type,
-						&rte_action->ud_net_id.udn_net_num_range,
-						&rte_action->ud_addr_range);
+					rc = lnet_udsp_match_nid(rte_action, gw_nid);
 				}
 				if (!rc)
 					continue;
@@ -309,9 +447,7 @@ lnet_udsp_apply_rte_rule_on_nets(struct udsp_info *udi)
 		if (LNET_NETTYP(net->net_id) != match->ud_net_id.udn_net_type)
 			continue;
 
-		rc = cfs_match_net(net->net_id,
-				   match->ud_net_id.udn_net_type,
-				   &match->ud_net_id.udn_net_num_range);
+		rc = lnet_udsp_match_net(match, net->net_id);
 		if (!rc)
 			continue;
 
@@ -334,9 +470,7 @@ lnet_udsp_apply_rte_rule_on_net(struct udsp_info *udi)
 	struct lnet_ud_nid_descr *match = udi->udi_match;
 	struct lnet_ud_nid_descr *rte_action = udi->udi_action;
 
-	rc = cfs_match_net(net->net_id,
-			   match->ud_net_id.udn_net_type,
-			   &match->ud_net_id.udn_net_num_range);
+	rc = lnet_udsp_match_net(match, net->net_id);
 	if (!rc)
 		return 0;
 
@@ -359,9 +493,7 @@ lnet_udsp_apply_prio_rule_on_net(struct udsp_info *udi)
 	if (!lnet_udsp_is_net_rule(match))
 		return RULE_NOT_APPLICABLE;
 
-	rc = cfs_match_net(net->net_id,
-			   match->ud_net_id.udn_net_type,
-			   &match->ud_net_id.udn_net_num_range);
+	rc = lnet_udsp_match_net(match, net->net_id);
 	if (!rc)
 		return 0;
 
@@ -419,11 +551,7 @@ lnet_udsp_apply_rte_list_on_lpni(struct lnet_peer_ni *lpni,
 		list_for_each_entry(rnet, rn_list, lrn_list) {
 			list_for_each_entry(route, &rnet->lrn_routes, lr_list) {
 				gw_nid = &route->lr_gateway->lp_primary_nid;
-				rc = cfs_match_nid_net(
-					gw_nid,
-					rte_action->ud_net_id.udn_net_type,
-					&rte_action->ud_net_id.udn_net_num_range,
-					&rte_action->ud_addr_range);
+				rc = lnet_udsp_match_nid(rte_action, gw_nid);
 				if (!rc)
 					continue;
 				lnet_net_unlock(LNET_LOCK_EX);
@@ -472,11 +600,7 @@ lnet_udsp_apply_ni_list(struct lnet_peer_ni *lpni,
 		if (LNET_NETTYP(net->net_id) != ni_action->ud_net_id.udn_net_type)
 			continue;
 		list_for_each_entry(ni, &net->net_ni_list, ni_netlist) {
-			rc = cfs_match_nid_net(
-				&ni->ni_nid,
-				ni_action->ud_net_id.udn_net_type,
-				&ni_action->ud_net_id.udn_net_num_range,
-				&ni_action->ud_addr_range);
+			rc = lnet_udsp_match_nid(ni_action, &ni->ni_nid);
 			if (!rc)
 				continue;
 			lnet_net_unlock(LNET_LOCK_EX);
@@ -521,19 +645,13 @@ lnet_udsp_apply_rule_on_lpni(struct udsp_info *udi)
 	bool local = udi->udi_local;
 	enum lnet_udsp_action_type type = udi->udi_type;
 
-	rc = cfs_match_nid_net(
-		&lpni->lpni_nid,
-		lp_match->ud_net_id.udn_net_type,
-		&lp_match->ud_net_id.udn_net_num_range,
-		&lp_match->ud_addr_range);
+	rc = lnet_udsp_match_nid(lp_match, &lpni->lpni_nid);
 
 	/* check if looking for a net match */
 	if (!rc &&
 	    (!udi->udi_lpn ||
-	     lnet_get_list_len(&lp_match->ud_addr_range) ||
-	     !cfs_match_net(udi->udi_lpn->lpn_net_id,
-			   lp_match->ud_net_id.udn_net_type,
-			   &lp_match->ud_net_id.udn_net_num_range))) {
+	     !lnet_udsp_is_net_rule(lp_match) ||
+	     !lnet_udsp_match_net(lp_match, udi->udi_lpn->lpn_net_id))) {
 		return 0;
 	}
 
@@ -567,9 +685,7 @@ lnet_udsp_apply_rule_on_lpn(struct udsp_info *udi)
 	    !lnet_udsp_is_net_rule(match))
 		return RULE_NOT_APPLICABLE;
 
-	rc = cfs_match_net(lpn->lpn_net_id,
-			match->ud_net_id.udn_net_type,
-			&match->ud_net_id.udn_net_num_range);
+	rc = lnet_udsp_match_net(match, lpn->lpn_net_id);
 	if (!rc)
 		return 0;
 
@@ -855,6 +971,211 @@ lnet_udsp_apply_policies(struct lnet_udsp *udsp, bool revert)
 	return rc;
 }
 
+static int
+lnet_udsp_reapply_rule_on_lpn(struct udsp_info *udi, struct lnet_peer_net *lpn)
+{
+	struct lnet_ud_nid_descr *lp_match = udi->udi_match;
+	bool net_match = lnet_udsp_is_net_rule(lp_match) &&
+			 lnet_udsp_match_net(lp_match, lpn->lpn_net_id);
+	struct lnet_peer_ni *lpni;
+	int last_failure = 0;
+	int rc;
+
+	udi->udi_lpn = lpn;
+
+	/* net priority rules apply to the peer net only */
+	if (lnet_udsp_is_net_rule(lp_match) &&
+	    udi->udi_type != EN_LNET_UDSP_ACTION_PREFERRED_LIST) {
+		if (!net_match)
+			return 0;
+		if (udi->udi_revert)
+			lnet_udsp_apply_rule_on_lpn(udi);
+		return lnet_udsp_apply_policies_on_lpn(lpn);
+	}
+
+	list_for_each_entry(lpni, &lpn->lpn_peer_nis, lpni_peer_nis) {
+		atomic64_inc(&lnet_udsp_stats.lus_lpni_scanned);
+		if (!net_match &&
+		    !lnet_udsp_match_nid(lp_match, &lpni->lpni_nid))
+			continue;
+
+		atomic64_inc(&lnet_udsp_stats.lus_lpni_matched);
+		if (udi->udi_revert) {
+			udi->udi_lpni = lpni;
+			lnet_udsp_apply_rule_on_lpni(udi);
+		}
+		rc = lnet_udsp_apply_policies_on_lpni(lpni);
+		if (rc)
+			last_failure = rc;
+	}
+
+	return last_failure;
+}
+
+/*
+ * Re-apply all the policies on the peers matched by the rule in \a udi,
+ * after reverting it if it is deleted. The net lock is released every
+ * UDSP_PEERS_PER_LOCK peers so a rule matching many peers does not stall
+ * the traffic for long.
+ */
+static int
+lnet_udsp_reapply_rule_on_lpnis(struct udsp_info *udi)
+{
+	int lncpt = cfs_percpt_number(the_lnet.ln_peer_tables);
+	struct lnet_ud_nid_descr *lp_match = udi->udi_match;
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_net *lpn;
+	struct lnet_peer *lp;
+	unsigned int scanned = 0;
+	int last_failure = 0;
+	bool on_list;
+	int cpt;
+	int rc;
+
+	for (cpt = 0; cpt < lncpt; cpt++) {
+		ptable = the_lnet.ln_peer_tables[cpt];
+restart:
+		list_for_each_entry(lp, &ptable->pt_peer_list, lp_peer_list) {
+			list_for_each_entry(lpn, &lp->lp_peer_nets,
+					    lpn_peer_nets) {
+				if (LNET_NETTYP(lpn->lpn_net_id) !=
+				    lp_match->ud_net_id.udn_net_type)
+					continue;
+
+				rc = lnet_udsp_reapply_rule_on_lpn(udi, lpn);
+				if (rc)
+					last_failure = rc;
+			}
+
+			if (++scanned % UDSP_PEERS_PER_LOCK)
+				continue;
+
+			lnet_peer_addref_locked(lp);
+			lnet_net_unlock(LNET_LOCK_EX);
+			cond_resched();
+			lnet_net_lock(LNET_LOCK_EX);
+			atomic64_inc(&lnet_udsp_stats.lus_lock_breaks);
+
+			/* peers are only freed once off the table */
+			on_list = !list_empty(&lp->lp_peer_list);
+			lnet_peer_decref_locked(lp);
+			/* start over, re-applying the policies is idempotent */
+			if (!on_list)
+				goto restart;
+		}
+	}
+
+	return last_failure;
+}
+
+/* local NIs and nets are few, re-apply all the policies on all of them */
+static int
+lnet_udsp_reapply_rule_on_nets(struct udsp_info *udi)
+{
+	struct lnet_net *net;
+	struct lnet_ni *ni;
+	int last_failure = 0;
+	int rc;
+
+	if (udi->udi_revert) {
+		if (udi->udi_type == EN_LNET_UDSP_ACTION_PREFERRED_LIST)
+			lnet_udsp_apply_rte_rule_on_nets(udi);
+		else
+			lnet_udsp_apply_rule_on_nis(udi);
+	}
+
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		rc = lnet_udsp_apply_policies_on_net(net);
+		if (rc)
+			last_failure = rc;
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist) {
+			rc = lnet_udsp_apply_policies_on_ni(ni);
+			if (rc)
+				last_failure = rc;
+		}
+	}
+
+	return last_failure;
+}
+
+/*
+ * Apply a rule which was added, changed or deleted on the constructs it
+ * matches only. These get all the policies re-applied in order, the outcome
+ * is the same as when re-applying all the policies across the system.
+ */
+static int
+lnet_udsp_apply_change(struct lnet_udsp *udsp, bool deleted)
+{
+	udsp_apply_rule cbs[UDSP_APPLY_MAX_ENUM] = {NULL};
+	struct udsp_info udi;
+	ktime_t start = ktime_get();
+	s64 usecs;
+	int rc;
+
+	memset(&udi, 0, sizeof(udi));
+
+	cbs[UDSP_APPLY_ON_PEERS] = lnet_udsp_reapply_rule_on_lpnis;
+	cbs[UDSP_APPLY_PRIO_ON_NIS] = lnet_udsp_reapply_rule_on_nets;
+	cbs[UDSP_APPLY_RTE_ON_NETS] = lnet_udsp_reapply_rule_on_nets;
+
+	udi.udi_revert = deleted;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	rc = lnet_udsp_apply_single_policy(udsp, &udi, cbs);
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	/* serialized by the api_mutex */
+	usecs = ktime_us_delta(ktime_get(), start);
+	atomic64_inc(&lnet_udsp_stats.lus_applies);
+	atomic64_add(usecs, &lnet_udsp_stats.lus_apply_usecs);
+	if (usecs > atomic64_read(&lnet_udsp_stats.lus_apply_max_usecs))
+		atomic64_set(&lnet_udsp_stats.lus_apply_max_usecs, usecs);
+
+	CDEBUG(D_NET, "udsp %p %s in %lld usecs: rc = %d\n", udsp,
+	       deleted ? "reverted" : "applied", usecs, rc);
+
+	return rc;
+}
+
+int
+lnet_udsp_stats_print(char *buf, int len)
+{
+	struct lnet_udsp_stats *st = &lnet_udsp_stats;
+
+	return scnprintf(buf, len,
+			 "matches: %lld\n"
+			 "slow_matches: %lld\n"
+			 "applies: %lld\n"
+			 "lpni_scanned: %lld\n"
+			 "lpni_matched: %lld\n"
+			 "lock_breaks: %lld\n"
+			 "apply_usecs: %lld\n"
+			 "apply_max_usecs: %lld",
+			 (s64)atomic64_read(&st->lus_matches),
+			 (s64)atomic64_read(&st->lus_slow_matches),
+			 (s64)atomic64_read(&st->lus_applies),
+			 (s64)atomic64_read(&st->lus_lpni_scanned),
+			 (s64)atomic64_read(&st->lus_lpni_matched),
+			 (s64)atomic64_read(&st->lus_lock_breaks),
+			 (s64)atomic64_read(&st->lus_apply_usecs),
+			 (s64)atomic64_read(&st->lus_apply_max_usecs));
+}
+
+void
+lnet_udsp_stats_reset(void)
+{
+	struct lnet_udsp_stats *st = &lnet_udsp_stats;
+
+	atomic64_set(&st->lus_matches, 0);
+	atomic64_set(&st->lus_slow_matches, 0);
+	atomic64_set(&st->lus_applies, 0);
+	atomic64_set(&st->lus_lpni_scanned, 0);
+	atomic64_set(&st->lus_lpni_matched, 0);
+	atomic64_set(&st->lus_lock_breaks, 0);
+	atomic64_set(&st->lus_apply_usecs, 0);
+	atomic64_set(&st->lus_apply_max_usecs, 0);
+}
+
 struct lnet_udsp *
 lnet_udsp_get_policy(int idx)
 {
@@ -909,6 +1230,8 @@ lnet_udsp_add_policy(struct lnet_udsp *new, int idx)
 				       udsp,
 				       udsp->udsp_idx,
 				       udsp->udsp_action.udsp_priority);
+				lnet_udsp_free(new);
+				lnet_udsp_apply_change(udsp, false);
 				return 0;
 			}
 			return -EALREADY;
@@ -938,6 +1261,8 @@ lnet_udsp_add_policy(struct lnet_udsp *new, int idx)
 	list_for_each_entry(udsp, &the_lnet.ln_udsp_list, udsp_on_list)
 		CDEBUG(D_NET, "udsp %p:%d\n", udsp, udsp->udsp_idx);
 
+	lnet_udsp_apply_change(new, false);
+
 	return 0;
 }
 
@@ -963,7 +1288,7 @@ lnet_udsp_del_policy(int idx)
 			udsp->udsp_idx--;
 		if (udsp->udsp_idx == idx && !removed) {
 			list_del_init(&udsp->udsp_on_list);
-			lnet_udsp_apply_policies(udsp, true);
+			lnet_udsp_apply_change(udsp, true);
 			lnet_udsp_free(udsp);
 			removed = true;
 		}
@@ -1554,6 +1879,8 @@ lnet_udsp_demarshal_add(void *bulk, __u32 bulk_size)
 	if (rc < 0)
 		goto free_udsp;
 
+	lnet_udsp_compile(udsp);
+
 	return lnet_udsp_add_policy(udsp, idx);
 
 free_udsp:
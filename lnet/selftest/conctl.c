@@ -497,7 +497,7 @@ lst_batch_info_ioctl(struct lstio_batch_info_args *args)
 }
 
 static int
-lst_stat_query_ioctl(struct lstio_stat_args *args)
+lst_stat_query_ioctl(struct lstio_stat_args *args, __u32 type)
 {
 	int rc;
 	char *name = NULL;
@@ -514,7 +514,7 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 			return -EINVAL;
 
 		rc = lstcon_nodes_stat(args->lstio_sta_count,
-				       args->lstio_sta_idsp,
+				       args->lstio_sta_idsp, type,
 				       args->lstio_sta_timeout,
 				       args->lstio_sta_resultp);
 	} else if (args->lstio_sta_namep != NULL) {
@@ -529,7 +529,8 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 		rc = copy_from_user(name, args->lstio_sta_namep,
 				    args->lstio_sta_nmlen);
 		if (rc == 0)
-			rc = lstcon_group_stat(name, args->lstio_sta_timeout,
+			rc = lstcon_group_stat(name, type,
+					       args->lstio_sta_timeout,
 					       args->lstio_sta_resultp);
 		else
 			rc = -EFAULT;
@@ -543,6 +544,20 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 	return rc;
 }
 
+static int
+lst_lat_query_ioctl(struct lstio_lat_args *args, int len)
+{
+	if (len < sizeof(*args))
+		return -EINVAL;
+
+	if (args->lstio_lat_type != LST_TEST_BULK &&
+	    args->lstio_lat_type != LST_TEST_PING)
+		return -EINVAL;
+
+	return lst_stat_query_ioctl(&args->lstio_lat_stat,
+				    args->lstio_lat_type);
+}
+
 static int lst_test_add_ioctl(struct lstio_test_args *args)
 {
 	char *batch_name;
@@ -742,7 +757,11 @@ lstcon_ioctl_entry(struct notifier_block *nb,
 		rc = lst_test_add_ioctl((struct lstio_test_args *)buf);
 		break;
 	case LSTIO_STAT_QUERY:
-		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf);
+		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf, 0);
+		break;
+	case LSTIO_LAT_QUERY:
+		rc = lst_lat_query_ioctl((struct lstio_lat_args *)buf,
+					 data->ioc_plen1);
 		break;
 	default:
 		rc = -EINVAL;
@@ -361,6 +361,7 @@ lstcon_rpc_get_reply(struct lstcon_rpc *crpc, struct srpc_msg **msgpp)
 	struct lstcon_node *nd = crpc->crp_node;
 	struct srpc_client_rpc *rpc = crpc->crp_rpc;
 	struct srpc_generic_reply *rep;
+	struct srpc_msg *reqst;
 
 	LASSERT(nd != NULL && rpc != NULL);
 	LASSERT(crpc->crp_stamp_ns != 0);
@@ -370,11 +371,17 @@ lstcon_rpc_get_reply(struct lstcon_rpc *crpc, struct srpc_msg **msgpp)
                 return crpc->crp_status;
         }
 
-        *msgpp = &rpc->crpc_replymsg;
-        if (!crpc->crp_unpacked) {
-                sfw_unpack_message(*msgpp);
-                crpc->crp_unpacked = 1;
-        }
+	*msgpp = &rpc->crpc_replymsg;
+	if (!crpc->crp_unpacked) {
+		reqst = &rpc->crpc_reqstmsg;
+		/* the layout of stat replies depends on the request */
+		if ((*msgpp)->msg_type == SRPC_MSG_STAT_REPLY)
+			sfw_unpack_stat_reply(*msgpp,
+					reqst->msg_body.stat_reqst.str_type);
+		else
+			sfw_unpack_message(*msgpp);
+		crpc->crp_unpacked = 1;
+	}
 
 	if (ktime_to_ns(nd->nd_stamp) > crpc->crp_stamp_ns)
 		return 0;
@@ -663,7 +670,7 @@ lstcon_batrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 }
 
 int
-lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
+lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats, __u32 type,
 		    struct lstcon_rpc **crpc)
 {
 	struct srpc_stat_reqst *srq;
@@ -679,7 +686,7 @@ lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
 	srq->str_sid.ses_stamp = console_session.ses_id.ses_stamp;
 	srq->str_sid.ses_nid =
 		lnet_nid_to_nid4(&console_session.ses_id.ses_nid);
-        srq->str_type = 0; /* XXX remove it */
+	srq->str_type = type;
 
         return 0;
 }
@@ -798,6 +805,20 @@ lstcon_bulkrpc_v1_prep(struct lst_test_bulk_param *param, bool is_client,
 	return 0;
 }
 
+static int
+lstcon_streamrpc_prep(struct lst_test_stream_param *param,
+		      struct srpc_test_reqst *req)
+{
+	struct test_stream_req *srq = &req->tsr_u.stream;
+
+	srq->stm_min_len  = param->stm_min_size;
+	srq->stm_max_len  = param->stm_max_size;
+	srq->stm_read_pct = param->stm_read_pct;
+	srq->stm_cksum	  = param->stm_cksum;
+
+	return 0;
+}
+
 int
 lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 		    struct lstcon_test *test, struct lstcon_rpc **crpc)
@@ -905,6 +926,11 @@ lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 		}
 
                 break;
+	case LST_TEST_STREAM:
+		trq->tsr_service = SRPC_SERVICE_STREAM;
+		rc = lstcon_streamrpc_prep((struct lst_test_stream_param *)
+					   &test->tes_param[0], trq);
+		break;
         default:
                 LBUG();
                 break;
@@ -1139,7 +1165,8 @@ lstcon_rpc_trans_ndlist(struct list_head *ndlist,
 						&rpc);
 			break;
 		case LST_TRANS_STATQRY:
-			rc = lstcon_statrpc_prep(nd, feats, &rpc);
+			rc = lstcon_statrpc_prep(nd, feats,
+						 arg ? *(__u32 *)arg : 0, &rpc);
                         break;
                 default:
                         rc = -EINVAL;
@@ -97,7 +97,7 @@ int  lstcon_batrpc_prep(struct lstcon_node *nd, int transop, unsigned version,
 int  lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned version,
 			 struct lstcon_test *test, struct lstcon_rpc **crpc);
 int  lstcon_statrpc_prep(struct lstcon_node *nd, unsigned version,
-			 struct lstcon_rpc **crpc);
+			 __u32 type, struct lstcon_rpc **crpc);
 void lstcon_rpc_put(struct lstcon_rpc *crpc);
 int  lstcon_rpc_trans_prep(struct list_head *translist,
 			   int transop, struct lstcon_rpc_trans **transpp);
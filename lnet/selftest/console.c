@@ -1243,6 +1243,11 @@ lstcon_test_add(char *batch_name, int type, int loop,
 	struct lstcon_group *dst_grp = NULL;
 	struct lstcon_batch *batch = NULL;
 
+	/* the stream test has no default parameters */
+	if (type == LST_TEST_STREAM &&
+	    (param == NULL || paramlen < sizeof(struct lst_test_stream_param)))
+		return -EINVAL;
+
 	/*
 	 * verify that a batch of the given name exists, and the groups
 	 * that will be part of the batch exist and have at least one
@@ -1444,15 +1449,35 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
 }
 
 static int
-lstcon_ndlist_stat(struct list_head *ndlist,
+lstcon_latrpc_readent(int transop, struct srpc_msg *msg,
+		      struct lstcon_rpc_ent __user *ent_up)
+{
+	struct srpc_stat_reply *rep = &msg->msg_body.stat_reply;
+
+	if (rep->str_status != 0)
+		return 0;
+
+	if (copy_to_user(&ent_up->rpe_payload[0], &rep->str_lat,
+			 sizeof(rep->str_lat)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+lstcon_ndlist_stat(struct list_head *ndlist, __u32 type,
 		   int timeout, struct list_head __user *result_up)
 {
 	LIST_HEAD(head);
 	struct lstcon_rpc_trans *trans;
 	int rc;
 
-        rc = lstcon_rpc_trans_ndlist(ndlist, &head,
-                                     LST_TRANS_STATQRY, NULL, NULL, &trans);
+	if (type != 0 &&
+	    !(console_session.ses_features & LST_FEAT_LAT_HIST))
+		return -EOPNOTSUPP;
+
+	rc = lstcon_rpc_trans_ndlist(ndlist, &head,
+				     LST_TRANS_STATQRY, &type, NULL, &trans);
         if (rc != 0) {
                 CERROR("Can't create transaction: %d\n", rc);
                 return rc;
@@ -1460,15 +1485,16 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
         lstcon_rpc_trans_postwait(trans, LST_VALIDATE_TIMEOUT(timeout));
 
-        rc = lstcon_rpc_trans_interpreter(trans, result_up,
-                                          lstcon_statrpc_readent);
+	rc = lstcon_rpc_trans_interpreter(trans, result_up,
+					  type == 0 ? lstcon_statrpc_readent :
+						      lstcon_latrpc_readent);
         lstcon_rpc_trans_destroy(trans);
 
         return rc;
 }
 
 int
-lstcon_group_stat(char *grp_name, int timeout,
+lstcon_group_stat(char *grp_name, __u32 type, int timeout,
 		  struct list_head __user *result_up)
 {
 	struct lstcon_group *grp;
@@ -1480,7 +1506,7 @@ lstcon_group_stat(char *grp_name, int timeout,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&grp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(grp);
 
@@ -1489,7 +1515,7 @@ lstcon_group_stat(char *grp_name, int timeout,
 
 int
 lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-		  int timeout, struct list_head __user *result_up)
+		  __u32 type, int timeout, struct list_head __user *result_up)
 {
 	struct lstcon_ndlink *ndl;
 	struct lstcon_group *tmp;
@@ -1524,7 +1550,7 @@ lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(tmp);
 
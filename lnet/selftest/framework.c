@@ -373,6 +373,36 @@ static struct lst_sid get_old_sid(struct sfw_session *sn)
 	return sid;
 }
 
+static void
+sfw_lat_record(struct sfw_lat_stats *sls, ktime_t posted)
+{
+	s64 usecs = min_t(s64, ktime_us_delta(ktime_get(), posted), INT_MAX);
+	int bucket = min_t(int, fls64(max_t(s64, usecs, 0)),
+			   LST_LAT_BUCKETS - 1);
+	int max = atomic_read(&sls->sls_max_us);
+	int old;
+
+	atomic_inc(&sls->sls_buckets[bucket]);
+
+	while (usecs > max) {
+		old = atomic_cmpxchg(&sls->sls_max_us, max, usecs);
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static void
+sfw_lat_get(struct sfw_lat_stats *sls, struct sfw_lat_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < LST_LAT_BUCKETS; i++)
+		hist->lat_buckets[i] = atomic_read(&sls->sls_buckets[i]);
+	/* the console diffs the buckets, but can't do so for the max */
+	hist->lat_max_us = atomic_xchg(&sls->sls_max_us, 0);
+}
+
 static int
 sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 {
@@ -392,6 +422,22 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 		return 0;
 	}
 
+	switch (request->str_type) {
+	case 0:
+		break;
+	case LST_TEST_BULK:
+		sfw_lat_get(&sn->sn_brw_lat, &reply->str_lat);
+		reply->str_status = 0;
+		return 0;
+	case LST_TEST_PING:
+		sfw_lat_get(&sn->sn_ping_lat, &reply->str_lat);
+		reply->str_status = 0;
+		return 0;
+	default:
+		reply->str_status = EINVAL;
+		return 0;
+	}
+
 	lnet_counters_get_common(&reply->str_lnet);
 	srpc_get_counters(&reply->str_rpc);
 
@@ -737,6 +783,16 @@ sfw_unpack_addtest_req(struct srpc_msg *msg)
 		return;
 	}
 
+	if (req->tsr_service == SRPC_SERVICE_STREAM) {
+		struct test_stream_req *stream = &req->tsr_u.stream;
+
+		__swab32s(&stream->stm_min_len);
+		__swab32s(&stream->stm_max_len);
+		__swab16s(&stream->stm_read_pct);
+		__swab16s(&stream->stm_cksum);
+		return;
+	}
+
 	LBUG();
 }
 
@@ -882,10 +938,17 @@ sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 {
 	struct sfw_test_unit *tsu = rpc->crpc_priv;
 	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	struct sfw_session *sn = tsi->tsi_batch->bat_session;
 	int done = 0;
 
 	tsi->tsi_ops->tso_done_rpc(tsu, rpc);
 
+	/* stream RPCs are bulk RPCs too */
+	if (rpc->crpc_status == 0)
+		sfw_lat_record(tsi->tsi_service != SRPC_SERVICE_PING ?
+			       &sn->sn_brw_lat : &sn->sn_ping_lat,
+			       rpc->crpc_posted);
+
 	spin_lock(&tsi->tsi_lock);
 
 	LASSERT(sfw_test_active(tsi));
@@ -994,6 +1057,7 @@ sfw_run_test(struct swi_workitem *wi)
 
 	spin_lock(&rpc->crpc_lock);
 	rpc->crpc_timeout = rpc_timeout;
+	rpc->crpc_posted = ktime_get();
 	srpc_post_rpc(rpc);
 	spin_unlock(&rpc->crpc_lock);
 	return;
@@ -1426,6 +1490,34 @@ sfw_create_rpc(struct lnet_process_id peer, int service,
 	return rpc;
 }
 
+/* the layout of a stat reply depends on the str_type of its request */
+void
+sfw_unpack_stat_reply(struct srpc_msg *msg, __u32 type)
+{
+	struct srpc_stat_reply *rep = &msg->msg_body.stat_reply;
+	int i;
+
+	if (msg->msg_magic == SRPC_MSG_MAGIC)
+		return; /* no flipping needed */
+
+	LASSERT(msg->msg_magic == __swab32(SRPC_MSG_MAGIC));
+	LASSERT(msg->msg_type == SRPC_MSG_STAT_REPLY);
+
+	__swab32s(&rep->str_status);
+	sfw_unpack_sid(rep->str_sid);
+
+	if (type == 0) {
+		sfw_unpack_fw_counters(rep->str_fw);
+		sfw_unpack_rpc_counters(rep->str_rpc);
+		sfw_unpack_lnet_counters(rep->str_lnet);
+		return;
+	}
+
+	for (i = 0; i < LST_LAT_BUCKETS; i++)
+		__swab32s(&rep->str_lat.lat_buckets[i]);
+	__swab32s(&rep->str_lat.lat_max_us);
+}
+
 void
 sfw_unpack_message(struct srpc_msg *msg)
 {
@@ -1445,13 +1537,7 @@ sfw_unpack_message(struct srpc_msg *msg)
 	}
 
 	if (msg->msg_type == SRPC_MSG_STAT_REPLY) {
-		struct srpc_stat_reply *rep = &msg->msg_body.stat_reply;
-
-		__swab32s(&rep->str_status);
-		sfw_unpack_sid(rep->str_sid);
-		sfw_unpack_fw_counters(rep->str_fw);
-		sfw_unpack_rpc_counters(rep->str_rpc);
-		sfw_unpack_lnet_counters(rep->str_lnet);
+		sfw_unpack_stat_reply(msg, 0);
 		return;
 	}
 
@@ -1651,6 +1737,10 @@ sfw_startup(void)
 	rc = sfw_register_test(&ping_test_service, &ping_test_client);
 	LASSERT(rc == 0);
 
+	stream_init_test_service();
+	rc = sfw_register_test(&stream_test_service, &stream_test_client);
+	LASSERT(rc == 0);
+
 	error = 0;
 	list_for_each_entry(tsc, &sfw_data.fw_tests, tsc_list) {
 		sv = tsc->tsc_srv_service;
@@ -77,7 +77,10 @@ lnet_selftest_structure_assertion(void)
 	BUILD_BUG_ON(offsetof(struct srpc_msg, msg_body.tes_reqst.tsr_ndest) !=
 			      78);
 	BUILD_BUG_ON(sizeof(struct srpc_stat_reply) != 136);
+	BUILD_BUG_ON(sizeof(struct sfw_lat_hist) != 116);
 	BUILD_BUG_ON(sizeof(struct srpc_stat_reqst) != 28);
+	BUILD_BUG_ON(sizeof(struct test_stream_req) != 12);
+	BUILD_BUG_ON(sizeof(struct srpc_stream_reqst) != 32);
 }
 
 static int __init
@@ -40,6 +40,8 @@ enum srpc_msg_type {
         SRPC_MSG_PING_REPLY     = 15,
         SRPC_MSG_JOIN_REQST     = 16,
         SRPC_MSG_JOIN_REPLY     = 17,
+	SRPC_MSG_STREAM_REQST	= 18,
+	SRPC_MSG_STREAM_REPLY	= 19,
 };
 
 /* CAVEAT EMPTOR:
@@ -134,15 +136,23 @@ struct srpc_batch_reply {
 struct srpc_stat_reqst {
         __u64                   str_rpyid;      /* reply buffer matchbits */
 	struct lst_sid		str_sid;	/* session id */
-        __u32                   str_type;       /* type of stat */
+	/* 0 for the counters, or the enum lst_test_type of the RPCs whose
+	 * latency to report, with LST_FEAT_LAT_HIST
+	 */
+	__u32			str_type;
 } __packed;
 
 struct srpc_stat_reply {
 	__u32                    str_status;
 	struct lst_sid           str_sid;
-	struct sfw_counters      str_fw;
-	struct srpc_counters     str_rpc;
-	struct lnet_counters_common str_lnet;
+	union {
+		struct {
+			struct sfw_counters		str_fw;
+			struct srpc_counters		str_rpc;
+			struct lnet_counters_common	str_lnet;
+		} __packed;
+		struct sfw_lat_hist	str_lat;
+	};
 } __packed;
 
 struct test_bulk_req {
@@ -167,6 +177,16 @@ struct test_ping_req {
 	__u32			png_flags;      /* reserved flags */
 } __packed;
 
+struct test_stream_req {
+	/** transfer length range */
+	__u32			stm_min_len;
+	__u32			stm_max_len;
+	/** % of transfers which are reads */
+	__u16			stm_read_pct;
+	/** enum lst_stream_cksum */
+	__u16			stm_cksum;
+} __packed;
+
 struct srpc_test_reqst {
 	__u64			tsr_rpyid;      /* reply buffer matchbits */
 	__u64			tsr_bulkid;     /* bulk buffer matchbits */
@@ -184,6 +204,7 @@ struct srpc_test_reqst {
 		struct test_ping_req	ping;
 		struct test_bulk_req	bulk_v0;
 		struct test_bulk_req_v1	bulk_v1;
+		struct test_stream_req	stream;
 	} tsr_u;
 } __packed;
 
@@ -219,6 +240,20 @@ struct srpc_brw_reply {
         __u32                   brw_status;
 } __packed; /* bulk r/w reply */
 
+struct srpc_stream_reqst {
+	__u64			stm_rpyid;	/* reply buffer matchbits */
+	__u64			stm_bulkid;	/* bulk buffer matchbits */
+	__u32			stm_rw;		/* read or write */
+	__u32			stm_len;	/* bulk data len */
+	__u32			stm_cksum_type;	/* enum lst_stream_cksum */
+	__u32			stm_cksum;	/* checksum of written data */
+} __packed;
+
+struct srpc_stream_reply {
+	__u32			stm_status;
+	__u32			stm_cksum;	/* checksum of read data */
+} __packed;
+
 #define SRPC_MSG_MAGIC                  0xeeb0f00d
 #define SRPC_MSG_VERSION                1
 
@@ -256,6 +291,8 @@ struct srpc_msg {
 		struct srpc_ping_reply		ping_reply;
 		struct srpc_brw_reqst		brw_reqst;
 		struct srpc_brw_reply		brw_reply;
+		struct srpc_stream_reqst	stream_reqst;
+		struct srpc_stream_reply	stream_reply;
 	} msg_body;
 } __packed;
 
@@ -142,7 +142,8 @@ struct sfw_test_instance;
 /* other services start from SRPC_FRAMEWORK_SERVICE_MAX_ID+1 */
 #define SRPC_SERVICE_BRW                11
 #define SRPC_SERVICE_PING               12
-#define SRPC_SERVICE_MAX_ID             12
+#define SRPC_SERVICE_STREAM		13
+#define SRPC_SERVICE_MAX_ID		13
 
 #define SRPC_REQUEST_PORTAL             50
 /* a lazy portal for framework RPC requests */
@@ -180,6 +181,9 @@ srpc_service2request(int service)
 	case SRPC_SERVICE_PING:
 		return SRPC_MSG_PING_REQST;
 
+	case SRPC_SERVICE_STREAM:
+		return SRPC_MSG_STREAM_REQST;
+
 	case SRPC_SERVICE_JOIN:
 		return SRPC_MSG_JOIN_REQST;
 	}
@@ -274,6 +278,7 @@ struct srpc_client_rpc {
 	void               (*crpc_fini)(struct srpc_client_rpc *);
 	int                  crpc_status;    /* completion status */
 	void                *crpc_priv;      /* caller data */
+	ktime_t			crpc_posted;	/* for the round trip time */
 
 	/* state flags */
 	unsigned int         crpc_aborted:1; /* being given up */
@@ -394,6 +399,12 @@ struct lst_session_id {
 
 extern struct lst_session_id LST_INVALID_SID;
 
+/* round trip times of the test RPCs of one type, see struct sfw_lat_hist */
+struct sfw_lat_stats {
+	atomic_t		sls_buckets[LST_LAT_BUCKETS];
+	atomic_t		sls_max_us;
+};
+
 struct sfw_session {
 	/* chain on fw_zombie_sessions */
 	struct list_head	sn_list;
@@ -409,6 +420,8 @@ struct sfw_session {
 	atomic_t		sn_brw_errors;
 	atomic_t		sn_ping_errors;
 	ktime_t			sn_started;
+	struct sfw_lat_stats	sn_brw_lat;
+	struct sfw_lat_stats	sn_ping_lat;
 };
 
 static inline int sfw_sid_equal(struct lst_sid sid0,
@@ -465,6 +478,7 @@ struct sfw_test_instance {
 		struct test_ping_req	ping;	  /* ping parameter */
 		struct test_bulk_req	bulk_v0;  /* bulk parameter */
 		struct test_bulk_req_v1	bulk_v1;  /* bulk v1 parameter */
+		struct test_stream_req	stream;	  /* stream parameter */
 	} tsi_u;
 };
 
@@ -501,6 +515,7 @@ void sfw_abort_rpc(struct srpc_client_rpc *rpc);
 void sfw_post_rpc(struct srpc_client_rpc *rpc);
 void sfw_client_rpc_done(struct srpc_client_rpc *rpc);
 void sfw_unpack_message(struct srpc_msg *msg);
+void sfw_unpack_stat_reply(struct srpc_msg *msg, __u32 type);
 void sfw_add_bulk_page(struct srpc_bulk *bk, struct page *pg, int i);
 int sfw_alloc_pages(struct srpc_server_rpc *rpc, int cpt, int len,
 		    int sink);
@@ -687,4 +702,8 @@ extern struct sfw_test_client_ops brw_test_client;
 extern struct srpc_service brw_test_service;
 void brw_init_test_service(void);
 
+extern struct sfw_test_client_ops stream_test_client;
+extern struct srpc_service stream_test_service;
+void stream_init_test_service(void);
+
 #endif /* __SELFTEST_SELFTEST_H__ */
@@ -0,0 +1,449 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Streaming bulk test: transfers of up to LST_STREAM_MAX_SIZE bytes with a
+ * mix of reads and writes, each sent as a pipeline of bulk RPCs of up to
+ * LNET_MTU bytes, as a Lustre client does with the bulk of a large RPC.
+ * The transfers to a peer are shared by the concurrent test units of the
+ * peer, so the concurrency is the queue depth of RPCs in flight per peer.
+ * The data can be checksummed with the algorithms of Lustre bulk RPCs.
+ */
+
+#include <libcfs/libcfs_crypto.h>
+
+#include "selftest.h"
+
+static int stream_srv_workitems = SFW_TEST_WI_MAX;
+module_param(stream_srv_workitems, int, 0644);
+MODULE_PARM_DESC(stream_srv_workitems, "# stream server workitems");
+
+/* transfer in progress to a peer, shared by the test units of the peer */
+struct stream_peer {
+	spinlock_t		stp_lock;
+	/* bytes of the transfer not sent yet */
+	unsigned int		stp_left;
+	/* LST_BRW_READ or LST_BRW_WRITE */
+	int			stp_rw;
+};
+
+struct stream_unit {
+	struct srpc_bulk	*stu_bulk;
+	struct stream_peer	*stu_peer;
+	/* the first unit of the peer, which frees stu_peer */
+	unsigned int		stu_peer_owner:1;
+};
+
+static enum cfs_crypto_hash_alg
+stream_cksum2alg(int type)
+{
+	switch (type) {
+	case LST_STREAM_CKSUM_ADLER:
+		return CFS_HASH_ALG_ADLER32;
+	case LST_STREAM_CKSUM_CRC32:
+		return CFS_HASH_ALG_CRC32;
+	case LST_STREAM_CKSUM_CRC32C:
+		return CFS_HASH_ALG_CRC32C;
+	default:
+		return CFS_HASH_ALG_NULL;
+	}
+}
+
+/* checksum of the first @len bytes of @bk */
+static int
+stream_bulk_cksum(struct srpc_bulk *bk, unsigned int len, int type,
+		  __u32 *cksum)
+{
+	unsigned int bufsize = sizeof(*cksum);
+	struct ahash_request *req;
+	unsigned int nob;
+	int i;
+
+	req = cfs_crypto_hash_init(stream_cksum2alg(type), NULL, 0);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	for (i = 0; i < bk->bk_niov && len > 0; i++) {
+		nob = min_t(unsigned int, len, bk->bk_iovs[i].bv_len);
+		cfs_crypto_hash_update_page(req, bk->bk_iovs[i].bv_page,
+					    bk->bk_iovs[i].bv_offset, nob);
+		len -= nob;
+	}
+
+	return cfs_crypto_hash_final(req, (unsigned char *)cksum, &bufsize);
+}
+
+static void
+stream_client_fini(struct sfw_test_instance *tsi)
+{
+	struct stream_unit *stu;
+	struct sfw_test_unit *tsu;
+
+	LASSERT(tsi->tsi_is_client);
+
+	list_for_each_entry(tsu, &tsi->tsi_units, tsu_list) {
+		stu = tsu->tsu_private;
+		if (stu == NULL)
+			continue;
+
+		if (stu->stu_bulk != NULL)
+			srpc_free_bulk(stu->stu_bulk);
+		if (stu->stu_peer_owner)
+			LIBCFS_FREE(stu->stu_peer, sizeof(*stu->stu_peer));
+		LIBCFS_FREE(stu, sizeof(*stu));
+		tsu->tsu_private = NULL;
+	}
+}
+
+static int
+stream_client_init(struct sfw_test_instance *tsi)
+{
+	struct test_stream_req *req = &tsi->tsi_u.stream;
+	struct stream_peer *stp = NULL;
+	struct lnet_process_id dest = {
+		.nid = LNET_NID_ANY,
+		.pid = LNET_PID_ANY,
+	};
+	struct stream_unit *stu;
+	struct sfw_test_unit *tsu;
+	struct srpc_bulk *bk;
+	unsigned int len;
+	int i;
+
+	LASSERT(tsi->tsi_is_client);
+
+	if (req->stm_min_len == 0 || req->stm_min_len > req->stm_max_len ||
+	    req->stm_max_len > LST_STREAM_MAX_SIZE ||
+	    req->stm_read_pct > 100 || req->stm_cksum >= LST_STREAM_CKSUM_MAX)
+		return -EINVAL;
+
+	len = min_t(unsigned int, req->stm_max_len, LNET_MTU);
+
+	list_for_each_entry(tsu, &tsi->tsi_units, tsu_list) {
+		LIBCFS_ALLOC(stu, sizeof(*stu));
+		if (stu == NULL)
+			goto nomem;
+		tsu->tsu_private = stu;
+
+		/* the units of a peer are next to each other */
+		if (stp == NULL || tsu->tsu_dest.nid != dest.nid ||
+		    tsu->tsu_dest.pid != dest.pid) {
+			LIBCFS_ALLOC(stp, sizeof(*stp));
+			if (stp == NULL)
+				goto nomem;
+			spin_lock_init(&stp->stp_lock);
+			stu->stu_peer_owner = 1;
+			dest = tsu->tsu_dest;
+		}
+		stu->stu_peer = stp;
+
+		bk = srpc_alloc_bulk(lnet_cpt_of_nid(dest.nid, NULL), len);
+		if (bk == NULL)
+			goto nomem;
+		srpc_init_bulk(bk, 0, len, 0);
+		stu->stu_bulk = bk;
+
+		/* don't send the stale content of the pages */
+		for (i = 0; i < bk->bk_niov; i++)
+			get_random_bytes(page_address(bk->bk_iovs[i].bv_page),
+					 PAGE_SIZE);
+	}
+
+	return 0;
+nomem:
+	stream_client_fini(tsi);
+	return -ENOMEM;
+}
+
+static int
+stream_client_prep_rpc(struct sfw_test_unit *tsu, struct lnet_process_id dest,
+		       struct srpc_client_rpc **rpcpp)
+{
+	struct stream_unit *stu = tsu->tsu_private;
+	struct stream_peer *stp = stu->stu_peer;
+	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	struct sfw_session *sn = tsi->tsi_batch->bat_session;
+	struct test_stream_req *sreq = &tsi->tsi_u.stream;
+	struct srpc_bulk *bulk = stu->stu_bulk;
+	struct srpc_stream_reqst *req;
+	struct srpc_client_rpc *rpc;
+	unsigned int len;
+	__u32 cksum = 0;
+	int rw;
+	int rc;
+
+	LASSERT(sn != NULL);
+	LASSERT(bulk != NULL);
+
+	/* take the next RPC of the transfer to the peer, or start one */
+	spin_lock(&stp->stp_lock);
+	if (stp->stp_left == 0) {
+		stp->stp_rw = get_random_u32_below(100) < sreq->stm_read_pct ?
+			      LST_BRW_READ : LST_BRW_WRITE;
+		stp->stp_left = sreq->stm_min_len +
+				get_random_u32_below(sreq->stm_max_len -
+						     sreq->stm_min_len + 1);
+	}
+	len = min_t(unsigned int, stp->stp_left, LNET_MTU);
+	stp->stp_left -= len;
+	rw = stp->stp_rw;
+	spin_unlock(&stp->stp_lock);
+
+	if (rw == LST_BRW_WRITE && sreq->stm_cksum != LST_STREAM_CKSUM_NONE) {
+		rc = stream_bulk_cksum(bulk, len, sreq->stm_cksum, &cksum);
+		if (rc != 0) {
+			CERROR("Can't checksum stream RPC to %s: rc = %d\n",
+			       libcfs_id2str(dest), rc);
+			return rc;
+		}
+	}
+
+	/* the whole buffer is always posted, so that the RPCs of the test
+	 * can be reused, but only @len bytes of it are transferred
+	 */
+	rc = sfw_create_test_rpc(tsu, dest, sn->sn_features, bulk->bk_niov,
+				 bulk->bk_len, &rpc);
+	if (rc != 0)
+		return rc;
+
+	unsafe_memcpy(&rpc->crpc_bulk, bulk,
+		      offsetof(struct srpc_bulk, bk_iovs[bulk->bk_niov]),
+		      FLEXIBLE_OBJECT);
+	rpc->crpc_bulk.bk_sink = rw == LST_BRW_READ;
+
+	req = &rpc->crpc_reqstmsg.msg_body.stream_reqst;
+	req->stm_rw	    = rw;
+	req->stm_len	    = len;
+	req->stm_cksum_type = sreq->stm_cksum;
+	req->stm_cksum	    = cksum;
+
+	*rpcpp = rpc;
+	return 0;
+}
+
+static void
+stream_client_done_rpc(struct sfw_test_unit *tsu, struct srpc_client_rpc *rpc)
+{
+	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	struct sfw_session *sn = tsi->tsi_batch->bat_session;
+	struct srpc_msg *msg = &rpc->crpc_replymsg;
+	struct srpc_stream_reply *reply = &msg->msg_body.stream_reply;
+	struct srpc_stream_reqst *reqst =
+		&rpc->crpc_reqstmsg.msg_body.stream_reqst;
+	__u32 cksum = 0;
+	int rc;
+
+	LASSERT(sn != NULL);
+
+	if (rpc->crpc_status != 0) {
+		CERROR("Stream RPC to %s failed with %d\n",
+		       libcfs_id2str(rpc->crpc_dest), rpc->crpc_status);
+		if (!tsi->tsi_stopping) /* rpc could have been aborted */
+			atomic_inc(&sn->sn_brw_errors);
+		return;
+	}
+
+	if (msg->msg_magic != SRPC_MSG_MAGIC) {
+		__swab32s(&reply->stm_status);
+		__swab32s(&reply->stm_cksum);
+	}
+
+	CDEBUG_LIMIT(reply->stm_status ? D_WARNING : D_NET,
+		     "Stream RPC to %s finished with status: %d\n",
+		     libcfs_id2str(rpc->crpc_dest), reply->stm_status);
+
+	if (reply->stm_status != 0) {
+		atomic_inc(&sn->sn_brw_errors);
+		rpc->crpc_status = -(int)reply->stm_status;
+		return;
+	}
+
+	if (reqst->stm_rw == LST_BRW_WRITE ||
+	    reqst->stm_cksum_type == LST_STREAM_CKSUM_NONE)
+		return;
+
+	rc = stream_bulk_cksum(&rpc->crpc_bulk, reqst->stm_len,
+			       reqst->stm_cksum_type, &cksum);
+	if (rc == 0 && cksum != reply->stm_cksum)
+		rc = -EBADMSG;
+	if (rc != 0) {
+		CERROR("Bad checksum of stream data from %s: %#x, %#x expected: rc = %d\n",
+		       libcfs_id2str(rpc->crpc_dest), cksum, reply->stm_cksum,
+		       rc);
+		atomic_inc(&sn->sn_brw_errors);
+		rpc->crpc_status = rc;
+	}
+}
+
+static void
+stream_server_rpc_done(struct srpc_server_rpc *rpc)
+{
+	struct srpc_bulk *blk = rpc->srpc_bulk;
+
+	if (blk == NULL)
+		return;
+
+	if (rpc->srpc_status != 0)
+		CERROR("Stream transfer %s %s has failed: %d\n",
+		       blk->bk_sink ? "from" : "to",
+		       libcfs_id2str(rpc->srpc_peer), rpc->srpc_status);
+	else
+		CDEBUG(D_NET, "Transferred %d bytes stream data %s %s\n",
+		       blk->bk_len, blk->bk_sink ? "from" : "to",
+		       libcfs_id2str(rpc->srpc_peer));
+}
+
+static int
+stream_bulk_ready(struct srpc_server_rpc *rpc, int status)
+{
+	struct srpc_stream_reply *reply =
+		&rpc->srpc_replymsg.msg_body.stream_reply;
+	struct srpc_stream_reqst *reqst;
+	__u32 cksum = 0;
+	int rc;
+
+	LASSERT(rpc->srpc_bulk != NULL);
+	LASSERT(rpc->srpc_reqstbuf != NULL);
+
+	reqst = &rpc->srpc_reqstbuf->buf_msg.msg_body.stream_reqst;
+
+	if (status != 0) {
+		CERROR("Stream bulk %s failed for RPC from %s: %d\n",
+		       reqst->stm_rw == LST_BRW_READ ? "READ" : "WRITE",
+		       libcfs_id2str(rpc->srpc_peer), status);
+		return -EIO;
+	}
+
+	if (reqst->stm_rw == LST_BRW_READ ||
+	    reqst->stm_cksum_type == LST_STREAM_CKSUM_NONE)
+		return 0;
+
+	rc = stream_bulk_cksum(rpc->srpc_bulk, reqst->stm_len,
+			       reqst->stm_cksum_type, &cksum);
+	if (rc == 0 && cksum != reqst->stm_cksum) {
+		CERROR("Bad checksum of stream data from %s: %#x, %#x expected\n",
+		       libcfs_id2str(rpc->srpc_peer), cksum, reqst->stm_cksum);
+		rc = -EBADMSG;
+	}
+	if (rc != 0)
+		reply->stm_status = -rc;
+
+	return 0;
+}
+
+static int
+stream_server_handle(struct srpc_server_rpc *rpc)
+{
+	struct srpc_service *sv = rpc->srpc_scd->scd_svc;
+	struct srpc_msg *replymsg = &rpc->srpc_replymsg;
+	struct srpc_msg *reqstmsg = &rpc->srpc_reqstbuf->buf_msg;
+	struct srpc_stream_reply *reply = &replymsg->msg_body.stream_reply;
+	struct srpc_stream_reqst *reqst = &reqstmsg->msg_body.stream_reqst;
+	int rc;
+
+	LASSERT(sv->sv_id == SRPC_SERVICE_STREAM);
+
+	if (reqstmsg->msg_magic != SRPC_MSG_MAGIC) {
+		LASSERT(reqstmsg->msg_magic == __swab32(SRPC_MSG_MAGIC));
+
+		__swab64s(&reqst->stm_rpyid);
+		__swab64s(&reqst->stm_bulkid);
+		__swab32s(&reqst->stm_rw);
+		__swab32s(&reqst->stm_len);
+		__swab32s(&reqst->stm_cksum_type);
+		__swab32s(&reqst->stm_cksum);
+	}
+	LASSERT(reqstmsg->msg_type == (__u32)srpc_service2request(sv->sv_id));
+
+	reply->stm_status = 0;
+	reply->stm_cksum = 0;
+	rpc->srpc_done = stream_server_rpc_done;
+
+	if ((reqst->stm_rw != LST_BRW_READ && reqst->stm_rw != LST_BRW_WRITE) ||
+	    reqst->stm_cksum_type >= LST_STREAM_CKSUM_MAX ||
+	    reqst->stm_len == 0 || reqst->stm_len > LNET_MTU) {
+		reply->stm_status = EINVAL;
+		return 0;
+	}
+
+	if ((reqstmsg->msg_ses_feats & ~LST_FEATS_MASK) != 0) {
+		replymsg->msg_ses_feats = LST_FEATS_MASK;
+		reply->stm_status = EPROTO;
+		return 0;
+	}
+
+	replymsg->msg_ses_feats = reqstmsg->msg_ses_feats;
+
+	srpc_init_bulk(rpc->srpc_bulk, 0, reqst->stm_len,
+		       reqst->stm_rw == LST_BRW_WRITE);
+
+	if (reqst->stm_rw == LST_BRW_READ &&
+	    reqst->stm_cksum_type != LST_STREAM_CKSUM_NONE) {
+		rc = stream_bulk_cksum(rpc->srpc_bulk, reqst->stm_len,
+				       reqst->stm_cksum_type,
+				       &reply->stm_cksum);
+		if (rc != 0)
+			reply->stm_status = -rc;
+	}
+
+	return 0;
+}
+
+static int
+stream_srpc_init(struct srpc_server_rpc *rpc, int cpt)
+{
+	struct srpc_bulk *bk;
+	int i;
+
+	/* just alloc a maximal size - actual values will be adjusted later */
+	bk = srpc_alloc_bulk(cpt, LNET_MTU);
+	if (bk == NULL)
+		return -ENOMEM;
+
+	/* don't send the stale content of the pages to readers */
+	for (i = 0; i < bk->bk_alloc; i++)
+		memset(page_address(bk->bk_iovs[i].bv_page), 0, PAGE_SIZE);
+
+	srpc_init_bulk(bk, 0, 0, 0);
+	rpc->srpc_bulk = bk;
+
+	return 0;
+}
+
+static void
+stream_srpc_fini(struct srpc_server_rpc *rpc)
+{
+	srpc_free_bulk(rpc->srpc_bulk);
+	rpc->srpc_bulk = NULL;
+}
+
+struct sfw_test_client_ops stream_test_client = {
+	.tso_init	= stream_client_init,
+	.tso_fini	= stream_client_fini,
+	.tso_prep_rpc	= stream_client_prep_rpc,
+	.tso_done_rpc	= stream_client_done_rpc,
+};
+
+struct srpc_service stream_test_service = {
+	.sv_id		= SRPC_SERVICE_STREAM,
+	.sv_name	= "stream_test",
+	.sv_handler	= stream_server_handle,
+	.sv_bulk_ready	= stream_bulk_ready,
+
+	.sv_srpc_init	= stream_srpc_init,
+	.sv_srpc_fini	= stream_srpc_fini,
+};
+
+void stream_init_test_service(void)
+{
+	unsigned long cache_size = cfs_totalram_pages() >> 4;
+
+	/* stream prealloc cache should don't eat more than half memory */
+	cache_size /= ((LNET_MTU >> PAGE_SHIFT) + 1);
+
+	stream_test_service.sv_wi_total = stream_srv_workitems;
+
+	if (stream_test_service.sv_wi_total > cache_size)
+		stream_test_service.sv_wi_total = cache_size;
+}
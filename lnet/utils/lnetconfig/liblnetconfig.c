@@ -3197,6 +3197,28 @@ int lustre_lnet_config_drop_asym_route(int drop, int seq_no,
 
 }
 
+int lustre_lnet_config_select_policy(int policy, int seq_no,
+				     struct cYAML **err_rc)
+{
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN] = "\"success\"";
+	char val[LNET_MAX_STR_LEN];
+
+	snprintf(val, sizeof(val), "%d", policy);
+
+	rc = write_sysfs_file(modparam_path, "lnet_select_policy", val,
+			      1, strlen(val) + 1);
+	if (rc)
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot configure select policy: %s\"",
+			 strerror(errno));
+
+	cYAML_build_error(rc, seq_no, ADD_CMD, "select_policy",
+			  err_str, err_rc);
+
+	return rc;
+}
+
 int lustre_lnet_config_numa_range(int range, int seq_no, struct cYAML **err_rc)
 {
 	return ioctl_set_value(range, IOC_LIBCFS_SET_NUMA_RANGE,
@@ -4588,6 +4610,29 @@ int lustre_lnet_show_drop_asym_route(int seq_no, struct cYAML **show_rc,
 				       show_rc, err_rc, l_errno);
 }
 
+int lustre_lnet_show_select_policy(int seq_no, struct cYAML **show_rc,
+				   struct cYAML **err_rc)
+{
+	int rc = LUSTRE_CFG_RC_OUT_OF_MEM;
+	char val[LNET_MAX_STR_LEN];
+	int select_policy = -1, l_errno = 0;
+	char err_str[LNET_MAX_STR_LEN] = "\"out of memory\"";
+
+	rc = read_sysfs_file(modparam_path, "lnet_select_policy", val,
+			     1, sizeof(val));
+	if (rc) {
+		l_errno = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot get select policy setting: %d\"", rc);
+	} else {
+		select_policy = atoi(val);
+	}
+
+	return build_global_yaml_entry(err_str, sizeof(err_str), seq_no,
+				       "select_policy", select_policy,
+				       show_rc, err_rc, l_errno);
+}
+
 int lustre_lnet_show_numa_range(int seq_no, struct cYAML **show_rc,
 				struct cYAML **err_rc)
 {
@@ -5594,7 +5639,7 @@ static int handle_yaml_config_global_settings(struct cYAML *tree,
 {
 	struct cYAML *max_intf, *numa, *discovery, *retry, *tto, *seq_no,
 		     *sen, *recov, *rsen, *drop_asym_route, *rsp_tracking,
-		     *recov_limit;
+		     *recov_limit, *select_policy;
 	int rc = 0;
 
 	seq_no = cYAML_get_object_item(tree, "seq_no");
@@ -5628,6 +5673,13 @@ static int handle_yaml_config_global_settings(struct cYAML *tree,
 			seq_no ? seq_no->cy_valueint : -1,
 			err_rc);
 
+	select_policy = cYAML_get_object_item(tree, "select_policy");
+	if (select_policy)
+		rc = lustre_lnet_config_select_policy(
+			select_policy->cy_valueint,
+			seq_no ? seq_no->cy_valueint : -1,
+			err_rc);
+
 	retry = cYAML_get_object_item(tree, "retry_count");
 	if (retry)
 		rc = lustre_lnet_config_retry_count(retry->cy_valueint,
@@ -5684,7 +5736,8 @@ static int handle_yaml_del_global_settings(struct cYAML *tree,
 					   struct cYAML **show_rc,
 					   struct cYAML **err_rc)
 {
-	struct cYAML *max_intf, *numa, *discovery, *seq_no, *drop_asym_route;
+	struct cYAML *max_intf, *numa, *discovery, *seq_no, *drop_asym_route,
+		     *select_policy;
 	int rc = 0;
 
 	seq_no = cYAML_get_object_item(tree, "seq_no");
@@ -5718,6 +5771,12 @@ static int handle_yaml_del_global_settings(struct cYAML *tree,
 		rc = lustre_lnet_config_drop_asym_route(
 			0, seq_no ? seq_no->cy_valueint : -1, err_rc);
 
+	/* NIs are selected on credits by default */
+	select_policy = cYAML_get_object_item(tree, "select_policy");
+	if (select_policy)
+		rc = lustre_lnet_config_select_policy(
+			0, seq_no ? seq_no->cy_valueint : -1, err_rc);
+
 	return rc;
 }
 
@@ -5727,7 +5786,7 @@ static int handle_yaml_show_global_settings(struct cYAML *tree,
 {
 	struct cYAML *max_intf, *numa, *discovery, *retry, *tto, *seq_no,
 		     *sen, *recov, *rsen, *drop_asym_route, *rsp_tracking,
-		     *recov_limit;
+		     *recov_limit, *select_policy;
 	int rc = 0;
 
 	seq_no = cYAML_get_object_item(tree, "seq_no");
@@ -5757,6 +5816,12 @@ static int handle_yaml_show_global_settings(struct cYAML *tree,
 			seq_no ? seq_no->cy_valueint : -1,
 			show_rc, err_rc);
 
+	select_policy = cYAML_get_object_item(tree, "select_policy");
+	if (select_policy)
+		rc = lustre_lnet_show_select_policy(
+			seq_no ? seq_no->cy_valueint : -1,
+			show_rc, err_rc);
+
 	retry = cYAML_get_object_item(tree, "retry_count");
 	if (retry)
 		rc = lustre_lnet_show_retry_count(seq_no ? seq_no->cy_valueint
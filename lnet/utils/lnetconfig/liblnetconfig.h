@@ -576,6 +576,31 @@ int lustre_lnet_config_drop_asym_route(int drop, int seq_no,
 int lustre_lnet_show_drop_asym_route(int seq_no, struct cYAML **show_rc,
 				     struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_config_select_policy
+ *   Select the local and peer NIs on available credits (0, the default) or
+ *   on measured latency and queued bytes (1).
+ *
+ *   policy - selection policy
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_config_select_policy(int policy, int seq_no,
+				     struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_select_policy
+ *    show current NI selection policy
+ *
+ *   seq_no - sequence number of the request
+ *   show_rc - [OUT] struct cYAML tree containing the selection policy
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_show_select_policy(int seq_no, struct cYAML **show_rc,
+				   struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_buffers
  *   Send down an IOCTL to configure routing buffer sizes.  A value of 0 means
@@ -59,6 +59,7 @@ static int jt_del_peer_nid(int argc, char **argv);
 static int jt_set_max_intf(int argc, char **argv);
 static int jt_set_discovery(int argc, char **argv);
 static int jt_set_drop_asym_route(int argc, char **argv);
+static int jt_set_select_policy(int argc, char **argv);
 static int jt_list_peer(int argc, char **argv);
 static int jt_add_udsp(int argc, char **argv);
 static int jt_del_udsp(int argc, char **argv);
@@ -96,7 +97,8 @@ command_t cmd_list[] = {
 			   " | discovery | drop_asym_route | retry_count"
 			   " | transaction_timeout | health_sensitivity"
 			   " | recovery_interval | router_sensitivity"
-			   " | response_tracking | recovery_limit}"},
+			   " | response_tracking | recovery_limit"
+			   " | select_policy}"},
 	{"import", jt_import, 0, "import FILE.yaml"},
 	{"export", jt_export, 0, "export FILE.yaml"},
 	{"stats", jt_stats, 0, "stats {show | help}"},
@@ -221,6 +223,10 @@ command_t set_cmds[] = {
 	 "drop/accept asymmetrical route messages\n"
 	 "\t0 - accept asymmetrical route messages (default)\n"
 	 "\t1 - drop asymmetrical route messages\n"},
+	{"select_policy", jt_set_select_policy, 0,
+	 "how to choose among equally healthy interfaces\n"
+	 "\t0 - on available credits (default)\n"
+	 "\t1 - on measured latency and queued bytes\n"},
 	{"retry_count", jt_set_retry_count, 0, "number of retries\n"
 	 "\t0 - turn of retries\n"
 	 "\t>0 - number of retries\n"},
@@ -732,6 +738,35 @@ static int jt_set_drop_asym_route(int argc, char **argv)
 	return rc;
 }
 
+static int jt_set_select_policy(int argc, char **argv)
+{
+	long int value;
+	int rc;
+	struct cYAML *err_rc = NULL;
+
+	rc = check_cmd(set_cmds, "set", "select_policy", 2, argc, argv);
+	if (rc)
+		return rc;
+
+	rc = parse_long(argv[1], &value);
+	if (rc != 0) {
+		cYAML_build_error(-1, -1, "parser", "set",
+				  "cannot parse select_policy value",
+				  &err_rc);
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+		return -1;
+	}
+
+	rc = lustre_lnet_config_select_policy(value, -1, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
 static int jt_set_tiny(int argc, char **argv)
 {
 	long int value;
@@ -3710,6 +3745,12 @@ static int jt_show_global(int argc, char **argv)
 		goto out;
 	}
 
+	rc = lustre_lnet_show_select_policy(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		goto out;
+	}
+
 	rc = lustre_lnet_show_retry_count(-1, &show_rc, &err_rc);
 	if (rc != LUSTRE_CFG_RC_NO_ERR) {
 		cYAML_print_tree2file(stderr, err_rc);
@@ -3930,6 +3971,16 @@ static int yaml_import_global_settings(char *key, unsigned long value,
 			rc = lustre_lnet_show_drop_asym_route(-1, &show_rc,
 							      &err_rc);
 		}
+	} else if (strcmp("select_policy", key) == 0) {
+		if (cmd == 'a' || cmd == 'd') {
+			if (cmd == 'd')
+				value = 0;
+			rc = lustre_lnet_config_select_policy(value, -1,
+							      &err_rc);
+		} else if (cmd == 's') {
+			rc = lustre_lnet_show_select_policy(-1, &show_rc,
+							    &err_rc);
+		}
 	} else if (strcmp("retry_count", key) == 0) {
 		if (cmd == 'a') {
 			rc = lustre_lnet_config_retry_count(value, -1,
@@ -4498,6 +4549,13 @@ show_others:
 		err_rc = NULL;
 	}
 
+	rc = lustre_lnet_show_select_policy(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(f, err_rc);
+		cYAML_free_tree(err_rc);
+		err_rc = NULL;
+	}
+
 	rc = lustre_lnet_show_retry_count(-1, &show_rc, &err_rc);
 	if (rc != LUSTRE_CFG_RC_NO_ERR) {
 		cYAML_print_tree2file(f, err_rc);
@@ -320,6 +320,8 @@ lst_test_type2name(int type)
                 return "ping";
         if (type == LST_TEST_BULK)
                 return "brw";
+	if (type == LST_TEST_STREAM)
+		return "stream";
 
         return "unknown";
 }
@@ -331,6 +333,8 @@ lst_test_name2type(char *name)
                 return LST_TEST_PING;
         if (strcasecmp(name, "brw") == 0)
                 return LST_TEST_BULK;
+	if (strcasecmp(name, "stream") == 0)
+		return LST_TEST_STREAM;
 
         return -1;
 }
@@ -2159,6 +2163,24 @@ lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
 	return lst_ioctl(LSTIO_STAT_QUERY, &args, sizeof(args));
 }
 
+static int
+lst_lat_ioctl(char *name, int count, struct lnet_process_id *idsp,
+	      int type, int timeout, struct list_head *resultp)
+{
+	struct lstio_lat_args args = { { 0 } };
+
+	args.lstio_lat_stat.lstio_sta_key     = session_key;
+	args.lstio_lat_stat.lstio_sta_timeout = timeout;
+	args.lstio_lat_stat.lstio_sta_nmlen   = strlen(name);
+	args.lstio_lat_stat.lstio_sta_namep   = name;
+	args.lstio_lat_stat.lstio_sta_count   = count;
+	args.lstio_lat_stat.lstio_sta_idsp    = idsp;
+	args.lstio_lat_stat.lstio_sta_resultp = resultp;
+	args.lstio_lat_type		      = type;
+
+	return lst_ioctl(LSTIO_LAT_QUERY, &args, sizeof(args));
+}
+
 typedef struct {
 	struct list_head              srp_link;
         int                     srp_count;
@@ -2187,6 +2209,7 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
         lst_stat_req_param_t *srp = NULL;
         int                   count = save_old ? 2 : 1;
         int                   rc;
+	size_t		      size;
         int                   i;
 
         srp = malloc(sizeof(*srp));
@@ -2215,11 +2238,15 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
 
 	srp->srp_name = name;
 
+	/* room for either the counters or a latency histogram */
+	size = sizeof(struct sfw_counters) + sizeof(struct srpc_counters) +
+	       sizeof(struct lnet_counters_common);
+	if (size < sizeof(struct sfw_lat_hist))
+		size = sizeof(struct sfw_lat_hist);
+
 	for (i = 0; i < count; i++) {
 		rc = lst_alloc_rpcent(&srp->srp_result[i], srp->srp_count,
-				      sizeof(struct sfw_counters)  +
-				      sizeof(struct srpc_counters) +
-				      sizeof(struct lnet_counters_common));
+				      size);
 		if (rc != 0) {
 			fprintf(stderr, "Out of memory\n");
 			break;
@@ -2504,6 +2531,146 @@ lst_print_stat(char *name, struct list_head *resultp,
 	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 }
 
+/* usecs at which the fraction @pct of the RPCs of @hist completed,
+ * interpolated within the log2 bucket it falls in
+ */
+static double
+lst_lat_percentile(struct sfw_lat_hist *hist, __u64 total, double pct)
+{
+	double target = pct * total;
+	double lower;
+	double upper;
+	__u64 sum = 0;
+	int i;
+
+	for (i = 0; i < LST_LAT_BUCKETS; i++) {
+		if (hist->lat_buckets[i] == 0 ||
+		    sum + hist->lat_buckets[i] < target) {
+			sum += hist->lat_buckets[i];
+			continue;
+		}
+
+		lower = i == 0 ? 0 : 1ULL << (i - 1);
+		upper = i == 0 ? 1 : 1ULL << i;
+		if (i == LST_LAT_BUCKETS - 1 && hist->lat_max_us > lower)
+			upper = hist->lat_max_us;
+		lower += (upper - lower) * (target - sum) /
+			 hist->lat_buckets[i];
+		/* the max of the interval is exact */
+		if (hist->lat_max_us != 0 && lower > hist->lat_max_us)
+			lower = hist->lat_max_us;
+		return lower;
+	}
+
+	return hist->lat_max_us;
+}
+
+static void
+lst_print_lat(char *name, struct list_head *resultp, int idx,
+	      int type, int json)
+{
+	static const double pcts[] = { 0.5, 0.99, 0.999 };
+	struct list_head tmp[2];
+	struct lstcon_rpc_ent *new;
+	struct lstcon_rpc_ent *old;
+	struct sfw_lat_hist *lat_new;
+	struct sfw_lat_hist *lat_old;
+	struct sfw_lat_hist hist;
+	__u64 total = 0;
+	int errcount = 0;
+	int nodes = 0;
+	int i;
+
+	INIT_LIST_HEAD(&tmp[0]);
+	INIT_LIST_HEAD(&tmp[1]);
+
+	memset(&hist, 0, sizeof(hist));
+
+	while (!list_empty(&resultp[idx])) {
+		if (list_empty(&resultp[1 - idx])) {
+			fprintf(stderr, "Group is changed, re-run stat\n");
+			break;
+		}
+
+		new = list_first_entry(&resultp[idx], struct lstcon_rpc_ent,
+				       rpe_link);
+		old = list_first_entry(&resultp[1 - idx], struct lstcon_rpc_ent,
+				       rpe_link);
+
+		/* first time get stats result, can't calculate diff */
+		if (new->rpe_peer.nid == LNET_NID_ANY)
+			break;
+
+		if (new->rpe_peer.nid != old->rpe_peer.nid ||
+		    new->rpe_peer.pid != old->rpe_peer.pid)
+			break;
+
+		list_move_tail(&new->rpe_link, &tmp[idx]);
+		list_move_tail(&old->rpe_link, &tmp[1 - idx]);
+
+		if (new->rpe_rpc_errno != 0 || new->rpe_fwk_errno != 0 ||
+		    old->rpe_rpc_errno != 0 || old->rpe_fwk_errno != 0) {
+			errcount++;
+			continue;
+		}
+
+		lat_new = (struct sfw_lat_hist *)&new->rpe_payload[0];
+		lat_old = (struct sfw_lat_hist *)&old->rpe_payload[0];
+
+		/* the buckets count since the session started */
+		for (i = 0; i < LST_LAT_BUCKETS; i++) {
+			__u32 diff = lat_new->lat_buckets[i] -
+				     lat_old->lat_buckets[i];
+
+			hist.lat_buckets[i] += diff;
+			total += diff;
+		}
+		/* while the max is reset by each query */
+		if (hist.lat_max_us < lat_new->lat_max_us)
+			hist.lat_max_us = lat_new->lat_max_us;
+		nodes++;
+	}
+
+	list_splice(&tmp[idx], &resultp[idx]);
+	list_splice(&tmp[1 - idx], &resultp[1 - idx]);
+
+	if (errcount > 0)
+		fprintf(stderr, "Failed to stat on %d nodes\n", errcount);
+
+	if (nodes == 0)
+		return;
+
+	if (json) {
+		fprintf(stdout,
+			"{ \"name\": \"%s\", \"type\": \"%s\", \"nodes\": %d, \"rpcs\": %llu",
+			name, type == LST_TEST_BULK ? "brw" : "ping", nodes,
+			(unsigned long long)total);
+		if (total != 0) {
+			fprintf(stdout,
+				", \"p50_us\": %.0f, \"p99_us\": %.0f, \"p999_us\": %.0f, \"max_us\": %u",
+				lst_lat_percentile(&hist, total, pcts[0]),
+				lst_lat_percentile(&hist, total, pcts[1]),
+				lst_lat_percentile(&hist, total, pcts[2]),
+				hist.lat_max_us);
+		}
+		fprintf(stdout, " }\n");
+		fflush(stdout);
+		return;
+	}
+
+	fprintf(stdout, "[%s RPC latency of %s]\n",
+		type == LST_TEST_BULK ? "brw" : "ping", name);
+	fprintf(stdout, "RPCs: %-8llu", (unsigned long long)total);
+	if (total != 0) {
+		fprintf(stdout, " p50: %-8.0f p99: %-8.0f p99.9: %-8.0f max: %u usec",
+			lst_lat_percentile(&hist, total, pcts[0]),
+			lst_lat_percentile(&hist, total, pcts[1]),
+			lst_lat_percentile(&hist, total, pcts[2]),
+			hist.lat_max_us);
+	}
+	fprintf(stdout, "\n");
+}
+
 static int
 jt_lst_stat(int argc, char **argv)
 {
@@ -2522,6 +2689,8 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      lat     = 0; /* RPC latency of a test type */
+	int		      json    = 0;
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -2537,6 +2706,8 @@ jt_lst_stat(int argc, char **argv)
 		{ .name = "min",     .has_arg = no_argument,       .val = 'n' },
 		{ .name = "max",     .has_arg = no_argument,       .val = 'x' },
 		{ .name = "mbs",     .has_arg = no_argument,       .val = 'm' },
+		{ .name = "lat",     .has_arg = required_argument, .val = 'L' },
+		{ .name = "json",    .has_arg = no_argument,       .val = 'j' },
 		{ .name = NULL } };
 
         if (session_key == 0) {
@@ -2546,7 +2717,7 @@ jt_lst_stat(int argc, char **argv)
         }
 
         while (1) {
-		c = getopt_long(argc, argv, "t:d:lcbarwgnxm", stat_opts,
+		c = getopt_long(argc, argv, "t:d:lcbarwgnxmL:j", stat_opts,
 				&optidx);
 
                 if (c == -1)
@@ -2604,6 +2775,20 @@ jt_lst_stat(int argc, char **argv)
 		case 'm':
 			mbs = 1;
 			break;
+		case 'L':
+			if (strcmp(optarg, "brw") == 0) {
+				lat = LST_TEST_BULK;
+			} else if (strcmp(optarg, "ping") == 0) {
+				lat = LST_TEST_PING;
+			} else {
+				fprintf(stderr, "Unknown test type: %s\n",
+					optarg);
+				return -1;
+			}
+			break;
+		case 'j':
+			json = 1;
+			break;
 
 		default:
 			lst_print_usage(argv[0]);
@@ -2650,17 +2835,29 @@ jt_lst_stat(int argc, char **argv)
 		last = now;
 
 		list_for_each_entry(srp, &head, srp_link) {
-                        rc = lst_stat_ioctl(srp->srp_name,
-                                            srp->srp_count, srp->srp_ids,
-                                            timeout, &srp->srp_result[idx]);
+			if (lat != 0)
+				rc = lst_lat_ioctl(srp->srp_name,
+						   srp->srp_count, srp->srp_ids,
+						   lat, timeout,
+						   &srp->srp_result[idx]);
+			else
+				rc = lst_stat_ioctl(srp->srp_name,
+						    srp->srp_count,
+						    srp->srp_ids, timeout,
+						    &srp->srp_result[idx]);
                         if (rc == -1) {
                                 lst_print_error("stat", "Failed to stat %s: %s\n",
                                                 srp->srp_name, strerror(errno));
                                 goto out;
                         }
 
-			lst_print_stat(srp->srp_name, srp->srp_result,
-				       idx, lnet, bwrt, rdwr, type, mbs);
+			if (lat != 0)
+				lst_print_lat(srp->srp_name, srp->srp_result,
+					      idx, lat, json);
+			else
+				lst_print_stat(srp->srp_name, srp->srp_result,
+					       idx, lnet, bwrt, rdwr, type,
+					       mbs);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
 		}
@@ -3648,11 +3845,108 @@ lst_get_bulk_param(int argc, char **argv, struct lst_test_bulk_param *bulk)
         return rc;
 }
 
+/* parse a size with an optional K or M suffix */
+static int
+lst_get_stream_size(char *str, char **end)
+{
+	long size = strtol(str, end, 0);
+
+	if (**end == 'k' || **end == 'K') {
+		size *= 1024;
+		(*end)++;
+	} else if (**end == 'm' || **end == 'M') {
+		size *= 1024 * 1024;
+		(*end)++;
+	}
+
+	if (size <= 0 || size > LST_STREAM_MAX_SIZE)
+		return -1;
+
+	return size;
+}
+
+static int
+lst_get_stream_param(int argc, char **argv,
+		     struct lst_test_stream_param *stream)
+{
+	static const char * const cksums[] = {
+		[LST_STREAM_CKSUM_NONE]		= "none",
+		[LST_STREAM_CKSUM_ADLER]	= "adler",
+		[LST_STREAM_CKSUM_CRC32]	= "crc32",
+		[LST_STREAM_CKSUM_CRC32C]	= "crc32c",
+	};
+	char *tok;
+	char *end;
+	int i;
+	int j;
+
+	stream->stm_min_size = stream->stm_max_size = 1024 * 1024;
+	stream->stm_read_pct = 50;
+	stream->stm_cksum = LST_STREAM_CKSUM_NONE;
+
+	for (i = 0; i < argc; i++) {
+		tok = strchr(argv[i], '=');
+		if (tok == NULL) {
+			fprintf(stderr, "Unknown parameter: %s\n", argv[i]);
+			return -1;
+		}
+		tok++;
+
+		if (strncasecmp(argv[i], "size=", 5) == 0 ||
+		    strncasecmp(argv[i], "s=", 2) == 0) {
+			/* SIZE or MIN-MAX */
+			stream->stm_min_size = lst_get_stream_size(tok, &end);
+			stream->stm_max_size = stream->stm_min_size;
+			if (stream->stm_min_size > 0 && *end == '-')
+				stream->stm_max_size =
+					lst_get_stream_size(end + 1, &end);
+			if (stream->stm_min_size <= 0 ||
+			    stream->stm_max_size < stream->stm_min_size ||
+			    *end != '\0') {
+				fprintf(stderr,
+					"Invalid size %s, sizes are up to %d bytes\n",
+					tok, LST_STREAM_MAX_SIZE);
+				return -1;
+			}
+
+		} else if (strncasecmp(argv[i], "read=", 5) == 0) {
+			stream->stm_read_pct = strtol(tok, &end, 0);
+			if (*end == '%')
+				end++;
+			if (stream->stm_read_pct < 0 ||
+			    stream->stm_read_pct > 100 || *end != '\0') {
+				fprintf(stderr, "Invalid read percentage %s\n",
+					tok);
+				return -1;
+			}
+
+		} else if (strncasecmp(argv[i], "cksum=", 6) == 0) {
+			for (j = 0; j < LST_STREAM_CKSUM_MAX; j++) {
+				if (strcasecmp(tok, cksums[j]) == 0)
+					break;
+			}
+			if (j == LST_STREAM_CKSUM_MAX) {
+				fprintf(stderr, "Unknown checksum type %s\n",
+					tok);
+				return -1;
+			}
+			stream->stm_cksum = j;
+
+		} else {
+			fprintf(stderr, "Unknown parameter: %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 static int
 lst_get_test_param(char *test, int argc, char **argv, void **param, int *plen)
 {
 	struct lst_test_bulk_param *bulk = NULL;
 	struct lst_test_ping_param *ping = NULL;
+	struct lst_test_stream_param *stream = NULL;
         int                    type;
 
         type = lst_test_name2type(test);
@@ -3695,6 +3989,25 @@ lst_get_test_param(char *test, int argc, char **argv, void **param, int *plen)
 
                 break;
 
+	case LST_TEST_STREAM:
+		stream = malloc(sizeof(*stream));
+		if (stream == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+
+		memset(stream, 0, sizeof(*stream));
+
+		if (lst_get_stream_param(argc, argv, stream) != 0) {
+			free(stream);
+			return -1;
+		}
+
+		*param = stream;
+		*plen  = sizeof(*stream);
+
+		break;
+
         default:
                 break;
         }
@@ -3905,7 +4218,8 @@ static command_t lst_cmdlist[] = {
           "Usage: lst list_group [--active] [--busy] [--down] [--unknown] GROUP ..."    },
 	{"stat",                jt_lst_stat,            NULL,
 	 "Usage: lst stat [--bw] [--rate] [--read] [--write] [--max] [--min] [--avg] "
-	 " [--mbs] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"                 },
+	 " [--mbs] [--lat brw|ping [--json]] [--timeout #] [--delay #] [--count #]"
+	 " GROUP [GROUP]"							},
         {"show_error",          jt_lst_show_error,      NULL,
          "Usage: lst show_error NAME | IDS ..."                                         },
         {"add_batch",           jt_lst_add_batch,       NULL,
@@ -3920,7 +4234,9 @@ static command_t lst_cmdlist[] = {
          "Usage: lst query [--test ID] [--server] [--timeout TIME] NAME"                },
         {"add_test",            jt_lst_add_test,        NULL,
          "Usage: lst add_test [--batch BATCH] [--loop #] [--concurrency #] "
-         " [--distribute #:#] [--from GROUP] [--to GROUP] TEST..."                      },
+         " [--distribute #:#] [--from GROUP] [--to GROUP] TEST...\n"
+	 "TEST: ping | brw [read|write] [size=#] [check=full|simple] [off=#] |"
+	 " stream [size=#[-#]] [read=PCT] [cksum=none|adler|crc32|crc32c]" },
         {0,                     0,                      0,      NULL                    }
 };
 
@@ -1467,6 +1467,22 @@ AC_DEFUN([LC_HAVE_CRYPTO_ALLOC_SKCIPHER], [
 	])
 ]) # LC_HAVE_CRYPTO_ALLOC_SKCIPHER
 
+#
+# LC_HAVE_ASM_FPU_API_HEADER
+#
+# Kernel version 4.2 commit df6b35f409af0a8ff1ef62f552b8402f3fef8665
+# x86/fpu: Rename i387.h to fpu/api.h
+#
+AC_DEFUN([LC_SRC_HAVE_ASM_FPU_API_HEADER], [
+	LB2_CHECK_LINUX_HEADER_SRC([asm/fpu/api.h], [-Werror])
+])
+AC_DEFUN([LC_HAVE_ASM_FPU_API_HEADER], [
+	LB2_CHECK_LINUX_HEADER_RESULT([asm/fpu/api.h], [
+		AC_DEFINE(HAVE_ASM_FPU_API_H, 1,
+			[asm/fpu/api.h is present])
+	])
+]) # LC_HAVE_ASM_FPU_API_HEADER
+
 #
 # LC_HAVE_INTERVAL_EXP_BLK_INTEGRITY
 #
@@ -4625,6 +4641,7 @@ AC_DEFUN([LC_PROG_LINUX_SRC], [
 	LC_SRC_SYMLINK_OPS_USE_NAMEIDATA
 	LC_SRC_ACCOUNT_PAGE_DIRTIED_3ARGS
 	LC_SRC_HAVE_CRYPTO_ALLOC_SKCIPHER
+	LC_SRC_HAVE_ASM_FPU_API_HEADER
 
 	# 4.3
 	LC_SRC_HAVE_INTERVAL_EXP_BLK_INTEGRITY
@@ -4924,6 +4941,7 @@ AC_DEFUN([LC_PROG_LINUX_RESULTS], [
 	LC_SYMLINK_OPS_USE_NAMEIDATA
 	LC_ACCOUNT_PAGE_DIRTIED_3ARGS
 	LC_HAVE_CRYPTO_ALLOC_SKCIPHER
+	LC_HAVE_ASM_FPU_API_HEADER
 
 	# 4.3
 	LC_HAVE_INTERVAL_EXP_BLK_INTEGRITY
@@ -32,6 +32,7 @@
 #include <linux/string.h>	/* for memset */
 #include <libcfs/libcfs.h>
 #include "erasure_code.h"
+#include "ec_internal.h"
 
 /* Global GF(256) tables */
 static const unsigned char gff_base[] = {
@@ -315,8 +316,8 @@ void gf_vect_mul_init(unsigned char c, unsigned char *tbl)
 #endif /* BITS_PER_LONG == 64 */
 }
 
-void ec_encode_data(int len, int srcs, int dests, unsigned char *v,
-		    unsigned char **src, unsigned char **dest)
+void ec_encode_data_base(int len, int srcs, int dests, unsigned char *v,
+			 unsigned char **src, unsigned char **dest)
 {
 	int i, j, l;
 	unsigned char s;
@@ -331,10 +332,96 @@ void ec_encode_data(int len, int srcs, int dests, unsigned char *v,
 		}
 	}
 }
+EXPORT_SYMBOL(ec_encode_data_base);
+
+/*
+ * Scalar dot product over [off, len) using the same nibble tables as the
+ * vector kernels, for the bytes left over after the last full vector.
+ */
+static void ec_dot_prod_tail(int off, int len, int srcs, unsigned char *v,
+			     unsigned char **src, unsigned char *dest)
+{
+	unsigned char *tbl;
+	unsigned char s, c;
+	int i, j;
+
+	for (i = off; i < len; i++) {
+		s = 0;
+		for (j = 0, tbl = v; j < srcs; j++, tbl += 32) {
+			c = src[j][i];
+			s ^= tbl[c & 0x0f] ^ tbl[16 + (c >> 4)];
+		}
+		dest[i] = s;
+	}
+}
+
+/*
+ * Bound the time spent with preemption disabled inside
+ * kernel_fpu_begin()/kernel_fpu_end() for large blocks.
+ */
+#define EC_SIMD_CHUNK	(64 * 1024)
+
+void ec_encode_data_impl(const struct ec_impl *impl, int len, int srcs,
+			 int dests, unsigned char *v, unsigned char **src,
+			 unsigned char **dest)
+{
+	int vlen, off, chunk, l;
+
+	if (!impl || len < impl->ei_width || !ec_simd_usable()) {
+		ec_encode_data_base(len, srcs, dests, v, src, dest);
+		return;
+	}
+
+	vlen = len - len % impl->ei_width;
+	for (l = 0; l < dests; l++, v += srcs * 32) {
+		for (off = 0; off < vlen; off += chunk) {
+			chunk = min(vlen - off, EC_SIMD_CHUNK);
+			ec_simd_begin();
+			impl->ei_dot_prod(off, chunk, srcs, v, src, dest[l]);
+			ec_simd_end();
+		}
+		if (vlen < len)
+			ec_dot_prod_tail(vlen, len, srcs, v, src, dest[l]);
+	}
+}
+EXPORT_SYMBOL(ec_encode_data_impl);
+
+static const struct ec_impl *ec_best_impl;
+
+void ec_encode_data(int len, int srcs, int dests, unsigned char *v,
+		    unsigned char **src, unsigned char **dest)
+{
+	ec_encode_data_impl(ec_best_impl, len, srcs, dests, v, src, dest);
+}
 EXPORT_SYMBOL(ec_encode_data);
 
+static char *ec_impl = "auto";
+module_param(ec_impl, charp, 0444);
+MODULE_PARM_DESC(ec_impl,
+		 "erasure code implementation: auto, base, ssse3, avx2, avx512");
+
 static int __init ec_init(void)
 {
+	const struct ec_impl *impl;
+	bool autoselect = strcmp(ec_impl, "auto") == 0;
+	int i;
+
+	for (i = 0; (impl = ec_simd_impl_get(i)) != NULL; i++) {
+		if (!impl->ei_usable())
+			continue;
+		if (autoselect || strcmp(ec_impl, impl->ei_name) == 0) {
+			ec_best_impl = impl;
+			break;
+		}
+	}
+
+	if (!ec_best_impl && !autoselect && strcmp(ec_impl, "base") != 0)
+		CWARN("ec: implementation '%s' unavailable, using base\n",
+		      ec_impl);
+
+	CDEBUG(D_INFO, "ec: using %s encode\n",
+	       ec_best_impl ? ec_best_impl->ei_name : "base");
+
 	return 0;
 }
 
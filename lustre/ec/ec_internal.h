@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ec/ec_internal.h
+ *
+ * Vectorized GF(2^8) dot product implementations used by ec_encode_data()
+ */
+
+#ifndef _EC_INTERNAL_H_
+#define _EC_INTERNAL_H_
+
+#include <linux/types.h>
+
+/*
+ * One vectorized GF(2^8) dot product implementation.
+ *
+ * ei_dot_prod() computes dest[i] = sum_j(gftbls[j] * src[j][i]) for
+ * i in [off, off + len), where len is a multiple of ei_width and each
+ * 32-byte table in gftbls was produced by gf_vect_mul_init().  It is always
+ * called between ec_simd_begin() and ec_simd_end().
+ */
+struct ec_impl {
+	const char	*ei_name;
+	/* bytes consumed per vector iteration */
+	int		 ei_width;
+	bool		(*ei_usable)(void);
+	void		(*ei_dot_prod)(int off, int len, int k,
+				       unsigned char *gftbls,
+				       unsigned char **src,
+				       unsigned char *dest);
+};
+
+/* ordered from the widest to the narrowest vector unit, NULL past the end */
+const struct ec_impl *ec_simd_impl_get(int i);
+
+bool ec_simd_usable(void);
+void ec_simd_begin(void);
+void ec_simd_end(void);
+
+void ec_encode_data_base(int len, int k, int rows, unsigned char *gftbls,
+			 unsigned char **data, unsigned char **coding);
+void ec_encode_data_impl(const struct ec_impl *impl, int len, int k, int rows,
+			 unsigned char *gftbls, unsigned char **data,
+			 unsigned char **coding);
+
+#endif /* _EC_INTERNAL_H_ */
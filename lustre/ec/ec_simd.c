@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ec/ec_simd.c
+ *
+ * Table driven vectorized GF(2^8) dot products for ec_encode_data().
+ *
+ * Every coefficient c is expanded by gf_vect_mul_init() into two 16-byte
+ * tables, c * {0x00 .. 0x0f} and c * {0x00, 0x10 .. 0xf0}.  Since GF(2^8)
+ * multiplication distributes over XOR, c * x is the XOR of the low nibble
+ * lookup and the high nibble lookup, and a byte shuffle (PSHUFB) does 16,
+ * 32 or 64 such lookups at once.
+ *
+ * The kernels follow the lib/raid6 convention of issuing one instruction
+ * per asm statement with fixed register names; this is safe because the
+ * compiler never allocates vector registers in kernel code and the whole
+ * sequence runs between kernel_fpu_begin() and kernel_fpu_end().
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#ifdef CONFIG_X86_64
+#include <asm/cpufeature.h>
+#ifdef HAVE_ASM_FPU_API_H
+#include <asm/fpu/api.h>
+#else
+#include <asm/i387.h>
+#endif
+#endif /* CONFIG_X86_64 */
+#include "ec_internal.h"
+
+#ifdef CONFIG_X86_64
+
+/* Describe the full extent of a vector memory operand to the compiler */
+#define EC_VIN(p, n)	(*(const unsigned char (*)[n])(p))
+#define EC_VOUT(p, n)	(*(unsigned char (*)[n])(p))
+
+static const unsigned char ec_nibble_mask[64] __aligned(64) = {
+	[0 ... 63] = 0x0f
+};
+
+bool ec_simd_usable(void)
+{
+	return irq_fpu_usable();
+}
+
+void ec_simd_begin(void)
+{
+	kernel_fpu_begin();
+}
+
+void ec_simd_end(void)
+{
+	kernel_fpu_end();
+}
+
+static bool ec_ssse3_usable(void)
+{
+	return boot_cpu_has(X86_FEATURE_SSSE3);
+}
+
+/* 32 bytes per iteration: two independent 16-byte accumulators */
+static void ec_dot_prod_ssse3(int off, int len, int k, unsigned char *gftbls,
+			      unsigned char **src, unsigned char *dest)
+{
+	unsigned char *tbl;
+	int i, j;
+
+	asm volatile("movdqa %0,%%xmm15" : : "m" (EC_VIN(ec_nibble_mask, 16)));
+	for (i = off; i < off + len; i += 32) {
+		asm volatile("pxor %xmm0,%xmm0");
+		asm volatile("pxor %xmm8,%xmm8");
+		for (j = 0, tbl = gftbls; j < k; j++, tbl += 32) {
+			asm volatile("movdqu %0,%%xmm1" : : "m" (EC_VIN(tbl, 16)));
+			asm volatile("movdqu %0,%%xmm2" :
+				     : "m" (EC_VIN(tbl + 16, 16)));
+			asm volatile("movdqa %xmm1,%xmm9");
+			asm volatile("movdqa %xmm2,%xmm10");
+			asm volatile("movdqu %0,%%xmm3" :
+				     : "m" (EC_VIN(&src[j][i], 16)));
+			asm volatile("movdqu %0,%%xmm11" :
+				     : "m" (EC_VIN(&src[j][i + 16], 16)));
+			asm volatile("movdqa %xmm3,%xmm4");
+			asm volatile("movdqa %xmm11,%xmm12");
+			asm volatile("psrlw $4,%xmm4");
+			asm volatile("psrlw $4,%xmm12");
+			asm volatile("pand %xmm15,%xmm3");
+			asm volatile("pand %xmm15,%xmm4");
+			asm volatile("pand %xmm15,%xmm11");
+			asm volatile("pand %xmm15,%xmm12");
+			asm volatile("pshufb %xmm3,%xmm1");
+			asm volatile("pshufb %xmm4,%xmm2");
+			asm volatile("pshufb %xmm11,%xmm9");
+			asm volatile("pshufb %xmm12,%xmm10");
+			asm volatile("pxor %xmm1,%xmm0");
+			asm volatile("pxor %xmm2,%xmm0");
+			asm volatile("pxor %xmm9,%xmm8");
+			asm volatile("pxor %xmm10,%xmm8");
+		}
+		asm volatile("movdqu %%xmm0,%0" : "=m" (EC_VOUT(&dest[i], 16)));
+		asm volatile("movdqu %%xmm8,%0" :
+			     "=m" (EC_VOUT(&dest[i + 16], 16)));
+	}
+}
+
+static const struct ec_impl ec_ssse3_impl = {
+	.ei_name	= "ssse3",
+	.ei_width	= 32,
+	.ei_usable	= ec_ssse3_usable,
+	.ei_dot_prod	= ec_dot_prod_ssse3,
+};
+
+static bool ec_avx2_usable(void)
+{
+	return boot_cpu_has(X86_FEATURE_AVX) && boot_cpu_has(X86_FEATURE_AVX2);
+}
+
+/* 64 bytes per iteration: two independent 32-byte accumulators */
+static void ec_dot_prod_avx2(int off, int len, int k, unsigned char *gftbls,
+			     unsigned char **src, unsigned char *dest)
+{
+	unsigned char *tbl;
+	int i, j;
+
+	asm volatile("vmovdqa %0,%%ymm15" : : "m" (EC_VIN(ec_nibble_mask, 32)));
+	for (i = off; i < off + len; i += 64) {
+		asm volatile("vpxor %ymm0,%ymm0,%ymm0");
+		asm volatile("vpxor %ymm8,%ymm8,%ymm8");
+		for (j = 0, tbl = gftbls; j < k; j++, tbl += 32) {
+			/* same 16-byte table in both 128-bit lanes */
+			asm volatile("vbroadcasti128 %0,%%ymm1" :
+				     : "m" (EC_VIN(tbl, 16)));
+			asm volatile("vbroadcasti128 %0,%%ymm2" :
+				     : "m" (EC_VIN(tbl + 16, 16)));
+			asm volatile("vmovdqu %0,%%ymm3" :
+				     : "m" (EC_VIN(&src[j][i], 32)));
+			asm volatile("vmovdqu %0,%%ymm9" :
+				     : "m" (EC_VIN(&src[j][i + 32], 32)));
+			asm volatile("vpsrlw $4,%ymm3,%ymm4");
+			asm volatile("vpsrlw $4,%ymm9,%ymm10");
+			asm volatile("vpand %ymm15,%ymm3,%ymm3");
+			asm volatile("vpand %ymm15,%ymm4,%ymm4");
+			asm volatile("vpand %ymm15,%ymm9,%ymm9");
+			asm volatile("vpand %ymm15,%ymm10,%ymm10");
+			asm volatile("vpshufb %ymm3,%ymm1,%ymm5");
+			asm volatile("vpshufb %ymm4,%ymm2,%ymm6");
+			asm volatile("vpshufb %ymm9,%ymm1,%ymm11");
+			asm volatile("vpshufb %ymm10,%ymm2,%ymm12");
+			asm volatile("vpxor %ymm5,%ymm0,%ymm0");
+			asm volatile("vpxor %ymm6,%ymm0,%ymm0");
+			asm volatile("vpxor %ymm11,%ymm8,%ymm8");
+			asm volatile("vpxor %ymm12,%ymm8,%ymm8");
+		}
+		asm volatile("vmovdqu %%ymm0,%0" : "=m" (EC_VOUT(&dest[i], 32)));
+		asm volatile("vmovdqu %%ymm8,%0" :
+			     "=m" (EC_VOUT(&dest[i + 32], 32)));
+	}
+	asm volatile("vzeroupper");
+}
+
+static const struct ec_impl ec_avx2_impl = {
+	.ei_name	= "avx2",
+	.ei_width	= 64,
+	.ei_usable	= ec_avx2_usable,
+	.ei_dot_prod	= ec_dot_prod_avx2,
+};
+
+#ifdef X86_FEATURE_AVX512BW
+static bool ec_avx512_usable(void)
+{
+	return boot_cpu_has(X86_FEATURE_AVX512F) &&
+	       boot_cpu_has(X86_FEATURE_AVX512BW);
+}
+
+/* 128 bytes per iteration: two independent 64-byte accumulators */
+static void ec_dot_prod_avx512(int off, int len, int k, unsigned char *gftbls,
+			       unsigned char **src, unsigned char *dest)
+{
+	unsigned char *tbl;
+	int i, j;
+
+	asm volatile("vmovdqa64 %0,%%zmm15" :
+		     : "m" (EC_VIN(ec_nibble_mask, 64)));
+	for (i = off; i < off + len; i += 128) {
+		asm volatile("vpxorq %zmm0,%zmm0,%zmm0");
+		asm volatile("vpxorq %zmm8,%zmm8,%zmm8");
+		for (j = 0, tbl = gftbls; j < k; j++, tbl += 32) {
+			/* same 16-byte table in all four 128-bit lanes */
+			asm volatile("vbroadcasti32x4 %0,%%zmm1" :
+				     : "m" (EC_VIN(tbl, 16)));
+			asm volatile("vbroadcasti32x4 %0,%%zmm2" :
+				     : "m" (EC_VIN(tbl + 16, 16)));
+			asm volatile("vmovdqu64 %0,%%zmm3" :
+				     : "m" (EC_VIN(&src[j][i], 64)));
+			asm volatile("vmovdqu64 %0,%%zmm9" :
+				     : "m" (EC_VIN(&src[j][i + 64], 64)));
+			asm volatile("vpsrlw $4,%zmm3,%zmm4");
+			asm volatile("vpsrlw $4,%zmm9,%zmm10");
+			asm volatile("vpandq %zmm15,%zmm3,%zmm3");
+			asm volatile("vpandq %zmm15,%zmm4,%zmm4");
+			asm volatile("vpandq %zmm15,%zmm9,%zmm9");
+			asm volatile("vpandq %zmm15,%zmm10,%zmm10");
+			asm volatile("vpshufb %zmm3,%zmm1,%zmm5");
+			asm volatile("vpshufb %zmm4,%zmm2,%zmm6");
+			asm volatile("vpshufb %zmm9,%zmm1,%zmm11");
+			asm volatile("vpshufb %zmm10,%zmm2,%zmm12");
+			/* zmm0 ^= zmm5 ^ zmm6, zmm8 ^= zmm11 ^ zmm12 */
+			asm volatile("vpternlogq $0x96,%zmm6,%zmm5,%zmm0");
+			asm volatile("vpternlogq $0x96,%zmm12,%zmm11,%zmm8");
+		}
+		asm volatile("vmovdqu64 %%zmm0,%0" :
+			     "=m" (EC_VOUT(&dest[i], 64)));
+		asm volatile("vmovdqu64 %%zmm8,%0" :
+			     "=m" (EC_VOUT(&dest[i + 64], 64)));
+	}
+	asm volatile("vzeroupper");
+}
+
+static const struct ec_impl ec_avx512_impl = {
+	.ei_name	= "avx512",
+	.ei_width	= 128,
+	.ei_usable	= ec_avx512_usable,
+	.ei_dot_prod	= ec_dot_prod_avx512,
+};
+#endif /* X86_FEATURE_AVX512BW */
+
+static const struct ec_impl *const ec_simd_impls[] = {
+#ifdef X86_FEATURE_AVX512BW
+	&ec_avx512_impl,
+#endif
+	&ec_avx2_impl,
+	&ec_ssse3_impl,
+	NULL
+};
+
+#else /* !CONFIG_X86_64 */
+
+bool ec_simd_usable(void)
+{
+	return false;
+}
+
+void ec_simd_begin(void)
+{
+}
+
+void ec_simd_end(void)
+{
+}
+
+static const struct ec_impl *const ec_simd_impls[] = {
+	NULL
+};
+
+#endif /* CONFIG_X86_64 */
+
+/* Return the \a i-th SIMD implementation, or NULL past the last one */
+const struct ec_impl *ec_simd_impl_get(int i)
+{
+	if (i < 0 || i >= ARRAY_SIZE(ec_simd_impls))
+		return NULL;
+
+	return ec_simd_impls[i];
+}
+EXPORT_SYMBOL(ec_simd_impl_get);
@@ -62,40 +62,120 @@ struct fld_cache *fld_cache_init(const char *name, int cache_size,
 	if (cache == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	cache->fci_stat = alloc_percpu(struct fld_stats);
+	if (!cache->fci_stat) {
+		OBD_FREE_PTR(cache);
+		RETURN(ERR_PTR(-ENOMEM));
+	}
+
 	INIT_LIST_HEAD(&cache->fci_entries_head);
 	INIT_LIST_HEAD(&cache->fci_lru);
 
 	cache->fci_cache_count = 0;
-	rwlock_init(&cache->fci_lock);
+	mutex_init(&cache->fci_lock);
+	seqlock_init(&cache->fci_seqlock);
+	RCU_INIT_POINTER(cache->fci_array, NULL);
 
 	strscpy(cache->fci_name, name, sizeof(cache->fci_name));
 
 	cache->fci_cache_size = cache_size;
 	cache->fci_threshold = cache_threshold;
 
-	/* Init fld cache info. */
-	memset(&cache->fci_stat, 0, sizeof(cache->fci_stat));
-
 	CDEBUG(D_INFO, "%s: FLD cache - Size: %d, Threshold: %d\n",
 	       cache->fci_name, cache_size, cache_threshold);
 
 	RETURN(cache);
 }
+EXPORT_SYMBOL(fld_cache_init);
+
+static inline size_t fld_cache_array_size(int count)
+{
+	return offsetof(struct fld_cache_array, fca_ranges[count]) +
+	       count * sizeof(u64);
+}
+
+static void fld_cache_array_free(struct rcu_head *head)
+{
+	struct fld_cache_array *fca = container_of(head, struct fld_cache_array,
+						   fca_rcu);
+
+	OBD_FREE_LARGE(fca, fld_cache_array_size(fca->fca_size));
+}
 
 /**
  * destroy fld cache.
  */
 void fld_cache_fini(struct fld_cache *cache)
 {
+	struct fld_cache_array *fca;
+	struct fld_stats stats;
+
 	LASSERT(cache != NULL);
 	fld_cache_flush(cache);
 
+	fld_cache_stats_get(cache, &stats);
 	CDEBUG(D_INFO, "FLD cache statistics (%s):\n", cache->fci_name);
-	CDEBUG(D_INFO, "  Cache reqs: %llu\n", cache->fci_stat.fst_cache);
-	CDEBUG(D_INFO, "  Total reqs: %llu\n", cache->fci_stat.fst_count);
+	CDEBUG(D_INFO, "  Cache reqs: %llu\n", stats.fst_cache);
+	CDEBUG(D_INFO, "  Total reqs: %llu\n", stats.fst_count);
+
+	fca = rcu_dereference_protected(cache->fci_array, 1);
+	if (fca)
+		OBD_FREE_LARGE(fca, fld_cache_array_size(fca->fca_size));
+	/* wait for the arrays replaced by fld_cache_publish() */
+	rcu_barrier();
 
+	free_percpu(cache->fci_stat);
 	OBD_FREE_PTR(cache);
 }
+EXPORT_SYMBOL(fld_cache_fini);
+
+/**
+ * Copy the sorted entries to the array used by fld_cache_lookup(). Called
+ * with fci_lock held after the entries are changed.
+ *
+ * If a larger array can't be allocated, the array is left empty and the
+ * lookups miss until the next change.
+ */
+static void fld_cache_publish(struct fld_cache *cache)
+{
+	struct fld_cache_array *fca;
+	struct fld_cache_array *old = NULL;
+	struct fld_cache_entry *flde;
+	u64 max_end = 0;
+	int count = 0;
+
+	fca = rcu_dereference_protected(cache->fci_array,
+					mutex_is_locked(&cache->fci_lock));
+	if (!fca || fca->fca_size < cache->fci_cache_count) {
+		struct fld_cache_array *new;
+		int size = roundup_pow_of_two(max(cache->fci_cache_count, 16));
+
+		OBD_ALLOC_LARGE(new, fld_cache_array_size(size));
+		if (new) {
+			new->fca_size = size;
+			new->fca_max_end = (u64 *)&new->fca_ranges[size];
+			old = fca;
+			fca = new;
+		} else if (!fca) {
+			return;
+		}
+	}
+
+	write_seqlock(&cache->fci_seqlock);
+	if (fca->fca_size >= cache->fci_cache_count) {
+		list_for_each_entry(flde, &cache->fci_entries_head, fce_list) {
+			fca->fca_ranges[count] = flde->fce_range;
+			max_end = max(max_end, flde->fce_range.lsr_end);
+			fca->fca_max_end[count++] = max_end;
+		}
+	}
+	fca->fca_count = count;
+	rcu_assign_pointer(cache->fci_array, fca);
+	write_sequnlock(&cache->fci_seqlock);
+
+	if (old)
+		call_rcu(&old->fca_rcu, fld_cache_array_free);
+}
 
 /**
  * delete given node from list.
@@ -231,10 +311,11 @@ void fld_cache_flush(struct fld_cache *cache)
 {
 	ENTRY;
 
-	write_lock(&cache->fci_lock);
+	mutex_lock(&cache->fci_lock);
 	cache->fci_cache_size = 0;
 	fld_cache_shrink(cache);
-	write_unlock(&cache->fci_lock);
+	fld_cache_publish(cache);
+	mutex_unlock(&cache->fci_lock);
 
 	EXIT;
 }
@@ -254,7 +335,7 @@ static void fld_cache_punch_hole(struct fld_cache *cache,
 	struct fld_cache_entry *fldt;
 
 	ENTRY;
-	OBD_ALLOC_GFP(fldt, sizeof(*fldt), GFP_ATOMIC);
+	OBD_ALLOC_PTR(fldt);
 	if (!fldt) {
 		OBD_FREE_PTR(f_new);
 		EXIT;
@@ -414,6 +495,7 @@ int fld_cache_insert_nolock(struct fld_cache *cache,
 	/* Add new entry to cache and lru list. */
 	fld_cache_entry_add(cache, f_new, prev);
 out:
+	fld_cache_publish(cache);
 	RETURN(0);
 }
 
@@ -427,14 +509,15 @@ int fld_cache_insert(struct fld_cache *cache,
 	if (IS_ERR(flde))
 		RETURN(PTR_ERR(flde));
 
-	write_lock(&cache->fci_lock);
+	mutex_lock(&cache->fci_lock);
 	rc = fld_cache_insert_nolock(cache, flde);
-	write_unlock(&cache->fci_lock);
+	mutex_unlock(&cache->fci_lock);
 	if (rc)
 		OBD_FREE_PTR(flde);
 
 	RETURN(rc);
 }
+EXPORT_SYMBOL(fld_cache_insert);
 
 void fld_cache_delete_nolock(struct fld_cache *cache,
 		      const struct lu_seq_range *range)
@@ -453,40 +536,107 @@ void fld_cache_delete_nolock(struct fld_cache *cache,
 			break;
 		}
 	}
+	fld_cache_publish(cache);
+}
+
+/**
+ * Search \a seq in \a fca like a walk of the sorted entries list would.
+ *
+ * \retval 0		\a range is the first range containing \a seq
+ * \retval -ENOENT	\a range is the last range starting before \a seq
+ *			if \a left is set
+ */
+static int fld_cache_array_lookup(const struct fld_cache_array *fca,
+				  const u64 seq, struct lu_seq_range *range,
+				  bool *left)
+{
+	int count = min(READ_ONCE(fca->fca_count), fca->fca_size);
+	int first = 0;
+	int last = count;
+	int i;
+
+	/* the ranges before \a last start at or before seq */
+	while (first < last) {
+		i = first + (last - first) / 2;
+		if (fca->fca_ranges[i].lsr_start > seq)
+			last = i;
+		else
+			first = i + 1;
+	}
+
+	/* the ranges before \a first all end at or before seq */
+	for (first = 0, i = last; first < i; ) {
+		int mid = first + (i - first) / 2;
+
+		if (fca->fca_max_end[mid] > seq)
+			i = mid;
+		else
+			first = mid + 1;
+	}
+
+	for (i = first; i < last; i++) {
+		if (lu_seq_range_within(&fca->fca_ranges[i], seq)) {
+			*range = fca->fca_ranges[i];
+			return 0;
+		}
+	}
+
+	*left = last > 0 && last < count;
+	if (*left)
+		*range = fca->fca_ranges[last - 1];
+
+	return -ENOENT;
 }
 
 /**
  * lookup \a seq sequence for range in fld cache.
+ *
+ * Lookups don't take any lock, they search the array of the cache entries
+ * published by fld_cache_publish() and retry if it is changed meanwhile.
  */
 int fld_cache_lookup(struct fld_cache *cache,
 		     const u64 seq, struct lu_seq_range *range)
 {
-	struct fld_cache_entry *flde;
-	struct fld_cache_entry *prev = NULL;
-	struct list_head *head;
+	struct fld_cache_array *fca;
+	struct lu_seq_range res;
+	unsigned int start;
+	bool left;
+	int rc;
 
 	ENTRY;
 
-	read_lock(&cache->fci_lock);
-	head = &cache->fci_entries_head;
-
-	cache->fci_stat.fst_count++;
-	list_for_each_entry(flde, head, fce_list) {
-		if (flde->fce_range.lsr_start > seq) {
-			if (prev != NULL)
-				*range = prev->fce_range;
-			break;
-		}
+	rcu_read_lock();
+	do {
+		start = read_seqbegin(&cache->fci_seqlock);
+		left = false;
+		fca = rcu_dereference(cache->fci_array);
+		rc = fca ? fld_cache_array_lookup(fca, seq, &res, &left) :
+			   -ENOENT;
+	} while (read_seqretry(&cache->fci_seqlock, start));
+	rcu_read_unlock();
+
+	this_cpu_inc(cache->fci_stat->fst_count);
+	if (rc == 0) {
+		this_cpu_inc(cache->fci_stat->fst_cache);
+		*range = res;
+	} else if (left) {
+		*range = res;
+	}
 
-		prev = flde;
-		if (lu_seq_range_within(&flde->fce_range, seq)) {
-			*range = flde->fce_range;
+	RETURN(rc);
+}
+EXPORT_SYMBOL(fld_cache_lookup);
 
-			cache->fci_stat.fst_cache++;
-			read_unlock(&cache->fci_lock);
-			RETURN(0);
-		}
+void fld_cache_stats_get(struct fld_cache *cache, struct fld_stats *stats)
+{
+	struct fld_stats *pcpu;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		pcpu = per_cpu_ptr(cache->fci_stat, cpu);
+		stats->fst_count += pcpu->fst_count;
+		stats->fst_cache += pcpu->fst_cache;
 	}
-	read_unlock(&cache->fci_lock);
-	RETURN(-ENOENT);
 }
+EXPORT_SYMBOL(fld_cache_stats_get);
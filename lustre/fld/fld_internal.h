@@ -59,7 +59,9 @@
 #include <lustre_fld.h>
 
 struct fld_stats {
+	/* lookups */
 	__u64	fst_count;
+	/* lookups which hit the cache */
 	__u64	fst_cache;
 };
 
@@ -78,9 +80,30 @@ struct fld_cache_entry {
 	struct lu_seq_range	fce_range;
 };
 
+/*
+ * Copy of the sorted fld cache entries searched without locking by
+ * fld_cache_lookup(), it is rebuilt after every change of the entries.
+ */
+struct fld_cache_array {
+	struct rcu_head		fca_rcu;
+	/* number of ranges allocated */
+	int			fca_size;
+	/* number of valid ranges, 0 if the array couldn't be grown */
+	int			fca_count;
+	/* fca_max_end[i] is the largest lsr_end of fca_ranges[0..i] */
+	u64			*fca_max_end;
+	struct lu_seq_range	fca_ranges[];
+};
+
 struct fld_cache {
-	/* Cache guard, protects fci_hash as immutable after init is finished */
-	rwlock_t		fci_lock;
+	/* Cache guard, serializes the changes of the cache entries */
+	struct mutex		fci_lock;
+
+	/* Protects the content of fci_array against lookups */
+	seqlock_t		fci_seqlock;
+
+	/* Sorted ranges for lookups, freed after an RCU grace period */
+	struct fld_cache_array __rcu *fci_array;
 
 	/* Cache shrink threshold */
 	int			fci_threshold;
@@ -97,8 +120,8 @@ struct fld_cache {
 	/* sorted fld entries. */
 	struct list_head	fci_entries_head;
 
-	/* Cache statistics. */
-	struct fld_stats	fci_stat;
+	/* Cache statistics, per CPU. */
+	struct fld_stats __percpu *fci_stat;
 
 	/* Cache name used for debug and messages. */
 	char			fci_name[LUSTRE_MDT_MAXNAMELEN];
@@ -185,6 +208,7 @@ void fld_cache_delete_nolock(struct fld_cache *cache,
 			     const struct lu_seq_range *range);
 int fld_cache_lookup(struct fld_cache *cache,
 		     const u64 seq, struct lu_seq_range *range);
+void fld_cache_stats_get(struct fld_cache *cache, struct fld_stats *stats);
 
 static inline const char *
 fld_target_name(const struct lu_fld_target *tar)
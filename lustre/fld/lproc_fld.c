@@ -115,6 +115,21 @@ fld_debugfs_hash_seq_write(struct file *file, const char __user *buffer,
 	return count;
 }
 
+static int
+fld_debugfs_cache_stats_seq_show(struct seq_file *m, void *unused)
+{
+	struct lu_client_fld *fld = (struct lu_client_fld *)m->private;
+	struct fld_stats stats;
+
+	ENTRY;
+	fld_cache_stats_get(fld->lcf_cache, &stats);
+	seq_printf(m, "lookups: %llu\nhits: %llu\nmisses: %llu\n",
+		   stats.fst_count, stats.fst_cache,
+		   stats.fst_count - stats.fst_cache);
+
+	RETURN(0);
+}
+
 static ssize_t ldebugfs_cache_flush_seq_write(struct file *file,
 					      const char __user *buffer,
 					      size_t count, loff_t *pos)
@@ -132,6 +147,7 @@ static ssize_t ldebugfs_cache_flush_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS_RO(fld_debugfs_targets);
 LDEBUGFS_SEQ_FOPS(fld_debugfs_hash);
+LDEBUGFS_SEQ_FOPS_RO(fld_debugfs_cache_stats);
 LDEBUGFS_FOPS_WR_ONLY(fld, cache_flush);
 
 struct ldebugfs_vars fld_client_debugfs_list[] = {
@@ -141,6 +157,8 @@ struct ldebugfs_vars fld_client_debugfs_list[] = {
 	  .fops	=	&fld_debugfs_hash_fops	},
 	{ .name	=	"cache_flush",
 	  .fops	=	&fld_cache_flush_fops	},
+	{ .name	=	"cache_stats",
+	  .fops	=	&fld_debugfs_cache_stats_fops	},
 	{ NULL }
 };
 
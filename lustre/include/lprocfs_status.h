@@ -399,6 +399,8 @@ enum brw_rw_stats {
 	BRW_W_DISK_IOSIZE,
 	BRW_MAP_TIME,
 	BRW_ALLOC_TIME,
+	BRW_COMMIT_MAP_TIME,
+	BRW_COMMIT_WAIT_TIME,
 	BRW_RW_STATS_NUM,
 };
 
@@ -117,10 +117,25 @@ struct target_distribute_txn_data {
 	void			*tdtd_show_retrievers_cbdata;
 };
 
+/* per-CPU share of the grant counters, see tgt_grant.c */
+struct tg_grant_shard {
+	spinlock_t		 tgs_lock;
+	/* changes of tgd_tot_* not folded into them yet */
+	s64			 tgs_dirty;
+	s64			 tgs_granted;
+	s64			 tgs_pending;
+	/* space counted in tgd_tot_granted, not granted to any export yet */
+	u64			 tgs_avail;
+};
+
 struct tg_grants_data {
 	/* grants: all values in bytes */
-	/* grant lock to protect all grant counters */
+	/* grant lock to protect the grant totals and the space left */
 	spinlock_t		 tgd_grant_lock;
+	/* grant counters updated without tgd_grant_lock */
+	struct tg_grant_shard __percpu *tgd_grant_shards;
+	/* tgd_grant_shards are not used while the totals must be exact */
+	bool			 tgd_grant_frozen;
 	/* total amount of dirty data reported by clients in incoming obdo */
 	u64			 tgd_tot_dirty;
 	/* sum of filesystem space granted to clients for async writes */
@@ -561,6 +576,8 @@ static inline int exp_grant_param_supp(struct obd_export *exp)
 #define COMPAT_BSIZE_SHIFT 12
 
 void tgt_grant_sanity_check(struct obd_device *obd, const char *func);
+void tgt_grant_totals(struct tg_grants_data *tgd, u64 *dirty, u64 *granted,
+		      u64 *pending);
 void tgt_grant_connect(const struct lu_env *env, struct obd_export *exp,
 		       struct obd_connect_data *data, bool new_conn);
 void tgt_grant_discard(struct obd_export *exp);
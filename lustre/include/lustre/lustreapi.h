@@ -444,6 +444,8 @@ struct find_param {
 	__u64			 fp_attrs;
 	__u64			 fp_neg_attrs;
 	struct xattr_match_info	*fp_xattr_match_info;
+	/* number of threads walking the tree (lfs find only) */
+	unsigned int		 fp_threads;
 };
 
 int llapi_ostlist(char *path, struct find_param *param);
@@ -1335,6 +1337,7 @@ bool llapi_mirror_is_sparse(int fd, unsigned int id);
 
 int llapi_heat_get(int fd, struct lu_heat *heat);
 int llapi_heat_set(int fd, __u64 flags);
+int llapi_ra_stats_get(int fd, struct lu_ra_stats *stats);
 
 int llapi_ioctl(int fd, unsigned int cmd, void *buf);
 
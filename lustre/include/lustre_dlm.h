@@ -49,6 +49,7 @@
 #include <lustre_handles.h>
 #include <interval_tree.h> /* for interval_node{}, ldlm_extent */
 #include <linux/interval_tree_generic.h>
+#include <libcfs/linux/linux-hash.h>
 #include <lu_ref.h>
 
 #include "lustre_dlm_flags.h"
@@ -354,10 +355,6 @@ struct ldlm_ns_bucket {
 	 * fact the network or overall system load is at fault
 	 */
 	struct adaptive_timeout     nsb_at_estimate;
-	/**
-	 * Which res in the bucket should we start with the reclaim.
-	 */
-	int			    nsb_reclaim_start;
 	/* counter of entries in this bucket */
 	atomic_t		nsb_count;
 };
@@ -417,8 +414,12 @@ struct ldlm_namespace {
 	/** name of this namespace */
 	char			*ns_name;
 
-	/** Resource hash table for namespace. */
-	struct cfs_hash		*ns_rs_hash;
+	/**
+	 * Resource hash table for namespace, looked up under RCU.  The
+	 * resources are also spread over ns_rs_buckets by FID, which only
+	 * hold the per-bucket adaptive timeout and resource count.
+	 */
+	struct rhashtable	ns_rs_hash;
 	struct ldlm_ns_bucket	*ns_rs_buckets;
 	unsigned int		ns_bucket_bits;
 
@@ -835,17 +836,17 @@ struct ldlm_lock {
 		struct {
 			struct interval_node	l_tree_node_flock;
 			/**
-			 * Per export hash of flock locks.
-			 * Protected by per-bucket exp->exp_flock_hash locks.
+			 * Per export hash of blocked flock locks, keyed by
+			 * owner.  Holds a reference while hashed.
 			 */
-			struct hlist_node	l_exp_flock_hash;
+			struct rhlist_head	l_exp_flock_hash;
 		};
 	};
 	/**
-	 * Per export hash of locks.
-	 * Protected by per-bucket exp->exp_lock_hash locks.
+	 * Per export hash of locks, keyed by l_remote_handle.
+	 * Holds a reference while hashed.
 	 */
-	struct hlist_node	l_exp_hash;
+	struct rhlist_head	l_exp_hash;
 	/**
 	 * Requested mode.
 	 * Protected by lr_lock.
@@ -1098,14 +1099,11 @@ struct ldlm_resource {
 	struct ldlm_ns_bucket	*lr_ns_bucket;
 
 	/**
-	 * List item for list in namespace hash.
-	 * protected by ns_lock.
-	 * Shared with linkage for RCU-delayed free.
+	 * Linkage in the namespace hash.  Lookups walk it under RCU, so it
+	 * must stay valid until lr_rcu frees the resource.
 	 */
-	union {
-		struct hlist_node	lr_hash;
-		struct rcu_head		lr_rcu;
-	};
+	struct rhash_head	lr_hash;
+	struct rcu_head		lr_rcu;
 
 	/** Reference count for this resource */
 	refcount_t		lr_refcount;
@@ -1419,6 +1417,8 @@ int ldlm_resource_foreach(struct ldlm_resource *res, ldlm_iterator_t iter,
 			  void *closure);
 void ldlm_namespace_foreach(struct ldlm_namespace *ns, ldlm_iterator_t iter,
 			    void *closure);
+int ldlm_namespace_res_foreach(struct ldlm_namespace *ns,
+			       ldlm_res_iterator_t iter, void *closure);
 int ldlm_resource_iterate(struct ldlm_namespace *ln,
 			  const struct ldlm_res_id *lri,
 			  ldlm_iterator_t iter, void *data);
@@ -1494,6 +1494,14 @@ int ldlm_get_ref(void);
 void ldlm_put_ref(void);
 int ldlm_init_export(struct obd_export *exp);
 void ldlm_destroy_export(struct obd_export *exp);
+int ldlm_export_lock_add(struct ldlm_lock *lock);
+void ldlm_export_lock_del(struct ldlm_lock *lock);
+void ldlm_export_lock_rehash(struct obd_export *exp, struct ldlm_lock *lock,
+			     const struct lustre_handle *remote);
+struct ldlm_lock *ldlm_export_lock_lookup(struct obd_export *exp,
+					  const struct lustre_handle *remote);
+int ldlm_export_lock_foreach(struct obd_export *exp, ldlm_iterator_t iter,
+			     void *closure);
 struct ldlm_lock *ldlm_request_lock(struct ptlrpc_request *req);
 
 /* ldlm_lock.c */
@@ -41,7 +41,7 @@
  * @{
  */
 
-#include <linux/rhashtable.h>
+#include <libcfs/linux/linux-hash.h>
 #include <linux/workqueue.h>
 
 #include <uapi/linux/lustre/lustre_idl.h>
@@ -95,7 +95,8 @@ struct tg_export_data {
 	int			ted_reply_max; /* high water mark */
 	int			ted_release_xid;
 	int			ted_release_tag;
-	/* grants */
+	/* grants, protected by ted_grant_lock */
+	spinlock_t		ted_grant_lock;
 	long			ted_dirty;    /* in bytes */
 	long			ted_grant;    /* in bytes */
 	long			ted_pending;  /* bytes just being written */
@@ -231,13 +232,15 @@ struct obd_export {
 	struct ptlrpc_connection *exp_connection;
 	/** Connection count value from last successful reconnect rpc */
 	__u32			  exp_conn_cnt;
-	/** Hash list of all ldlm locks granted on this export */
-	struct cfs_hash		 *exp_lock_hash;
+	/** Hash of all ldlm locks granted on this export */
+	struct rhltable		*exp_lock_hash;
+	/** Serializes rehashes, lets lookups retry a miss during one */
+	seqlock_t		exp_lock_hash_seq;
 	/**
-	 * Hash list for Posix lock deadlock detection, added with
+	 * Hash for Posix lock deadlock detection, added with
 	 * ldlm_lock::l_exp_flock_hash.
 	 */
-	struct cfs_hash		*exp_flock_hash;
+	struct rhltable		*exp_flock_hash;
 	struct list_head	exp_outstanding_replies;
 	struct list_head	exp_uncommitted_replies;
 	spinlock_t		exp_uncommitted_replies_lock;
@@ -76,6 +76,15 @@ struct cat_handle_data {
 	struct list_head	chd_head;
 	struct llog_handle     *chd_current_log;/* currently open log */
 	struct llog_handle     *chd_next_log;	/* llog to be used next */
+	/* header writes and records of the appends to the plain llogs */
+	atomic64_t		chd_batches;
+	atomic64_t		chd_batch_recs;
+	/* llog_cat_add_rec() callers whose record is not appended yet */
+	atomic_t		chd_appenders;
+	/* appenders waiting for their deferred header write */
+	wait_queue_head_t	chd_flush_waitq;
+	/* appends of concurrent transactions share a header write */
+	bool			chd_group_commit;
 };
 
 struct llog_handle;
@@ -162,6 +171,10 @@ int llog_cat_add_rec(const struct lu_env *env, struct llog_handle *cathandle,
 int llog_cat_declare_add_rec(const struct lu_env *env,
 			     struct llog_handle *cathandle,
 			     struct llog_rec_hdr *rec, struct thandle *th);
+int llog_cat_add_arr_rec(const struct lu_env *env,
+			 struct llog_handle *cathandle, int count,
+			 struct llog_rec_hdr **recs,
+			 struct llog_cookie *cookies, struct thandle *th);
 int llog_cat_add(const struct lu_env *env, struct llog_handle *cathandle,
 		 struct llog_rec_hdr *rec, struct llog_cookie *reccookie);
 int llog_cat_cancel_arr_rec(const struct lu_env *env,
@@ -297,6 +310,11 @@ struct llog_handle {
 	 */
 	int			 lgh_last_idx;
 	struct rw_semaphore	 lgh_last_sem;
+	/* first record appended while the header update is deferred */
+	int			 lgh_hdr_defer_idx;
+	bool			 lgh_hdr_defer;
+	/* number of header writes covering all the appended records */
+	__u64			 lgh_hdr_gen;
 	__u64			 lgh_cur_offset; /* used for test only */
 	struct llog_ctxt	*lgh_ctxt;
 	union {
@@ -604,6 +622,9 @@ int llog_write_rec(const struct lu_env *env, struct llog_handle *handle,
 int llog_add(const struct lu_env *env, struct llog_handle *lgh,
 	     struct llog_rec_hdr *rec, struct llog_cookie *logcookies,
 	     struct thandle *th);
+int llog_add_arr(const struct lu_env *env, struct llog_handle *lgh,
+		 int count, struct llog_rec_hdr **recs,
+		 struct llog_cookie *logcookies, struct thandle *th);
 int llog_declare_add(const struct lu_env *env, struct llog_handle *lgh,
 		     struct llog_rec_hdr *rec, struct thandle *th);
 int lustre_process_log(struct super_block *sb, char *logname,
@@ -1174,8 +1174,15 @@ static inline bool ptlrpc_nrs_req_can_move(struct ptlrpc_request *req)
 	 * request has been enqueued first, and ptlrpc_nrs_request::nr_started
 	 * to make sure it has not been scheduled yet (analogous to previous
 	 * (non-NRS) checking of !list_empty(&ptlrpc_request::rq_list).
+	 * A request still on ptlrpc_nrs::nrs_arrivals is on no policy yet, so
+	 * it cannot be removed from one; ptlrpc_nrs_req_hp_move() drains the
+	 * arrivals first, so only a request still being added is skipped.
+	 * A request on ptlrpc_nrs::nrs_cpu_queues is on no policy either, it
+	 * is moved straight from its queue.
 	 */
-	return nrq->nr_enqueued && !nrq->nr_started && !req->rq_hp;
+	return (nrq->nr_enqueued || READ_ONCE(nrq->nr_cpu_queued)) &&
+	       !READ_ONCE(nrq->nr_arriving) && !nrq->nr_started &&
+	       !req->rq_hp;
 }
 /** @} nrs */
 
@@ -1737,8 +1744,11 @@ struct ptlrpc_service_part {
 	 */
 	spinlock_t			scp_req_lock __cfs_cacheline_aligned;
 	/** # reqs in either of the NRS heads below */
-	/** # reqs being served */
-	int				scp_nreqs_active;
+	/**
+	 * # reqs being served; also changed without scp_req_lock by
+	 * ptlrpc_server_request_get_direct()
+	 */
+	atomic_t			scp_nreqs_active;
 	/** # HPreqs being served */
 	int				scp_nhreqs_active;
 	/** # hp requests handled */
@@ -32,6 +32,8 @@
 #ifndef _LUSTRE_NRS_H
 #define _LUSTRE_NRS_H
 
+#include <linux/llist.h>
+
 /**
  * \defgroup nrs Network Request Scheduler
  * @{
@@ -303,6 +305,16 @@ enum ptlrpc_nrs_queue_type {
 	PTLRPC_NRS_QUEUE_BOTH	= (PTLRPC_NRS_QUEUE_REG | PTLRPC_NRS_QUEUE_HP)
 };
 
+/**
+ * Per-CPU queue of requests of an NRS head, see ptlrpc_nrs::nrs_cpu_queues
+ */
+struct ptlrpc_nrs_cpu_queue {
+	spinlock_t			ncq_lock;
+	struct list_head		ncq_list;
+	/** # requests got from this queue */
+	unsigned int			ncq_gets;
+};
+
 /**
  * NRS head
  *
@@ -386,6 +398,27 @@ struct ptlrpc_nrs {
 	 * NRS policy is throttling reqeust
 	 */
 	unsigned			nrs_throttling:1;
+	/**
+	 * Requests added to this NRS head that are not enqueued on a policy
+	 * yet. They are added without ptlrpc_service_part::scp_req_lock and
+	 * moved to the policies in arrival order by the next thread getting a
+	 * request under the lock, so threads adding requests never contend
+	 * with threads handling them. Kept on its own cacheline, away from
+	 * the fields protected by the lock.
+	 */
+	struct llist_head		nrs_arrivals __cfs_cacheline_aligned;
+	/**
+	 * Requests added to the regular NRS head while it has no primary
+	 * policy, i.e. while they would be served in FIFO order. They are
+	 * queued on the queue of the CPU adding them, and a thread getting a
+	 * request takes one from the queue of its CPU, or steals one from the
+	 * queue of another CPU, without ptlrpc_service_part::scp_req_lock.
+	 * Moved to the policies by the next thread getting a request under
+	 * the lock once a primary policy is started.
+	 */
+	struct ptlrpc_nrs_cpu_queue __percpu *nrs_cpu_queues;
+	/** # requests on ptlrpc_nrs::nrs_cpu_queues */
+	atomic_t			nrs_cpu_queued;
 };
 
 #define NRS_POL_NAME_MAX		16
@@ -703,6 +736,7 @@ struct binheap_node {
 #include <lustre_nrs_tbf.h>
 #include <lustre_nrs_crr.h>
 #include <lustre_nrs_orr.h>
+#include <lustre_nrs_hdrr.h>
 #endif /* HAVE_SERVER_SUPPORT */
 #include <lustre_nrs_delay.h>
 
@@ -730,7 +764,22 @@ struct ptlrpc_nrs_request {
 	unsigned int			nr_enqueued:1;
 	unsigned int			nr_started:1;
 	unsigned int			nr_finalized:1;
+	/**
+	 * added to ptlrpc_nrs::nrs_arrivals, not yet on a policy; set without
+	 * ptlrpc_service_part::scp_req_lock, so kept out of the bitfield
+	 */
+	bool				nr_arriving;
 	struct binheap_node		nr_node;
+	/** linkage into ptlrpc_nrs::nrs_arrivals */
+	struct llist_node		nr_arrival;
+	/**
+	 * on ptlrpc_nrs::nrs_cpu_queues; protected by the
+	 * ptlrpc_nrs_cpu_queue::ncq_lock of CPU \a nr_cpu
+	 */
+	bool				nr_cpu_queued;
+	int				nr_cpu;
+	/** linkage into ptlrpc_nrs_cpu_queue::ncq_list */
+	struct list_head		nr_cpu_link;
 
 	/**
 	 * Policy-specific fields, used for determining a request's scheduling
@@ -752,6 +801,10 @@ struct ptlrpc_nrs_request {
 		 * TBF request definition
 		 */
 		struct nrs_tbf_req	tbf;
+		/**
+		 * HDRR request definition
+		 */
+		struct nrs_hdrr_req	hdrr;
 #endif /* HAVE_SERVER_SUPPORT */
 		/**
 		 * Fields for the delay policy
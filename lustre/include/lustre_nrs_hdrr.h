@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/include/lustre_nrs_hdrr.h
+ *
+ * Network Request Scheduler (NRS) Hierarchical Deficit Round Robin (HDRR)
+ * policy
+ */
+
+#ifndef _LUSTRE_NRS_HDRR_H
+#define _LUSTRE_NRS_HDRR_H
+
+/**
+ * \name HDRR
+ *
+ * HDRR, Hierarchical Deficit Round Robin over project, UID and JobID
+ * @{
+ */
+#include <linux/rhashtable.h>
+
+/**
+ * Levels of the scheduling hierarchy; requests are queued on JobID nodes,
+ * which are children of UID nodes, which are children of project nodes.
+ */
+enum nrs_hdrr_level {
+	NRS_HDRR_PROJECT	= 0,
+	NRS_HDRR_UID		= 1,
+	NRS_HDRR_JOBID		= 2,
+	NRS_HDRR_LEVELS
+};
+
+/** share of a node with no configured share */
+#define NRS_HDRR_SHARE_DEFAULT	100
+#define NRS_HDRR_SHARE_MAX	10000
+/** maximum number of configured shares per policy instance */
+#define NRS_HDRR_SHARES_MAX	64
+
+/** deficit granted to a node with the default share in each round */
+#define NRS_HDRR_QUANTUM_DEFAULT	(1U << 20)
+#define NRS_HDRR_QUANTUM_MIN		PAGE_SIZE
+#define NRS_HDRR_QUANTUM_MAX		(64U << 20)
+
+/**
+ * Cost of RPCs without bulk, by operation class, in the same unit as the
+ * bulk bytes of OST_READ and OST_WRITE RPCs.
+ */
+#define NRS_HDRR_COST_META	(4U << 10)	/* getattr, statfs, ... */
+#define NRS_HDRR_COST_MODIFY	(16U << 10)	/* reint, open, punch, ... */
+#define NRS_HDRR_COST_READDIR	(64U << 10)	/* readpage */
+
+/**
+ * Key of a node in the hierarchy; only the fields of the levels down to
+ * hk_level are set, the others are zero.
+ */
+struct nrs_hdrr_key {
+	__u32				hk_level;
+	__u32				hk_projid;
+	__u32				hk_uid;
+	char				hk_jobid[LUSTRE_JOBID_SIZE];
+};
+
+/**
+ * A configured share, matching the nodes of level hs_level by project ID,
+ * UID or JobID.
+ */
+struct nrs_hdrr_share {
+	__u32				hs_level;
+	__u32				hs_id;
+	char				hs_jobid[LUSTRE_JOBID_SIZE];
+	__u32				hs_share;
+};
+
+/**
+ * A project, UID or JobID in the scheduling hierarchy.
+ */
+struct nrs_hdrr_node {
+	struct ptlrpc_nrs_resource	hn_res;
+	struct rhash_head		hn_rhead;
+	struct nrs_hdrr_key		hn_key;
+	struct nrs_hdrr_node	       *hn_parent;
+	/** linkage into nrs_hdrr_head::hh_nodes */
+	struct list_head		hn_list;
+	/** linkage into the active list of the parent node or of the head */
+	struct list_head		hn_active;
+	/**
+	 * Active child nodes in round robin order, or the queued requests
+	 * in arrival order for JobID nodes.
+	 */
+	struct list_head		hn_queue;
+	/**
+	 * Requests pending and being handled for this node, and child nodes;
+	 * protected by nrs_hdrr_head::hh_lock.
+	 */
+	unsigned int			hn_ref;
+	/** requests queued in this subtree */
+	unsigned int			hn_queued;
+	/** configured share, relative to NRS_HDRR_SHARE_DEFAULT */
+	unsigned int			hn_share;
+	/** the node got its quantum in the current visit */
+	unsigned int			hn_granted:1;
+	/** cost this node may still dispatch in the current visit */
+	__s64				hn_deficit;
+};
+
+/**
+ * Private data structure of an HDRR policy instance.
+ */
+struct nrs_hdrr_head {
+	struct ptlrpc_nrs_resource	hh_res;
+	/** protects the node hash, hh_nodes, the node refs and the shares */
+	spinlock_t			hh_lock;
+	struct rhashtable		hh_node_hash;
+	struct list_head		hh_nodes;
+	/** active project nodes in round robin order */
+	struct list_head		hh_active;
+	/** deficit granted in each round to a node with the default share */
+	__u32				hh_quantum;
+	unsigned int			hh_nshares;
+	struct nrs_hdrr_share		hh_shares[NRS_HDRR_SHARES_MAX];
+};
+
+/**
+ * HDRR NRS request definition
+ */
+struct nrs_hdrr_req {
+	/** linkage into the queue of the JobID node */
+	struct list_head		hr_list;
+	/** bulk bytes, or the cost of the operation class */
+	__u64				hr_cost;
+};
+
+/**
+ * HDRR policy operations.
+ *
+ * Read the quantum of an HDRR policy.
+ */
+#define NRS_CTL_HDRR_RD_QUANTUM	PTLRPC_NRS_CTL_POL_SPEC_01
+/**
+ * Write the quantum of an HDRR policy.
+ */
+#define NRS_CTL_HDRR_WR_QUANTUM	PTLRPC_NRS_CTL_POL_SPEC_02
+/**
+ * Print the configured shares of an HDRR policy.
+ */
+#define NRS_CTL_HDRR_RD_SHARES	PTLRPC_NRS_CTL_POL_SPEC_03
+/**
+ * Set, change or remove a share of an HDRR policy.
+ */
+#define NRS_CTL_HDRR_WR_SHARE	PTLRPC_NRS_CTL_POL_SPEC_04
+
+/** @} HDRR */
+#endif
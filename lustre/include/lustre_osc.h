@@ -661,8 +661,7 @@ int osc_cleanup_common(struct obd_device *obd);
 int osc_set_info_async(const struct lu_env *env, struct obd_export *exp,
 		       u32 keylen, void *key, u32 vallen, void *val,
 		       struct ptlrpc_request_set *set);
-int osc_ldlm_resource_invalidate(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				 struct hlist_node *hnode, void *arg);
+int osc_ldlm_resource_invalidate(struct ldlm_resource *res, void *arg);
 int osc_reconnect(const struct lu_env *env, struct obd_export *exp,
 		  struct obd_device *obd, struct obd_uuid *cluuid,
 		  struct obd_connect_data *data, void *localdata);
@@ -80,9 +80,7 @@ extern bool obd_enable_health_write;
 #define HASH_LQE_BKT_BITS 5
 #define HASH_LQE_CUR_BITS 7
 #define HASH_LQE_MAX_BITS 12
-#define HASH_EXP_LOCK_BKT_BITS  5
 #define HASH_EXP_LOCK_CUR_BITS  7
-#define HASH_EXP_LOCK_MAX_BITS  16
 #define HASH_JOB_STATS_BKT_BITS 5
 #define HASH_JOB_STATS_CUR_BITS 7
 #define HASH_JOB_STATS_MAX_BITS 12
@@ -601,6 +599,7 @@ extern bool obd_enable_health_write;
 #define OBD_FAIL_CATLIST			    0x131b
 #define OBD_FAIL_LLOG_PAUSE_AFTER_PAD               0x131c
 #define OBD_FAIL_LLOG_ADD_GAP			    0x131d
+#define OBD_FAIL_LLOG_CAT_ADD_DELAY		    0x131e
 
 #define OBD_FAIL_LLITE                              0x1400
 #define OBD_FAIL_LLITE_FAULT_TRUNC_RACE             0x1401
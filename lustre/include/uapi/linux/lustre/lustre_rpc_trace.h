@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Binary trace of the RPC lifecycle events, read from the
+ * /dev/lustre-rpc-trace character device.
+ */
+
+#ifndef _LUSTRE_RPC_TRACE_H
+# define _LUSTRE_RPC_TRACE_H
+
+#include <linux/types.h>
+#include <asm/ioctl.h>
+#include <linux/lnet/lnet-idl.h>
+
+#define LUSTRE_RPC_TRACE_DEV_NAME "lustre-rpc-trace"
+
+enum rpc_trace_event {
+	/* client: request added to a request set or to ptlrpcd */
+	RPC_TRACE_QUEUED		= 1,
+	/* client: request sent */
+	RPC_TRACE_SENT			= 2,
+	/* server: request received from the network */
+	RPC_TRACE_ARRIVED		= 3,
+	/* server: request unpacked and added to the NRS queue */
+	RPC_TRACE_NRS_QUEUED		= 4,
+	/* server: request taken off the NRS queue by a service thread */
+	RPC_TRACE_NRS_DEQUEUED		= 5,
+	/* server: request handler called and returned */
+	RPC_TRACE_HANDLE_START		= 6,
+	RPC_TRACE_HANDLE_END		= 7,
+	/* client: bulk buffers posted, server: bulk transfer started */
+	RPC_TRACE_BULK_START		= 8,
+	/* bulk transfer completed, successfully or not */
+	RPC_TRACE_BULK_END		= 9,
+	/* server: reply sent */
+	RPC_TRACE_REPLY_SENT		= 10,
+	/* client: reply received, early replies are not traced */
+	RPC_TRACE_REPLY_RECEIVED	= 11,
+	RPC_TRACE_EVENT_MAX,
+};
+
+enum rpc_trace_flags {
+	/* the event is on the client side of the RPC */
+	RPC_TRACE_FL_CLIENT	= 0x0001,
+};
+
+struct rpc_trace_entry_v1 {
+	__u64		rte_xid;	/* 8 */
+	__u64		rte_time;	/* 16 ns, CLOCK_MONOTONIC */
+	__u64		rte_bytes;	/* 24 bulk bytes */
+	struct lnet_nid	rte_peer;	/* 44 */
+	__u32		rte_opc;	/* 48 0 until the request is unpacked */
+	__s32		rte_status;	/* 52 */
+	__u32		rte_pid;	/* 56 */
+	__u32		rte_cpu;	/* 60 */
+	__u16		rte_event;	/* 62 enum rpc_trace_event */
+	__u16		rte_flags;	/* 64 enum rpc_trace_flags */
+};
+
+enum {
+	LUSTRE_RPC_TRACE_VERSION_1 = 0x00010000,
+};
+
+struct rpc_trace_info_v1 {
+	__u32	rti_version;		/* LUSTRE_RPC_TRACE_VERSION_1 */
+	__u32	rti_entry_size;
+	/* size of the buffer of each CPU, in bytes */
+	__u32	rti_buf_size;
+	__u32	rti_cpu_count;
+	/* entries buffered, and dropped as a buffer was full */
+	__u64	rti_entry_count;
+	__u64	rti_drop_count;
+};
+
+/* /dev/lustre-rpc-trace ioctls */
+enum {
+	/* return the RPC trace interface version */
+	LUSTRE_RPC_TRACE_IOCTL_VERSION = _IO('O', 0x90),
+
+	/* populate struct rpc_trace_info_v1 */
+	LUSTRE_RPC_TRACE_IOCTL_INFO = _IOR('O', 0x91,
+					   struct rpc_trace_info_v1),
+};
+
+#endif /* _LUSTRE_RPC_TRACE_H */
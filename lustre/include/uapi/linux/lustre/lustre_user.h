@@ -654,6 +654,7 @@ struct ll_ioc_lease_id {
 #define LL_IOC_PCC_DETACH_BY_FID	_IOW('f', 252, struct lu_pcc_detach_fid)
 #define LL_IOC_PCC_STATE		_IOR('f', 252, struct lu_pcc_state)
 #define LL_IOC_PROJECT			_IOW('f', 253, struct lu_project)
+#define LL_IOC_RA_STATS_GET		_IOR('f', 254, struct lu_ra_stats)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -2921,6 +2922,42 @@ struct lu_heat {
 	__u64 lh_heat[0];
 };
 
+/* read pattern of a file as classified by the client readahead */
+enum lu_ra_pattern {
+	LU_RA_PATTERN_NONE		= 0,
+	LU_RA_PATTERN_SEQUENTIAL	= 1,
+	LU_RA_PATTERN_STRIDE		= 2,
+	LU_RA_PATTERN_MULTI_STRIDE	= 3,
+	LU_RA_PATTERN_RECORD		= 4,
+	LU_RA_PATTERN_RANDOM		= 5,
+	LU_RA_PATTERN_MAX
+};
+
+#define LU_RA_PATTERN_NAMES {					\
+	[LU_RA_PATTERN_NONE]		= "none",		\
+	[LU_RA_PATTERN_SEQUENTIAL]	= "sequential",		\
+	[LU_RA_PATTERN_STRIDE]		= "stride",		\
+	[LU_RA_PATTERN_MULTI_STRIDE]	= "multi_stride",	\
+	[LU_RA_PATTERN_RECORD]		= "record",		\
+	[LU_RA_PATTERN_RANDOM]		= "random",		\
+}
+
+#define LU_RA_STRIDES_MAX	4
+
+/* per-file readahead history, see LL_IOC_RA_STATS_GET */
+struct lu_ra_stats {
+	__u32 lrs_pattern;	/* enum lu_ra_pattern */
+	__u32 lrs_period;	/* requests in one multi_stride cycle */
+	__s64 lrs_strides[LU_RA_STRIDES_MAX]; /* offset deltas of a cycle */
+	__u64 lrs_record_bytes;	/* record size of the record pattern */
+	__u64 lrs_requests;	/* read requests recorded */
+	__u64 lrs_hits;		/* pages read from the cache */
+	__u64 lrs_misses;	/* pages that had to be read synchronously */
+	__u64 lrs_predictions;	/* predicted ranges read ahead */
+	__u64 lrs_predicted_pages; /* pages read ahead for predictions */
+	__u64 lrs_padding[4];
+};
+
 enum lu_pcc_type {
 	LU_PCC_NONE		= 0x0,
 	LU_PCC_READWRITE	= 0x01,
@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/kunit/ec_test.c
+ *
+ * Correctness and performance tests for the erasure code encoders:
+ *   1) every usable vector implementation must produce the same parity as
+ *      ec_encode_data_base() for a range of k+m layouts and block lengths
+ *   2) data erased from a stripe must be rebuilt from the survivors
+ *   3) the encode bandwidth of each implementation is reported in MB/s
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/random.h>
+
+#include <libcfs/libcfs.h>
+#include <obd_support.h>
+#include <erasure_code.h>
+#include "../ec/ec_internal.h"
+
+static int bench_secs = 1;
+module_param(bench_secs, int, 0644);
+MODULE_PARM_DESC(bench_secs, "seconds to run each encode benchmark, 0 to skip");
+
+static int bench_len = 1024 * 1024;
+module_param(bench_len, int, 0644);
+MODULE_PARM_DESC(bench_len, "block size used by the encode benchmark");
+
+#define EC_TEST_MAX_K	16
+#define EC_TEST_MAX_M	4
+
+struct ec_test_layout {
+	int	etl_k;
+	int	etl_m;
+};
+
+static const struct ec_test_layout ec_test_layouts[] = {
+	{ 1, 1 }, { 2, 1 }, { 4, 2 }, { 8, 2 }, { 10, 4 }, { 16, 4 },
+};
+
+/* odd lengths exercise the scalar tail after the last full vector */
+static const int ec_test_lens[] = {
+	1, 15, 16, 31, 63, 64, 127, 129, 4095, 4096, 65536 + 17,
+	2 * 65536 + 128,
+};
+
+struct ec_test_bufs {
+	unsigned char	*etb_data[EC_TEST_MAX_K];
+	unsigned char	*etb_code[EC_TEST_MAX_M];
+	unsigned char	*etb_check[EC_TEST_MAX_M];
+	unsigned char	 etb_matrix[(EC_TEST_MAX_K + EC_TEST_MAX_M) *
+				    EC_TEST_MAX_K];
+	unsigned char	 etb_tbls[EC_TEST_MAX_K * EC_TEST_MAX_M * 32];
+	int		 etb_len;
+};
+
+static struct rnd_state ec_rstate;
+
+static void ec_test_bufs_free(struct ec_test_bufs *b)
+{
+	int i;
+
+	for (i = 0; i < EC_TEST_MAX_K; i++)
+		if (b->etb_data[i])
+			OBD_FREE_LARGE(b->etb_data[i], b->etb_len);
+	for (i = 0; i < EC_TEST_MAX_M; i++) {
+		if (b->etb_code[i])
+			OBD_FREE_LARGE(b->etb_code[i], b->etb_len);
+		if (b->etb_check[i])
+			OBD_FREE_LARGE(b->etb_check[i], b->etb_len);
+	}
+	OBD_FREE_PTR(b);
+}
+
+static struct ec_test_bufs *ec_test_bufs_alloc(int len)
+{
+	struct ec_test_bufs *b;
+	int i;
+
+	OBD_ALLOC_PTR(b);
+	if (!b)
+		return NULL;
+
+	b->etb_len = len;
+	for (i = 0; i < EC_TEST_MAX_K; i++) {
+		OBD_ALLOC_LARGE(b->etb_data[i], len);
+		if (!b->etb_data[i])
+			goto out_free;
+		prandom_bytes_state(&ec_rstate, b->etb_data[i], len);
+	}
+	for (i = 0; i < EC_TEST_MAX_M; i++) {
+		OBD_ALLOC_LARGE(b->etb_code[i], len);
+		OBD_ALLOC_LARGE(b->etb_check[i], len);
+		if (!b->etb_code[i] || !b->etb_check[i])
+			goto out_free;
+	}
+
+	return b;
+
+out_free:
+	ec_test_bufs_free(b);
+	return NULL;
+}
+
+static void ec_test_setup_layout(struct ec_test_bufs *b, int k, int m)
+{
+	gf_gen_cauchy1_matrix(b->etb_matrix, k + m, k);
+	ec_init_tables(k, m, &b->etb_matrix[k * k], b->etb_tbls);
+}
+
+static int ec_test_compare(const struct ec_impl *impl, struct ec_test_bufs *b,
+			   int k, int m, int len)
+{
+	int i;
+
+	ec_encode_data_base(len, k, m, b->etb_tbls, b->etb_data, b->etb_code);
+
+	for (i = 0; i < m; i++)
+		memset(b->etb_check[i], 0xa5, len);
+	ec_encode_data_impl(impl, len, k, m, b->etb_tbls, b->etb_data,
+			    b->etb_check);
+
+	for (i = 0; i < m; i++) {
+		if (memcmp(b->etb_code[i], b->etb_check[i], len) != 0) {
+			pr_err("ec_test: %s %d+%d len=%d parity %d mismatch\n",
+			       impl->ei_name, k, m, len, i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Erase the first @m data blocks and rebuild them from the remaining data
+ * and all of the parity blocks by inverting the surviving rows of the
+ * encode matrix, as a degraded read would.
+ */
+static int ec_test_recover(struct ec_test_bufs *b, int k, int m, int len)
+{
+	unsigned char survive[EC_TEST_MAX_K * EC_TEST_MAX_K];
+	unsigned char invert[EC_TEST_MAX_K * EC_TEST_MAX_K];
+	unsigned char *srcs[EC_TEST_MAX_K];
+	int erased = min(k, m);
+	int i, j, rc;
+
+	ec_encode_data(len, k, m, b->etb_tbls, b->etb_data, b->etb_code);
+
+	/* surviving rows: data blocks erased..k-1, then parity 0..erased-1 */
+	for (i = 0; i < k; i++) {
+		int row = i < k - erased ? i + erased : k + i - (k - erased);
+
+		memcpy(&survive[i * k], &b->etb_matrix[row * k], k);
+		srcs[i] = row < k ? b->etb_data[row] : b->etb_code[row - k];
+	}
+
+	rc = gf_invert_matrix(survive, invert, k);
+	if (rc) {
+		pr_err("ec_test: %d+%d decode matrix is singular\n", k, m);
+		return -EINVAL;
+	}
+
+	ec_init_tables(k, erased, invert, b->etb_tbls);
+	ec_encode_data(len, k, erased, b->etb_tbls, srcs, b->etb_check);
+
+	for (j = 0; j < erased; j++) {
+		if (memcmp(b->etb_check[j], b->etb_data[j], len) != 0) {
+			pr_err("ec_test: %d+%d len=%d block %d not recovered\n",
+			       k, m, len, j);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static void ec_test_bench(const struct ec_impl *impl, struct ec_test_bufs *b,
+			  int k, int m)
+{
+	ktime_t start, now;
+	u64 bytes = 0;
+	s64 us;
+
+	start = now = ktime_get();
+	do {
+		if (impl)
+			ec_encode_data_impl(impl, b->etb_len, k, m, b->etb_tbls,
+					    b->etb_data, b->etb_code);
+		else
+			ec_encode_data_base(b->etb_len, k, m, b->etb_tbls,
+					    b->etb_data, b->etb_code);
+		bytes += (u64)b->etb_len * k;
+		now = ktime_get();
+		cond_resched();
+	} while (ktime_ms_delta(now, start) < bench_secs * MSEC_PER_SEC);
+
+	us = max_t(s64, ktime_us_delta(now, start), 1);
+	pr_info("ec_test: %s %d+%d len=%d: %llu MB/s\n",
+		impl ? impl->ei_name : "base", k, m, b->etb_len,
+		div64_u64(bytes, us));
+}
+
+static int __init ec_test_init(void)
+{
+	const struct ec_impl *impl;
+	struct ec_test_bufs *b;
+	int max_len = 0;
+	int i, j, l, rc = 0;
+
+	prandom_seed_state(&ec_rstate, 42);
+
+	for (l = 0; l < ARRAY_SIZE(ec_test_lens); l++)
+		max_len = max(max_len, ec_test_lens[l]);
+
+	b = ec_test_bufs_alloc(max_len);
+	if (!b)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(ec_test_layouts) && !rc; i++) {
+		int k = ec_test_layouts[i].etl_k;
+		int m = ec_test_layouts[i].etl_m;
+
+		for (l = 0; l < ARRAY_SIZE(ec_test_lens) && !rc; l++) {
+			int len = ec_test_lens[l];
+
+			ec_test_setup_layout(b, k, m);
+			for (j = 0; (impl = ec_simd_impl_get(j)) && !rc; j++) {
+				if (!impl->ei_usable())
+					continue;
+				rc = ec_test_compare(impl, b, k, m, len);
+			}
+			if (!rc)
+				rc = ec_test_recover(b, k, m, len);
+		}
+	}
+	ec_test_bufs_free(b);
+	if (rc)
+		return rc;
+
+	pr_info("ec_test: encode and recovery checks passed\n");
+
+	if (bench_secs <= 0 || bench_len <= 0)
+		return 0;
+
+	b = ec_test_bufs_alloc(bench_len);
+	if (!b)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(ec_test_layouts); i++) {
+		int k = ec_test_layouts[i].etl_k;
+		int m = ec_test_layouts[i].etl_m;
+
+		if (k < 8)
+			continue;
+
+		ec_test_setup_layout(b, k, m);
+		ec_test_bench(NULL, b, k, m);
+		for (j = 0; (impl = ec_simd_impl_get(j)) != NULL; j++)
+			if (impl->ei_usable())
+				ec_test_bench(impl, b, k, m);
+	}
+	ec_test_bufs_free(b);
+
+	return 0;
+}
+
+static void __exit ec_test_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre erasure code encode test");
+MODULE_LICENSE("GPL");
+
+module_init(ec_test_init);
+module_exit(ec_test_exit);
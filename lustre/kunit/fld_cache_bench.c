@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/kunit/fld_cache_bench.c
+ *
+ * Check and measure fld_cache_lookup() on a cache holding many sequence
+ * ranges spread over many MDTs.  The lookups are done by one thread and
+ * then by several threads concurrently.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/random.h>
+
+#include <libcfs/libcfs.h>
+#include <obd_support.h>
+#include <lustre_fid.h>
+#include <lustre_fld.h>
+#include "../fld/fld_internal.h"
+
+/* ranges are 2 sequences long, with a 2 sequences hole after each one */
+#define FLD_BENCH_STRIDE	4
+#define FLD_BENCH_WIDTH		2
+
+static int nranges = 10000;
+module_param(nranges, int, 0644);
+MODULE_PARM_DESC(nranges, "number of sequence ranges in the cache");
+
+static int nmdts = 256;
+module_param(nmdts, int, 0644);
+MODULE_PARM_DESC(nmdts, "number of MDTs the ranges are spread over");
+
+static int threads;
+module_param(threads, int, 0644);
+MODULE_PARM_DESC(threads, "number of benchmark threads, 0 for online CPUs");
+
+static int bench_secs = 5;
+module_param(bench_secs, int, 0644);
+MODULE_PARM_DESC(bench_secs, "seconds to run each benchmark pass");
+
+struct fld_bench_thread {
+	struct task_struct	*fbt_task;
+	struct fld_cache	*fbt_cache;
+	struct completion	*fbt_done;
+	atomic_t		*fbt_running;
+	ktime_t			 fbt_deadline;
+	int			 fbt_idx;
+	u64			 fbt_ops;
+	u64			 fbt_errors;
+};
+
+static void fld_bench_range(struct lu_seq_range *range, u32 n)
+{
+	range->lsr_start = FID_SEQ_NORMAL + (u64)n * FLD_BENCH_STRIDE;
+	range->lsr_end = range->lsr_start + FLD_BENCH_WIDTH;
+	range->lsr_index = n % nmdts;
+	fld_range_set_mdt(range);
+}
+
+static int fld_bench_thread_main(void *arg)
+{
+	struct fld_bench_thread *fbt = arg;
+	struct lu_seq_range range;
+	struct rnd_state rstate;
+	u32 rnd;
+
+	prandom_seed_state(&rstate, fbt->fbt_idx + 1);
+
+	while (ktime_before(ktime_get(), fbt->fbt_deadline)) {
+		int i;
+
+		for (i = 0; i < 1024; i++) {
+			rnd = prandom_u32_state(&rstate) % nranges;
+			if (fld_cache_lookup(fbt->fbt_cache, FID_SEQ_NORMAL +
+					     (u64)rnd * FLD_BENCH_STRIDE + 1,
+					     &range) ||
+			    range.lsr_index != rnd % nmdts)
+				fbt->fbt_errors++;
+			fbt->fbt_ops++;
+		}
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(fbt->fbt_running))
+		complete(fbt->fbt_done);
+
+	return 0;
+}
+
+static int fld_bench_run(struct fld_cache *cache, int nthreads)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct fld_bench_thread *fbt;
+	atomic_t running;
+	ktime_t start;
+	u64 ops = 0;
+	u64 errors = 0;
+	s64 ns_elapsed;
+	int i;
+	int rc = 0;
+
+	OBD_ALLOC_PTR_ARRAY(fbt, nthreads);
+	if (!fbt)
+		return -ENOMEM;
+
+	atomic_set(&running, nthreads);
+	start = ktime_get();
+	for (i = 0; i < nthreads; i++) {
+		fbt[i].fbt_cache = cache;
+		fbt[i].fbt_done = &done;
+		fbt[i].fbt_running = &running;
+		fbt[i].fbt_deadline = ktime_add_ms(start,
+						   bench_secs * MSEC_PER_SEC);
+		fbt[i].fbt_idx = i;
+		fbt[i].fbt_task = kthread_run(fld_bench_thread_main, &fbt[i],
+					      "fld_cache_bench_%02d", i);
+		if (IS_ERR(fbt[i].fbt_task)) {
+			rc = PTR_ERR(fbt[i].fbt_task);
+			pr_err("fld_cache_bench: cannot start thread %d: rc = %d\n",
+			       i, rc);
+			/* account for the threads that were never started */
+			if (atomic_sub_and_test(nthreads - i, &running))
+				complete(&done);
+			break;
+		}
+	}
+
+	wait_for_completion(&done);
+	ns_elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (i = 0; i < nthreads; i++) {
+		ops += fbt[i].fbt_ops;
+		errors += fbt[i].fbt_errors;
+	}
+
+	if (ops) {
+		pr_info("fld_cache_bench: threads=%d ranges=%d ops=%llu errors=%llu ops/s=%llu ns/op=%llu\n",
+			nthreads, nranges, ops, errors,
+			div64_u64(ops * NSEC_PER_SEC,
+				  max_t(s64, ns_elapsed, 1)),
+			div64_u64((u64)ns_elapsed * nthreads, ops));
+	}
+	if (errors && !rc)
+		rc = -EINVAL;
+
+	OBD_FREE_PTR_ARRAY(fbt, nthreads);
+
+	return rc;
+}
+
+/* every range is found, and none of the holes between them */
+static int fld_bench_check(struct fld_cache *cache)
+{
+	struct lu_seq_range expected;
+	struct lu_seq_range range;
+	int i;
+	int rc;
+
+	for (i = 0; i < nranges; i++) {
+		fld_bench_range(&expected, i);
+
+		rc = fld_cache_lookup(cache, expected.lsr_start, &range);
+		if (rc || lu_seq_range_compare_loc(&range, &expected) ||
+		    range.lsr_start != expected.lsr_start ||
+		    range.lsr_end != expected.lsr_end) {
+			pr_err("fld_cache_bench: lookup %#llx: rc = %d, range "DRANGE", expected "DRANGE"\n",
+			       expected.lsr_start, rc, PRANGE(&range),
+			       PRANGE(&expected));
+			return -EINVAL;
+		}
+
+		rc = fld_cache_lookup(cache, expected.lsr_end, &range);
+		if (rc != -ENOENT) {
+			pr_err("fld_cache_bench: lookup %#llx in a hole: rc = %d\n",
+			       expected.lsr_end, rc);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int __init fld_cache_bench_init(void)
+{
+	struct lu_seq_range range;
+	struct fld_cache *cache;
+	struct fld_stats stats;
+	ktime_t start;
+	int nthreads;
+	int i;
+	int rc;
+
+	if (nranges <= 0 || nmdts <= 0 || bench_secs <= 0)
+		return -EINVAL;
+
+	nthreads = threads > 0 ? threads : num_online_cpus();
+
+	/* big enough for all the ranges not to be shrunk */
+	cache = fld_cache_init("fld_cache_bench", nranges * 2, nranges / 10);
+	if (IS_ERR(cache))
+		return PTR_ERR(cache);
+
+	start = ktime_get();
+	for (i = 0; i < nranges; i++) {
+		fld_bench_range(&range, i);
+		rc = fld_cache_insert(cache, &range);
+		if (rc)
+			GOTO(out, rc);
+	}
+	pr_info("fld_cache_bench: %d ranges on %d MDTs inserted in %lld us\n",
+		nranges, nmdts, ktime_us_delta(ktime_get(), start));
+
+	rc = fld_bench_check(cache);
+	if (rc)
+		GOTO(out, rc);
+
+	pr_info("fld_cache_bench: %d threads, %d seconds per pass\n",
+		nthreads, bench_secs);
+
+	rc = fld_bench_run(cache, 1);
+	if (!rc && nthreads > 1)
+		rc = fld_bench_run(cache, nthreads);
+
+	fld_cache_stats_get(cache, &stats);
+	pr_info("fld_cache_bench: lookups=%llu hits=%llu\n",
+		stats.fst_count, stats.fst_cache);
+out:
+	fld_cache_fini(cache);
+
+	return rc;
+}
+
+static void __exit fld_cache_bench_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre FLD cache lookup benchmark");
+MODULE_LICENSE("GPL");
+
+module_init(fld_cache_bench_init);
+module_exit(fld_cache_bench_exit);
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/kunit/ldlm_res_bench.c
+ *
+ * Microbenchmark of ldlm_resource_get()/ldlm_resource_putref() on a shared
+ * namespace.  Several threads look up random resources of a pre-populated
+ * namespace while a fraction of the operations create and destroy
+ * short-lived resources, so lookups race with hash insertions, removals
+ * and resizes.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/random.h>
+
+#include <libcfs/libcfs.h>
+#include <lustre_dlm.h>
+#include <obd_support.h>
+#include <obd.h>
+#include <obd_class.h>
+
+static int nres = 65536;
+module_param(nres, int, 0644);
+MODULE_PARM_DESC(nres, "number of resources created before the benchmark");
+
+static int threads;
+module_param(threads, int, 0644);
+MODULE_PARM_DESC(threads, "number of benchmark threads, 0 for online CPUs");
+
+static int bench_secs = 5;
+module_param(bench_secs, int, 0644);
+MODULE_PARM_DESC(bench_secs, "seconds to run each benchmark pass");
+
+static int churn_pct = 10;
+module_param(churn_pct, int, 0644);
+MODULE_PARM_DESC(churn_pct, "percentage of operations creating a new resource in the churn pass");
+
+static int bench_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
+{
+	return 0;
+}
+
+static int bench_cleanup(struct obd_device *obd)
+{
+	return 0;
+}
+
+static const struct obd_ops bench_ops = {
+	.o_owner       = THIS_MODULE,
+	.o_setup       = bench_setup,
+	.o_cleanup     = bench_cleanup,
+};
+
+struct res_bench_thread {
+	struct task_struct	*rbt_task;
+	struct ldlm_namespace	*rbt_ns;
+	struct completion	*rbt_done;
+	atomic_t		*rbt_running;
+	ktime_t			 rbt_deadline;
+	int			 rbt_churn;
+	int			 rbt_idx;
+	u64			 rbt_ops;
+	u64			 rbt_misses;
+};
+
+static void res_bench_id(struct ldlm_res_id *id, u32 n)
+{
+	memset(id, 0, sizeof(*id));
+	/* name[0] must not be zero */
+	id->name[0] = FID_SEQ_NORMAL + n / 1024;
+	id->name[1] = n % 1024 + 1;
+}
+
+static int res_bench_thread_main(void *arg)
+{
+	struct res_bench_thread *rbt = arg;
+	struct ldlm_resource *res;
+	struct ldlm_res_id id;
+	struct rnd_state rstate;
+	u32 rnd;
+
+	prandom_seed_state(&rstate, rbt->rbt_idx + 1);
+
+	while (ktime_before(ktime_get(), rbt->rbt_deadline)) {
+		int i;
+
+		for (i = 0; i < 1024; i++) {
+			rnd = prandom_u32_state(&rstate);
+			if (rbt->rbt_churn && rnd % 100 < rbt->rbt_churn) {
+				/* beyond the pre-created ones, freed on put */
+				res_bench_id(&id, nres + rnd % (nres + 1));
+				res = ldlm_resource_get(rbt->rbt_ns, &id,
+							LDLM_PLAIN, 1);
+			} else {
+				res_bench_id(&id, rnd % nres);
+				res = ldlm_resource_get(rbt->rbt_ns, &id,
+							LDLM_PLAIN, 0);
+			}
+			rbt->rbt_ops++;
+			if (IS_ERR(res)) {
+				rbt->rbt_misses++;
+				continue;
+			}
+			ldlm_resource_putref(res);
+		}
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(rbt->rbt_running))
+		complete(rbt->rbt_done);
+
+	return 0;
+}
+
+static int res_bench_run(struct ldlm_namespace *ns, int nthreads, int churn)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct res_bench_thread *rbt;
+	atomic_t running;
+	ktime_t start;
+	u64 ops = 0;
+	u64 misses = 0;
+	s64 ns_elapsed;
+	int i;
+	int rc = 0;
+
+	OBD_ALLOC_PTR_ARRAY(rbt, nthreads);
+	if (!rbt)
+		return -ENOMEM;
+
+	atomic_set(&running, nthreads);
+	start = ktime_get();
+	for (i = 0; i < nthreads; i++) {
+		rbt[i].rbt_ns = ns;
+		rbt[i].rbt_done = &done;
+		rbt[i].rbt_running = &running;
+		rbt[i].rbt_deadline = ktime_add_ms(start,
+						   bench_secs * MSEC_PER_SEC);
+		rbt[i].rbt_churn = churn;
+		rbt[i].rbt_idx = i;
+		rbt[i].rbt_task = kthread_run(res_bench_thread_main, &rbt[i],
+					      "ldlm_res_bench_%02d", i);
+		if (IS_ERR(rbt[i].rbt_task)) {
+			rc = PTR_ERR(rbt[i].rbt_task);
+			pr_err("ldlm_res_bench: cannot start thread %d: rc = %d\n",
+			       i, rc);
+			/* account for the threads that were never started */
+			if (atomic_sub_and_test(nthreads - i, &running))
+				complete(&done);
+			break;
+		}
+	}
+
+	wait_for_completion(&done);
+	ns_elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (i = 0; i < nthreads; i++) {
+		ops += rbt[i].rbt_ops;
+		misses += rbt[i].rbt_misses;
+	}
+
+	if (ops) {
+		pr_info("ldlm_res_bench: threads=%d churn=%d%% ops=%llu misses=%llu ops/s=%llu ns/op=%llu\n",
+			nthreads, churn, ops, misses,
+			div64_u64(ops * NSEC_PER_SEC,
+				  max_t(s64, ns_elapsed, 1)),
+			div64_u64((u64)ns_elapsed * nthreads, ops));
+	}
+
+	OBD_FREE_PTR_ARRAY(rbt, nthreads);
+
+	return rc;
+}
+
+static int __init ldlm_res_bench_init(void)
+{
+	struct ldlm_resource **resv = NULL;
+	struct lustre_cfg_bufs bufs;
+	struct lustre_cfg *cfg;
+	struct obd_device *obd;
+	struct ldlm_namespace *ns;
+	struct ldlm_res_id id;
+	char *name, *uuid;
+	int nthreads;
+	int i;
+	int rc;
+
+	if (nres <= 0 || bench_secs <= 0)
+		return -EINVAL;
+
+	nthreads = threads > 0 ? threads : num_online_cpus();
+
+	rc = class_register_type(&bench_ops, NULL, false, "ldlm_res_bench",
+				 NULL);
+	if (rc)
+		return rc;
+
+	OBD_ALLOC(name, MAX_OBD_NAME);
+	OBD_ALLOC(uuid, MAX_OBD_NAME);
+	strscpy(name, "res_bench", MAX_OBD_NAME);
+	lustre_cfg_bufs_reset(&bufs, name);
+	snprintf(uuid, MAX_OBD_NAME, "%s_UUID", name);
+
+	lustre_cfg_bufs_set_string(&bufs, 1, "ldlm_res_bench"); /* typename */
+	lustre_cfg_bufs_set_string(&bufs, 2, uuid);
+	OBD_ALLOC(cfg, lustre_cfg_len(bufs.lcfg_bufcount, bufs.lcfg_buflen));
+	lustre_cfg_init(cfg, LCFG_ATTACH, &bufs);
+
+	rc = class_attach(cfg);
+	if (rc)
+		GOTO(out_free, rc);
+
+	obd = class_name2obd(name);
+	ns = ldlm_namespace_new(obd, "res-bench", LDLM_NAMESPACE_CLIENT,
+				LDLM_NAMESPACE_MODEST, LDLM_NS_TYPE_MDT);
+	if (IS_ERR(ns))
+		GOTO(out_detach, rc = PTR_ERR(ns));
+
+	/* keep a reference so that lookups of these always hit */
+	OBD_ALLOC_PTR_ARRAY_LARGE(resv, nres);
+	if (!resv)
+		GOTO(out_ns, rc = -ENOMEM);
+
+	for (i = 0; i < nres; i++) {
+		res_bench_id(&id, i);
+		resv[i] = ldlm_resource_get(ns, &id, LDLM_PLAIN, 1);
+		if (IS_ERR(resv[i])) {
+			rc = PTR_ERR(resv[i]);
+			resv[i] = NULL;
+			GOTO(out_res, rc);
+		}
+	}
+
+	pr_info("ldlm_res_bench: %d resources, %d threads, %d seconds per pass\n",
+		nres, nthreads, bench_secs);
+
+	/* lookup only, from a single thread and then all of them */
+	rc = res_bench_run(ns, 1, 0);
+	if (!rc && nthreads > 1)
+		rc = res_bench_run(ns, nthreads, 0);
+	/* lookups racing with resource creation and destruction */
+	if (!rc && churn_pct > 0)
+		rc = res_bench_run(ns, nthreads, min(churn_pct, 100));
+
+out_res:
+	for (i = 0; i < nres && resv[i]; i++)
+		ldlm_resource_putref(resv[i]);
+	OBD_FREE_PTR_ARRAY_LARGE(resv, nres);
+out_ns:
+	ldlm_namespace_free_post(ns);
+out_detach:
+	class_detach(obd, cfg);
+out_free:
+	OBD_FREE(name, MAX_OBD_NAME);
+	OBD_FREE(uuid, MAX_OBD_NAME);
+	OBD_FREE(cfg, lustre_cfg_len(bufs.lcfg_bufcount, bufs.lcfg_buflen));
+	class_unregister_type("ldlm_res_bench");
+
+	return rc;
+}
+
+static void __exit ldlm_res_bench_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre ldlm resource hash lookup benchmark");
+MODULE_LICENSE("GPL");
+
+module_init(ldlm_res_bench_init);
+module_exit(ldlm_res_bench_exit);
@@ -2165,6 +2165,133 @@ ctxt_release:
 	RETURN(rc);
 }
 
+#define LLOG_TEST_BATCH	8
+
+/* Test adding a batch of records of one transaction to a catalog */
+static int llog_test_11(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_mini_rec lmr[LLOG_TEST_BATCH];
+	struct llog_rec_hdr *recs[LLOG_TEST_BATCH];
+	struct llog_cookie cookies[LLOG_TEST_BATCH];
+	struct llog_handle *cath, *llh;
+	struct llog_ctxt *ctxt;
+	struct dt_device *dt;
+	struct thandle *th;
+	char name[10];
+	int rc, rc2, i;
+
+	ENTRY;
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	snprintf(name, sizeof(name), "%x", llog_test_rand + 3);
+	CWARN("11a: create a catalog log with name: %s\n", name);
+	rc = llog_open_create(env, ctxt, &cath, NULL, name);
+	if (rc) {
+		CERROR("11a: llog_create with name %s failed: %d\n", name, rc);
+		GOTO(ctxt_release, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("11a: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	dt = lu2dt_dev(cath->lgh_obj->do_lu.lo_dev);
+
+	CWARN("11b: add %d records in one transaction\n", LLOG_TEST_BATCH);
+	for (i = 0; i < LLOG_TEST_BATCH; i++) {
+		lmr[i].lmr_hdr.lrh_len = LLOG_MIN_REC_SIZE;
+		lmr[i].lmr_tail.lrt_len = LLOG_MIN_REC_SIZE;
+		lmr[i].lmr_hdr.lrh_type = LLOG_OP_MAGIC;
+		recs[i] = &lmr[i].lmr_hdr;
+	}
+	memset(cookies, 0, sizeof(cookies));
+
+	th = dt_trans_create(env, dt);
+	if (IS_ERR(th))
+		GOTO(out, rc = PTR_ERR(th));
+
+	for (i = 0; i < LLOG_TEST_BATCH; i++) {
+		rc = llog_cat_declare_add_rec(env, cath, recs[i], th);
+		if (rc)
+			GOTO(out_trans, rc);
+	}
+
+	rc = dt_trans_start_local(env, dt, th);
+	if (rc)
+		GOTO(out_trans, rc);
+
+	rc = llog_cat_add_arr_rec(env, cath, LLOG_TEST_BATCH, recs, cookies,
+				  th);
+out_trans:
+	rc2 = dt_trans_stop(env, dt, th);
+	if (rc == 0)
+		rc = rc2;
+	if (rc) {
+		CERROR("11b: add %d records failed: %d\n", LLOG_TEST_BATCH, rc);
+		GOTO(out, rc);
+	}
+
+	rc = verify_handle("11b", cath->u.chd.chd_current_log,
+			   LLOG_TEST_BATCH + 1);
+	if (rc)
+		GOTO(out, rc);
+
+	if (atomic64_read(&cath->u.chd.chd_batches) != 1 ||
+	    atomic64_read(&cath->u.chd.chd_batch_recs) != LLOG_TEST_BATCH) {
+		CERROR("11b: %lld records in %lld batches, expected %d in 1\n",
+		       (s64)atomic64_read(&cath->u.chd.chd_batch_recs),
+		       (s64)atomic64_read(&cath->u.chd.chd_batches),
+		       LLOG_TEST_BATCH);
+		GOTO(out, rc = -ERANGE);
+	}
+
+	for (i = 0; i < LLOG_TEST_BATCH; i++) {
+		if (cookies[i].lgc_index != i + 1) {
+			CERROR("11b: record #%d added at index %u\n",
+			       i, cookies[i].lgc_index);
+			GOTO(out, rc = -ERANGE);
+		}
+	}
+
+	/* the header is only written by the last record of the batch */
+	CWARN("11c: re-open the plain log and verify the header on disk\n");
+	rc = llog_open(env, ctxt, &llh, &cookies[0].lgc_lgl, NULL,
+		       LLOG_OPEN_EXISTS);
+	if (rc) {
+		CERROR("11c: re-open plain log failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	rc = llog_init_handle(env, llh, LLOG_F_IS_PLAIN, &uuid);
+	if (rc)
+		CERROR("11c: can't init llog handle: %d\n", rc);
+	else
+		rc = verify_handle("11c", llh, LLOG_TEST_BATCH + 1);
+	llog_close(env, llh);
+	if (rc)
+		GOTO(out, rc);
+
+	CWARN("11d: cancel %d records\n", LLOG_TEST_BATCH);
+	rc = llog_cat_cancel_records(env, cath, LLOG_TEST_BATCH, cookies);
+	if (rc)
+		CERROR("11d: cancel %d records failed: %d\n",
+		       LLOG_TEST_BATCH, rc);
+out:
+	CWARN("11: put newly-created catalog\n");
+	rc2 = llog_cat_close(env, cath);
+	if (rc2) {
+		CERROR("11: close log %s failed: %d\n", name, rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	RETURN(rc);
+}
+
 /*
  * -------------------------------------------------------------------------
  * Tests above, boring obd functions below
@@ -2223,6 +2350,10 @@ static int llog_run_tests(const struct lu_env *env, struct obd_device *obd)
 	if (rc)
 		GOTO(cleanup, rc);
 
+	rc = llog_test_11(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
 cleanup:
 	err = llog_destroy(env, llh);
 	if (err)
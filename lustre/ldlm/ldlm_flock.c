@@ -65,6 +65,37 @@
 int ldlm_flock_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 			    void *data, int flag);
 
+/*
+ * Export owner<->blocked flock hash, used for deadlock detection.
+ *
+ * A hashed lock holds a reference on itself, on its blocking export and
+ * one blocking_refs count; each lookup takes the same three references.
+ * An owner may have several blocked locks, e.g. from different threads
+ * sharing a file descriptor, so this is an rhltable.
+ */
+static const struct rhashtable_params ldlm_export_flock_params = {
+	.key_len	= sizeof(__u64),
+	.key_offset	= offsetof(struct ldlm_lock,
+				   l_policy_data.l_flock.owner),
+	.head_offset	= offsetof(struct ldlm_lock, l_exp_flock_hash),
+	.nelem_hint	= 1U << HASH_EXP_LOCK_CUR_BITS,
+	.automatic_shrinking = true,
+};
+
+static void ldlm_export_flock_put(struct ldlm_lock *lock)
+{
+	struct ldlm_flock *flock = &lock->l_policy_data.l_flock;
+	struct obd_export *exp = flock->blocking_export;
+
+	LASSERT(exp != NULL);
+	if (atomic_dec_and_test(&flock->blocking_refs)) {
+		flock->blocking_owner = 0;
+		flock->blocking_export = NULL;
+	}
+	class_export_put(exp);
+	LDLM_LOCK_RELEASE(lock);
+}
+
 static inline int
 ldlm_same_flock_owner(struct ldlm_lock *lock, struct ldlm_lock *new)
 {
@@ -85,21 +116,28 @@ ldlm_flocks_overlap(struct ldlm_lock *lock, struct ldlm_lock *new)
 static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
 					    struct ldlm_lock *lock)
 {
+	int rc;
+
 	/* For server only */
 	if (req->l_export == NULL)
 		return;
 
-	LASSERT(hlist_unhashed(&req->l_exp_flock_hash));
-
 	req->l_policy_data.l_flock.blocking_owner =
 		lock->l_policy_data.l_flock.owner;
 	req->l_policy_data.l_flock.blocking_export =
-		lock->l_export;
-	atomic_set(&req->l_policy_data.l_flock.blocking_refs, 0);
-
-	cfs_hash_add(req->l_export->exp_flock_hash,
-		     &req->l_policy_data.l_flock.owner,
-		     &req->l_exp_flock_hash);
+		class_export_get(lock->l_export);
+	atomic_set(&req->l_policy_data.l_flock.blocking_refs, 1);
+	LDLM_LOCK_GET(req);
+
+	rc = rhltable_insert_key(req->l_export->exp_flock_hash,
+				 &req->l_policy_data.l_flock.owner,
+				 &req->l_exp_flock_hash,
+				 ldlm_export_flock_params);
+	if (rc) {
+		LDLM_ERROR(req, "cannot add to export flock hash: rc = %d",
+			   rc);
+		ldlm_export_flock_put(req);
+	}
 }
 
 static inline void ldlm_flock_blocking_unlink(struct ldlm_lock *req)
@@ -110,10 +148,10 @@ static inline void ldlm_flock_blocking_unlink(struct ldlm_lock *req)
 
 	check_res_locked(req->l_resource);
 	if (req->l_export->exp_flock_hash != NULL &&
-	    !hlist_unhashed(&req->l_exp_flock_hash))
-		cfs_hash_del(req->l_export->exp_flock_hash,
-			     &req->l_policy_data.l_flock.owner,
-			     &req->l_exp_flock_hash);
+	    rhltable_remove(req->l_export->exp_flock_hash,
+			    &req->l_exp_flock_hash,
+			    ldlm_export_flock_params) == 0)
+		ldlm_export_flock_put(req);
 }
 
 /** Remove cancelled lock from resource interval tree. */
@@ -135,9 +173,6 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 
 	LDLM_DEBUG(lock, "%s(mode: %d, flags: %#llx)", __func__, mode, flags);
 
-	/* Safe to not lock here, since it should be empty anyway */
-	LASSERT(hlist_unhashed(&lock->l_exp_flock_hash));
-
 	list_del_init(&lock->l_res_link);
 	if (flags == LDLM_FL_WAIT_NOREPROC) {
 		/* client side - set a flag to prevent sending a CANCEL */
@@ -173,14 +208,33 @@ struct ldlm_flock_lookup_cb_data {
 static int ldlm_flock_lookup_cb(struct obd_export *exp, void *data)
 {
 	struct ldlm_flock_lookup_cb_data *cb_data = data;
+	struct rhlist_head *list, *pos;
 	struct ldlm_lock *lock;
+	struct ldlm_flock *flock;
 
 	if (exp->exp_failed)
 		return 0;
 
-	lock = cfs_hash_lookup(exp->exp_flock_hash, cb_data->bl_owner);
-	if (lock == NULL)
+	rcu_read_lock();
+	list = rhltable_lookup(exp->exp_flock_hash, cb_data->bl_owner,
+			       ldlm_export_flock_params);
+	rhl_for_each_entry_rcu(lock, pos, list, l_exp_flock_hash) {
+		/* skip a lock which is not blocked anymore or being freed */
+		if (atomic_read(&lock->l_policy_data.l_flock.blocking_refs) &&
+		    refcount_inc_not_zero(&lock->l_handle.h_ref))
+			break;
+	}
+	rcu_read_unlock();
+	if (pos == NULL)
+		return 0;
+
+	/* the lock may have been unhashed meanwhile */
+	flock = &lock->l_policy_data.l_flock;
+	if (!atomic_inc_not_zero(&flock->blocking_refs)) {
+		LDLM_LOCK_RELEASE(lock);
 		return 0;
+	}
+	class_export_get(flock->blocking_export);
 
 	/* Stop on first found lock. Same process can't sleep twice */
 	cb_data->lock = lock;
@@ -237,7 +291,7 @@ ldlm_flock_deadlock(struct ldlm_lock *req, struct ldlm_lock *bl_lock)
 		bl_exp_new = class_export_get(flock->blocking_export);
 		class_export_put(bl_exp);
 
-		cfs_hash_put(bl_exp->exp_flock_hash, &lock->l_exp_flock_hash);
+		ldlm_export_flock_put(lock);
 		bl_exp = bl_exp_new;
 
 		if (bl_exp->exp_failed)
@@ -336,6 +390,7 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 	int local = ns_is_client(ns);
 	int added = (mode == LCK_NL);
 	int splitted = 0;
+	int rc;
 	const struct ldlm_callback_suite null_cbs = { NULL };
 #ifdef HAVE_SERVER_SUPPORT
 	struct list_head *grant_work = (intention == LDLM_PROCESS_ENQUEUE ?
@@ -585,6 +640,22 @@ reprocess:
 			goto reprocess;
 		}
 
+		if (lock->l_export != NULL) {
+			new2->l_export = class_export_lock_get(lock->l_export,
+							       new2);
+			if (new2->l_export->exp_lock_hash) {
+				rc = ldlm_export_lock_add(new2);
+				if (rc) {
+					ldlm_lock_destroy_nolock(new2);
+					ldlm_flock_destroy(req,
+							   lock->l_granted_mode,
+							   *flags);
+					*err = rc;
+					RETURN(LDLM_ITER_STOP);
+				}
+			}
+		}
+
 		splitted = 1;
 
 		new2->l_granted_mode = lock->l_granted_mode;
@@ -599,15 +670,6 @@ reprocess:
 		lock->l_policy_data.l_flock.start =
 			new->l_policy_data.l_flock.end + 1;
 		new2->l_conn_export = lock->l_conn_export;
-		if (lock->l_export != NULL) {
-			new2->l_export = class_export_lock_get(lock->l_export,
-							       new2);
-			if (new2->l_export->exp_lock_hash &&
-			    hlist_unhashed(&new2->l_exp_hash))
-				cfs_hash_add(new2->l_export->exp_lock_hash,
-					     &new2->l_remote_handle,
-					     &new2->l_exp_hash);
-		}
 		if (*flags == LDLM_FL_WAIT_NOREPROC)
 			ldlm_lock_addref_internal_nolock(new2,
 							 lock->l_granted_mode);
@@ -902,104 +964,32 @@ void ldlm_flock_policy_local_to_wire(const union ldlm_policy_data *lpolicy,
 	wpolicy->l_flock.lfw_owner = lpolicy->l_flock.owner;
 }
 
-/*
- * Export handle<->flock hash operations.
- */
-static unsigned int
-ldlm_export_flock_hash(struct cfs_hash *hs, const void *key,
-		       const unsigned int bits)
-{
-	return cfs_hash_64(*(__u64 *)key, bits);
-}
-
-static void *
-ldlm_export_flock_key(struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	return &lock->l_policy_data.l_flock.owner;
-}
-
-static int
-ldlm_export_flock_keycmp(const void *key, struct hlist_node *hnode)
-{
-	return !memcmp(ldlm_export_flock_key(hnode), key, sizeof(__u64));
-}
-
-static void *
-ldlm_export_flock_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-}
-
-static void
-ldlm_export_flock_get(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	LDLM_LOCK_GET(lock);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_get(flock->blocking_export);
-	atomic_inc(&flock->blocking_refs);
-}
-
-static void
-ldlm_export_flock_put(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_put(flock->blocking_export);
-	if (atomic_dec_and_test(&flock->blocking_refs)) {
-		flock->blocking_owner = 0;
-		flock->blocking_export = NULL;
-	}
-	LDLM_LOCK_RELEASE(lock);
-}
-
-static struct cfs_hash_ops ldlm_export_flock_ops = {
-	.hs_hash        = ldlm_export_flock_hash,
-	.hs_key         = ldlm_export_flock_key,
-	.hs_keycmp      = ldlm_export_flock_keycmp,
-	.hs_object      = ldlm_export_flock_object,
-	.hs_get         = ldlm_export_flock_get,
-	.hs_put         = ldlm_export_flock_put,
-	.hs_put_locked  = ldlm_export_flock_put,
-};
-
 int ldlm_init_flock_export(struct obd_export *exp)
 {
+	int rc;
+
 	if (strcmp(exp->exp_obd->obd_type->typ_name, LUSTRE_MDT_NAME) != 0)
 		RETURN(0);
 
-	exp->exp_flock_hash =
-		cfs_hash_create(obd_uuid2str(&exp->exp_client_uuid),
-				HASH_EXP_LOCK_CUR_BITS,
-				HASH_EXP_LOCK_MAX_BITS,
-				HASH_EXP_LOCK_BKT_BITS, 0,
-				CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
-				&ldlm_export_flock_ops,
-				CFS_HASH_DEFAULT | CFS_HASH_NBLK_CHANGE);
+	OBD_ALLOC_PTR(exp->exp_flock_hash);
 	if (!exp->exp_flock_hash)
 		RETURN(-ENOMEM);
 
-	RETURN(0);
+	rc = rhltable_init(exp->exp_flock_hash, &ldlm_export_flock_params);
+	if (rc) {
+		OBD_FREE_PTR(exp->exp_flock_hash);
+		exp->exp_flock_hash = NULL;
+	}
+
+	RETURN(rc);
 }
 
 void ldlm_destroy_flock_export(struct obd_export *exp)
 {
 	ENTRY;
 	if (exp->exp_flock_hash) {
-		cfs_hash_putref(exp->exp_flock_hash);
+		rhltable_destroy(exp->exp_flock_hash);
+		OBD_FREE_PTR(exp->exp_flock_hash);
 		exp->exp_flock_hash = NULL;
 	}
 	EXIT;
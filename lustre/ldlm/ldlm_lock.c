@@ -391,12 +391,9 @@ static int ldlm_lock_destroy_internal(struct ldlm_lock *lock)
 	ldlm_set_destroyed(lock);
 	wake_up(&lock->l_waitq);
 
-	if (lock->l_export && lock->l_export->exp_lock_hash) {
-		/* Safe to call cfs_hash_del as lock isn't in exp_lock_hash. */
-		/* below, .hs_keycmp resolves to ldlm_export_lock_keycmp() */
-		cfs_hash_del(lock->l_export->exp_lock_hash,
-			     &lock->l_remote_handle, &lock->l_exp_hash);
-	}
+	/* Safe to call even if the lock isn't in exp_lock_hash. */
+	if (lock->l_export && lock->l_export->exp_lock_hash)
+		ldlm_export_lock_del(lock);
 
 	ldlm_lock_remove_from_lru(lock);
 	class_handle_unhash(&lock->l_handle);
@@ -480,7 +477,6 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 		INIT_LIST_HEAD(&lock->l_sl_policy);
 		break;
 	case LDLM_FLOCK:
-		INIT_HLIST_NODE(&lock->l_exp_flock_hash);
 		break;
 	case LDLM_EXTENT:
 		RB_CLEAR_NODE(&lock->l_rb);
@@ -488,7 +484,6 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	case LDLM_MAX_TYPE:
 		break;
 	}
-	INIT_HLIST_NODE(&lock->l_exp_hash);
 
 	lprocfs_counter_incr(ldlm_res_to_ns(resource)->ns_stats,
 			     LDLM_NSS_LOCKS);
@@ -2447,11 +2442,8 @@ void ldlm_reprocess_all(struct ldlm_resource *res, __u64 hint)
 }
 EXPORT_SYMBOL(ldlm_reprocess_all);
 
-static int ldlm_reprocess_res(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			      struct hlist_node *hnode, void *arg)
+static int ldlm_reprocess_res(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
-
 	/* This is only called once after recovery done. LU-8306. */
 	__ldlm_reprocess_all(res, LDLM_PROCESS_RECOVERY, 0);
 	return 0;
@@ -2462,10 +2454,8 @@ void ldlm_reprocess_recovery_done(struct ldlm_namespace *ns)
 {
 	ENTRY;
 
-	if (ns != NULL) {
-		cfs_hash_for_each_nolock(ns->ns_rs_hash,
-					 ldlm_reprocess_res, NULL, 0);
-	}
+	if (ns != NULL)
+		ldlm_namespace_res_foreach(ns, ldlm_reprocess_res, NULL);
 	EXIT;
 }
 
@@ -2602,18 +2592,12 @@ static void ldlm_cancel_lock_for_export(struct obd_export *exp,
  * Iterator function for ldlm_export_cancel_locks.
  * Cancels passed locks.
  */
-static int
-ldlm_cancel_locks_for_export_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				struct hlist_node *hnode, void *data)
-
+static int ldlm_cancel_locks_for_export_cb(struct ldlm_lock *lock, void *data)
 {
 	struct export_cl_data	*ecl = (struct export_cl_data *)data;
 	struct obd_export	*exp  = ecl->ecl_exp;
-	struct ldlm_lock	*lock = cfs_hash_object(hs, hnode);
 
-	LDLM_LOCK_GET(lock);
 	ldlm_cancel_lock_for_export(exp, lock, ecl);
-	LDLM_LOCK_RELEASE(lock);
 
 	return 0;
 }
@@ -2662,7 +2646,7 @@ int ldlm_export_cancel_blocked_locks(struct obd_export *exp)
 
 	CDEBUG(D_DLMTRACE,
 	       "Export %p, canceled %d locks, left on hash table %d.\n", exp,
-	       ecl.ecl_loop, atomic_read(&exp->exp_lock_hash->hs_count));
+	       ecl.ecl_loop, atomic_read(&exp->exp_lock_hash->ht.nelems));
 
 	return ecl.ecl_loop;
 }
@@ -2676,6 +2660,7 @@ int ldlm_export_cancel_locks(struct obd_export *exp)
 {
 	struct export_cl_data ecl;
 	struct lu_env env;
+	unsigned int i = 0;
 	int rc;
 
 	rc = lu_env_init(&env, LCT_DT_THREAD);
@@ -2685,15 +2670,22 @@ int ldlm_export_cancel_locks(struct obd_export *exp)
 	ecl.ecl_exp = exp;
 	ecl.ecl_loop = 0;
 
-	cfs_hash_for_each_empty(exp->exp_lock_hash,
-				ldlm_cancel_locks_for_export_cb, &ecl);
+	/* cancelled locks are removed from exp_lock_hash */
+	while (atomic_read(&exp->exp_lock_hash->ht.nelems) > 0) {
+		ldlm_export_lock_foreach(exp, ldlm_cancel_locks_for_export_cb,
+					 &ecl);
+		if (++i % 100 == 0)
+			CDEBUG(D_INFO, "Export %p, emptying lock hash: loop %u\n",
+			       exp, i);
+		cond_resched();
+	}
 
 	CDEBUG(D_DLMTRACE,
 	       "Export %p, canceled %d locks, left on hash table %d.\n", exp,
-	       ecl.ecl_loop, atomic_read(&exp->exp_lock_hash->hs_count));
+	       ecl.ecl_loop, atomic_read(&exp->exp_lock_hash->ht.nelems));
 
 	if (ecl.ecl_loop > 0 &&
-	    atomic_read(&exp->exp_lock_hash->hs_count) == 0 &&
+	    atomic_read(&exp->exp_lock_hash->ht.nelems) == 0 &&
 	    exp->exp_obd->obd_stopping)
 		ldlm_reprocess_recovery_done(exp->exp_obd->obd_namespace);
 
@@ -1353,12 +1353,8 @@ int ldlm_handle_enqueue(struct ldlm_namespace *ns,
 	if (unlikely((flags & LDLM_FL_REPLAY) ||
 		     (lustre_msg_get_flags(req->rq_reqmsg) & MSG_RESENT))) {
 		/* Find an existing lock in the per-export lock hash */
-		/*
-		 * In the function below, .hs_keycmp resolves to
-		 * ldlm_export_lock_keycmp()
-		 */
-		lock = cfs_hash_lookup(req->rq_export->exp_lock_hash,
-				       (void *)&dlm_req->lock_handle[0]);
+		lock = ldlm_export_lock_lookup(req->rq_export,
+					       &dlm_req->lock_handle[0]);
 		if (lock != NULL) {
 			DEBUG_REQ(D_DLMTRACE, req,
 				  "found existing lock cookie %#llx",
@@ -1417,10 +1413,11 @@ int ldlm_handle_enqueue(struct ldlm_namespace *ns,
 	}
 
 	lock->l_export = class_export_lock_get(req->rq_export, lock);
-	if (lock->l_export->exp_lock_hash)
-		cfs_hash_add(lock->l_export->exp_lock_hash,
-			     &lock->l_remote_handle,
-			     &lock->l_exp_hash);
+	if (lock->l_export->exp_lock_hash) {
+		rc = ldlm_export_lock_add(lock);
+		if (rc)
+			GOTO(out, rc);
+	}
 
 	/*
 	 * Inherit the enqueue flags before the operation, because we do not
@@ -2737,12 +2734,9 @@ static int ldlm_hpreq_handler(struct ptlrpc_request *req)
 	RETURN(0);
 }
 
-static int ldlm_revoke_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			       struct hlist_node *hnode, void *data)
-
+static int ldlm_revoke_lock_cb(struct ldlm_lock *lock, void *data)
 {
 	struct list_head *rpc_list = data;
-	struct ldlm_lock *lock = cfs_hash_object(hs, hnode);
 
 	lock_res_and_lock(lock);
 
@@ -2767,18 +2761,9 @@ static int ldlm_revoke_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	LASSERT(!lock->l_blocking_lock);
 
 	ldlm_set_ast_sent(lock);
-	if (lock->l_export && lock->l_export->exp_lock_hash) {
-		/*
-		 * NB: it's safe to call cfs_hash_del() even lock isn't
-		 * in exp_lock_hash.
-		 */
-		/*
-		 * In the function below, .hs_keycmp resolves to
-		 * ldlm_export_lock_keycmp()
-		 */
-		cfs_hash_del(lock->l_export->exp_lock_hash,
-			     &lock->l_remote_handle, &lock->l_exp_hash);
-	}
+	/* NB: it's safe to call even if the lock isn't in exp_lock_hash. */
+	if (lock->l_export && lock->l_export->exp_lock_hash)
+		ldlm_export_lock_del(lock);
 
 	list_add_tail(&lock->l_rk_ast, rpc_list);
 	LDLM_LOCK_GET(lock);
@@ -2794,8 +2779,7 @@ void ldlm_revoke_export_locks(struct obd_export *exp)
 
 	ENTRY;
 
-	cfs_hash_for_each_nolock(exp->exp_lock_hash,
-				 ldlm_revoke_lock_cb, &rpc_list, 0);
+	ldlm_export_lock_foreach(exp, ldlm_revoke_lock_cb, &rpc_list);
 	rc = ldlm_run_ast_work(exp->exp_obd->obd_namespace, &rpc_list,
 			  LDLM_WORK_REVOKE_AST);
 
@@ -3120,72 +3104,164 @@ void ldlm_put_ref(void)
 	EXIT;
 }
 
-/* Export handle<->lock hash operations. */
-static unsigned
-ldlm_export_lock_hash(struct cfs_hash *hs, const void *key,
-		      const unsigned int bits)
-{
-	return cfs_hash_64(((struct lustre_handle *)key)->cookie, bits);
-}
+/*
+ * Export handle<->lock hash operations.
+ *
+ * Lookups are lockless under RCU, locks are freed after a grace period and
+ * a hashed lock holds a reference which is dropped when it is unhashed.
+ * Several locks may have the same remote handle, e.g. the lock replaced by
+ * mdt_intent_lock_replace() until it is destroyed, so this is an rhltable.
+ */
+static const struct rhashtable_params ldlm_export_lock_params = {
+	.key_len	= sizeof(struct lustre_handle),
+	.key_offset	= offsetof(struct ldlm_lock, l_remote_handle),
+	.head_offset	= offsetof(struct ldlm_lock, l_exp_hash),
+	.nelem_hint	= 1U << HASH_EXP_LOCK_CUR_BITS,
+	.automatic_shrinking = true,
+};
 
-static void *
-ldlm_export_lock_key(struct hlist_node *hnode)
+/* Add \a lock to the per-export hash of its export, keyed by remote handle */
+int ldlm_export_lock_add(struct ldlm_lock *lock)
 {
-	struct ldlm_lock *lock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_hash);
-	return &lock->l_remote_handle;
-}
+	int rc;
 
-static void
-ldlm_export_lock_keycpy(struct hlist_node *hnode, void *key)
-{
-	struct ldlm_lock     *lock;
+	LDLM_LOCK_GET(lock);
+	rc = rhltable_insert_key(lock->l_export->exp_lock_hash,
+				 &lock->l_remote_handle, &lock->l_exp_hash,
+				 ldlm_export_lock_params);
+	if (rc) {
+		LDLM_ERROR(lock, "cannot add to export lock hash: rc = %d",
+			   rc);
+		LDLM_LOCK_RELEASE(lock);
+	}
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_hash);
-	lock->l_remote_handle = *(struct lustre_handle *)key;
+	return rc;
 }
+EXPORT_SYMBOL(ldlm_export_lock_add);
 
-static int
-ldlm_export_lock_keycmp(const void *key, struct hlist_node *hnode)
+/* Remove \a lock from the per-export hash, safe if it is not hashed */
+void ldlm_export_lock_del(struct ldlm_lock *lock)
 {
-	return lustre_handle_equal(ldlm_export_lock_key(hnode), key);
+	if (rhltable_remove(lock->l_export->exp_lock_hash, &lock->l_exp_hash,
+			    ldlm_export_lock_params) == 0)
+		LDLM_LOCK_RELEASE(lock);
 }
+EXPORT_SYMBOL(ldlm_export_lock_del);
 
-static void *
-ldlm_export_lock_object(struct hlist_node *hnode)
+/**
+ * Change the remote handle of \a lock to \a remote, moving it in the
+ * per-export hash if it was hashed. Callers serialize rehashes of the
+ * same lock with the resource lock.
+ *
+ * The lock has a single hash node, so it is briefly unhashed. This is
+ * done under exp_lock_hash_seq so that ldlm_export_lock_lookup() retries
+ * a miss instead of reporting it. If the lock cannot be hashed with the
+ * new handle it is put back with the old one.
+ */
+void ldlm_export_lock_rehash(struct obd_export *exp, struct ldlm_lock *lock,
+			     const struct lustre_handle *remote)
 {
-	return hlist_entry(hnode, struct ldlm_lock, l_exp_hash);
+	struct lustre_handle old = lock->l_remote_handle;
+	int rc;
+
+	if (!exp || !exp->exp_lock_hash) {
+		lock->l_remote_handle = *remote;
+		return;
+	}
+
+	write_seqlock(&exp->exp_lock_hash_seq);
+	rc = rhltable_remove(exp->exp_lock_hash, &lock->l_exp_hash,
+			     ldlm_export_lock_params);
+	lock->l_remote_handle = *remote;
+	if (rc)
+		goto out;
+
+	/* keep the reference of the old hash entry for the new one */
+	rc = rhltable_insert_key(exp->exp_lock_hash, &lock->l_remote_handle,
+				 &lock->l_exp_hash, ldlm_export_lock_params);
+	if (rc == 0)
+		goto out;
+
+	LDLM_ERROR(lock, "cannot rehash in export lock hash: rc = %d", rc);
+	lock->l_remote_handle = old;
+	rc = rhltable_insert_key(exp->exp_lock_hash, &lock->l_remote_handle,
+				 &lock->l_exp_hash, ldlm_export_lock_params);
+	if (rc)
+		LDLM_LOCK_RELEASE(lock);
+out:
+	write_sequnlock(&exp->exp_lock_hash_seq);
 }
+EXPORT_SYMBOL(ldlm_export_lock_rehash);
 
-static void
-ldlm_export_lock_get(struct cfs_hash *hs, struct hlist_node *hnode)
+/**
+ * Find the lock with remote handle \a remote in the per-export hash.
+ * The most recently added lock is found first.
+ *
+ * \retval referenced lock, release with LDLM_LOCK_RELEASE()
+ * \retval NULL if not found
+ */
+struct ldlm_lock *ldlm_export_lock_lookup(struct obd_export *exp,
+					  const struct lustre_handle *remote)
 {
+	struct rhlist_head *list, *pos;
 	struct ldlm_lock *lock;
+	unsigned int seq;
+
+	rcu_read_lock();
+	do {
+		seq = read_seqbegin(&exp->exp_lock_hash_seq);
+		list = rhltable_lookup(exp->exp_lock_hash, remote,
+				       ldlm_export_lock_params);
+		rhl_for_each_entry_rcu(lock, pos, list, l_exp_hash) {
+			/* the lock is being freed if it has no reference */
+			if (refcount_inc_not_zero(&lock->l_handle.h_ref))
+				goto out;
+		}
+		lock = NULL;
+	} while (read_seqretry(&exp->exp_lock_hash_seq, seq));
+out:
+	rcu_read_unlock();
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_hash);
-	LDLM_LOCK_GET(lock);
+	return lock;
 }
+EXPORT_SYMBOL(ldlm_export_lock_lookup);
 
-static void
-ldlm_export_lock_put(struct cfs_hash *hs, struct hlist_node *hnode)
+/**
+ * Call \a iter on every lock in the per-export hash of \a exp.
+ *
+ * A reference is held on the lock across the call, and \a iter may block
+ * or remove the lock from the hash. The walk stops on the first non-zero
+ * value returned by \a iter, which is returned.
+ */
+int ldlm_export_lock_foreach(struct obd_export *exp, ldlm_iterator_t iter,
+			     void *closure)
 {
+	struct rhashtable_iter hiter;
 	struct ldlm_lock *lock;
+	int rc = 0;
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_hash);
-	LDLM_LOCK_RELEASE(lock);
-}
+	rhltable_walk_enter(exp->exp_lock_hash, &hiter);
+	rhashtable_walk_start(&hiter);
+	while ((lock = rhashtable_walk_next(&hiter)) != NULL) {
+		if (IS_ERR(lock))
+			continue;
+		if (!refcount_inc_not_zero(&lock->l_handle.h_ref))
+			continue;
+		rhashtable_walk_stop(&hiter);
 
-static struct cfs_hash_ops ldlm_export_lock_ops = {
-	.hs_hash        = ldlm_export_lock_hash,
-	.hs_key         = ldlm_export_lock_key,
-	.hs_keycmp      = ldlm_export_lock_keycmp,
-	.hs_keycpy      = ldlm_export_lock_keycpy,
-	.hs_object      = ldlm_export_lock_object,
-	.hs_get         = ldlm_export_lock_get,
-	.hs_put         = ldlm_export_lock_put,
-	.hs_put_locked  = ldlm_export_lock_put,
-};
+		rc = iter(lock, closure);
+		LDLM_LOCK_RELEASE(lock);
+
+		rhashtable_walk_start(&hiter);
+		if (rc)
+			break;
+	}
+	rhashtable_walk_stop(&hiter);
+	rhashtable_walk_exit(&hiter);
+
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_export_lock_foreach);
 
 int ldlm_init_export(struct obd_export *exp)
 {
@@ -3193,19 +3269,18 @@ int ldlm_init_export(struct obd_export *exp)
 
 	ENTRY;
 
-	exp->exp_lock_hash =
-		cfs_hash_create(obd_uuid2str(&exp->exp_client_uuid),
-				HASH_EXP_LOCK_CUR_BITS,
-				HASH_EXP_LOCK_MAX_BITS,
-				HASH_EXP_LOCK_BKT_BITS, 0,
-				CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
-				&ldlm_export_lock_ops,
-				CFS_HASH_DEFAULT | CFS_HASH_REHASH_KEY |
-				CFS_HASH_NBLK_CHANGE);
-
+	seqlock_init(&exp->exp_lock_hash_seq);
+	OBD_ALLOC_PTR(exp->exp_lock_hash);
 	if (!exp->exp_lock_hash)
 		RETURN(-ENOMEM);
 
+	rc = rhltable_init(exp->exp_lock_hash, &ldlm_export_lock_params);
+	if (rc) {
+		OBD_FREE_PTR(exp->exp_lock_hash);
+		exp->exp_lock_hash = NULL;
+		RETURN(rc);
+	}
+
 	rc = ldlm_init_flock_export(exp);
 	if (rc)
 		GOTO(err, rc);
@@ -3220,8 +3295,12 @@ EXPORT_SYMBOL(ldlm_init_export);
 void ldlm_destroy_export(struct obd_export *exp)
 {
 	ENTRY;
-	cfs_hash_putref(exp->exp_lock_hash);
-	exp->exp_lock_hash = NULL;
+	if (exp->exp_lock_hash) {
+		/* all locks were cancelled and unhashed by now */
+		rhltable_destroy(exp->exp_lock_hash);
+		OBD_FREE_PTR(exp->exp_lock_hash);
+		exp->exp_lock_hash = NULL;
+	}
 
 	ldlm_destroy_flock_export(exp);
 	EXIT;
@@ -38,6 +38,7 @@
 #include <lustre_dlm.h>
 #include <lustre_fid.h>
 #include <obd_class.h>
+#include <linux/jhash.h>
 #include <libcfs/linux/linux-hash.h>
 #include "ldlm_internal.h"
 
@@ -766,19 +767,6 @@ static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 }
 #undef MAX_STRING_SIZE
 
-static unsigned int ldlm_res_hop_hash(struct cfs_hash *hs,
-				      const void *key, const unsigned int bits)
-{
-	const struct ldlm_res_id *id = key;
-	unsigned int val = 0;
-	unsigned int i;
-
-	for (i = 0; i < RES_NAME_SIZE; i++)
-		val += id->name[i];
-
-	return val & ((1UL << bits) - 1);
-}
-
 static unsigned int ldlm_res_hop_fid_hash(const struct ldlm_res_id *id,
 					  const unsigned int bits)
 {
@@ -802,84 +790,54 @@ static unsigned int ldlm_res_hop_fid_hash(const struct ldlm_res_id *id,
 	return cfs_hash_32(hash, bits);
 }
 
-static void *ldlm_res_hop_key(struct hlist_node *hnode)
+static u32 ldlm_res_hash(const void *data, u32 len, u32 seed)
 {
-	struct ldlm_resource   *res;
+	const struct ldlm_res_id *id = data;
 
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	return &res->lr_name;
+	return jhash2((const u32 *)id->name, len / sizeof(u32), seed);
 }
 
-static int ldlm_res_hop_keycmp(const void *key, struct hlist_node *hnode)
-{
-	struct ldlm_resource   *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	return ldlm_res_eq((const struct ldlm_res_id *)key,
-			   (const struct ldlm_res_id *)&res->lr_name);
-}
-
-static void *ldlm_res_hop_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct ldlm_resource, lr_hash);
-}
-
-static void
-ldlm_res_hop_get_locked(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_resource *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	ldlm_resource_getref(res);
-}
-
-static void ldlm_res_hop_put(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_resource *res;
-
-	res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
-	ldlm_resource_putref(res);
-}
-
-static struct cfs_hash_ops ldlm_ns_hash_ops = {
-	.hs_hash        = ldlm_res_hop_hash,
-	.hs_key         = ldlm_res_hop_key,
-	.hs_keycmp      = ldlm_res_hop_keycmp,
-	.hs_keycpy      = NULL,
-	.hs_object      = ldlm_res_hop_object,
-	.hs_get         = ldlm_res_hop_get_locked,
-	.hs_put         = ldlm_res_hop_put
+/*
+ * The resource hash is only looked up under RCU, a resource is unhashed
+ * once its last reference is dropped and freed after a grace period.
+ */
+static const struct rhashtable_params ldlm_res_hash_params = {
+	.key_len	= sizeof(struct ldlm_res_id),
+	.key_offset	= offsetof(struct ldlm_resource, lr_name),
+	.head_offset	= offsetof(struct ldlm_resource, lr_hash),
+	.hashfn		= ldlm_res_hash,
+	.automatic_shrinking = true,
 };
 
 static struct {
-	/** hash bucket bits */
+	/** bits of the ldlm_ns_bucket array (adaptive timeouts) */
 	unsigned int		nsd_bkt_bits;
-	/** hash bits */
-	unsigned int		nsd_all_bits;
+	/** expected number of resources, sizes the initial hash table */
+	unsigned int		nsd_hint_bits;
 } ldlm_ns_hash_defs[] = {
 	[LDLM_NS_TYPE_MDC] = {
-		.nsd_bkt_bits   = 11,
-		.nsd_all_bits   = 16,
+		.nsd_bkt_bits   = 5,
+		.nsd_hint_bits  = 11,
 	},
 	[LDLM_NS_TYPE_MDT] = {
-		.nsd_bkt_bits   = 14,
-		.nsd_all_bits   = 21,
+		.nsd_bkt_bits   = 7,
+		.nsd_hint_bits  = 14,
 	},
 	[LDLM_NS_TYPE_OSC] = {
-		.nsd_bkt_bits   = 8,
-		.nsd_all_bits   = 12,
+		.nsd_bkt_bits   = 4,
+		.nsd_hint_bits  = 8,
 	},
 	[LDLM_NS_TYPE_OST] = {
-		.nsd_bkt_bits   = 11,
-		.nsd_all_bits   = 17,
+		.nsd_bkt_bits   = 6,
+		.nsd_hint_bits  = 11,
 	},
 	[LDLM_NS_TYPE_MGC] = {
-		.nsd_bkt_bits   = 3,
-		.nsd_all_bits   = 4,
+		.nsd_bkt_bits   = 1,
+		.nsd_hint_bits  = 3,
 	},
 	[LDLM_NS_TYPE_MGT] = {
-		.nsd_bkt_bits   = 3,
-		.nsd_all_bits   = 4,
+		.nsd_bkt_bits   = 1,
+		.nsd_hint_bits  = 3,
 	},
 };
 
@@ -891,6 +849,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 					  enum ldlm_appetite apt,
 					  enum ldlm_ns_type ns_type)
 {
+	struct rhashtable_params params = ldlm_res_hash_params;
 	struct ldlm_namespace *ns = NULL;
 	int idx;
 	int rc;
@@ -916,23 +875,12 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	if (!ns)
 		GOTO(out_ref, rc = -ENOMEM);
 
-	ns->ns_rs_hash = cfs_hash_create(name,
-					 ldlm_ns_hash_defs[ns_type].nsd_all_bits,
-					 ldlm_ns_hash_defs[ns_type].nsd_all_bits,
-					 ldlm_ns_hash_defs[ns_type].nsd_bkt_bits,
-					 0,
-					 CFS_HASH_MIN_THETA,
-					 CFS_HASH_MAX_THETA,
-					 &ldlm_ns_hash_ops,
-					 CFS_HASH_DEPTH |
-					 CFS_HASH_BIGNAME |
-					 CFS_HASH_SPIN_BKTLOCK |
-					 CFS_HASH_NO_ITEMREF);
-	if (!ns->ns_rs_hash)
-		GOTO(out_ns, rc = -ENOMEM);
-
-	ns->ns_bucket_bits = ldlm_ns_hash_defs[ns_type].nsd_all_bits -
-			     ldlm_ns_hash_defs[ns_type].nsd_bkt_bits;
+	params.nelem_hint = 1U << ldlm_ns_hash_defs[ns_type].nsd_hint_bits;
+	rc = rhashtable_init(&ns->ns_rs_hash, &params);
+	if (rc)
+		GOTO(out_ns, rc);
+
+	ns->ns_bucket_bits = ldlm_ns_hash_defs[ns_type].nsd_bkt_bits;
 
 	OBD_ALLOC_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
 	if (!ns->ns_rs_buckets)
@@ -943,7 +891,6 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 
 		at_init(&nsb->nsb_at_estimate, obd_get_ldlm_enqueue_min(obd), 0);
 		nsb->nsb_namespace = ns;
-		nsb->nsb_reclaim_start = 0;
 		atomic_set(&nsb->nsb_count, 0);
 	}
 
@@ -1007,9 +954,11 @@ out_sysfs:
 	ldlm_namespace_sysfs_unregister(ns);
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
-	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
+	if (ns->ns_rs_buckets)
+		OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets,
+					 1 << ns->ns_bucket_bits);
 	kfree(ns->ns_name);
-	cfs_hash_putref(ns->ns_rs_hash);
+	rhashtable_destroy(&ns->ns_rs_hash);
 out_ns:
 	OBD_FREE_PTR(ns);
 out_ref:
@@ -1104,10 +1053,8 @@ static void cleanup_resource(struct ldlm_resource *res, struct list_head *q,
 	} while (1);
 }
 
-static int ldlm_resource_clean(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			       struct hlist_node *hnode, void *arg)
+static int ldlm_resource_clean(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
 	__u64 flags = *(__u64 *)arg;
 
 	cleanup_resource(res, &res->lr_granted, flags);
@@ -1116,16 +1063,20 @@ static int ldlm_resource_clean(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	return 0;
 }
 
-static int ldlm_resource_complain(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				  struct hlist_node *hnode, void *arg)
+static int ldlm_resource_complain(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource  *res = cfs_hash_object(hs, hnode);
+	/* not counting the reference of ldlm_namespace_res_foreach() */
+	int refcount = refcount_read(&res->lr_refcount) - 1;
+
+	/* released since cleanup, our putref frees it */
+	if (refcount == 0)
+		return 0;
 
 	lock_res(res);
 	CERROR("%s: namespace resource "DLDLMRES" (%p) refcount nonzero "
 	       "(%d) after lock cleanup; forcing cleanup.\n",
 	       ldlm_ns_name(ldlm_res_to_ns(res)), PLDLMRES(res), res,
-	       refcount_read(&res->lr_refcount) - 1);
+	       refcount);
 
 	/* Use D_NETERROR since it is in the default mask */
 	ldlm_resource_dump(D_NETERROR, res);
@@ -1147,10 +1098,8 @@ int ldlm_namespace_cleanup(struct ldlm_namespace *ns, __u64 flags)
 		return ELDLM_OK;
 	}
 
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_resource_clean,
-				 &flags, 0);
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_resource_complain,
-				 NULL, 0);
+	ldlm_namespace_res_foreach(ns, ldlm_resource_clean, &flags);
+	ldlm_namespace_res_foreach(ns, ldlm_resource_complain, NULL);
 	return ELDLM_OK;
 }
 EXPORT_SYMBOL(ldlm_namespace_cleanup);
@@ -1275,7 +1224,7 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
-	cfs_hash_putref(ns->ns_rs_hash);
+	rhashtable_destroy(&ns->ns_rs_hash);
 	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
@@ -1495,68 +1444,92 @@ static void ldlm_resource_free(struct ldlm_resource *res)
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
- * Locks: takes and releases NS hash-lock and res->lr_lock
+ * Locks: lookups are lockless under RCU, takes and releases res->lr_lock
  * Returns: referenced, unlocked ldlm_resource or ERR_PTR
  */
 struct ldlm_resource *
 ldlm_resource_get(struct ldlm_namespace *ns, const struct ldlm_res_id *name,
 		  enum ldlm_type type, int create)
 {
-	struct hlist_node	*hnode;
-	struct ldlm_resource	*res = NULL;
-	struct cfs_hash_bd		bd;
-	__u64			version;
+	struct ldlm_resource	*res;
+	struct ldlm_resource	*new = NULL;
 	int			ns_refcount = 0;
 	int hash;
 
 	LASSERT(ns != NULL);
-	LASSERT(ns->ns_rs_hash != NULL);
 	LASSERT(name->name[0] != 0);
 
-	cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
-	hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
-	if (hnode != NULL) {
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
-		GOTO(found, res);
+	rcu_read_lock();
+	res = rhashtable_lookup(&ns->ns_rs_hash, name, ldlm_res_hash_params);
+	/* a resource found with no references is being freed */
+	if (res && refcount_inc_not_zero(&res->lr_refcount)) {
+		rcu_read_unlock();
+		return res;
 	}
-
-	version = cfs_hash_bd_version_get(&bd);
-	cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
+	rcu_read_unlock();
 
 	if (create == 0)
 		return ERR_PTR(-ENOENT);
 
 	LASSERTF(type >= LDLM_MIN_TYPE && type < LDLM_MAX_TYPE,
 		 "type: %d\n", type);
-	res = ldlm_resource_new(type);
-	if (res == NULL)
+	new = ldlm_resource_new(type);
+	if (new == NULL)
 		return ERR_PTR(-ENOMEM);
 
 	hash = ldlm_res_hop_fid_hash(name, ns->ns_bucket_bits);
-	res->lr_ns_bucket = &ns->ns_rs_buckets[hash];
-	res->lr_name = *name;
-	res->lr_type = type;
-
-	cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 1);
-	hnode = (version == cfs_hash_bd_version_get(&bd)) ? NULL :
-		cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
-
-	if (hnode != NULL) {
-		/* Someone won the race and already added the resource. */
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
-		/* Clean lu_ref for failed resource. */
-		lu_ref_fini(&res->lr_reference);
-		ldlm_resource_free(res);
-found:
-		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
+	new->lr_ns_bucket = &ns->ns_rs_buckets[hash];
+	new->lr_name = *name;
+	new->lr_type = type;
+
+	/* nsb_count must not drop to zero while the resource is visible */
+	if (atomic_inc_return(&new->lr_ns_bucket->nsb_count) == 1)
+		ns_refcount = ldlm_namespace_get_return(ns);
+
+try_again:
+	rcu_read_lock();
+	res = rhashtable_lookup_get_insert_fast(&ns->ns_rs_hash, &new->lr_hash,
+						ldlm_res_hash_params);
+	if (IS_ERR(res)) {
+		rcu_read_unlock();
+		CDEBUG(D_INFO, "%s: insert "DLDLMRES" failed: rc = %ld\n",
+		       ldlm_ns_name(ns), PLDLMRES(new), PTR_ERR(res));
+		/* -E2BIG is transient while the table is being resized */
+		if (PTR_ERR(res) != -ENOMEM) {
+			cond_resched();
+			goto try_again;
+		}
+		if (atomic_dec_and_test(&new->lr_ns_bucket->nsb_count))
+			ldlm_namespace_put(ns);
+		lu_ref_fini(&new->lr_reference);
+		ldlm_resource_free(new);
 		return res;
 	}
-	/* We won! Let's add the resource. */
-	cfs_hash_bd_add_locked(ns->ns_rs_hash, &bd, &res->lr_hash);
-	if (atomic_inc_return(&res->lr_ns_bucket->nsb_count) == 1)
-		ns_refcount = ldlm_namespace_get_return(ns);
 
-	cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
+	if (res) {
+		if (refcount_inc_not_zero(&res->lr_refcount)) {
+			/* Someone won the race and already added the resource. */
+			rcu_read_unlock();
+			if (atomic_dec_and_test(&new->lr_ns_bucket->nsb_count))
+				ldlm_namespace_put(ns);
+			/* Clean lu_ref for failed resource. */
+			lu_ref_fini(&new->lr_reference);
+			ldlm_resource_free(new);
+			return res;
+		}
+		/*
+		 * The old resource is on its way out, unhash it now rather
+		 * than wait for its final ldlm_resource_putref() to do it.
+		 * It is not freed before rcu_read_unlock().
+		 */
+		rhashtable_remove_fast(&ns->ns_rs_hash, &res->lr_hash,
+				       ldlm_res_hash_params);
+		rcu_read_unlock();
+		goto try_again;
+	}
+	rcu_read_unlock();
+	/* We won! The resource is hashed. */
+	res = new;
 
 	CFS_FAIL_TIMEOUT(OBD_FAIL_LDLM_CREATE_RESOURCE, 2);
 
@@ -1585,8 +1558,7 @@ struct ldlm_resource *ldlm_resource_getref(struct ldlm_resource *res)
 	return res;
 }
 
-static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
-					 struct ldlm_resource *res)
+static void __ldlm_resource_putref_final(struct ldlm_resource *res)
 {
 	struct ldlm_ns_bucket *nsb = res->lr_ns_bucket;
 
@@ -1600,8 +1572,9 @@ static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
 		LBUG();
 	}
 
-	cfs_hash_bd_del_locked(nsb->nsb_namespace->ns_rs_hash,
-			       bd, &res->lr_hash);
+	/* -ENOENT if ldlm_resource_get() already unhashed it for a new one */
+	rhashtable_remove_fast(&nsb->nsb_namespace->ns_rs_hash, &res->lr_hash,
+			       ldlm_res_hash_params);
 	lu_ref_fini(&res->lr_reference);
 	if (atomic_dec_and_test(&nsb->nsb_count))
 		ldlm_namespace_put(nsb->nsb_namespace);
@@ -1611,7 +1584,6 @@ static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
 int ldlm_resource_putref(struct ldlm_resource *res)
 {
 	struct ldlm_namespace *ns;
-	struct cfs_hash_bd bd;
 	int refcount;
 
 	if (refcount_dec_not_one(&res->lr_refcount))
@@ -1623,10 +1595,12 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 	CDEBUG(D_INFO, "putref res: %p count: %d\n",
 	       res, refcount_read(&res->lr_refcount) - 1);
 
-	cfs_hash_bd_get(ns->ns_rs_hash, &res->lr_name, &bd);
-	if (cfs_hash_bd_dec_and_lock(ns->ns_rs_hash, &bd, &res->lr_refcount)) {
-		__ldlm_resource_putref_final(&bd, res);
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
+	/*
+	 * Once the count is zero, lookups under RCU may still find the
+	 * resource but can no longer take a reference on it.
+	 */
+	if (refcount_dec_and_test(&res->lr_refcount)) {
+		__ldlm_resource_putref_final(res);
 		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
 			ns->ns_lvbo->lvbo_free(res);
 		ldlm_resource_free(res);
@@ -1636,6 +1610,48 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 }
 EXPORT_SYMBOL(ldlm_resource_putref);
 
+/**
+ * Call \a iter on every resource of the namespace.
+ *
+ * The walk holds a reference on the current resource and leaves the RCU
+ * read section around \a iter, so the callback may block and may drop
+ * locks or even the last other reference on the resource. Resources
+ * added or removed during the walk may or may not be visited.
+ *
+ * \retval 0 all resources were visited
+ * \retval the first non-zero value returned by \a iter
+ */
+int ldlm_namespace_res_foreach(struct ldlm_namespace *ns,
+			       ldlm_res_iterator_t iter, void *closure)
+{
+	struct rhashtable_iter hiter;
+	struct ldlm_resource *res;
+	int rc = 0;
+
+	rhashtable_walk_enter(&ns->ns_rs_hash, &hiter);
+	rhashtable_walk_start(&hiter);
+	while ((res = rhashtable_walk_next(&hiter)) != NULL) {
+		/* -EAGAIN on resize, some resources may be seen twice */
+		if (IS_ERR(res))
+			continue;
+		if (!refcount_inc_not_zero(&res->lr_refcount))
+			continue;
+		rhashtable_walk_stop(&hiter);
+
+		rc = iter(res, closure);
+		ldlm_resource_putref(res);
+
+		rhashtable_walk_start(&hiter);
+		if (rc)
+			break;
+	}
+	rhashtable_walk_stop(&hiter);
+	rhashtable_walk_exit(&hiter);
+
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_namespace_res_foreach);
+
 static void __ldlm_resource_add_lock(struct ldlm_resource *res,
 				     struct list_head *head,
 				     struct ldlm_lock *lock,
@@ -1745,10 +1761,8 @@ void ldlm_dump_all_namespaces(enum ldlm_side client, int level)
 	mutex_unlock(ldlm_namespace_lock(client));
 }
 
-static int ldlm_res_hash_dump(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-			      struct hlist_node *hnode, void *arg)
+static int ldlm_res_hash_dump(struct ldlm_resource *res, void *arg)
 {
-	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
 	int    level = (int)(unsigned long)arg;
 
 	lock_res(res);
@@ -1771,9 +1785,8 @@ void ldlm_namespace_dump(int level, struct ldlm_namespace *ns)
 	if (ktime_get_seconds() < ns->ns_next_dump)
 		return;
 
-	cfs_hash_for_each_nolock(ns->ns_rs_hash,
-				 ldlm_res_hash_dump,
-				 (void *)(unsigned long)level, 0);
+	ldlm_namespace_res_foreach(ns, ldlm_res_hash_dump,
+				   (void *)(unsigned long)level);
 	spin_lock(&ns->ns_lock);
 	ns->ns_next_dump = ktime_get_seconds() + 10;
 	spin_unlock(&ns->ns_lock);
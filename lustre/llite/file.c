@@ -815,6 +815,18 @@ static int ll_local_open(struct file *file, struct lookup_intent *it,
 	fd->fd_omode = it->it_open_flags & (FMODE_READ | FMODE_WRITE |
 					    FMODE_EXEC);
 
+	/* io_uring issues I/O inline with IOCB_NOWAIT on such files instead
+	 * of queueing it to a worker thread, see ll_file_nowait_eagain()
+	 */
+	if (S_ISREG(inode->i_mode) && ll_sbi_has_nowait_io(ll_i2sbi(inode))) {
+#ifdef FMODE_NOWAIT
+		file->f_mode |= FMODE_NOWAIT;
+#endif
+#ifdef FMODE_DIO_PARALLEL_WRITE
+		file->f_mode |= FMODE_DIO_PARALLEL_WRITE;
+#endif
+	}
+
 	RETURN(0);
 }
 
@@ -1901,7 +1913,11 @@ restart:
 		    !(vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
 			CDEBUG(D_VFSTRACE, "Range lock "RL_FMT"\n",
 			       RL_PARA(&range));
-			rc = range_lock(&lli->lli_write_tree, &range);
+			if (io->ci_iocb_nowait)
+				rc = range_lock_try(&lli->lli_write_tree,
+						    &range);
+			else
+				rc = range_lock(&lli->lli_write_tree, &range);
 			if (rc < 0)
 				GOTO(out, rc);
 
@@ -2180,6 +2196,10 @@ fini_io:
 	kms = attr->cat_kms;
 	/* if read beyond end-of-file, adjust read count */
 	if (kms > 0 && (iocb->ki_pos >= kms || read_end > kms)) {
+		/* the glimpse is an RPC to the OSTs */
+		if (ll_iocb_nowait(iocb))
+			RETURN(-EAGAIN);
+
 		rc = ll_glimpse_size(inode);
 		if (rc != 0)
 			return rc;
@@ -2280,6 +2300,58 @@ static bool is_unaligned_directio(struct kiocb *iocb, struct iov_iter *iter,
 #endif /* HAVE_DIO_ITER */
 }
 
+/**
+ * Check whether an IOCB_NOWAIT read or write has to be retried from a context
+ * that may block.
+ *
+ * Only async direct I/O is submitted inline: it is lockless unless appending,
+ * its RPCs are handed to ptlrpcd without waiting for them, and it completes
+ * through ki_complete().  Buffered I/O, sync DIO, and I/O that would have to
+ * fetch the layout or wait for a truncate return -EAGAIN instead, so that
+ * io_uring queues them to its worker threads as before.
+ *
+ * \retval true	the caller must return -EAGAIN
+ */
+static bool ll_file_nowait_eagain(struct kiocb *iocb, enum cl_io_type iot)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_file_data *fd = file->private_data;
+	int flags = iocb_ki_flags_get(file, iocb);
+
+	if (!ll_iocb_nowait(iocb))
+		return false;
+
+	if (!ll_sbi_has_nowait_io(sbi))
+		return true;
+
+	if (!iocb_ki_flags_check(flags, DIRECT) || is_sync_kiocb(iocb))
+		return true;
+
+	/* append enqueues a DLM lock, and a security attribute change needs
+	 * the inode lock
+	 */
+	if (iot == CIT_WRITE &&
+	    (iocb_ki_flags_check(flags, APPEND) || !IS_NOSEC(inode)))
+		return true;
+
+	if (test_bit(LL_SBI_LAYOUT_LOCK, sbi->ll_flags) &&
+	    ll_layout_version_get(lli) == CL_LAYOUT_GEN_NONE)
+		return true;
+
+	if (fd->fd_pcc_file.pccf_file)
+		return true;
+
+	/* vvp_io_{read,write}_start() would wait for the truncate */
+	if (atomic_read(&lli->lli_trunc_sem.ll_trunc_readers) < 0 ||
+	    atomic_read(&lli->lli_trunc_sem.ll_trunc_waiters))
+		return true;
+
+	return false;
+}
+
 /*
  * Read from a file (through the page cache).
  */
@@ -2307,6 +2379,9 @@ static ssize_t do_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (!iov_iter_count(to))
 		RETURN(0);
 
+	if (ll_file_nowait_eagain(iocb, CIT_READ))
+		RETURN(-EAGAIN);
+
 	env = cl_env_get(&refcheck);
 	if (IS_ERR(env))
 		RETURN(PTR_ERR(env));
@@ -2484,6 +2559,9 @@ static ssize_t do_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if (!iov_iter_count(from))
 		GOTO(out, rc_normal = 0);
 
+	if (ll_file_nowait_eagain(iocb, CIT_WRITE))
+		GOTO(out, rc_normal = -EAGAIN);
+
 	/**
 	 * When PCC write failed, we usually do not fall back to the normal
 	 * write path, just return the error. But there is a special case when
@@ -4865,6 +4943,14 @@ out_ladvise:
 		rc = ll_heat_set(inode, flags);
 		RETURN(rc);
 	}
+	case LL_IOC_RA_STATS_GET: {
+		struct lu_ra_stats stats;
+
+		ll_ra_stats_get(inode, &stats);
+		if (copy_to_user(uarg, &stats, sizeof(stats)))
+			RETURN(-EFAULT);
+		RETURN(0);
+	}
 	case LL_IOC_PCC_ATTACH: {
 		struct lu_pcc_attach *attach;
 
@@ -6243,6 +6329,9 @@ static const struct file_operations ll_file_operations = {
 	.fsync		= ll_fsync,
 	.flush		= ll_flush,
 	.fallocate	= ll_fallocate,
+#ifdef FOP_DIO_PARALLEL_WRITE
+	.fop_flags	= FOP_DIO_PARALLEL_WRITE,
+#endif
 };
 
 static const struct file_operations ll_file_operations_flock = {
@@ -6273,6 +6362,9 @@ static const struct file_operations ll_file_operations_flock = {
 	.flock		= ll_file_flock,
 	.lock		= ll_file_flock,
 	.fallocate	= ll_fallocate,
+#ifdef FOP_DIO_PARALLEL_WRITE
+	.fop_flags	= FOP_DIO_PARALLEL_WRITE,
+#endif
 };
 
 /* These are for -o noflock - to return ENOSYS on flock calls */
@@ -6304,6 +6396,9 @@ static const struct file_operations ll_file_operations_noflock = {
 	.flock		= ll_file_noflock,
 	.lock		= ll_file_noflock,
 	.fallocate	= ll_fallocate,
+#ifdef FOP_DIO_PARALLEL_WRITE
+	.fop_flags	= FOP_DIO_PARALLEL_WRITE,
+#endif
 };
 
 const struct inode_operations ll_file_inode_operations = {
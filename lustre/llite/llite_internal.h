@@ -265,6 +265,9 @@ struct ll_inode_info {
 			__u32				lli_heat_flags;
 			struct obd_heat_instance	lli_heat_instances[OBD_HEAT_COUNT];
 
+			/* read history for the readahead predictors */
+			struct ll_ra_history	*lli_ra_hist;
+
 			/*
 			 * Whenever a process try to read/write the file, the
 			 * jobid, uid and gid of the process will be saved here,
@@ -739,6 +742,60 @@ struct ll_ra_info {
 	atomic_t ra_async_inflight;
 	/* Threshold to control when to trigger async readahead */
 	unsigned long ra_async_pages_per_file_threshold;
+	/* predictors enabled, bitmask of BIT(enum lu_ra_pattern) */
+	unsigned long ra_predict_mask;
+	/* cycles a pattern must repeat before it is predicted */
+	unsigned int ra_predict_confirm;
+};
+
+#define LL_RA_PREDICT_DEFAULT		(BIT(LU_RA_PATTERN_MULTI_STRIDE) | \
+					 BIT(LU_RA_PATTERN_RECORD))
+#define LL_RA_PREDICT_CONFIRM_DEFAULT	3
+#define LL_RA_PREDICT_CONFIRM_MIN	2
+#define LL_RA_PREDICT_CONFIRM_MAX	6
+
+/* reads remembered per inode, enough to confirm the longest cycle */
+#define LL_RA_HIST_SIZE		32
+/* contiguous runs of reads remembered for the record detector */
+#define LL_RA_RUNS_SIZE		LL_RA_PREDICT_CONFIRM_MAX
+/* byte ranges predicted at once */
+#define LL_RA_PREDICT_RANGES	LU_RA_STRIDES_MAX
+
+struct ll_ra_range {
+	loff_t	lrr_start;
+	loff_t	lrr_end;	/* exclusive */
+};
+
+/*
+ * Read history of an inode, kept across opens and used by the readahead
+ * predictors in ra_predict.c.  Allocated on the first read of the inode.
+ */
+struct ll_ra_history {
+	spinlock_t		lrh_lock;
+	/* last reads, lrh_reads[(lrh_seq - 1) % LL_RA_HIST_SIZE] is newest */
+	struct ll_ra_range	lrh_reads[LL_RA_HIST_SIZE];
+	__u64			lrh_seq;
+	/* current run of contiguous reads and the completed ones before */
+	struct ll_ra_range	lrh_run;
+	struct ll_ra_range	lrh_runs[LL_RA_RUNS_SIZE];
+	unsigned int		lrh_runs_nr;
+	/* last classification */
+	enum lu_ra_pattern	lrh_pattern;
+	unsigned int		lrh_period;
+	loff_t			lrh_strides[LU_RA_STRIDES_MAX];
+	loff_t			lrh_stride_bytes[LU_RA_STRIDES_MAX];
+	loff_t			lrh_record_bytes;
+	loff_t			lrh_record_base;
+	/* last read already covered by a prediction */
+	__u64			lrh_pred_seq;
+	/* predicted ranges not read ahead yet */
+	struct ll_ra_range	lrh_pred[LL_RA_PREDICT_RANGES];
+	unsigned int		lrh_pred_nr;
+	/* statistics, the page counts are updated without lrh_lock */
+	atomic64_t		lrh_hits;
+	atomic64_t		lrh_misses;
+	__u64			lrh_predictions;
+	__u64			lrh_predicted_pages;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -836,6 +893,7 @@ enum ll_sbi_flags {
 	LL_SBI_ENCRYPT_NAME,		/* name encryption */
 	LL_SBI_UNALIGNED_DIO,		/* unaligned DIO */
 	LL_SBI_HYBRID_IO,		/* allow BIO as DIO */
+	LL_SBI_NOWAIT_IO,		/* non-blocking io_uring DIO submit */
 	LL_SBI_NUM_FLAGS
 };
 
@@ -1202,6 +1260,11 @@ static inline bool ll_sbi_has_parallel_dio(struct ll_sb_info *sbi)
 	return test_bit(LL_SBI_PARALLEL_DIO, sbi->ll_flags);
 }
 
+static inline bool ll_sbi_has_nowait_io(struct ll_sb_info *sbi)
+{
+	return test_bit(LL_SBI_NOWAIT_IO, sbi->ll_flags);
+}
+
 static inline bool ll_sbi_has_unaligned_dio(struct ll_sb_info *sbi)
 {
 	return test_bit(LL_SBI_UNALIGNED_DIO, sbi->ll_flags);
@@ -1209,6 +1272,19 @@ static inline bool ll_sbi_has_unaligned_dio(struct ll_sb_info *sbi)
 
 void ll_ras_enter(struct file *f, loff_t pos, size_t bytes);
 
+/* llite/ra_predict.c */
+void ll_ra_predict_enter(struct inode *inode, loff_t pos, size_t bytes);
+void ll_ra_predict_page(struct inode *inode, bool hit);
+bool ll_ra_predict_pending(struct inode *inode);
+int ll_ra_predict_take(struct inode *inode, struct ll_ra_range *ranges,
+		       int max);
+void ll_ra_predict_done(struct inode *inode, int ranges, unsigned long pages);
+void ll_ra_stats_get(struct inode *inode, struct lu_ra_stats *stats);
+void ll_ra_history_free(struct inode *inode);
+int ll_ra_predict_mask_parse(const char *buf, size_t count,
+			     unsigned long *mask);
+int ll_ra_predict_mask_print(unsigned long mask, char *buf, size_t size);
+
 /* llite/lcommon_misc.c */
 int cl_ocd_update(struct obd_device *host, struct obd_device *watched,
 		  enum obd_notify_event ev, void *owner);
@@ -1561,6 +1637,15 @@ static inline unsigned int iocb_ki_flags_get(const struct file *file,
 #endif
 }
 
+static inline bool ll_iocb_nowait(const struct kiocb *iocb)
+{
+#ifdef IOCB_NOWAIT
+	return iocb && (iocb->ki_flags & IOCB_NOWAIT);
+#else
+	return false;
+#endif
+}
+
 static inline unsigned int vvp_io_args_flags(const struct file *file,
 					     const struct vvp_io_args *args)
 {
@@ -173,6 +173,8 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 				sbi->ll_ra_info.ra_max_pages_per_file;
 	sbi->ll_ra_info.ra_range_pages = SBI_DEFAULT_RA_RANGE_PAGES;
 	sbi->ll_ra_info.ra_max_read_ahead_whole_pages = -1;
+	sbi->ll_ra_info.ra_predict_mask = LL_RA_PREDICT_DEFAULT;
+	sbi->ll_ra_info.ra_predict_confirm = LL_RA_PREDICT_CONFIRM_DEFAULT;
 	atomic_set(&sbi->ll_ra_info.ra_async_inflight, 0);
 
 	set_bit(LL_SBI_VERBOSE, sbi->ll_flags);
@@ -206,6 +208,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	set_bit(LL_SBI_FAST_READ, sbi->ll_flags);
 	set_bit(LL_SBI_TINY_WRITE, sbi->ll_flags);
 	set_bit(LL_SBI_PARALLEL_DIO, sbi->ll_flags);
+	set_bit(LL_SBI_NOWAIT_IO, sbi->ll_flags);
 	set_bit(LL_SBI_UNALIGNED_DIO, sbi->ll_flags);
 	set_bit(LL_SBI_STATFS_PROJECT, sbi->ll_flags);
 	ll_sbi_set_encrypt(sbi, true);
@@ -1044,6 +1047,7 @@ static const match_table_t ll_sbi_flags_name = {
 	{LL_SBI_HYBRID_IO,		"hybrid_io"},
 	{LL_SBI_ENCRYPT_NAME,		"name_encrypt"},
 	{LL_SBI_UNALIGNED_DIO,		"unaligned_dio"},
+	{LL_SBI_NOWAIT_IO,		"nowait_io"},
 };
 
 int ll_sbi_flags_seq_show(struct seq_file *m, void *v)
@@ -1296,6 +1300,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 		spin_lock_init(&lli->lli_heat_lock);
 		obd_heat_clear(lli->lli_heat_instances, OBD_HEAT_COUNT);
 		lli->lli_heat_flags = 0;
+		lli->lli_ra_hist = NULL;
 		mutex_init(&lli->lli_pcc_lock);
 		lli->lli_pcc_state = PCC_STATE_FL_NONE;
 		lli->lli_pcc_inode = NULL;
@@ -1929,6 +1934,7 @@ void ll_clear_inode(struct inode *inode)
 		LASSERT(lli->lli_sai == NULL);
 	} else {
 		pcc_inode_free(inode);
+		ll_ra_history_free(inode);
 	}
 
 	md_null_inode(sbi->ll_md_exp, ll_inode2fid(inode));
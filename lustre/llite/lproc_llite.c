@@ -1374,6 +1374,39 @@ static ssize_t parallel_dio_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(parallel_dio);
 
+static ssize_t nowait_io_show(struct kobject *kobj, struct attribute *attr,
+			      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			test_bit(LL_SBI_NOWAIT_IO, sbi->ll_flags));
+}
+
+static ssize_t nowait_io_store(struct kobject *kobj, struct attribute *attr,
+			       const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		set_bit(LL_SBI_NOWAIT_IO, sbi->ll_flags);
+	else
+		clear_bit(LL_SBI_NOWAIT_IO, sbi->ll_flags);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(nowait_io);
+
 static ssize_t hybrid_io_show(struct kobject *kobj, struct attribute *attr,
 			      char *buf)
 {
@@ -1538,6 +1571,73 @@ out:
 }
 LUSTRE_RW_ATTR(read_ahead_range_kb);
 
+static ssize_t read_ahead_predict_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return ll_ra_predict_mask_print(sbi->ll_ra_info.ra_predict_mask, buf,
+					PAGE_SIZE);
+}
+
+static ssize_t read_ahead_predict_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long mask;
+	int rc;
+
+	rc = ll_ra_predict_mask_parse(buffer, count, &mask);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_ra_info.ra_predict_mask = mask;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_predict);
+
+static ssize_t read_ahead_predict_confirm_show(struct kobject *kobj,
+					       struct attribute *attr,
+					       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			sbi->ll_ra_info.ra_predict_confirm);
+}
+
+static ssize_t read_ahead_predict_confirm_store(struct kobject *kobj,
+						struct attribute *attr,
+						const char *buffer,
+						size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < LL_RA_PREDICT_CONFIRM_MIN || val > LL_RA_PREDICT_CONFIRM_MAX)
+		return -ERANGE;
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_ra_info.ra_predict_confirm = val;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_predict_confirm);
+
 static ssize_t fast_read_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -2178,6 +2278,8 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_max_read_ahead_async_active.attr,
 	&lustre_attr_read_ahead_async_file_threshold_mb.attr,
 	&lustre_attr_read_ahead_range_kb.attr,
+	&lustre_attr_read_ahead_predict.attr,
+	&lustre_attr_read_ahead_predict_confirm.attr,
 	&lustre_attr_stats_track_pid.attr,
 	&lustre_attr_stats_track_ppid.attr,
 	&lustre_attr_stats_track_gid.attr,
@@ -2198,6 +2300,7 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_fast_read.attr,
 	&lustre_attr_tiny_write.attr,
 	&lustre_attr_parallel_dio.attr,
+	&lustre_attr_nowait_io.attr,
 	&lustre_attr_unaligned_dio.attr,
 	&lustre_attr_hybrid_io.attr,
 	&lustre_attr_file_heat.attr,
@@ -0,0 +1,556 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/llite/ra_predict.c
+ *
+ * Readahead predictors for read patterns the readahead window in rw.c does
+ * not follow.  Every read of a regular file is recorded in a per-inode
+ * history which outlives the file descriptors, and the history is matched
+ * against a table of patterns in order:
+ *
+ *   multi_stride  reads repeating a cycle of 2..LU_RA_STRIDES_MAX different
+ *                 strides, as HDF5 chunks of a multi-dimensional dataset
+ *   record        reads of fixed size records in a shuffled order, each
+ *                 record possibly read in several pieces
+ *   stride        single stride, read ahead by the ras_stride_* state
+ *   sequential    read ahead by the readahead window
+ *
+ * A pattern is only used once it repeated ra_predict_confirm times.  The
+ * ranges predicted for the next reads are picked up by ll_io_read_page()
+ * and read ahead together with the pages of the current read.
+ */
+
+#define DEBUG_SUBSYSTEM S_LLITE
+
+#include <linux/ctype.h>
+
+#include <obd_support.h>
+
+#include "llite_internal.h"
+
+struct ll_ra_predictor {
+	const char		*lrp_name;
+	enum lu_ra_pattern	 lrp_pattern;
+	/* match the history, return true if the pattern is confirmed */
+	bool (*lrp_detect)(struct ll_ra_history *hist, unsigned int confirm);
+	/* add the ranges of the next reads to lrh_pred, NULL if rw.c does */
+	void (*lrp_predict)(struct ll_ra_history *hist, bool new_run,
+			    unsigned long max_pages);
+};
+
+/* \a back reads before the newest one */
+static inline struct ll_ra_range *ra_hist_read(struct ll_ra_history *hist,
+					       unsigned int back)
+{
+	return &hist->lrh_reads[(hist->lrh_seq - 1 - back) &
+				(LL_RA_HIST_SIZE - 1)];
+}
+
+static inline unsigned int ra_hist_nr(struct ll_ra_history *hist)
+{
+	return min_t(__u64, hist->lrh_seq, LL_RA_HIST_SIZE);
+}
+
+/* offset from the read before to the read \a back reads before the newest */
+static inline loff_t ra_hist_delta(struct ll_ra_history *hist,
+				   unsigned int back)
+{
+	return ra_hist_read(hist, back)->lrr_start -
+	       ra_hist_read(hist, back + 1)->lrr_start;
+}
+
+static inline loff_t ra_hist_bytes(struct ll_ra_history *hist,
+				   unsigned int back)
+{
+	struct ll_ra_range *read = ra_hist_read(hist, back);
+
+	return read->lrr_end - read->lrr_start;
+}
+
+static inline unsigned long ra_range_pages(loff_t start, loff_t end)
+{
+	return ((end - 1) >> PAGE_SHIFT) - (start >> PAGE_SHIFT) + 1;
+}
+
+static bool ra_predict_add(struct ll_ra_history *hist, loff_t start,
+			   loff_t end)
+{
+	struct ll_ra_range *last;
+
+	if (hist->lrh_pred_nr > 0) {
+		last = &hist->lrh_pred[hist->lrh_pred_nr - 1];
+		if (start <= last->lrr_end && end >= last->lrr_start) {
+			last->lrr_start = min(last->lrr_start, start);
+			last->lrr_end = max(last->lrr_end, end);
+			return true;
+		}
+	}
+	if (hist->lrh_pred_nr == LL_RA_PREDICT_RANGES)
+		return false;
+
+	last = &hist->lrh_pred[hist->lrh_pred_nr++];
+	last->lrr_start = start;
+	last->lrr_end = end;
+
+	return true;
+}
+
+static bool ra_multi_stride_detect(struct ll_ra_history *hist,
+				   unsigned int confirm)
+{
+	unsigned int nr = ra_hist_nr(hist);
+	unsigned int period;
+	unsigned int i;
+
+	for (period = 2; period <= LU_RA_STRIDES_MAX; period++) {
+		if (period * confirm + 1 > nr)
+			break;
+
+		for (i = 0; i < period * (confirm - 1); i++) {
+			if (ra_hist_delta(hist, i) !=
+			    ra_hist_delta(hist, i + period) ||
+			    ra_hist_bytes(hist, i) !=
+			    ra_hist_bytes(hist, i + period))
+				break;
+		}
+		if (i < period * (confirm - 1))
+			continue;
+
+		/* a cycle of equal strides is a single stride */
+		for (i = 1; i < period; i++)
+			if (ra_hist_delta(hist, i) != ra_hist_delta(hist, 0))
+				break;
+		if (i == period)
+			return false;
+
+		/* oldest read of the last cycle first */
+		hist->lrh_period = period;
+		for (i = 0; i < period; i++) {
+			hist->lrh_strides[i] =
+				ra_hist_delta(hist, period - 1 - i);
+			hist->lrh_stride_bytes[i] =
+				ra_hist_bytes(hist, period - 1 - i);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/* read ahead one cycle beyond the newest read */
+static void ra_multi_stride_predict(struct ll_ra_history *hist, bool new_run,
+				    unsigned long max_pages)
+{
+	loff_t pos = ra_hist_read(hist, 0)->lrr_start;
+	unsigned long pages = 0;
+	unsigned int m;
+
+	for (m = 1; m <= hist->lrh_period; m++) {
+		loff_t bytes = hist->lrh_stride_bytes[m - 1];
+
+		pos += hist->lrh_strides[m - 1];
+		if (hist->lrh_seq + m <= hist->lrh_pred_seq)
+			continue;
+		if (pos < 0)
+			break;
+
+		pages += ra_range_pages(pos, pos + bytes);
+		if (pages > max_pages)
+			break;
+		if (!ra_predict_add(hist, pos, pos + bytes))
+			break;
+		hist->lrh_pred_seq = hist->lrh_seq + m;
+	}
+}
+
+static bool ra_record_detect(struct ll_ra_history *hist,
+			     unsigned int confirm)
+{
+	struct ll_ra_range *runs = hist->lrh_runs;
+	loff_t bytes = runs[0].lrr_end - runs[0].lrr_start;
+	bool spaced = true;
+	unsigned int i;
+	u64 rem;
+
+	if (hist->lrh_runs_nr < confirm || bytes < PAGE_SIZE)
+		return false;
+
+	/* the current record is still being read */
+	if (hist->lrh_run.lrr_end - hist->lrh_run.lrr_start > bytes)
+		return false;
+
+	for (i = 1; i < confirm; i++) {
+		loff_t diff = runs[i].lrr_start - runs[0].lrr_start;
+
+		if (runs[i].lrr_end - runs[i].lrr_start != bytes)
+			return false;
+
+		/* records are laid out back to back */
+		div64_u64_rem(diff < 0 ? -diff : diff, bytes, &rem);
+		if (rem != 0)
+			return false;
+
+		if (i > 1 && runs[i - 1].lrr_start - runs[i].lrr_start !=
+			     runs[0].lrr_start - runs[1].lrr_start)
+			spaced = false;
+	}
+
+	/* evenly spaced records are a stride */
+	if (confirm > 2 && spaced)
+		return false;
+
+	hist->lrh_record_bytes = bytes;
+	div64_u64_rem(runs[0].lrr_start, bytes, &rem);
+	hist->lrh_record_base = rem;
+
+	return true;
+}
+
+/* read ahead the rest of the record when its first piece is read */
+static void ra_record_predict(struct ll_ra_history *hist, bool new_run,
+			      unsigned long max_pages)
+{
+	struct ll_ra_range *read = ra_hist_read(hist, 0);
+	loff_t start = read->lrr_end;
+	loff_t end;
+	u64 rem;
+
+	if (!new_run || read->lrr_start < hist->lrh_record_base)
+		return;
+
+	div64_u64_rem(read->lrr_start - hist->lrh_record_base,
+		      hist->lrh_record_bytes, &rem);
+	end = read->lrr_start - rem + hist->lrh_record_bytes;
+	if (end <= start)
+		return;
+
+	end = min_t(loff_t, end, start + ((loff_t)max_pages << PAGE_SHIFT));
+	if (ra_predict_add(hist, start, end))
+		hist->lrh_pred_seq = hist->lrh_seq;
+}
+
+static bool ra_stride_detect(struct ll_ra_history *hist, unsigned int confirm)
+{
+	loff_t delta = ra_hist_delta(hist, 0);
+	loff_t bytes = ra_hist_bytes(hist, 0);
+	unsigned int i;
+
+	if (confirm + 1 > ra_hist_nr(hist) || delta == ra_hist_bytes(hist, 1))
+		return false;
+
+	for (i = 1; i < confirm; i++)
+		if (ra_hist_delta(hist, i) != delta ||
+		    ra_hist_bytes(hist, i) != bytes)
+			return false;
+
+	return true;
+}
+
+static bool ra_sequential_detect(struct ll_ra_history *hist,
+				 unsigned int confirm)
+{
+	unsigned int i;
+
+	if (confirm + 1 > ra_hist_nr(hist))
+		return false;
+
+	for (i = 0; i < confirm; i++)
+		if (ra_hist_delta(hist, i) != ra_hist_bytes(hist, i + 1))
+			return false;
+
+	return true;
+}
+
+/* most specific pattern first */
+static const struct ll_ra_predictor ll_ra_predictors[] = {
+	{
+		.lrp_name	= "multi_stride",
+		.lrp_pattern	= LU_RA_PATTERN_MULTI_STRIDE,
+		.lrp_detect	= ra_multi_stride_detect,
+		.lrp_predict	= ra_multi_stride_predict,
+	},
+	{
+		.lrp_name	= "record",
+		.lrp_pattern	= LU_RA_PATTERN_RECORD,
+		.lrp_detect	= ra_record_detect,
+		.lrp_predict	= ra_record_predict,
+	},
+	{
+		.lrp_name	= "stride",
+		.lrp_pattern	= LU_RA_PATTERN_STRIDE,
+		.lrp_detect	= ra_stride_detect,
+	},
+	{
+		.lrp_name	= "sequential",
+		.lrp_pattern	= LU_RA_PATTERN_SEQUENTIAL,
+		.lrp_detect	= ra_sequential_detect,
+	},
+};
+
+static struct ll_ra_history *ll_ra_history_get(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_ra_history *hist = READ_ONCE(lli->lli_ra_hist);
+
+	BUILD_BUG_ON(LL_RA_HIST_SIZE & (LL_RA_HIST_SIZE - 1));
+	BUILD_BUG_ON(LL_RA_HIST_SIZE <
+		     LU_RA_STRIDES_MAX * LL_RA_PREDICT_CONFIRM_MAX + 1);
+
+	if (hist)
+		return hist;
+
+	OBD_ALLOC_PTR(hist);
+	if (!hist)
+		return NULL;
+
+	spin_lock_init(&hist->lrh_lock);
+	if (cmpxchg(&lli->lli_ra_hist, NULL, hist) != NULL) {
+		OBD_FREE_PTR(hist);
+		hist = READ_ONCE(lli->lli_ra_hist);
+	}
+
+	return hist;
+}
+
+/* new run of contiguous reads? */
+static bool ra_history_add(struct ll_ra_history *hist, loff_t pos,
+			   size_t bytes)
+{
+	struct ll_ra_range *read;
+	struct ll_ra_range *run = &hist->lrh_run;
+
+	read = &hist->lrh_reads[hist->lrh_seq & (LL_RA_HIST_SIZE - 1)];
+	read->lrr_start = pos;
+	read->lrr_end = pos + bytes;
+	hist->lrh_seq++;
+
+	if (run->lrr_end > run->lrr_start) {
+		if (pos == run->lrr_end) {
+			run->lrr_end = pos + bytes;
+			return false;
+		}
+
+		memmove(&hist->lrh_runs[1], &hist->lrh_runs[0],
+			sizeof(hist->lrh_runs[0]) * (LL_RA_RUNS_SIZE - 1));
+		hist->lrh_runs[0] = *run;
+		if (hist->lrh_runs_nr < LL_RA_RUNS_SIZE)
+			hist->lrh_runs_nr++;
+	}
+	run->lrr_start = pos;
+	run->lrr_end = pos + bytes;
+
+	return true;
+}
+
+/* record a read of the inode and predict the reads following it */
+void ll_ra_predict_enter(struct inode *inode, loff_t pos, size_t bytes)
+{
+	struct ll_ra_info *ra = &ll_i2sbi(inode)->ll_ra_info;
+	unsigned long mask = READ_ONCE(ra->ra_predict_mask);
+	unsigned int confirm = READ_ONCE(ra->ra_predict_confirm);
+	const struct ll_ra_predictor *lrp = NULL;
+	enum lu_ra_pattern pattern;
+	struct ll_ra_history *hist;
+	bool new_run;
+	int i;
+
+	if (mask == 0 || bytes == 0)
+		return;
+
+	hist = ll_ra_history_get(inode);
+	if (!hist)
+		return;
+
+	spin_lock(&hist->lrh_lock);
+	new_run = ra_history_add(hist, pos, bytes);
+
+	for (i = 0; i < ARRAY_SIZE(ll_ra_predictors); i++) {
+		if (ll_ra_predictors[i].lrp_predict &&
+		    !(mask & BIT(ll_ra_predictors[i].lrp_pattern)))
+			continue;
+		if (ll_ra_predictors[i].lrp_detect(hist, confirm)) {
+			lrp = &ll_ra_predictors[i];
+			break;
+		}
+	}
+
+	if (lrp)
+		pattern = lrp->lrp_pattern;
+	else if (hist->lrh_seq > confirm)
+		pattern = LU_RA_PATTERN_RANDOM;
+	else
+		pattern = LU_RA_PATTERN_NONE;
+
+	if (pattern != hist->lrh_pattern) {
+		hist->lrh_pattern = pattern;
+		hist->lrh_pred_seq = hist->lrh_seq;
+	}
+
+	if (lrp && lrp->lrp_predict)
+		lrp->lrp_predict(hist, new_run, ra->ra_max_pages_per_file);
+
+	CDEBUG(D_READA, DFID": read %lld+%zu #%llu, pattern %u, %u ranges\n",
+	       PFID(ll_inode2fid(inode)), pos, bytes, hist->lrh_seq, pattern,
+	       hist->lrh_pred_nr);
+	spin_unlock(&hist->lrh_lock);
+}
+
+/* account a page read by the application, \a hit if it was read ahead */
+void ll_ra_predict_page(struct inode *inode, bool hit)
+{
+	struct ll_ra_history *hist = READ_ONCE(ll_i2info(inode)->lli_ra_hist);
+
+	if (!hist)
+		return;
+
+	atomic64_inc(hit ? &hist->lrh_hits : &hist->lrh_misses);
+}
+
+bool ll_ra_predict_pending(struct inode *inode)
+{
+	struct ll_ra_history *hist = READ_ONCE(ll_i2info(inode)->lli_ra_hist);
+
+	return hist && READ_ONCE(hist->lrh_pred_nr) > 0;
+}
+
+/* move the predicted ranges to \a ranges, return how many there are */
+int ll_ra_predict_take(struct inode *inode, struct ll_ra_range *ranges,
+		       int max)
+{
+	struct ll_ra_history *hist = READ_ONCE(ll_i2info(inode)->lli_ra_hist);
+	int nr;
+
+	if (!hist || !READ_ONCE(hist->lrh_pred_nr))
+		return 0;
+
+	spin_lock(&hist->lrh_lock);
+	nr = min_t(int, hist->lrh_pred_nr, max);
+	memcpy(ranges, hist->lrh_pred, sizeof(*ranges) * nr);
+	hist->lrh_pred_nr = 0;
+	spin_unlock(&hist->lrh_lock);
+
+	return nr;
+}
+
+void ll_ra_predict_done(struct inode *inode, int ranges, unsigned long pages)
+{
+	struct ll_ra_history *hist = READ_ONCE(ll_i2info(inode)->lli_ra_hist);
+
+	if (!hist)
+		return;
+
+	spin_lock(&hist->lrh_lock);
+	hist->lrh_predictions += ranges;
+	hist->lrh_predicted_pages += pages;
+	spin_unlock(&hist->lrh_lock);
+}
+
+void ll_ra_stats_get(struct inode *inode, struct lu_ra_stats *stats)
+{
+	struct ll_ra_history *hist = READ_ONCE(ll_i2info(inode)->lli_ra_hist);
+	unsigned int i;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!hist)
+		return;
+
+	spin_lock(&hist->lrh_lock);
+	stats->lrs_pattern = hist->lrh_pattern;
+	if (hist->lrh_pattern == LU_RA_PATTERN_MULTI_STRIDE) {
+		stats->lrs_period = hist->lrh_period;
+		for (i = 0; i < hist->lrh_period; i++)
+			stats->lrs_strides[i] = hist->lrh_strides[i];
+	} else if (hist->lrh_pattern == LU_RA_PATTERN_RECORD) {
+		stats->lrs_record_bytes = hist->lrh_record_bytes;
+	}
+	stats->lrs_requests = hist->lrh_seq;
+	stats->lrs_hits = atomic64_read(&hist->lrh_hits);
+	stats->lrs_misses = atomic64_read(&hist->lrh_misses);
+	stats->lrs_predictions = hist->lrh_predictions;
+	stats->lrs_predicted_pages = hist->lrh_predicted_pages;
+	spin_unlock(&hist->lrh_lock);
+}
+
+void ll_ra_history_free(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	if (lli->lli_ra_hist) {
+		OBD_FREE_PTR(lli->lli_ra_hist);
+		lli->lli_ra_hist = NULL;
+	}
+}
+
+static unsigned long ll_ra_predict_all(void)
+{
+	unsigned long mask = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ll_ra_predictors); i++)
+		if (ll_ra_predictors[i].lrp_predict)
+			mask |= BIT(ll_ra_predictors[i].lrp_pattern);
+
+	return mask;
+}
+
+/* "multi_stride record", "all" or "none" */
+int ll_ra_predict_mask_parse(const char *buf, size_t count,
+			     unsigned long *mask)
+{
+	const char *end = buf + count;
+	unsigned long val = 0;
+
+	while (buf < end) {
+		size_t len = 0;
+		int i;
+
+		while (buf < end && (isspace(*buf) || *buf == ','))
+			buf++;
+		while (buf + len < end && !isspace(buf[len]) && buf[len] != ',')
+			len++;
+		if (len == 0)
+			break;
+
+		if (len == 3 && strncmp(buf, "all", len) == 0) {
+			val = ll_ra_predict_all();
+		} else if (len == 4 && strncmp(buf, "none", len) == 0) {
+			val = 0;
+		} else {
+			for (i = 0; i < ARRAY_SIZE(ll_ra_predictors); i++) {
+				const struct ll_ra_predictor *lrp;
+
+				lrp = &ll_ra_predictors[i];
+				if (lrp->lrp_predict &&
+				    strlen(lrp->lrp_name) == len &&
+				    strncmp(buf, lrp->lrp_name, len) == 0)
+					break;
+			}
+			if (i == ARRAY_SIZE(ll_ra_predictors))
+				return -EINVAL;
+			val |= BIT(ll_ra_predictors[i].lrp_pattern);
+		}
+		buf += len;
+	}
+	*mask = val;
+
+	return 0;
+}
+
+int ll_ra_predict_mask_print(unsigned long mask, char *buf, size_t size)
+{
+	int len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ll_ra_predictors); i++) {
+		const struct ll_ra_predictor *lrp = &ll_ra_predictors[i];
+
+		if (lrp->lrp_predict && (mask & BIT(lrp->lrp_pattern)))
+			len += scnprintf(buf + len, size - len, "%s%s",
+					 len ? " " : "", lrp->lrp_name);
+	}
+	len += scnprintf(buf + len, size - len, "%s\n", len ? "" : "none");
+
+	return len;
+}
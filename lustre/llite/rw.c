@@ -898,6 +898,76 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	RETURN(ret);
 }
 
+/*
+ * Read ahead the ranges ll_ra_predict_enter() expects the next reads of
+ * the file to cover, for patterns the readahead window does not follow.
+ */
+static int ll_readahead_predicted(const struct lu_env *env, struct cl_io *io,
+				  struct cl_page_list *queue,
+				  struct ll_readahead_state *ras)
+{
+	struct ll_ra_range ranges[LL_RA_PREDICT_RANGES];
+	struct ra_io_arg *ria = &ll_env_info(env)->lti_ria;
+	struct inode *inode = vvp_object_inode(io->ci_obj);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	unsigned long pages;
+	pgoff_t ra_end_idx;
+	pgoff_t eof_idx;
+	int count = 0;
+	int nr, i;
+	__u64 kms;
+	int rc;
+
+	ENTRY;
+
+	nr = ll_ra_predict_take(inode, ranges, ARRAY_SIZE(ranges));
+	if (nr == 0)
+		RETURN(0);
+
+	if (atomic_read(&sbi->ll_ra_info.ra_cur_pages) >=
+	    sbi->ll_cache->ccc_lru_max) {
+		ll_ra_stats_inc(inode, RA_STAT_MAX_IN_FLIGHT);
+		RETURN(0);
+	}
+
+	rc = ll_readahead_file_kms(env, io, &kms);
+	if (rc != 0 || kms == 0)
+		RETURN(rc);
+	eof_idx = (kms - 1) >> PAGE_SHIFT;
+
+	for (i = 0; i < nr; i++) {
+		memset(ria, 0, sizeof(*ria));
+		ria->ria_start_idx = ranges[i].lrr_start >> PAGE_SHIFT;
+		if (ria->ria_start_idx > eof_idx)
+			continue;
+		ria->ria_end_idx = min_t(pgoff_t, eof_idx,
+					 (ranges[i].lrr_end - 1) >> PAGE_SHIFT);
+		/* stop at the first lock extent if the lock is contended */
+		ria->ria_end_idx_min = ria->ria_start_idx;
+		/* exact range, do not align it on the RPC size */
+		ria->ria_eof = true;
+
+		pages = ria->ria_end_idx - ria->ria_start_idx + 1;
+		ria->ria_reserved = ll_ra_count_get(sbi, ria, pages, 0);
+		if (ria->ria_reserved < pages)
+			ll_ra_stats_inc(inode, RA_STAT_MAX_IN_FLIGHT);
+		if (ria->ria_reserved == 0)
+			break;
+
+		ra_end_idx = 0;
+		count += ll_read_ahead_pages(env, io, queue, ras, ria,
+					     &ra_end_idx, 0);
+		if (ria->ria_reserved != 0)
+			ll_ra_count_put(sbi, ria->ria_reserved);
+	}
+	ll_ra_predict_done(inode, nr, count);
+
+	CDEBUG(D_READA, DFID": %d pages read ahead for %d predicted ranges\n",
+	       PFID(ll_inode2fid(inode)), count, nr);
+
+	RETURN(count);
+}
+
 static int ll_readpages(const struct lu_env *env, struct cl_io *io,
 			struct cl_page_list *queue,
 			pgoff_t start, pgoff_t end)
@@ -1291,6 +1361,8 @@ void ll_ras_enter(struct file *f, loff_t pos, size_t bytes)
 	ras_detect_read_pattern(ras, sbi, pos, bytes, false);
 out_unlock:
 	spin_unlock(&ras->ras_lock);
+
+	ll_ra_predict_enter(inode, pos, bytes);
 }
 
 static bool index_in_stride_window(struct ll_readahead_state *ras,
@@ -1331,6 +1403,8 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 	bool hit = flags & LL_RAS_HIT;
 
 	ENTRY;
+	ll_ra_predict_page(inode, hit);
+
 	spin_lock(&ras->ras_lock);
 
 	RAS_CDEBUG(ras);
@@ -1764,6 +1838,7 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 		       cl_page_index(page), ras->ras_stride_offset,
 		       ras->ras_stride_length, ras->ras_stride_bytes);
 
+		ll_readahead_predicted(env, io, &queue->c2_qin, ras);
 	} else if (cl_page_index(page) == io_start_index &&
 		   io_end_index - io_start_index > 0) {
 		rc2 = ll_readpages(env, io, &queue->c2_qin, io_start_index + 1,
@@ -1894,6 +1969,10 @@ static bool ll_use_fast_io(struct file *file,
 
 	RAS_CDEBUG(ras);
 
+	/* predicted ranges are read ahead from a cl_io */
+	if (ll_ra_predict_pending(file_inode(file)))
+		return false;
+
 	if (stride_io_mode(ras) && stride_bytes) {
 		skip_pages = (ras->ras_stride_length +
 			ras->ras_stride_bytes - 1) / stride_bytes;
@@ -32,6 +32,7 @@
 
 #include <lprocfs_status.h>
 #include <obd_class.h>
+#include <lustre_log.h>
 #include <linux/seq_file.h>
 #include "lod_internal.h"
 #include <uapi/linux/lustre/lustre_param.h>
@@ -1539,6 +1540,48 @@ lod_ost_weights_seq_write(struct file *file, const char __user *buf,
 }
 LDEBUGFS_SEQ_FOPS(lod_ost_weights);
 
+static void lod_update_log_stats_show(struct seq_file *m, u32 index,
+				      struct dt_device *dt)
+{
+	struct llog_ctxt *ctxt;
+	s64 batches = 0;
+	s64 recs = 0;
+
+	ctxt = llog_get_context(dt->dd_lu_dev.ld_obd,
+				LLOG_UPDATELOG_ORIG_CTXT);
+	if (!ctxt)
+		return;
+
+	if (ctxt->loc_handle) {
+		batches = atomic64_read(&ctxt->loc_handle->u.chd.chd_batches);
+		recs = atomic64_read(&ctxt->loc_handle->u.chd.chd_batch_recs);
+	}
+	llog_ctxt_put(ctxt);
+
+	seq_printf(m, "- { mdt_idx: %u, batches: %lld, batch_records: %lld, records_per_batch: %lld }\n",
+		   index, batches, recs,
+		   batches ? div64_s64(recs, batches) : 0);
+}
+
+/* records added to the update logs per header write */
+static int lod_update_log_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct lod_device *lod = m->private;
+	struct lu_tgt_desc *mdt;
+	u32 index;
+
+	if (lodname2mdt_index(lod2obd(lod)->obd_name, &index) == 0)
+		lod_update_log_stats_show(m, index, lod->lod_child);
+
+	lod_getref(&lod->lod_mdt_descs);
+	lod_foreach_mdt(lod, mdt)
+		lod_update_log_stats_show(m, mdt->ltd_index, mdt->ltd_tgt);
+	lod_putref(lod, &lod->lod_mdt_descs);
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(lod_update_log_stats);
+
 static struct ldebugfs_vars ldebugfs_lod_vars[] = {
 	{ .name	=	"qos_mdt_weights",
 	  .fops	=	&lod_mdt_weights_fops,
@@ -1546,6 +1589,9 @@ static struct ldebugfs_vars ldebugfs_lod_vars[] = {
 	{ .name	=	"qos_ost_weights",
 	  .fops	=	&lod_ost_weights_fops,
 	  .proc_mode =	0444 },
+	{ .name	=	"update_log_stats",
+	  .fops	=	&lod_update_log_stats_fops,
+	  .proc_mode =	0444 },
 	{ 0 }
 };
 
@@ -215,7 +215,8 @@ struct lov_layout_dom {
 
 struct lov_layout_entry {
 	__u32				lle_type;
-	unsigned int			lle_valid:1;
+	unsigned int			lle_valid:1,
+					lle_parity:1;	/* EC parity component */
 	unsigned int			lle_preference;
 	struct lu_extent		*lle_extent;
 	struct lov_stripe_md_entry	*lle_lsme;
@@ -591,6 +591,7 @@ lsm_unpackmd_comp_md_v1(struct lov_obd *lov, void *buf, size_t buf_size)
 	lsm->lsm_layout_gen = le32_to_cpu(lcm->lcm_layout_gen);
 	lsm->lsm_entry_count = entry_count;
 	lsm->lsm_mirror_count = le16_to_cpu(lcm->lcm_mirror_count);
+	lsm->lsm_ec_count = lcm->lcm_ec_count;
 	lsm->lsm_flags = le16_to_cpu(lcm->lcm_flags);
 	lsm->lsm_is_rdonly = lsm->lsm_flags & LCM_FL_PCC_RDONLY;
 	lsm->lsm_is_released = true;
@@ -646,6 +647,10 @@ lsm_unpackmd_comp_md_v1(struct lov_obd *lov, void *buf, size_t buf_size)
 		if (lsme->lsme_flags & LCME_FL_NOSYNC)
 			lsme->lsme_timestamp =
 				le64_to_cpu(lcme->lcme_timestamp);
+		if (lsme_is_parity(lsme)) {
+			lsme->lsme_dstripe_count = lcme->lcme_dstripe_count;
+			lsme->lsme_cstripe_count = lcme->lcme_cstripe_count;
+		}
 		lu_extent_le_to_cpu(&lsme->lsme_extent, &lcme->lcme_extent);
 
 		if (i == entry_count - 1) {
@@ -739,10 +744,11 @@ void dump_lsm(unsigned int level, const struct lov_stripe_md *lsm)
 	int i, j;
 
 	CDEBUG_LIMIT(level,
-		     "lsm %p, objid "DOSTID", maxbytes %#llx, magic 0x%08X, refc: %d, entry: %u, mirror: %u, flags: %u,layout_gen %u\n",
+		     "lsm %p, objid "DOSTID", maxbytes %#llx, magic 0x%08X, refc: %d, entry: %u, mirror: %u, ec: %u, flags: %u,layout_gen %u\n",
 	       lsm, POSTID(&lsm->lsm_oi), lsm->lsm_maxbytes, lsm->lsm_magic,
 	       atomic_read(&lsm->lsm_refc), lsm->lsm_entry_count,
-	       lsm->lsm_mirror_count, lsm->lsm_flags, lsm->lsm_layout_gen);
+	       lsm->lsm_mirror_count, lsm->lsm_ec_count, lsm->lsm_flags,
+	       lsm->lsm_layout_gen);
 
 	if (lsm->lsm_magic == LOV_MAGIC_FOREIGN) {
 		struct lov_foreign_md *lfm = (void *)lsm_foreign(lsm);
@@ -773,6 +779,10 @@ void dump_lsm(unsigned int level, const struct lov_stripe_md *lsm)
 				   lse->lsme_flags, lse->lsme_magic,
 				   lse->lsme_layout_gen, lse->lsme_stripe_count,
 				   lse->lsme_stripe_size, lse->lsme_pool_name);
+			if (lsme_is_parity(lse))
+				CDEBUG_LIMIT(level, "   parity: %u+%u\n",
+					     lse->lsme_dstripe_count,
+					     lse->lsme_cstripe_count);
 			if (!lsme_inited(lse) ||
 			    lse->lsme_pattern & LOV_PATTERN_F_RELEASED ||
 			    !lov_supported_comp_magic(lse->lsme_magic) ||
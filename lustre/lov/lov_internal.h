@@ -47,6 +47,9 @@ struct lov_stripe_md_entry {
 	u32			lsme_flags;
 	u32			lsme_pattern;
 	u64			lsme_timestamp;
+	/* EC: data (k) and code (p) stripe counts of a parity component */
+	u8			lsme_dstripe_count;
+	u8			lsme_cstripe_count;
 	union {
 		struct { /* For stripe objects */
 			u32	lsme_stripe_size;
@@ -79,6 +82,11 @@ static inline bool lsme_is_dom(struct lov_stripe_md_entry *lsme)
 	return (lov_pattern(lsme->lsme_pattern) & LOV_PATTERN_MDT);
 }
 
+static inline bool lsme_is_parity(const struct lov_stripe_md_entry *lsme)
+{
+	return lsme->lsme_flags & LCME_FL_PARITY;
+}
+
 static inline void copy_lsm_entry(struct lov_stripe_md_entry *dst,
 				  struct lov_stripe_md_entry *src)
 {
@@ -110,6 +118,7 @@ struct lov_stripe_md {
 	bool		lsm_is_rdonly;
 	u16		lsm_mirror_count;
 	u16		lsm_entry_count;
+	u8		lsm_ec_count;	/* number of parity components */
 	struct lov_stripe_md_entry *lsm_entries[];
 };
 
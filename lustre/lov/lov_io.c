@@ -282,6 +282,9 @@ static int lov_io_mirror_write_intent(struct lov_io *lio,
 	}
 
 	lov_foreach_mirror_layout_entry(obj, lle, primary) {
+		if (lle->lle_parity)
+			continue;
+
 		LASSERT(lle->lle_valid);
 		if (!lu_extent_is_overlapped(ext, lle->lle_extent))
 			continue;
@@ -438,7 +441,7 @@ static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
 			continue;
 
 		lov_foreach_mirror_layout_entry(obj, lle, lre) {
-			if (!lle->lle_valid)
+			if (!lle->lle_valid || lle->lle_parity)
 				continue;
 
 			if (lu_extent_is_overlapped(&ext, lle->lle_extent)) {
@@ -2044,6 +2047,10 @@ int lov_io_layout_at(struct lov_io *lio, __u64 offset)
 
 		LASSERT(!lsme_is_foreign(lle->lle_lsme));
 
+		/* parity shares the extent of its data, never map I/O to it */
+		if (lle->lle_parity)
+			continue;
+
 		if ((offset >= lle->lle_extent->e_start &&
 		     offset < lle->lle_extent->e_end) ||
 		    (offset == OBD_OBJECT_EOF &&
@@ -592,6 +592,73 @@ static struct lov_comp_layout_entry_ops dom_ops = {
 	.lco_getattr = lov_attr_get_dom,
 };
 
+/*
+ * EC: every parity component immediately follows the data component it
+ * protects, in the same mirror and with the same extent.  Check that, and
+ * drop parity whose geometry does not match the data so that it is never
+ * used to rebuild data.
+ */
+static int lov_init_composite_ec(struct lov_device *dev,
+				 struct lov_object *lov,
+				 struct lov_stripe_md *lsm)
+{
+	struct lov_layout_entry *data = NULL;
+	struct lov_layout_entry *lle;
+	unsigned int ec_count = 0;
+
+	lov_foreach_layout_entry(lov, lle) {
+		struct lov_stripe_md_entry *lsme = lle->lle_lsme;
+		struct lov_stripe_md_entry *dlsme;
+
+		if (!lle->lle_parity) {
+			data = lle;
+			continue;
+		}
+
+		ec_count++;
+		if (!data || data->lle_parity ||
+		    mirror_id_of(data->lle_lsme->lsme_id) !=
+		    mirror_id_of(lsme->lsme_id) ||
+		    data->lle_extent->e_start != lle->lle_extent->e_start ||
+		    data->lle_extent->e_end != lle->lle_extent->e_end) {
+			CERROR("%s: parity component %#x does not follow its data component\n",
+			       lov2obd(dev->ld_lov)->obd_name, lsme->lsme_id);
+			dump_lsm(D_ERROR, lsm);
+			return -EINVAL;
+		}
+
+		dlsme = data->lle_lsme;
+		/* at most one parity component per data component */
+		data = lle;
+		if (!lsme_inited(lsme) || !lsme_inited(dlsme))
+			continue;
+
+		if (lsme->lsme_dstripe_count != dlsme->lsme_stripe_count ||
+		    lsme->lsme_cstripe_count != lsme->lsme_stripe_count ||
+		    lsme->lsme_stripe_size != dlsme->lsme_stripe_size ||
+		    lsme->lsme_cstripe_count == 0) {
+			CWARN("%s: "DFID" parity component %#x %u+%u does not match data %u x %u, ignoring it\n",
+			      lov2obd(dev->ld_lov)->obd_name,
+			      PFID(lov_object_fid(lov)), lsme->lsme_id,
+			      lsme->lsme_dstripe_count,
+			      lsme->lsme_cstripe_count,
+			      dlsme->lsme_stripe_count,
+			      dlsme->lsme_stripe_size);
+			lle->lle_valid = 0;
+		}
+	}
+
+	if (ec_count != lsm->lsm_ec_count) {
+		CDEBUG(D_INODE, DFID
+		       " doesn't have the # of parity components it claims, %u/%u\n",
+		       PFID(lu_object_fid(lov2lu(lov))), ec_count,
+		       lsm->lsm_ec_count);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 			      struct lov_object *lov, struct lov_stripe_md *lsm,
 			      const struct cl_object_conf *conf,
@@ -645,6 +712,7 @@ static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 		lle->lle_lsme = lsm->lsm_entries[i];
 		lle->lle_type = lov_entry_type(lle->lle_lsme);
 		lle->lle_preference = 0;
+		lle->lle_parity = lsme_is_parity(lle->lle_lsme);
 		switch (lle->lle_type) {
 		case LOV_PATTERN_RAID0:
 			lle->lle_comp_ops = &raid0_ops;
@@ -708,6 +776,11 @@ static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 		lre = &comp->lo_mirrors[j];
 		if (i > 0) {
 			if (mirror_id == lre->lre_mirror_id) {
+				/* stale parity does not make data stale */
+				if (lle->lle_parity) {
+					lre->lre_end = i;
+					continue;
+				}
 				lre->lre_valid |= lle->lle_valid;
 				lre->lre_stale |= !lle->lle_valid;
 				lre->lre_foreign |=
@@ -746,6 +819,10 @@ static int lov_init_composite(const struct lu_env *env, struct lov_device *dev,
 		GOTO(out, result = -EINVAL);
 	}
 
+	result = lov_init_composite_ec(dev, lov, lsm);
+	if (result < 0)
+		GOTO(out, result);
+
 	lov_foreach_layout_entry(lov, lle) {
 		int index = lov_layout_entry_index(lov, lle);
 
@@ -1092,6 +1169,12 @@ static int lov_attr_get_composite(const struct lu_env *env,
 		       lov_attr->cat_mtime, lov_attr->cat_atime,
 		       lov_attr->cat_ctime, lov_attr->cat_blocks);
 
+		/* EC parity objects take space but do not hold file data */
+		if (entry->lle_parity) {
+			attr->cat_blocks += lov_attr->cat_blocks;
+			continue;
+		}
+
 		/* merge results */
 		if (lov_attr->cat_kms_valid)
 			attr->cat_kms_valid = 1;
@@ -2165,6 +2248,13 @@ static int lov_object_fiemap(const struct lu_env *env, struct cl_object *obj,
 			continue;
 		}
 
+		/* EC parity stripes do not map any file data */
+		if (lsme_is_parity(lsme)) {
+			stripe_last += lsme->lsme_stripe_count;
+			resume = false;
+			continue;
+		}
+
 		if (!lu_extent_is_overlapped(&range, &lsme->lsme_extent)) {
 			stripe_last += lsme->lsme_stripe_count;
 			resume = false;
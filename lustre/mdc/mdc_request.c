@@ -2829,9 +2829,9 @@ static int mdc_import_event(struct obd_device *obd, struct obd_import *imp,
 			 */
 			osc_io_unplug(env, cli, NULL);
 
-			cfs_hash_for_each_nolock(ns->ns_rs_hash,
-						 osc_ldlm_resource_invalidate,
-						 env, 0);
+			ldlm_namespace_res_foreach(ns,
+						   osc_ldlm_resource_invalidate,
+						   env);
 			cl_env_put(env, &refcheck);
 			ldlm_namespace_cleanup(ns, LDLM_FL_LOCAL_ONLY);
 		} else {
@@ -254,6 +254,30 @@ static int mdd_changelog_users_seq_show(struct seq_file *m, void *data)
 }
 LDEBUGFS_SEQ_FOPS_RO(mdd_changelog_users);
 
+/* changelog records appended per header write of the plain llogs */
+static int mdd_changelog_batch_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct mdd_device *mdd = m->private;
+	struct llog_ctxt *ctxt;
+	s64 batches = 0;
+	s64 recs = 0;
+
+	ctxt = llog_get_context(mdd2obd_dev(mdd), LLOG_CHANGELOG_ORIG_CTXT);
+	if (ctxt == NULL)
+		return -ENXIO;
+
+	if (ctxt->loc_handle) {
+		batches = atomic64_read(&ctxt->loc_handle->u.chd.chd_batches);
+		recs = atomic64_read(&ctxt->loc_handle->u.chd.chd_batch_recs);
+	}
+	llog_ctxt_put(ctxt);
+
+	seq_printf(m, "batches: %lld\nbatch_records: %lld\nrecords_per_batch: %lld\n",
+		   batches, recs, batches ? div64_s64(recs, batches) : 0);
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(mdd_changelog_batch_stats);
+
 static int mdd_changelog_size_ctxt(const struct lu_env *env,
 				   struct mdd_device *mdd,
 				   int index, __u64 *val)
@@ -773,6 +797,8 @@ static struct ldebugfs_vars ldebugfs_mdd_obd_vars[] = {
 	  .fops =	&mdd_changelog_current_mask_fops },
 	{ .name =	"changelog_users",
 	  .fops =	&mdd_changelog_users_fops	},
+	{ .name =	"changelog_batch_stats",
+	  .fops =	&mdd_changelog_batch_stats_fops	},
 	{ .name =	"lfsck_namespace",
 	  .fops =	&mdd_lfsck_namespace_fops	},
 	{ .name	=	"lfsck_layout",
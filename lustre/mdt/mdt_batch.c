@@ -150,6 +150,7 @@ int mdt_batch(struct tgt_session_info *tsi)
 	struct tg_reply_data *trd = NULL;
 	struct lustre_msg *repmsg = NULL;
 	bool need_reconstruct;
+	__u32 opc_count[BUT_LAST_OPC] = { 0 };
 	__u32 handled_update_count = 0;
 	__u32 update_buf_count;
 	__u32 packed_replen;
@@ -338,6 +339,7 @@ next:
 
 			replen = lustre_packed_msg_size(repmsg);
 			packed_replen += replen;
+			opc_count[reqmsg->lm_opc]++;
 			handled_update_count++;
 		}
 	}
@@ -348,6 +350,7 @@ next:
 		req_capsule_shrink(&req->rq_pill, &RMF_BUT_REPLY,
 				   packed_replen, RCL_SERVER);
 out:
+	mdt_batch_stats_tally(info->mti_mdt, opc_count, handled_update_count);
 	if (reply != NULL) {
 		if (grown) {
 			reply = req_capsule_server_get(&req->rq_pill,
@@ -493,6 +493,7 @@ static int mdt_statfs(struct tgt_session_info *tsi)
 	struct mdt_body *reqbody = NULL;
 	struct mdt_statfs_cache *msf;
 	ktime_t kstart = ktime_get();
+	u64 tot_dirty, tot_granted, tot_pending;
 	int current_blockbits;
 	int rc;
 	timeout_t at_est;
@@ -558,18 +559,18 @@ static int mdt_statfs(struct tgt_session_info *tsi)
 	 * changed.
 	 */
 	current_blockbits = fls64(osfs->os_bsize) - 1;
+	tgt_grant_totals(tgd, &tot_dirty, &tot_granted, &tot_pending);
 
 	/* Account for cached pages. its still racy and might be under-reporting
 	 * if clients haven't announced their caches with brw recently
 	 */
 	CDEBUG(D_SUPER | D_CACHE, "blocks cached %llu granted %llu pending %llu free %llu avail %llu\n",
-	       tgd->tgd_tot_dirty, tgd->tgd_tot_granted,
-	       tgd->tgd_tot_pending,
+	       tot_dirty, tot_granted, tot_pending,
 	       osfs->os_bfree << current_blockbits,
 	       osfs->os_bavail << current_blockbits);
 
 	osfs->os_bavail -= min_t(u64, osfs->os_bavail,
-				 ((tgd->tgd_tot_dirty + tgd->tgd_tot_pending +
+				 ((tot_dirty + tot_pending +
 				   osfs->os_bsize - 1) >> current_blockbits));
 
 	tgt_grant_sanity_check(mdt->mdt_lu_dev.ld_obd, __func__);
@@ -4604,6 +4605,7 @@ int mdt_intent_lock_replace(struct mdt_thread_info *info,
 	struct ptlrpc_request  *req = mdt_info_req(info);
 	struct ldlm_lock       *lock = *lockp;
 	struct ldlm_lock       *new_lock;
+	int rc;
 
 	/* If possible resent found a lock, @lh is set to its handle */
 	new_lock = ldlm_handle2lock_long(&lh->mlh_reg_lh, 0);
@@ -4687,9 +4689,15 @@ int mdt_intent_lock_replace(struct mdt_thread_info *info,
 
 	unlock_res_and_lock(new_lock);
 
-	cfs_hash_add(new_lock->l_export->exp_lock_hash,
-		     &new_lock->l_remote_handle,
-		     &new_lock->l_exp_hash);
+	rc = ldlm_export_lock_add(new_lock);
+	if (rc) {
+		/* the client never sees new_lock, fail the original one */
+		ldlm_lock_cancel(new_lock);
+		LDLM_LOCK_RELEASE(new_lock);
+		*lockp = lock;
+		lh->mlh_reg_lh.cookie = 0;
+		RETURN(rc);
+	}
 
 	LDLM_LOCK_RELEASE(new_lock);
 	lh->mlh_reg_lh.cookie = 0;
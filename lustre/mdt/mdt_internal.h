@@ -217,6 +217,14 @@ struct rename_stats {
 	struct obd_histogram	rs_hist[RENAME_LAST];
 };
 
+struct batch_stats {
+	ktime_t			bs_init;
+	atomic64_t		bs_rpcs;
+	atomic64_t		bs_subreqs[BUT_LAST_OPC];
+	/* sub requests handled per batch RPC */
+	struct obd_histogram	bs_size_hist;
+};
+
 /* split directory automatically when sub file count exceeds 50k */
 #define DIR_SPLIT_COUNT_DEFAULT	50000
 
@@ -336,6 +344,7 @@ struct mdt_device {
 	struct root_squash_info	   mdt_squash;
 
 	struct rename_stats	   mdt_rename_stats;
+	struct batch_stats	   mdt_batch_stats;
 	struct lu_fid		   mdt_md_root_fid;
 
 	/* connection to quota master */
@@ -1372,6 +1381,8 @@ void mdt_rename_counter_tally(struct mdt_thread_info *info,
 			      struct ptlrpc_request *req,
 			      struct mdt_object *src, struct mdt_object *tgt,
 			      enum mdt_stat_idx msi, s64 count);
+void mdt_batch_stats_tally(struct mdt_device *mdt, const __u32 *opc_count,
+			   __u32 count);
 
 static inline struct obd_device *mdt2obd_dev(const struct mdt_device *mdt)
 {
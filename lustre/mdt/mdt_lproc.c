@@ -205,6 +205,122 @@ void mdt_rename_counter_tally(struct mdt_thread_info *info,
 			      (unsigned int)ma->ma_attr.la_size);
 }
 
+/**
+ * The batch stats output is in YAML format, like
+ * batch_stats:
+ * - snapshot_time: 1234567890.123456789
+ * - start_time:    1234567880.987654321
+ * - elapsed_time:  9.135802468
+ * - batches:       1024
+ * - sub_requests:
+ *     getattr:     30720
+ * - batch_size:
+ *       16: { sample: 128, pct:  12, cum_pct:  12 }
+ *       32: { sample: 896, pct:  87, cum_pct: 100 }
+ **/
+static const char * const mdt_batch_opc_names[BUT_LAST_OPC] = {
+	[BUT_GETATTR]	= "getattr",
+};
+
+static int mdt_batch_stats_seq_show(struct seq_file *seq, void *v)
+{
+	struct mdt_device *mdt = seq->private;
+	struct batch_stats *stats = &mdt->mdt_batch_stats;
+	struct obd_histogram *hist = &stats->bs_size_hist;
+	unsigned long tot, t, cum = 0;
+	int i;
+
+	/* this sampling races with updates */
+	seq_puts(seq, "batch_stats:\n");
+	lprocfs_stats_header(seq, ktime_get_real(), stats->bs_init, 15,
+			     ":", false, "- ");
+	seq_printf(seq, "- %-14s %lld\n", "batches:",
+		   (s64)atomic64_read(&stats->bs_rpcs));
+
+	seq_puts(seq, "- sub_requests:\n");
+	for (i = BUT_FIRST_OPC; i < BUT_LAST_OPC; i++)
+		seq_printf(seq, "%4s%-12s %lld\n", " ", mdt_batch_opc_names[i],
+			   (s64)atomic64_read(&stats->bs_subreqs[i]));
+
+	tot = lprocfs_oh_sum(hist);
+	if (tot > 0)
+		seq_puts(seq, "- batch_size:\n");
+
+	for (i = 0; i < OBD_HIST_MAX && tot > 0; i++) {
+		t = hist->oh_buckets[i];
+		cum += t;
+		if (cum == 0)
+			continue;
+
+		seq_printf(seq, "%6s%u:", " ", 1U << i);
+		seq_printf(seq, " { sample: %3lu, pct: %3u, cum_pct: %3u }\n",
+			   t, pct(t, tot), pct(cum, tot));
+
+		if (cum == tot)
+			break;
+	}
+
+	return 0;
+}
+
+static ssize_t
+mdt_batch_stats_seq_write(struct file *file, const char __user *buf,
+			  size_t len, loff_t *off)
+{
+	struct seq_file *seq = file->private_data;
+	struct mdt_device *mdt = seq->private;
+	struct batch_stats *stats = &mdt->mdt_batch_stats;
+	int i;
+
+	atomic64_set(&stats->bs_rpcs, 0);
+	for (i = 0; i < BUT_LAST_OPC; i++)
+		atomic64_set(&stats->bs_subreqs[i], 0);
+	lprocfs_oh_clear(&stats->bs_size_hist);
+	stats->bs_init = ktime_get_real();
+
+	return len;
+}
+LPROC_SEQ_FOPS(mdt_batch_stats);
+
+static int lproc_mdt_attach_batch_seqstat(struct mdt_device *mdt)
+{
+	struct batch_stats *stats = &mdt->mdt_batch_stats;
+	int i;
+
+	atomic64_set(&stats->bs_rpcs, 0);
+	for (i = 0; i < BUT_LAST_OPC; i++)
+		atomic64_set(&stats->bs_subreqs[i], 0);
+	spin_lock_init(&stats->bs_size_hist.oh_lock);
+	lprocfs_oh_clear(&stats->bs_size_hist);
+	stats->bs_init = ktime_get_real();
+
+	return lprocfs_obd_seq_create(mdt2obd_dev(mdt), "batch_stats", 0644,
+				      &mdt_batch_stats_fops, mdt);
+}
+
+/**
+ * Account one batch RPC.
+ *
+ * \param[in] mdt		MDT device
+ * \param[in] opc_count	sub requests handled per BUT_* opcode
+ * \param[in] count		sub requests handled in total
+ */
+void mdt_batch_stats_tally(struct mdt_device *mdt, const __u32 *opc_count,
+			   __u32 count)
+{
+	struct batch_stats *stats = &mdt->mdt_batch_stats;
+	int i;
+
+	if (count == 0)
+		return;
+
+	atomic64_inc(&stats->bs_rpcs);
+	for (i = BUT_FIRST_OPC; i < BUT_LAST_OPC; i++)
+		if (opc_count[i])
+			atomic64_add(opc_count[i], &stats->bs_subreqs[i]);
+	lprocfs_oh_tally_log2(&stats->bs_size_hist, count);
+}
+
 static ssize_t identity_expire_show(struct kobject *kobj,
 				    struct attribute *attr, char *buf)
 {
@@ -1614,6 +1730,11 @@ int mdt_tunables_init(struct mdt_device *mdt, const char *name)
 		CERROR("%s: MDT can not create rename stats rc = %d\n",
 		       mdt_obd_name(mdt), rc);
 
+	rc = lproc_mdt_attach_batch_seqstat(mdt);
+	if (rc)
+		CERROR("%s: MDT can not create batch stats rc = %d\n",
+		       mdt_obd_name(mdt), rc);
+
 	RETURN(rc);
 }
 
@@ -179,8 +179,8 @@ static int ldlm_enqueue_hpreq_check(struct ptlrpc_request *req)
 	if (dlm_req->lock_count > 0) {
 		struct ldlm_lock *lock;
 
-		lock = cfs_hash_lookup(req->rq_export->exp_lock_hash,
-                                       (void *)&dlm_req->lock_handle[0]);
+		lock = ldlm_export_lock_lookup(req->rq_export,
+					       &dlm_req->lock_handle[0]);
 
 		DEBUG_REQ(D_RPCTRACE, req, "lock %p cookie 0x%llx",
 			lock, dlm_req->lock_handle[0].cookie);
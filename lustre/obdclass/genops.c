@@ -1814,7 +1814,7 @@ void obd_stale_export_put(struct obd_export *exp)
 
 	LASSERT(list_empty(&exp->exp_stale_list));
 	if (exp->exp_lock_hash &&
-	    atomic_read(&exp->exp_lock_hash->hs_count)) {
+	    atomic_read(&exp->exp_lock_hash->ht.nelems)) {
 		CDEBUG(D_DLMTRACE, "Put export %p: total %d\n", exp,
 		       atomic_read(&obd_stale_export_num));
 
@@ -46,6 +46,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/kthread.h>
 #include <llog_swab.h>
+#include <lustre_disk.h>
 #include <lustre_log.h>
 #include <obd_support.h>
 #include <obd_class.h>
@@ -391,6 +392,36 @@ int llog_read_header(const struct lu_env *env, struct llog_handle *handle,
 }
 EXPORT_SYMBOL(llog_read_header);
 
+/* Whether the appends of concurrent transactions to the plain llogs of
+ * a catalog can share one header write, see llog_cat_add_rec(). With
+ * ldiskfs all the open jbd2 handles belong to the running transaction,
+ * so the header written by the last appender of a group commits along
+ * with the records of the others. This does not hold for ZFS, whose
+ * handles may be assigned to different txgs, nor for remote llogs.
+ */
+static bool llog_cat_group_commit(const struct lu_env *env,
+				  struct llog_handle *cathandle)
+{
+	struct llog_ctxt *ctxt = cathandle->lgh_ctxt;
+	struct dt_device_param param;
+	struct dt_device *dt;
+
+	if (cathandle->lgh_obj == NULL ||
+	    dt_object_remote(cathandle->lgh_obj))
+		return false;
+
+	if (ctxt == NULL || ctxt->loc_exp == NULL)
+		return false;
+
+	dt = ctxt->loc_exp->exp_obd->obd_lvfs_ctxt.dt;
+	if (dt == NULL || dt->dd_ops->dt_conf_get == NULL)
+		return false;
+
+	dt_conf_get(env, dt, &param);
+
+	return param.ddp_mount_type == LDD_MT_LDISKFS;
+}
+
 int llog_init_handle(const struct lu_env *env, struct llog_handle *handle,
 		     int flags, struct obd_uuid *uuid)
 {
@@ -448,6 +479,10 @@ int llog_init_handle(const struct lu_env *env, struct llog_handle *handle,
 	if (flags & LLOG_F_IS_CAT) {
 		LASSERT(list_empty(&handle->u.chd.chd_head));
 		INIT_LIST_HEAD(&handle->u.chd.chd_head);
+		atomic_set(&handle->u.chd.chd_appenders, 0);
+		init_waitqueue_head(&handle->u.chd.chd_flush_waitq);
+		handle->u.chd.chd_group_commit =
+			llog_cat_group_commit(env, handle);
 		llh->llh_size = sizeof(struct llog_logid_rec);
 		llh->llh_flags |= LLOG_F_IS_FIXSIZE;
 	} else if (!(flags & LLOG_F_IS_PLAIN)) {
@@ -1210,6 +1245,28 @@ int llog_add(const struct lu_env *env, struct llog_handle *lgh,
 }
 EXPORT_SYMBOL(llog_add);
 
+/* Add \a count records of the same transaction to the catalog \a lgh,
+ * see llog_cat_add_arr_rec()
+ */
+int llog_add_arr(const struct lu_env *env, struct llog_handle *lgh,
+		 int count, struct llog_rec_hdr **recs,
+		 struct llog_cookie *logcookies, struct thandle *th)
+{
+	const struct cred *old_cred;
+	int rc;
+
+	ENTRY;
+
+	if (!(lgh->lgh_hdr->llh_flags & LLOG_F_IS_CAT))
+		RETURN(-EOPNOTSUPP);
+
+	old_cred = llog_raise_resource();
+	rc = llog_cat_add_arr_rec(env, lgh, count, recs, logcookies, th);
+	llog_restore_resource(old_cred);
+	RETURN(rc);
+}
+EXPORT_SYMBOL(llog_add_arr);
+
 int llog_declare_add(const struct lu_env *env, struct llog_handle *lgh,
 		     struct llog_rec_hdr *rec, struct thandle *th)
 {
@@ -551,25 +551,95 @@ out_unlock:
 	RETURN(loghandle);
 }
 
+/* Write the header of a plain llog whose update was deferred by
+ * llog_cat_add_arr_rec() or llog_cat_add_rec()
+ */
+static int llog_cat_flush_hdr(const struct lu_env *env,
+			      struct llog_handle *loghandle, struct thandle *th)
+{
+	int rc;
+
+	if (loghandle->lgh_hdr_defer_idx == 0)
+		return 0;
+
+	mutex_lock(&loghandle->lgh_hdr_mutex);
+	rc = llog_write_rec(env, loghandle, &loghandle->lgh_hdr->llh_hdr, NULL,
+			    LLOG_HEADER_IDX, th);
+	if (rc == 0) {
+		loghandle->lgh_hdr_defer_idx = 0;
+		loghandle->lgh_hdr_gen++;
+	}
+	mutex_unlock(&loghandle->lgh_hdr_mutex);
+
+	return rc;
+}
+
+/* max records of a group sharing one header write, see llog_cat_add_rec() */
+#define LLOG_CAT_GROUP_MAX	32
+
+/* Wait until the header of \a loghandle covering our record is written by
+ * another appender of the group. If there is no appender left, write it
+ * with our own transaction handle.
+ */
+static int llog_cat_wait_hdr(const struct lu_env *env,
+			     struct llog_handle *cathandle,
+			     struct llog_handle *loghandle, __u64 gen,
+			     struct thandle *th)
+{
+	struct cat_handle_data *chd = &cathandle->u.chd;
+	int rc = 0;
+
+	wait_event_idle(chd->chd_flush_waitq,
+			READ_ONCE(loghandle->lgh_hdr_gen) != gen ||
+			atomic_read(&chd->chd_appenders) == 0);
+	if (READ_ONCE(loghandle->lgh_hdr_gen) != gen)
+		return 0;
+
+	down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
+	if (loghandle->lgh_hdr_gen == gen && !loghandle->lgh_destroyed) {
+		rc = llog_cat_flush_hdr(env, loghandle, th);
+		if (rc == 0) {
+			atomic64_inc(&chd->chd_batches);
+			wake_up_all(&chd->chd_flush_waitq);
+		}
+	}
+	up_write(&loghandle->lgh_lock);
+
+	return rc;
+}
+
 /* Add a single record to the recovery log(s) using a catalog
  * Returns as llog_write_record
  *
+ * With chd_group_commit, the record of a transaction appended while
+ * other transactions are appending to the catalog does not update the
+ * header of the plain llog, the next appender writes it for the whole
+ * group instead. An appender whose header write was deferred waits for
+ * it before returning, and does it itself if no appender is left, so
+ * the header is always written by a handle of the running transaction.
+ *
  * Assumes caller has already pushed us into the kernel context.
  */
 int llog_cat_add_rec(const struct lu_env *env, struct llog_handle *cathandle,
 		     struct llog_rec_hdr *rec, struct llog_cookie *reccookie,
 		     struct thandle *th)
 {
-        struct llog_handle *loghandle;
-	int rc, retried = 0;
+	struct cat_handle_data *chd = &cathandle->u.chd;
+	struct llog_handle *loghandle;
+	struct llog_handle *waithandle = NULL;
+	bool group = chd->chd_group_commit && th != NULL;
+	__u64 gen = 0;
+	int rc, rc2, retried = 0;
 	ENTRY;
 
 	LASSERT(rec->lrh_len <= cathandle->lgh_ctxt->loc_chunk_size);
 
+	if (group)
+		atomic_inc(&chd->chd_appenders);
 retry:
 	loghandle = llog_cat_current_log(cathandle, th);
 	if (IS_ERR(loghandle))
-		RETURN(PTR_ERR(loghandle));
+		GOTO(out, rc = PTR_ERR(loghandle));
 
 	/* loghandle is already locked by llog_cat_current_log() for us */
 	if (!llog_exist(loghandle)) {
@@ -581,11 +651,23 @@ retry:
 			if (cathandle->u.chd.chd_current_log == loghandle)
 				cathandle->u.chd.chd_current_log = NULL;
 			up_write(&cathandle->lgh_lock);
-			RETURN(rc);
+			GOTO(out, rc);
 		}
 	}
+
+	CFS_FAIL_TIMEOUT_MS(OBD_FAIL_LLOG_CAT_ADD_DELAY, cfs_fail_val);
+
+	/* leave the header to the next appender of the group */
+	if (group && atomic_read(&chd->chd_appenders) > 1)
+		loghandle->lgh_hdr_defer =
+			loghandle->lgh_hdr_defer_idx == 0 ||
+			loghandle->lgh_last_idx - loghandle->lgh_hdr_defer_idx <
+			LLOG_CAT_GROUP_MAX - 1;
+	gen = loghandle->lgh_hdr_gen;
+
 	/* now let's try to add the record */
 	rc = llog_write_rec(env, loghandle, rec, reccookie, LLOG_NEXT_IDX, th);
+	loghandle->lgh_hdr_defer = false;
 	if (rc < 0) {
 		CDEBUG_LIMIT(rc == -ENOSPC ? D_HA : D_ERROR,
 			     "llog_write_rec %d: lh=%p\n", rc, loghandle);
@@ -597,6 +679,24 @@ retry:
 		 * actual cause here */
 		if (rc == -ENOSPC && llog_is_full(loghandle))
 			rc = -ENOBUFS;
+	} else {
+		atomic64_inc(&chd->chd_batch_recs);
+	}
+
+	/* nobody appends to this llog anymore, write its header now */
+	if (rc < 0 || llog_is_full(loghandle)) {
+		rc2 = llog_cat_flush_hdr(env, loghandle, th);
+		if (rc2 < 0 && rc >= 0)
+			rc = rc2;
+	}
+
+	if (loghandle->lgh_hdr_gen != gen) {
+		atomic64_inc(&chd->chd_batches);
+		if (group)
+			wake_up_all(&chd->chd_flush_waitq);
+	} else if (rc >= 0 && loghandle->lgh_hdr_defer_idx != 0) {
+		llog_handle_get(loghandle);
+		waithandle = loghandle;
 	}
 	up_write(&loghandle->lgh_lock);
 
@@ -607,10 +707,120 @@ retry:
 		       loghandle2name(cathandle), rc);
 	}
 
+out:
+	if (group && atomic_dec_and_test(&chd->chd_appenders))
+		wake_up_all(&chd->chd_flush_waitq);
+
+	if (waithandle) {
+		rc2 = llog_cat_wait_hdr(env, cathandle, waithandle, gen, th);
+		if (rc2 < 0 && rc >= 0)
+			rc = rc2;
+		llog_handle_put(env, waithandle);
+	}
+
 	RETURN(rc);
 }
 EXPORT_SYMBOL(llog_cat_add_rec);
 
+/* Add an array of records of the same transaction to the recovery log(s)
+ * using a catalog. The records of the batch appended to one plain llog
+ * update its header once, instead of once per record, and the plain llog
+ * is locked once for the batch.
+ * The cookies of the records are returned in \a cookies, if not NULL.
+ *
+ * Returns 0 on success, or a negative errno.
+ */
+int llog_cat_add_arr_rec(const struct lu_env *env,
+			 struct llog_handle *cathandle, int count,
+			 struct llog_rec_hdr **recs,
+			 struct llog_cookie *cookies, struct thandle *th)
+{
+	struct llog_handle *loghandle;
+	int rc = 0, rc2, retried = 0, start, i = 0;
+
+	ENTRY;
+
+	while (i < count) {
+		loghandle = llog_cat_current_log(cathandle, th);
+		if (IS_ERR(loghandle))
+			RETURN(PTR_ERR(loghandle));
+
+		/* loghandle is already locked by llog_cat_current_log() */
+		if (!llog_exist(loghandle)) {
+			rc = llog_cat_new_log(env, cathandle, loghandle, th);
+			if (rc < 0) {
+				up_write(&loghandle->lgh_lock);
+				/* nobody should be trying to use this llog */
+				down_write(&cathandle->lgh_lock);
+				if (cathandle->u.chd.chd_current_log ==
+				    loghandle)
+					cathandle->u.chd.chd_current_log = NULL;
+				up_write(&cathandle->lgh_lock);
+				RETURN(rc);
+			}
+		}
+
+		/* the header of a remote llog is still updated per record,
+		 * as a whole header write would not fit in the update RPC
+		 */
+		loghandle->lgh_hdr_defer =
+			!dt_object_remote(loghandle->lgh_obj);
+		for (start = i; i < count; i++) {
+			LASSERT(recs[i]->lrh_len <=
+				cathandle->lgh_ctxt->loc_chunk_size);
+
+			/* the last record writes the header for the batch */
+			if (i == count - 1)
+				loghandle->lgh_hdr_defer = false;
+			rc = llog_write_rec(env, loghandle, recs[i],
+					    cookies ? &cookies[i] : NULL,
+					    LLOG_NEXT_IDX, th);
+			if (rc < 0)
+				break;
+		}
+		loghandle->lgh_hdr_defer = false;
+
+		if (rc < 0) {
+			CDEBUG_LIMIT(rc == -ENOSPC ? D_HA : D_ERROR,
+				     "llog_write_rec %d: lh=%p\n",
+				     rc, loghandle);
+			/* see llog_cat_add_rec() */
+			if (rc == -ENOSPC && llog_is_full(loghandle))
+				rc = -ENOBUFS;
+		}
+		/* the batch stopped before its last record, e.g. the llog
+		 * is full, write the header of the records appended so far
+		 */
+		rc2 = llog_cat_flush_hdr(env, loghandle, th);
+		if (rc2 < 0 && rc >= 0)
+			rc = rc2;
+		up_write(&loghandle->lgh_lock);
+		/* the header also covers the records of llog_cat_add_rec() */
+		if (cathandle->u.chd.chd_group_commit)
+			wake_up_all(&cathandle->u.chd.chd_flush_waitq);
+
+		if (i > start) {
+			atomic64_inc(&cathandle->u.chd.chd_batches);
+			atomic64_add(i - start,
+				     &cathandle->u.chd.chd_batch_recs);
+			retried = 0;
+		}
+
+		if (rc == -ENOBUFS) {
+			/* continue with the next llog */
+			if (retried++ == 0)
+				continue;
+			CERROR("%s: error on 2nd llog: rc = %d\n",
+			       loghandle2name(cathandle), rc);
+		}
+		if (rc < 0)
+			RETURN(rc);
+	}
+
+	RETURN(0);
+}
+EXPORT_SYMBOL(llog_cat_add_arr_rec);
+
 int llog_cat_declare_add_rec(const struct lu_env *env,
 			     struct llog_handle *cathandle,
 			     struct llog_rec_hdr *rec, struct thandle *th)
@@ -654,8 +654,24 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 		if (rc != 0)
 			GOTO(out_unlock, rc);
+		loghandle->lgh_hdr_defer_idx = 0;
+		loghandle->lgh_hdr_gen++;
+	} else if (loghandle->lgh_hdr_defer) {
+		/* the header is written once for the whole batch of records,
+		 * see llog_cat_add_arr_rec() and llog_cat_add_rec()
+		 */
+		if (loghandle->lgh_hdr_defer_idx == 0)
+			loghandle->lgh_hdr_defer_idx = index;
 	} else {
 		__u32	*bitmap = LLOG_HDR_BITMAP(llh);
+		int	first = index;
+
+		/* also write the bits of the records appended since the
+		 * header was written last
+		 */
+		if (loghandle->lgh_hdr_defer_idx > 0 &&
+		    loghandle->lgh_hdr_defer_idx < index)
+			first = loghandle->lgh_hdr_defer_idx;
 
 		/* Note: If this is not initialization (size == 0), then do not
 		 * write the whole header (8k bytes), only update header/tail
@@ -672,10 +688,12 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		if (rc != 0)
 			GOTO(out_unlock, rc);
 
+		first /= sizeof(*bitmap) * 8;
 		lgi->lgi_off = llh->llh_bitmap_offset +
-			      (index / (sizeof(*bitmap) * 8)) * sizeof(*bitmap);
-		lgi->lgi_buf.lb_len = sizeof(*bitmap);
-		lgi->lgi_buf.lb_buf = &bitmap[index/(sizeof(*bitmap)*8)];
+			       first * sizeof(*bitmap);
+		lgi->lgi_buf.lb_len = (index / (sizeof(*bitmap) * 8) -
+				       first + 1) * sizeof(*bitmap);
+		lgi->lgi_buf.lb_buf = &bitmap[first];
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 		if (rc != 0)
 			GOTO(out_unlock, rc);
@@ -687,6 +705,8 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 		if (rc != 0)
 			GOTO(out_unlock, rc);
+		loghandle->lgh_hdr_defer_idx = 0;
+		loghandle->lgh_hdr_gen++;
 	}
 	if (CFS_FAIL_PRECHECK(OBD_FAIL_LLOG_PAUSE_AFTER_PAD) && pad) {
 		/* a window for concurrent llog reader, see LU-12577 */
@@ -69,6 +69,7 @@ struct job_stat {
 	ktime_t			js_time_init;	/* time of initial stat*/
 	ktime_t			js_time_latest;	/* time of most recent stat*/
 	struct lprocfs_stats	*js_stats;	/* per-job statistics */
+	struct obd_hist_pcpu	*js_lat_hist;	/* log2 usecs, per counter */
 	struct obd_job_stats	*js_jobstats;	/* for accessing ojs_lock */
 	struct rcu_head		js_rcu;		/* RCU head for job_reclaim_rcu*/
 };
@@ -111,10 +112,24 @@ static void job_stat_get(struct cfs_hash *hs, struct hlist_node *hnode)
 	kref_get(&job->js_refcount);
 }
 
+static void job_lat_hist_free(struct job_stat *job)
+{
+	int num = job->js_stats->ls_num;
+	int i;
+
+	if (job->js_lat_hist == NULL)
+		return;
+
+	for (i = 0; i < num; i++)
+		lprocfs_oh_release_pcpu(&job->js_lat_hist[i]);
+	OBD_FREE_PTR_ARRAY(job->js_lat_hist, num);
+}
+
 static void job_reclaim_rcu(struct rcu_head *head)
 {
 	struct job_stat *job = container_of(head, typeof(*job), js_rcu);
 
+	job_lat_hist_free(job);
 	lprocfs_stats_free(&job->js_stats);
 	OBD_FREE_PTR(job);
 }
@@ -268,6 +283,7 @@ static void lprocfs_job_cleanup(struct obd_job_stats *stats, bool clear)
 static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 {
 	struct job_stat *job;
+	int i;
 
 	OBD_ALLOC_PTR(job);
 	if (job == NULL)
@@ -281,6 +297,23 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 
 	jobs->ojs_cntr_init_fn(job->js_stats, 0, 0);
 
+	/* Averages hide the stalls users complain about, so keep a log2
+	 * histogram of every latency counter to report its percentiles.
+	 */
+	OBD_ALLOC_PTR_ARRAY(job->js_lat_hist, jobs->ojs_cntr_num);
+	if (job->js_lat_hist == NULL)
+		goto out_free;
+
+	for (i = 0; i < jobs->ojs_cntr_num; i++) {
+		struct lprocfs_counter_header *hdr;
+
+		hdr = &job->js_stats->ls_cnt_header[i];
+		if ((hdr->lc_config & LPROCFS_TYPE_MASK) != LPROCFS_TYPE_USECS)
+			continue;
+		if (lprocfs_oh_alloc_pcpu(&job->js_lat_hist[i]))
+			goto out_free;
+	}
+
 	memcpy(job->js_jobid, jobid, sizeof(job->js_jobid));
 	job->js_time_latest = job->js_stats->ls_init;
 	job->js_jobstats = jobs;
@@ -289,6 +322,12 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 	kref_init(&job->js_refcount);
 
 	return job;
+
+out_free:
+	job_lat_hist_free(job);
+	lprocfs_stats_free(&job->js_stats);
+	OBD_FREE_PTR(job);
+	return NULL;
 }
 
 int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
@@ -345,6 +384,9 @@ found:
 	LASSERT(stats == job->js_jobstats);
 	job->js_time_latest = ktime_get_real();
 	lprocfs_counter_add(job->js_stats, event, amount);
+	if (job->js_lat_hist[event].oh_initialized)
+		lprocfs_oh_tally_log2_pcpu(&job->js_lat_hist[event],
+					   clamp_val(amount, 0, UINT_MAX));
 
 	job_putref(job);
 
@@ -485,6 +527,50 @@ static int inline width(const char *str, int len)
 	return len - min((int)strlen(str), 15);
 }
 
+/* permille of the samples at or below each reported percentile */
+static const struct {
+	const char	*name;
+	unsigned int	 permille;
+} job_lat_pcts[] = {
+	{ "p50",  500 },
+	{ "p99",  990 },
+	{ "p999", 999 },
+};
+
+/**
+ * Print the latency percentiles of one counter of a job.
+ *
+ * A sample of value v is tallied in bucket fls(v - 1), so every sample in
+ * bucket j is at most 2^j and that upper bound is what gets reported: the
+ * percentiles are accurate to within a factor of two, which is all that is
+ * needed to tell a 100us operation from a 10ms stall.
+ */
+static void job_lat_pct_show(struct seq_file *p, struct obd_hist_pcpu *oh)
+{
+	unsigned long buckets[OBD_HIST_MAX];
+	unsigned long total = 0;
+	unsigned long sum = 0;
+	int i, j = 0;
+
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		buckets[i] = lprocfs_oh_counter_pcpu(oh, i);
+		total += buckets[i];
+	}
+
+	for (i = 0; i < ARRAY_SIZE(job_lat_pcts); i++) {
+		u64 rank = 0;
+
+		if (total != 0) {
+			rank = DIV_ROUND_UP_ULL((u64)total *
+						job_lat_pcts[i].permille, 1000);
+			while (j < OBD_HIST_MAX - 1 && sum + buckets[j] < rank)
+				sum += buckets[j++];
+		}
+		seq_printf(p, ", %s: %8lu", job_lat_pcts[i].name,
+			   total ? BIT(j) : 0);
+	}
+}
+
 static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 {
 	struct job_stat *job = v;
@@ -553,6 +639,10 @@ static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 				   ret.lc_count ? ret.lc_sumsquare : 0);
 		}
 
+		/* only the percentiles of the latency histogram */
+		if (job->js_lat_hist[i].oh_initialized)
+			job_lat_pct_show(p, &job->js_lat_hist[i]);
+
 		/* show obd_histogram */
 		hist = s->ls_cnt_header[i].lc_hist;
 		if (hist != NULL) {
@@ -177,3 +177,35 @@ out:
 	RETURN(rc);
 }
 EXPORT_SYMBOL(range_lock);
+
+/**
+ * Lock a region without waiting
+ *
+ * \param tree [in]	range lock tree
+ * \param lock [in]	range lock node containing the region span
+ *
+ * \retval 0		get the range lock
+ * \retval -EAGAIN	the region overlaps an existing range lock
+ *
+ * Used by IOCB_NOWAIT I/O, which must be retried from a context that is
+ * allowed to block rather than wait for an overlapping I/O here.
+ */
+int range_lock_try(struct range_lock_tree *tree, struct range_lock *lock)
+{
+	int rc = 0;
+
+	ENTRY;
+
+	spin_lock(&tree->rlt_lock);
+	if (range_lock_iter_first(&tree->rlt_root, lock->rl_start,
+				  lock->rl_end)) {
+		rc = -EAGAIN;
+	} else {
+		range_lock_insert(lock, &tree->rlt_root);
+		lock->rl_sequence = ++tree->rlt_sequence;
+	}
+	spin_unlock(&tree->rlt_lock);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(range_lock_try);
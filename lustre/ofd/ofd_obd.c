@@ -712,6 +712,7 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	struct obd_device *obd = class_exp2obd(exp);
 	struct ofd_device *ofd = ofd_exp(exp);
 	struct tg_grants_data *tgd = &ofd->ofd_lut.lut_tgd;
+	u64 tot_dirty, tot_granted, tot_pending;
 	int current_blockbits;
 	int rc;
 
@@ -729,6 +730,7 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	 * changed.
 	 */
 	current_blockbits = fls64(osfs->os_bsize) - 1;
+	tgt_grant_totals(tgd, &tot_dirty, &tot_granted, &tot_pending);
 
 	/*
 	 * at least try to account for cached pages.  its still racy and
@@ -737,13 +739,12 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	 */
 	CDEBUG(D_SUPER | D_CACHE,
 	       "blocks cached %llu granted %llu pending %llu free %llu avail %llu\n",
-	       tgd->tgd_tot_dirty, tgd->tgd_tot_granted,
-	       tgd->tgd_tot_pending,
+	       tot_dirty, tot_granted, tot_pending,
 	       osfs->os_bfree << current_blockbits,
 	       osfs->os_bavail << current_blockbits);
 
 	osfs->os_bavail -= min_t(u64, osfs->os_bavail,
-				 ((tgd->tgd_tot_dirty + tgd->tgd_tot_pending +
+				 ((tot_dirty + tot_pending +
 				   osfs->os_bsize - 1) >> current_blockbits));
 
 	/*
@@ -2265,8 +2265,13 @@ static int osd_trans_stop(const struct lu_env *env, struct dt_device *dt,
 	 * IMPORTANT: we have to wait till any IO submited by the thread is
 	 * completed otherwise iobuf may be corrupted by different request
 	 */
-	wait_event(iobuf->dr_wait,
-		       atomic_read(&iobuf->dr_numreqs) == 0);
+	if (atomic_read(&iobuf->dr_numreqs) > 0) {
+		ktime_t start = ktime_get();
+
+		wait_event(iobuf->dr_wait,
+			   atomic_read(&iobuf->dr_numreqs) == 0);
+		iobuf->dr_wait_time = ktime_sub(ktime_get(), start);
+	}
 
 	if (!rc)
 		rc = iobuf->dr_error;
@@ -605,6 +605,8 @@ struct osd_iobuf {
 	sector_t	  *dr_blocks;
 	ktime_t		   dr_start_time;
 	ktime_t		   dr_elapsed;	/* how long io took */
+	ktime_t		   dr_map_time;	/* time spent mapping blocks */
+	ktime_t		   dr_wait_time; /* time spent waiting for io */
 	struct osd_device *dr_dev;
 	/* Already written blocks of the start page */
 	unsigned int	   dr_start_pg_wblks;
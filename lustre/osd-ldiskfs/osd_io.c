@@ -131,7 +131,10 @@ static int __osd_init_iobuf(struct osd_device *d, struct osd_iobuf *iobuf,
 	iobuf->dr_error = 0;
 	iobuf->dr_dev = d;
 	iobuf->dr_frags = 0;
+	iobuf->dr_start_time = ktime_set(0, 0);
 	iobuf->dr_elapsed = ktime_set(0, 0);
+	iobuf->dr_map_time = ktime_set(0, 0);
+	iobuf->dr_wait_time = ktime_set(0, 0);
 	/* must be counted before, so assert */
 	iobuf->dr_rw = rw;
 	iobuf->dr_init_at = line;
@@ -209,6 +212,14 @@ void osd_fini_iobuf(struct osd_device *d, struct osd_iobuf *iobuf)
 				      iobuf->dr_frags);
 		lprocfs_oh_tally_log2_pcpu(&h->bs_hist[BRW_R_IO_TIME+rw],
 					   ktime_to_ms(iobuf->dr_elapsed));
+		if (rw) {
+			lprocfs_oh_tally_log2_pcpu(
+				&h->bs_hist[BRW_COMMIT_MAP_TIME],
+				ktime_to_ms(iobuf->dr_map_time));
+			lprocfs_oh_tally_log2_pcpu(
+				&h->bs_hist[BRW_COMMIT_WAIT_TIME],
+				ktime_to_ms(iobuf->dr_wait_time));
+		}
 	}
 
 	iobuf->dr_error = 0;
@@ -378,6 +389,41 @@ static void osd_mark_page_io_done(struct osd_iobuf *iobuf,
 #define BIO_MAX_VECS	BIO_MAX_PAGES
 #endif
 
+#ifdef HAVE_BVEC_ITER_ALL
+/*
+ * Count the whole pages after \a page_idx which are physically contiguous
+ * with it and whose blocks continue on disk from \a sector, so they can be
+ * added to the bio together with the end of \a page_idx as one multi-page
+ * bio_vec.
+ */
+static int osd_bio_contig_pages(struct osd_iobuf *iobuf, int page_idx,
+				int block_idx_end, sector_t sector,
+				int blocks_per_page, int sector_bits)
+{
+	struct niobuf_local **lnbs = iobuf->dr_lnbs;
+	sector_t *blocks = iobuf->dr_blocks;
+	unsigned long pfn = page_to_pfn(lnbs[page_idx]->lnb_page);
+	int block_idx, i, n;
+
+	for (n = 1; page_idx + n < iobuf->dr_npages; n++) {
+		block_idx = (page_idx + n) * blocks_per_page;
+		if (block_idx + blocks_per_page > block_idx_end)
+			break;
+		if (page_to_pfn(lnbs[page_idx + n]->lnb_page) != pfn + n)
+			break;
+		for (i = 0; i < blocks_per_page; i++) {
+			if (blocks[block_idx + i] == 0 ||
+			    (sector_t)blocks[block_idx + i] << sector_bits !=
+			    sector)
+				return n - 1;
+			sector += 1 << sector_bits;
+		}
+	}
+
+	return n - 1;
+}
+#endif
+
 static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 		      struct osd_iobuf *iobuf, sector_t start_blocks,
 		      sector_t count)
@@ -403,11 +449,18 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 	bool integrity_enabled;
 	struct blk_plug plug;
 	int blocks_left_page;
+	int pages_contig = 0;
+	unsigned int len;
 
 	ENTRY;
 
 	LASSERT(iobuf->dr_npages == npages);
-	iobuf->dr_start_time = ktime_get();
+	/*
+	 * a pipelined write submits several ranges, and the earlier ones may
+	 * have completed already, so time the IO from the first submission
+	 */
+	if (ktime_to_ns(iobuf->dr_start_time) == 0)
+		iobuf->dr_start_time = ktime_get();
 	integrity_enabled = bdev_integrity_enabled(bdev, iobuf->dr_rw);
 
 	if (!count)
@@ -418,8 +471,8 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 
 	page_idx_start = start_blocks / blocks_per_page;
 	for (page_idx = page_idx_start, block_idx = start_blocks;
-	     block_idx < block_idx_end; page_idx++,
-	     block_idx += blocks_left_page) {
+	     block_idx < block_idx_end; page_idx += 1 + pages_contig,
+	     block_idx += blocks_left_page + pages_contig * blocks_per_page) {
 		/* For cases where the filesystems blocksize is not the
 		 * same as PAGE_SIZE (e.g. ARM with PAGE_SIZE=64KB and
 		 * blocksize=4KB), there will be multiple blocks to
@@ -431,6 +484,7 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 		 */
 		page = lnbs[page_idx]->lnb_page;
 		LASSERT(page_idx < iobuf->dr_npages);
+		pages_contig = 0;
 
 		i = block_idx % blocks_per_page;
 		blocks_left_page = blocks_per_page - i;
@@ -462,9 +516,26 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 				 sector_bits))
 				nblocks++;
 
+			len = blocksize * nblocks;
+#ifdef HAVE_BVEC_ITER_ALL
+			/*
+			 * a run reaching the end of the page may go on in the
+			 * next pages, e.g. the contiguous direct IO pages from
+			 * osd_dio_pages_prealloc(). Add them as a single
+			 * bio_vec rather than merging them one page at a time.
+			 * The integrity code expects one page per bio_vec.
+			 */
+			if (!integrity_enabled &&
+			    i + nblocks == blocks_left_page)
+				pages_contig = osd_bio_contig_pages(iobuf,
+					page_idx, block_idx_end,
+					sector + (nblocks << sector_bits),
+					blocks_per_page, sector_bits);
+			len += pages_contig * PAGE_SIZE;
+#endif
+
 			if (bio && can_be_merged(bio, sector) &&
-			    bio_add_page(bio, page, blocksize * nblocks,
-					 page_offset) != 0)
+			    bio_add_page(bio, page, len, page_offset) != 0)
 				continue;       /* added this frag OK */
 
 			rc = osd_submit_bio(osd, iobuf, bio);
@@ -492,8 +563,7 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
 			if (rc)
 				goto out;
 
-			rc = bio_add_page(bio, page,
-					  blocksize * nblocks, page_offset);
+			rc = bio_add_page(bio, page, len, page_offset);
 			LASSERT(rc != 0);
 		}
 	}
@@ -570,6 +640,52 @@ static int osd_map_remote_to_local(loff_t offset, ssize_t len, int *nrpages,
 	RETURN(rc);
 }
 
+/* direct IO pages are allocated by physically contiguous chunks of 1MB */
+#define OSD_DIO_PAGES_ORDER	(PAGE_SHIFT < 20 ? 20 - PAGE_SHIFT : 0)
+
+/*
+ * Allocate the missing per-thread direct IO pages needed for \a npages
+ * more pages. They are allocated by high-order chunks split into single
+ * pages, so that the pages of a bulk IO are mostly contiguous in memory
+ * and osd_do_bio() can add them to bios as multi-page bio_vecs. Entries
+ * which cannot be allocated here are left to osd_get_page().
+ */
+static void osd_dio_pages_prealloc(struct osd_thread_info *oti, int npages,
+				   gfp_t gfp_mask)
+{
+	int cur = oti->oti_dio_pages_used;
+	int end = min_t(int, cur + npages, PTLRPC_MAX_BRW_PAGES);
+	struct page *page;
+	int order, run, i;
+
+	while (cur < end) {
+		if (oti->oti_dio_pages[cur]) {
+			cur++;
+			continue;
+		}
+
+		for (run = 1; cur + run < end && !oti->oti_dio_pages[cur + run];
+		     run++)
+			;
+		order = min_t(int, ilog2(run), OSD_DIO_PAGES_ORDER);
+		for (page = NULL; order > 0; order--) {
+			page = alloc_pages(gfp_mask | __GFP_NORETRY |
+					   __GFP_NOWARN, order);
+			if (page)
+				break;
+		}
+		if (!page)
+			return;
+
+		split_page(page, order);
+		for (i = 0; i < (1 << order); i++, cur++) {
+			oti->oti_dio_pages[cur] = page + i;
+			SetPagePrivate2(page + i);
+			lock_page(page + i);
+		}
+	}
+}
+
 static struct page *osd_get_page(const struct lu_env *env, struct dt_object *dt,
 				 loff_t offset, gfp_t gfp_mask, bool cache)
 {
@@ -792,6 +908,8 @@ bypass_checks:
 	/* this could also try less hard for DT_BUFS_TYPE_READAHEAD pages */
 	gfp_mask = rw & DT_BUFS_TYPE_LOCAL ? (GFP_NOFS | __GFP_HIGHMEM) :
 					     GFP_HIGHUSER;
+	if (!cache)
+		osd_dio_pages_prealloc(oti, npages, gfp_mask);
 	for (i = 0; i < npages; i++, lnb++) {
 		lnb->lnb_page = osd_get_page(env, dt, lnb->lnb_file_offset,
 					     gfp_mask, cache);
@@ -912,6 +1030,12 @@ static void osd_decay_extent_bytes(struct osd_device *osd,
 		 EXTENT_BYTES_DECAY - 1) / EXTENT_BYTES_DECAY;
 }
 
+/*
+ * Mapped blocks of a write are submitted by chunks of at least this size,
+ * so the IO of a large bulk write overlaps the mapping of its remainder.
+ */
+#define OSD_WRITE_PIPELINE_BYTES	(1 << 20)
+
 static int osd_ldiskfs_map_inode_pages(struct inode *inode,
 				       struct osd_iobuf *iobuf,
 				       struct osd_device *osd,
@@ -1021,9 +1145,11 @@ cont_map:
 			 * want to avoid that as much as possible.
 			 */
 			if (oh->oh_declared_ext <= 0) {
-				rc = osd_ldiskfs_map_write(inode,
-					iobuf, osd, start_blocks,
-					count, &disk_size, user_size);
+				/* may have been submitted by the pipeline */
+				if (count)
+					rc = osd_ldiskfs_map_write(inode,
+						iobuf, osd, start_blocks,
+						count, &disk_size, user_size);
 				if (rc)
 					GOTO(cleanup, rc);
 				thandle->th_restart_tran = 1;
@@ -1049,6 +1175,7 @@ cont_map:
 		time = ktime_get();
 		rc = ldiskfs_map_blocks(handle, inode, &map, flags);
 		time = ktime_sub(ktime_get(), time);
+		iobuf->dr_map_time = ktime_add(iobuf->dr_map_time, time);
 
 		if (rc >= 0) {
 			struct brw_stats *h = &osd->od_brw_stats;
@@ -1119,6 +1246,20 @@ cont_map:
 		}
 		if (rc != 0)
 			GOTO(cleanup, rc);
+		/*
+		 * submit the blocks mapped so far, so that their IO is in
+		 * flight while the next extents are being mapped
+		 */
+		if (create && i < pages &&
+		    count >= (OSD_WRITE_PIPELINE_BYTES >> inode->i_blkbits)) {
+			rc = osd_ldiskfs_map_write(inode, iobuf, osd,
+						   start_blocks, count,
+						   &disk_size, user_size);
+			if (rc)
+				GOTO(cleanup, rc);
+			start_blocks += count;
+			count = 0;
+		}
 		/*
 		 * decay extent blocks if we could allocate
 		 * good large extent.
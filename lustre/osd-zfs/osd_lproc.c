@@ -139,6 +139,7 @@ static int osd_stats_init(struct osd_device *osd)
 	/* These fields are not supported for ZFS */
 	osd->od_brw_stats.bs_props[BRW_R_DISCONT_BLOCKS / 2].bsp_name = NULL;
 	osd->od_brw_stats.bs_props[BRW_R_DIO_FRAGS / 2].bsp_name = NULL;
+	osd->od_brw_stats.bs_props[BRW_COMMIT_MAP_TIME / 2].bsp_name = NULL;
 
 	RETURN(result);
 }
@@ -1193,6 +1193,7 @@ void ptlrpc_set_add_req(struct ptlrpc_request_set *set,
 	req->rq_set = set;
 	atomic_inc(&set->set_remaining);
 	req->rq_queued_time = ktime_get_seconds();
+	ptlrpc_rpc_trace(req, RPC_TRACE_QUEUED, 0);
 
 	if (req->rq_reqmsg) {
 		lustre_msg_set_jobid(req->rq_reqmsg, NULL);
@@ -166,6 +166,7 @@ void reply_in_callback(struct lnet_event *ev)
 			  "reply in flags=%x mlen=%u offset=%d replen=%d",
 			  lustre_msg_get_flags(req->rq_reqmsg), ev->mlength,
 			  ev->offset, req->rq_replen);
+		ptlrpc_rpc_trace(req, RPC_TRACE_REPLY_RECEIVED, 0);
 	}
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) != OBD_PING)
@@ -229,8 +230,11 @@ void client_bulk_callback(struct lnet_event *ev)
 
 	/* NB don't unlock till after wakeup; desc can disappear under us
 	 * otherwise */
-	if (desc->bd_refs == 0)
+	if (desc->bd_refs == 0) {
+		ptlrpc_rpc_trace(req, RPC_TRACE_BULK_END,
+				 desc->bd_nob_transferred);
 		ptlrpc_client_wake_req(desc->bd_req);
+	}
 
 	spin_unlock(&desc->bd_lock);
 	EXIT;
@@ -351,6 +355,7 @@ void request_in_callback(struct lnet_event *ev)
 	req->rq_self = ev->target.nid;
 	req->rq_rqbd = rqbd;
 	req->rq_phase = RQ_PHASE_NEW;
+	ptlrpc_rpc_trace(req, RPC_TRACE_ARRIVED, 0);
 	if (ev->type == LNET_EVENT_PUT)
 		CDEBUG(D_INFO, "incoming req@%p x%llu msgsize %u\n",
 		       req, req->rq_xid, ev->mlength);
@@ -493,8 +498,11 @@ void server_bulk_callback(struct lnet_event *ev)
 	if (ev->unlinked) {
 		desc->bd_refs--;
 		/* This is the last callback no matter what... */
-		if (desc->bd_refs == 0)
+		if (desc->bd_refs == 0) {
+			ptlrpc_rpc_trace(desc->bd_req, RPC_TRACE_BULK_END,
+					 desc->bd_nob_transferred);
 			wake_up(&desc->bd_waitq);
+		}
 	}
 
 	spin_unlock(&desc->bd_lock);
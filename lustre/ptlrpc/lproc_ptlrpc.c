@@ -523,6 +523,10 @@ static void nrs_policy_get_info_locked(struct ptlrpc_nrs_policy *policy,
 	 */
 	info->pi_req_queued  = policy->pol_req_queued;
 	info->pi_req_started = policy->pol_req_started;
+	/* requests on the per-CPU queues are served in fallback order */
+	if (info->pi_fallback && policy->pol_nrs->nrs_cpu_queues != NULL)
+		info->pi_req_queued +=
+			atomic_read(&policy->pol_nrs->nrs_cpu_queued);
 }
 
 /**
@@ -196,6 +196,7 @@ int ptlrpc_start_bulk_transfer(struct ptlrpc_bulk_desc *desc)
 	total_md = desc->bd_req->rq_mbits - mbits + 1;
 	desc->bd_refs = total_md;
 	desc->bd_failure = 0;
+	ptlrpc_rpc_trace(desc->bd_req, RPC_TRACE_BULK_START, desc->bd_nob);
 
 	md.user_ptr = &desc->bd_cbid;
 	md.handler = ptlrpc_handler;
@@ -433,6 +434,7 @@ int ptlrpc_register_bulk(struct ptlrpc_request *req)
 	       ptlrpc_is_bulk_op_get(desc->bd_type) ? "get-source" : "put-sink",
 	       desc->bd_iov_count, desc->bd_nob,
 	       desc->bd_last_mbits, req->rq_mbits, desc->bd_portal);
+	ptlrpc_rpc_trace(req, RPC_TRACE_BULK_START, desc->bd_nob);
 
 	RETURN(0);
 }
@@ -646,6 +648,7 @@ int ptlrpc_send_reply(struct ptlrpc_request *req, int flags)
 		goto out;
 
 	req->rq_sent = ktime_get_real_seconds();
+	ptlrpc_rpc_trace(req, RPC_TRACE_REPLY_SENT, 0);
 
 	rc = ptl_send_buf(&rs->rs_md_h, rs->rs_repbuf, rs->rs_repdata_len,
 			  (rs->rs_difficult && !rs->rs_no_ack) ?
@@ -956,6 +959,7 @@ int ptl_send_rpc(struct ptlrpc_request *request, int noreply)
 	 */
 	request->rq_deadline = request->rq_sent + request->rq_timeout +
 		ptlrpc_at_get_net_latency(request);
+	ptlrpc_rpc_trace(request, RPC_TRACE_SENT, 0);
 
 	DEBUG_REQ(D_INFO, request, "send flags=%x",
 		  lustre_msg_get_flags(request->rq_reqmsg));
@@ -894,6 +894,197 @@ static void ptlrpc_nrs_req_add_nolock(struct ptlrpc_request *req)
 				  &policy->pol_nrs->nrs_policy_queued);
 }
 
+/**
+ * Whether request \a req added to NRS head \a nrs can be queued on the
+ * per-CPU queues, i.e. the head has no primary policy to order it.
+ */
+static inline bool nrs_cpu_queue_use(struct ptlrpc_nrs *nrs,
+				     struct ptlrpc_request *req)
+{
+	return nrs->nrs_cpu_queues != NULL &&
+	       req->rq_nrq.nr_res_ptrs[NRS_RES_PRIMARY] == NULL &&
+	       READ_ONCE(nrs->nrs_policy_primary) == NULL;
+}
+
+/**
+ * Queues request \a req on the queue of the current CPU of NRS head \a nrs.
+ */
+static void nrs_cpu_queue_add(struct ptlrpc_nrs *nrs,
+			      struct ptlrpc_request *req)
+{
+	struct ptlrpc_nrs_cpu_queue *ncq;
+	int cpu = raw_smp_processor_id();
+
+	/* counted first: a getter may find none, but never misses one */
+	atomic_inc(&nrs->nrs_cpu_queued);
+
+	ncq = per_cpu_ptr(nrs->nrs_cpu_queues, cpu);
+	spin_lock(&ncq->ncq_lock);
+	req->rq_nrq.nr_cpu = cpu;
+	WRITE_ONCE(req->rq_nrq.nr_cpu_queued, true);
+	list_add_tail(&req->rq_nrq.nr_cpu_link, &ncq->ncq_list);
+	spin_unlock(&ncq->ncq_lock);
+}
+
+/* every that many requests got from its own queue, a CPU steals first */
+#define NRS_CPU_QUEUE_STEAL	16
+
+/**
+ * Gets a request from the queue of the current CPU of NRS head \a nrs, or
+ * steals one from the queue of another CPU if it is empty. The queue of
+ * the current CPU is skipped once in a while, so that the requests queued
+ * by a CPU whose threads are busy are not left waiting.
+ *
+ * \param[in] nrs  the NRS head
+ * \param[in] peek when set, the request is not removed from its queue but a
+ *		   reference is taken on it
+ *
+ * \retval the request, or NULL if all the queues are empty
+ */
+static struct ptlrpc_request *nrs_cpu_queue_get(struct ptlrpc_nrs *nrs,
+						bool peek)
+{
+	struct ptlrpc_nrs_cpu_queue *ncq;
+	struct ptlrpc_request *req;
+	int this = raw_smp_processor_id();
+	int cpu = this;
+
+	if (nrs->nrs_cpu_queues == NULL)
+		return NULL;
+
+	ncq = per_cpu_ptr(nrs->nrs_cpu_queues, this);
+	if (READ_ONCE(ncq->ncq_gets) % NRS_CPU_QUEUE_STEAL == 0 &&
+	    atomic_read(&nrs->nrs_cpu_queued) > 1) {
+		cpu = cpumask_next(this, cpu_possible_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_possible_mask);
+		this = cpu;
+	}
+
+	while (atomic_read(&nrs->nrs_cpu_queued) > 0) {
+		ncq = per_cpu_ptr(nrs->nrs_cpu_queues, cpu);
+		if (!list_empty(&ncq->ncq_list)) {
+			spin_lock(&ncq->ncq_lock);
+			req = list_first_entry_or_null(&ncq->ncq_list,
+						       struct ptlrpc_request,
+						       rq_nrq.nr_cpu_link);
+			if (req != NULL && peek) {
+				atomic_inc(&req->rq_refcount);
+			} else if (req != NULL) {
+				list_del_init(&req->rq_nrq.nr_cpu_link);
+				WRITE_ONCE(req->rq_nrq.nr_cpu_queued, false);
+				atomic_dec(&nrs->nrs_cpu_queued);
+				ncq->ncq_gets++;
+			}
+			spin_unlock(&ncq->ncq_lock);
+			if (req != NULL)
+				return req;
+		}
+
+		cpu = cpumask_next(cpu, cpu_possible_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_possible_mask);
+		if (cpu == this)
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * Removes request \a req from the per-CPU queue it is on, if any.
+ *
+ * \retval true if \a req was removed
+ */
+static bool nrs_cpu_queue_del(struct ptlrpc_nrs *nrs,
+			      struct ptlrpc_request *req)
+{
+	struct ptlrpc_nrs_cpu_queue *ncq;
+	bool queued = false;
+
+	if (nrs->nrs_cpu_queues == NULL ||
+	    !READ_ONCE(req->rq_nrq.nr_cpu_queued))
+		return false;
+
+	ncq = per_cpu_ptr(nrs->nrs_cpu_queues, req->rq_nrq.nr_cpu);
+	spin_lock(&ncq->ncq_lock);
+	if (req->rq_nrq.nr_cpu_queued) {
+		list_del_init(&req->rq_nrq.nr_cpu_link);
+		WRITE_ONCE(req->rq_nrq.nr_cpu_queued, false);
+		atomic_dec(&nrs->nrs_cpu_queued);
+		queued = true;
+	}
+	spin_unlock(&ncq->ncq_lock);
+
+	return queued;
+}
+
+/**
+ * Enqueues the requests of the per-CPU queues of NRS head \a nrs on the
+ * policies, once a primary policy has been started.
+ *
+ * \param[in] nrs the NRS head
+ */
+static void nrs_cpu_queues_enqueue_nolock(struct ptlrpc_nrs *nrs)
+{
+	struct ptlrpc_nrs_cpu_queue *ncq;
+	struct ptlrpc_request *req;
+	struct ptlrpc_request *tmp;
+	LIST_HEAD(list);
+	int cpu;
+	int n;
+
+	for_each_possible_cpu(cpu) {
+		if (atomic_read(&nrs->nrs_cpu_queued) == 0)
+			break;
+
+		n = 0;
+		ncq = per_cpu_ptr(nrs->nrs_cpu_queues, cpu);
+		spin_lock(&ncq->ncq_lock);
+		list_for_each_entry(req, &ncq->ncq_list, rq_nrq.nr_cpu_link) {
+			WRITE_ONCE(req->rq_nrq.nr_cpu_queued, false);
+			n++;
+		}
+		list_splice_init(&ncq->ncq_list, &list);
+		spin_unlock(&ncq->ncq_lock);
+		atomic_sub(n, &nrs->nrs_cpu_queued);
+
+		list_for_each_entry_safe(req, tmp, &list, rq_nrq.nr_cpu_link) {
+			list_del_init(&req->rq_nrq.nr_cpu_link);
+			ptlrpc_nrs_req_add_nolock(req);
+		}
+	}
+}
+
+/**
+ * Enqueues the requests added to NRS head \a nrs by ptlrpc_nrs_req_add() on
+ * the policies, in arrival order. The requests of the per-CPU queues are
+ * only moved to the policies once a primary policy orders them.
+ *
+ * \param[in] nrs the NRS head
+ */
+static void nrs_arrivals_enqueue_nolock(struct ptlrpc_nrs *nrs)
+{
+	struct ptlrpc_request *req;
+	struct ptlrpc_request *tmp;
+	struct llist_node *list;
+
+	assert_spin_locked(&nrs->nrs_svcpt->scp_req_lock);
+
+	if (unlikely(READ_ONCE(nrs->nrs_policy_primary) != NULL) &&
+	    nrs->nrs_cpu_queues != NULL)
+		nrs_cpu_queues_enqueue_nolock(nrs);
+
+	if (llist_empty(&nrs->nrs_arrivals))
+		return;
+
+	list = llist_reverse_order(llist_del_all(&nrs->nrs_arrivals));
+	llist_for_each_entry_safe(req, tmp, list, rq_nrq.nr_arrival) {
+		WRITE_ONCE(req->rq_nrq.nr_arriving, false);
+		ptlrpc_nrs_req_add_nolock(req);
+	}
+}
+
 /**
  * Enqueue a request on the high priority NRS head.
  *
@@ -1004,8 +1195,26 @@ static int nrs_svcpt_setup_locked0(struct ptlrpc_nrs *nrs,
 	spin_lock_init(&nrs->nrs_lock);
 	INIT_LIST_HEAD(&nrs->nrs_policy_list);
 	INIT_LIST_HEAD(&nrs->nrs_policy_queued);
+	init_llist_head(&nrs->nrs_arrivals);
 	nrs->nrs_throttling = 0;
 
+	if (queue == PTLRPC_NRS_QUEUE_REG) {
+		int cpu;
+
+		nrs->nrs_cpu_queues = alloc_percpu(struct ptlrpc_nrs_cpu_queue);
+		if (nrs->nrs_cpu_queues == NULL)
+			RETURN(-ENOMEM);
+
+		for_each_possible_cpu(cpu) {
+			struct ptlrpc_nrs_cpu_queue *ncq;
+
+			ncq = per_cpu_ptr(nrs->nrs_cpu_queues, cpu);
+			spin_lock_init(&ncq->ncq_lock);
+			INIT_LIST_HEAD(&ncq->ncq_list);
+		}
+		atomic_set(&nrs->nrs_cpu_queued, 0);
+	}
+
 	rc = nrs_register_policies_locked(nrs);
 
 	RETURN(rc);
@@ -1090,6 +1299,12 @@ again:
 		LASSERT(rc == 0);
 	}
 
+	if (nrs->nrs_cpu_queues != NULL) {
+		LASSERT(atomic_read(&nrs->nrs_cpu_queued) == 0);
+		free_percpu(nrs->nrs_cpu_queues);
+		nrs->nrs_cpu_queues = NULL;
+	}
+
 	/**
 	 * If the service partition has an HP NRS head, clean that up as well.
 	 */
@@ -1487,8 +1702,13 @@ void ptlrpc_nrs_req_stop_nolock(struct ptlrpc_request *req)
 }
 
 /**
- * Enqueues request \a req on either the regular or high-priority NRS head
- * of service partition \a svcpt.
+ * Adds request \a req to either the regular or high-priority NRS head of
+ * service partition \a svcpt.
+ *
+ * The request is only put on the lockless list of arrivals of the head; it
+ * is enqueued on the policies by the next thread getting a request, which
+ * holds ptlrpc_service_part::scp_req_lock anyway, so that adding requests
+ * does not contend on the lock with the threads handling them.
  *
  * \param[in] svcpt the service partition
  * \param[in] req   the request to be enqueued
@@ -1498,14 +1718,34 @@ void ptlrpc_nrs_req_stop_nolock(struct ptlrpc_request *req)
 void ptlrpc_nrs_req_add(struct ptlrpc_service_part *svcpt,
 			struct ptlrpc_request *req, bool hp)
 {
-	spin_lock(&svcpt->scp_req_lock);
+	struct ptlrpc_nrs *nrs = nrs_svcpt2nrs(svcpt, hp);
 
-	if (hp)
-		ptlrpc_nrs_hpreq_add_nolock(req);
-	else
-		ptlrpc_nrs_req_add_nolock(req);
+	if (hp) {
+		spin_lock(&req->rq_lock);
+		req->rq_hp = 1;
+		spin_unlock(&req->rq_lock);
+		if (lustre_msg_get_opc(req->rq_reqmsg) != OBD_PING)
+			DEBUG_REQ(D_NET, req, "high priority req");
+	}
 
-	spin_unlock(&svcpt->scp_req_lock);
+	if (!hp && nrs_cpu_queue_use(nrs, req)) {
+		nrs_cpu_queue_add(nrs, req);
+		return;
+	}
+
+	WRITE_ONCE(req->rq_nrq.nr_arriving, true);
+	llist_add(&req->rq_nrq.nr_arrival, &nrs->nrs_arrivals);
+
+	/**
+	 * A throttling policy does not hand out requests, so nobody would
+	 * enqueue this one until the throttling ends, but the policy may need
+	 * to see it to reconsider its deadline, e.g. TBF for a new client.
+	 */
+	if (unlikely(nrs->nrs_throttling)) {
+		spin_lock(&svcpt->scp_req_lock);
+		nrs_arrivals_enqueue_nolock(nrs);
+		spin_unlock(&svcpt->scp_req_lock);
+	}
 }
 
 static void nrs_request_removed(struct ptlrpc_nrs_policy *policy)
@@ -1564,6 +1804,8 @@ ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 	struct ptlrpc_nrs_policy  *policy;
 	struct ptlrpc_nrs_request *nrq;
 
+	nrs_arrivals_enqueue_nolock(nrs);
+
 	/**
 	 * Always try to drain requests from all NRS polices even if they are
 	 * inactive, because the user can change policy status at runtime.
@@ -1572,6 +1814,9 @@ ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 				pol_list_queued) {
 		nrq = nrs_request_get(policy, peek, force);
 		if (nrq != NULL) {
+			struct ptlrpc_request *req;
+
+			req = container_of(nrq, struct ptlrpc_request, rq_nrq);
 			if (likely(!peek)) {
 				nrq->nr_started = 1;
 
@@ -1579,13 +1824,52 @@ ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 				policy->pol_nrs->nrs_req_started++;
 
 				nrs_request_removed(policy);
+			} else {
+				atomic_inc(&req->rq_refcount);
 			}
 
-			return container_of(nrq, struct ptlrpc_request, rq_nrq);
+			return req;
 		}
 	}
 
-	return NULL;
+	/* requests not ordered by a policy, see ptlrpc_nrs_req_get_direct() */
+	return nrs_cpu_queue_get(nrs, peek);
+}
+
+/**
+ * Returns whether the regular NRS head of service partition \a svcpt has
+ * requests to be got by ptlrpc_nrs_req_get_direct(). Can be called without
+ * ptlrpc_service_part::scp_req_lock.
+ *
+ * \param[in] svcpt the service partition to enquire.
+ */
+bool ptlrpc_nrs_req_direct_pending(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_nrs *nrs = nrs_svcpt2nrs(svcpt, false);
+
+	return nrs->nrs_cpu_queues != NULL &&
+	       atomic_read(&nrs->nrs_cpu_queued) > 0 &&
+	       READ_ONCE(nrs->nrs_policy_primary) == NULL &&
+	       READ_ONCE(nrs->nrs_req_queued) == 0 &&
+	       llist_empty(&nrs->nrs_arrivals);
+}
+
+/**
+ * Obtains a request for handling from the per-CPU queues of the regular NRS
+ * head of service partition \a svcpt, without
+ * ptlrpc_service_part::scp_req_lock. The queue of the current CPU is tried
+ * first, then the queues of the other CPUs; the request is not started on
+ * any policy.
+ *
+ * \param[in] svcpt the service partition
+ *
+ * \retval the request to be handled
+ * \retval NULL the per-CPU queues are empty
+ */
+struct ptlrpc_request *
+ptlrpc_nrs_req_get_direct(struct ptlrpc_service_part *svcpt)
+{
+	return nrs_cpu_queue_get(nrs_svcpt2nrs(svcpt, false), false);
 }
 
 /**
@@ -1606,9 +1890,9 @@ void ptlrpc_nrs_req_del_nolock(struct ptlrpc_request *req)
 
 /**
  * Returns whether there are any requests currently enqueued on any of the
- * policies of service partition's \a svcpt NRS head specified by \a hp. Should
- * be called while holding ptlrpc_service_part::scp_req_lock to get a reliable
- * result.
+ * policies, or waiting to be enqueued on them, of service partition's \a svcpt
+ * NRS head specified by \a hp. Should be called while holding
+ * ptlrpc_service_part::scp_req_lock to get a reliable result.
  *
  * \param[in] svcpt the service partition to enquire.
  * \param[in] hp    whether the regular or high-priority NRS head is to be
@@ -1621,7 +1905,9 @@ bool ptlrpc_nrs_req_pending_nolock(struct ptlrpc_service_part *svcpt, bool hp)
 {
 	struct ptlrpc_nrs *nrs = nrs_svcpt2nrs(svcpt, hp);
 
-	return nrs->nrs_req_queued > 0;
+	return nrs->nrs_req_queued > 0 || !llist_empty(&nrs->nrs_arrivals) ||
+	       (nrs->nrs_cpu_queues != NULL &&
+		atomic_read(&nrs->nrs_cpu_queued) > 0);
 };
 
 /**
@@ -1662,10 +1948,16 @@ void ptlrpc_nrs_req_hp_move(struct ptlrpc_request *req)
 
 	spin_lock(&svcpt->scp_req_lock);
 
-	if (!ptlrpc_nrs_req_can_move(req))
-		goto out;
+	/* the request may still be on the arrivals of the regular head */
+	nrs_arrivals_enqueue_nolock(nrs_svcpt2nrs(svcpt, false));
+
+	/* or on its per-CPU queues, on no policy */
+	if (!nrs_cpu_queue_del(nrs_svcpt2nrs(svcpt, false), req)) {
+		if (!ptlrpc_nrs_req_can_move(req))
+			goto out;
 
-	ptlrpc_nrs_req_del_nolock(req);
+		ptlrpc_nrs_req_del_nolock(req);
+	}
 
 	memcpy(res2, nrq->nr_res_ptrs, NRS_RES_MAX * sizeof(res2[0]));
 	memcpy(nrq->nr_res_ptrs, res1, NRS_RES_MAX * sizeof(res1[0]));
@@ -1788,6 +2080,10 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_tbf);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_hdrr);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif /* HAVE_SERVER_SUPPORT */
 
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_delay);
@@ -0,0 +1,1063 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ptlrpc/nrs_hdrr.c
+ *
+ * Network Request Scheduler (NRS) HDRR policy
+ *
+ * Weighted, work-conserving sharing of a service between projects, the UIDs
+ * of each project and the jobs of each UID, using Deficit Round Robin at each
+ * level of the hierarchy.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lustre_req_layout.h>
+#include <lprocfs_status.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name HDRR policy
+ *
+ * Hierarchical Deficit Round Robin over project ID, UID and JobID
+ *
+ * Each node of the hierarchy keeps the active (i.e. with queued requests)
+ * child nodes in a round robin list. When a node gets to the head of the
+ * list of its parent, its deficit is increased by the quantum scaled by its
+ * share, and it dispatches requests as long as its deficit covers their cost;
+ * then it moves to the tail of the list. Requests are charged by their bulk
+ * size, or by the class of the operation for RPCs without bulk, so a share is
+ * a fraction of the bandwidth of the service. Idle nodes are not in the
+ * lists, so their share is used by the active ones and the service never
+ * idles while requests are queued.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_HDRR	"hdrr"
+
+static const char * const nrs_hdrr_level_names[] = {
+	[NRS_HDRR_PROJECT]	= "project",
+	[NRS_HDRR_UID]		= "uid",
+	[NRS_HDRR_JOBID]	= "jobid",
+};
+
+static const struct rhashtable_params nrs_hdrr_hash_params = {
+	.key_len	= sizeof(struct nrs_hdrr_key),
+	.key_offset	= offsetof(struct nrs_hdrr_node, hn_key),
+	.head_offset	= offsetof(struct nrs_hdrr_node, hn_rhead),
+};
+
+static bool nrs_hdrr_share_match(const struct nrs_hdrr_share *share,
+				 const struct nrs_hdrr_key *key)
+{
+	if (share->hs_level != key->hk_level)
+		return false;
+
+	switch (key->hk_level) {
+	case NRS_HDRR_PROJECT:
+		return share->hs_id == key->hk_projid;
+	case NRS_HDRR_UID:
+		return share->hs_id == key->hk_uid;
+	default:
+		return strncmp(share->hs_jobid, key->hk_jobid,
+			       LUSTRE_JOBID_SIZE) == 0;
+	}
+}
+
+/**
+ * Share of the node with key \a key.
+ *
+ * \pre spin_is_locked(&head->hh_lock)
+ */
+static unsigned int nrs_hdrr_share_get(struct nrs_hdrr_head *head,
+				       const struct nrs_hdrr_key *key)
+{
+	int i;
+
+	for (i = 0; i < head->hh_nshares; i++)
+		if (nrs_hdrr_share_match(&head->hh_shares[i], key))
+			return head->hh_shares[i].hs_share;
+
+	return NRS_HDRR_SHARE_DEFAULT;
+}
+
+/**
+ * Adds, changes or removes a share; setting the default share removes it,
+ * and hs_level == NRS_HDRR_LEVELS removes all of them.
+ */
+static int nrs_hdrr_share_set(struct nrs_hdrr_head *head,
+			      const struct nrs_hdrr_share *share)
+{
+	struct nrs_hdrr_node *node;
+	int rc = 0;
+	int i;
+
+	spin_lock(&head->hh_lock);
+	if (share->hs_level == NRS_HDRR_LEVELS) {
+		head->hh_nshares = 0;
+		GOTO(update, rc);
+	}
+
+	for (i = 0; i < head->hh_nshares; i++) {
+		struct nrs_hdrr_share *cur = &head->hh_shares[i];
+
+		if (cur->hs_level != share->hs_level ||
+		    cur->hs_id != share->hs_id ||
+		    strncmp(cur->hs_jobid, share->hs_jobid,
+			    LUSTRE_JOBID_SIZE) != 0)
+			continue;
+
+		if (share->hs_share == NRS_HDRR_SHARE_DEFAULT)
+			*cur = head->hh_shares[--head->hh_nshares];
+		else
+			cur->hs_share = share->hs_share;
+		GOTO(update, rc);
+	}
+
+	if (share->hs_share == NRS_HDRR_SHARE_DEFAULT)
+		GOTO(out, rc);
+
+	if (head->hh_nshares == NRS_HDRR_SHARES_MAX)
+		GOTO(out, rc = -ENOSPC);
+
+	head->hh_shares[head->hh_nshares++] = *share;
+update:
+	list_for_each_entry(node, &head->hh_nodes, hn_list)
+		WRITE_ONCE(node->hn_share,
+			   nrs_hdrr_share_get(head, &node->hn_key));
+out:
+	spin_unlock(&head->hh_lock);
+
+	return rc;
+}
+
+static void nrs_hdrr_shares_print(struct nrs_hdrr_head *head,
+				  struct seq_file *m)
+{
+	int i;
+
+	spin_lock(&head->hh_lock);
+	for (i = 0; i < head->hh_nshares; i++) {
+		struct nrs_hdrr_share *share = &head->hh_shares[i];
+
+		if (share->hs_level == NRS_HDRR_JOBID)
+			seq_printf(m, "%s %s %u\n",
+				   nrs_hdrr_level_names[share->hs_level],
+				   share->hs_jobid, share->hs_share);
+		else
+			seq_printf(m, "%s %u %u\n",
+				   nrs_hdrr_level_names[share->hs_level],
+				   share->hs_id, share->hs_share);
+	}
+	spin_unlock(&head->hh_lock);
+}
+
+/**
+ * Called when an HDRR policy instance is started.
+ *
+ * \param[in] policy the policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval 0	   success
+ */
+static int nrs_hdrr_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_hdrr_head *head;
+	int rc;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	rc = rhashtable_init(&head->hh_node_hash, &nrs_hdrr_hash_params);
+	if (rc) {
+		OBD_FREE_PTR(head);
+		RETURN(rc);
+	}
+
+	spin_lock_init(&head->hh_lock);
+	INIT_LIST_HEAD(&head->hh_nodes);
+	INIT_LIST_HEAD(&head->hh_active);
+	head->hh_quantum = NRS_HDRR_QUANTUM_DEFAULT;
+
+	policy->pol_private = head;
+
+	RETURN(0);
+}
+
+/**
+ * Called when an HDRR policy instance is stopped.
+ *
+ * Called when the policy has been instructed to transition to the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state and has no more pending
+ * requests to serve; all nodes have been released by then.
+ *
+ * \param[in] policy the policy
+ */
+static void nrs_hdrr_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_hdrr_head *head = policy->pol_private;
+
+	ENTRY;
+
+	LASSERT(head != NULL);
+	LASSERT(list_empty(&head->hh_active));
+	LASSERT(list_empty(&head->hh_nodes));
+
+	rhashtable_destroy(&head->hh_node_hash);
+	OBD_FREE_PTR(head);
+
+	EXIT;
+}
+
+/**
+ * Performs a policy-specific ctl function on HDRR policy instances; similar
+ * to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_hdrr_ctl(struct ptlrpc_nrs_policy *policy,
+			enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_hdrr_head *head = policy->pol_private;
+	int rc = 0;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch (opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_HDRR_RD_QUANTUM:
+		*(__u32 *)arg = head->hh_quantum;
+		break;
+
+	case NRS_CTL_HDRR_WR_QUANTUM:
+		head->hh_quantum = *(__u32 *)arg;
+		break;
+
+	case NRS_CTL_HDRR_RD_SHARES:
+		nrs_hdrr_shares_print(head, arg);
+		break;
+
+	case NRS_CTL_HDRR_WR_SHARE:
+		rc = nrs_hdrr_share_set(head, arg);
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * Fills the project ID and the UID from the OST body of the request when
+ * they are not available from the ptlrpc body, and the bulk size.
+ */
+static void nrs_hdrr_req_ost_info(struct ptlrpc_request *req, __u32 opc,
+				  struct nrs_hdrr_key *key, __u64 *cost)
+{
+	const struct req_format *old_fmt;
+	struct req_format *fmt;
+	struct ost_body *body;
+
+	switch (opc) {
+	case OST_READ:
+		fmt = &RQF_OST_BRW_READ;
+		break;
+	case OST_WRITE:
+		fmt = &RQF_OST_BRW_WRITE;
+		break;
+	case OST_PUNCH:
+		fmt = &RQF_OST_PUNCH;
+		break;
+	case OST_SETATTR:
+		fmt = &RQF_OST_SETATTR;
+		break;
+	case OST_GETATTR:
+		fmt = &RQF_OST_GETATTR;
+		break;
+	default:
+		return;
+	}
+
+	req_capsule_init(&req->rq_pill, req, RCL_SERVER);
+	old_fmt = req->rq_pill.rc_fmt;
+	if (old_fmt == NULL)
+		req_capsule_set(&req->rq_pill, fmt);
+	else if (old_fmt != fmt)
+		return;
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
+	if (body != NULL) {
+		if (body->oa.o_valid & OBD_MD_FLPROJID)
+			key->hk_projid = body->oa.o_projid;
+		if (key->hk_uid == (__u32)-1 &&
+		    body->oa.o_valid & OBD_MD_FLUID)
+			key->hk_uid = body->oa.o_uid;
+	}
+
+	if (opc == OST_READ || opc == OST_WRITE) {
+		struct niobuf_remote *nb;
+		struct obd_ioobj *ioo;
+		__u64 bytes = 0;
+		int i;
+
+		ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
+		nb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
+		if (ioo != NULL && nb != NULL) {
+			int count = req_capsule_get_size(&req->rq_pill,
+							 &RMF_NIOBUF_REMOTE,
+							 RCL_CLIENT) /
+				    sizeof(*nb);
+
+			count = min_t(int, count, ioo->ioo_bufcnt);
+			for (i = 0; i < count; i++)
+				bytes += nb[i].rnb_len;
+		}
+		*cost = max_t(__u64, bytes, PAGE_SIZE);
+	}
+
+	/* restore it to the original state */
+	if (req->rq_pill.rc_fmt != old_fmt)
+		req->rq_pill.rc_fmt = old_fmt;
+}
+
+/**
+ * Classifies a request: fills the key of its JobID node and its cost.
+ */
+static void nrs_hdrr_req_classify(struct ptlrpc_request *req,
+				  struct nrs_hdrr_key *key, __u64 *cost)
+{
+	__u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	char *jobid;
+
+	memset(key, 0, sizeof(*key));
+	key->hk_level = NRS_HDRR_JOBID;
+	if (lustre_msg_get_uid_gid(req->rq_reqmsg, &key->hk_uid, NULL))
+		key->hk_uid = (__u32)-1;
+
+	jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+	if (jobid != NULL)
+		strscpy(key->hk_jobid, jobid, sizeof(key->hk_jobid));
+
+	switch (opc) {
+	case OST_PUNCH:
+	case OST_SETATTR:
+	case OST_CREATE:
+	case OST_DESTROY:
+	case OST_FALLOCATE:
+	case MDS_REINT:
+	case MDS_CLOSE:
+	case MDS_SWAP_LAYOUTS:
+	case LDLM_ENQUEUE:
+		*cost = NRS_HDRR_COST_MODIFY;
+		break;
+	case MDS_READPAGE:
+		*cost = NRS_HDRR_COST_READDIR;
+		break;
+	default:
+		*cost = NRS_HDRR_COST_META;
+		break;
+	}
+
+	if (opc < OST_LAST_OPC)
+		nrs_hdrr_req_ost_info(req, opc, key, cost);
+}
+
+/**
+ * Finds the node with key \a key, or inserts \a *new for it, and takes a
+ * reference on it.
+ *
+ * \pre spin_is_locked(&head->hh_lock)
+ *
+ * \retval the node
+ * \retval NULL there is no such node and \a *new is NULL
+ * \retval ERR_PTR(-ve) the hash insertion failed
+ */
+static struct nrs_hdrr_node *
+nrs_hdrr_node_get_locked(struct nrs_hdrr_head *head,
+			 const struct nrs_hdrr_key *key,
+			 struct nrs_hdrr_node *parent,
+			 struct nrs_hdrr_node **new)
+{
+	struct nrs_hdrr_node *node;
+	int rc;
+
+	node = rhashtable_lookup_fast(&head->hh_node_hash, key,
+				      nrs_hdrr_hash_params);
+	if (node != NULL)
+		goto out;
+
+	node = *new;
+	if (node == NULL)
+		return NULL;
+
+	node->hn_key = *key;
+	rc = rhashtable_insert_fast(&head->hh_node_hash, &node->hn_rhead,
+				    nrs_hdrr_hash_params);
+	if (rc)
+		return ERR_PTR(rc);
+
+	*new = NULL;
+	node->hn_parent = parent;
+	node->hn_share = nrs_hdrr_share_get(head, key);
+	INIT_LIST_HEAD(&node->hn_active);
+	INIT_LIST_HEAD(&node->hn_queue);
+	list_add_tail(&node->hn_list, &head->hh_nodes);
+	/* the reference of a child on its parent */
+	if (parent != NULL)
+		parent->hn_ref++;
+out:
+	node->hn_ref++;
+
+	return node;
+}
+
+/**
+ * Drops a reference on \a node and frees the nodes of the subtree that are
+ * no longer referenced.
+ *
+ * \pre spin_is_locked(&head->hh_lock)
+ */
+static void nrs_hdrr_node_put_locked(struct nrs_hdrr_head *head,
+				     struct nrs_hdrr_node *node,
+				     struct list_head *zombies)
+{
+	while (node != NULL && --node->hn_ref == 0) {
+		struct nrs_hdrr_node *parent = node->hn_parent;
+
+		LASSERT(node->hn_queued == 0);
+		rhashtable_remove_fast(&head->hh_node_hash, &node->hn_rhead,
+				       nrs_hdrr_hash_params);
+		list_move(&node->hn_list, zombies);
+		node = parent;
+	}
+}
+
+static void nrs_hdrr_zombies_free(struct list_head *zombies)
+{
+	struct nrs_hdrr_node *node;
+	struct nrs_hdrr_node *tmp;
+
+	list_for_each_entry_safe(node, tmp, zombies, hn_list) {
+		list_del(&node->hn_list);
+		OBD_FREE_PTR(node);
+	}
+}
+
+/**
+ * Finds the JobID node of the request, and its UID and project nodes; the
+ * missing ones are inserted from \a new when not NULL.
+ *
+ * \retval 0	   the JobID node is in \a *leaf with a reference for the
+ *		   request
+ * \retval -EAGAIN some nodes are missing, and \a new is NULL
+ * \retval -ve	   error
+ */
+static int nrs_hdrr_nodes_get(struct nrs_hdrr_head *head,
+			      const struct nrs_hdrr_key *leaf_key,
+			      struct nrs_hdrr_node **new,
+			      struct nrs_hdrr_node **leaf)
+{
+	struct nrs_hdrr_node *nodes[NRS_HDRR_LEVELS] = { NULL };
+	struct nrs_hdrr_node *none[NRS_HDRR_LEVELS] = { NULL };
+	struct nrs_hdrr_key key = { 0 };
+	LIST_HEAD(zombies);
+	int rc = 0;
+	int i;
+	int j;
+
+	if (new == NULL)
+		new = none;
+
+	spin_lock(&head->hh_lock);
+	for (i = 0; i < NRS_HDRR_LEVELS; i++) {
+		struct nrs_hdrr_node *parent = i > 0 ? nodes[i - 1] : NULL;
+
+		key.hk_level = i;
+		switch (i) {
+		case NRS_HDRR_PROJECT:
+			key.hk_projid = leaf_key->hk_projid;
+			break;
+		case NRS_HDRR_UID:
+			key.hk_uid = leaf_key->hk_uid;
+			break;
+		case NRS_HDRR_JOBID:
+			memcpy(key.hk_jobid, leaf_key->hk_jobid,
+			       sizeof(key.hk_jobid));
+			break;
+		}
+
+		nodes[i] = nrs_hdrr_node_get_locked(head, &key, parent,
+						    &new[i]);
+		if (IS_ERR_OR_NULL(nodes[i])) {
+			rc = nodes[i] == NULL ? -EAGAIN : PTR_ERR(nodes[i]);
+			break;
+		}
+	}
+
+	/* the child nodes hold the project and UID nodes, the request only
+	 * keeps its reference on the JobID node
+	 */
+	for (j = 0; j < i && j < NRS_HDRR_JOBID; j++)
+		nrs_hdrr_node_put_locked(head, nodes[j], &zombies);
+	if (rc == 0)
+		*leaf = nodes[NRS_HDRR_JOBID];
+	spin_unlock(&head->hh_lock);
+
+	nrs_hdrr_zombies_free(&zombies);
+
+	return rc;
+}
+
+/**
+ * Obtains resources from HDRR policy instances. The top-level resource lives
+ * inside \e nrs_hdrr_head and the second-level resource inside the
+ * \e nrs_hdrr_node of the JobID the request belongs to.
+ *
+ * \param[in]  policy	  the policy for which resources are being taken for
+ *			  request \a nrq
+ * \param[in]  nrq	  the request for which resources are being taken
+ * \param[in]  parent	  parent resource, embedded in nrs_hdrr_head for the
+ *			  HDRR policy
+ * \param[out] resp	  resources references are placed in this array
+ * \param[in]  moving_req signifies limited caller context; used to perform
+ *			  memory allocations in an atomic context in this
+ *			  policy
+ *
+ * \retval 0   we are returning a top-level, parent resource, one that is
+ *	       embedded in an nrs_hdrr_head object
+ * \retval 1   we are returning a bottom-level resource, one that is embedded
+ *	       in an nrs_hdrr_node object
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_hdrr_res_get(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq,
+			    const struct ptlrpc_nrs_resource *parent,
+			    struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	struct nrs_hdrr_node *new[NRS_HDRR_LEVELS] = { NULL };
+	struct nrs_hdrr_head *head;
+	struct nrs_hdrr_node *leaf = NULL;
+	struct ptlrpc_request *req;
+	struct nrs_hdrr_key key;
+	int rc;
+	int i;
+
+	if (parent == NULL) {
+		*resp = &((struct nrs_hdrr_head *)policy->pol_private)->hh_res;
+		return 0;
+	}
+
+	head = container_of(parent, struct nrs_hdrr_head, hh_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+	nrs_hdrr_req_classify(req, &key, &nrq->nr_u.hdrr.hr_cost);
+	INIT_LIST_HEAD(&nrq->nr_u.hdrr.hr_list);
+
+	/* the nodes of active jobs exist already in most cases */
+	rc = nrs_hdrr_nodes_get(head, &key, NULL, &leaf);
+	if (rc != -EAGAIN)
+		goto out;
+
+	for (i = 0; i < NRS_HDRR_LEVELS; i++) {
+		OBD_CPT_ALLOC_GFP(new[i], nrs_pol2cptab(policy),
+				  nrs_pol2cptid(policy), sizeof(*new[i]),
+				  moving_req ? GFP_ATOMIC : GFP_NOFS);
+		if (new[i] == NULL)
+			GOTO(out_free, rc = -ENOMEM);
+	}
+
+	rc = nrs_hdrr_nodes_get(head, &key, new, &leaf);
+out_free:
+	for (i = 0; i < NRS_HDRR_LEVELS; i++)
+		if (new[i] != NULL)
+			OBD_FREE_PTR(new[i]);
+out:
+	if (rc)
+		return rc;
+
+	*resp = &leaf->hn_res;
+
+	return 1;
+}
+
+/**
+ * Called when releasing references to the resource hierachy obtained for a
+ * request for scheduling using the HDRR policy.
+ *
+ * \param[in] policy   the policy the resource belongs to
+ * \param[in] res      the resource to be released
+ */
+static void nrs_hdrr_res_put(struct ptlrpc_nrs_policy *policy,
+			     const struct ptlrpc_nrs_resource *res)
+{
+	struct nrs_hdrr_head *head;
+	struct nrs_hdrr_node *node;
+	LIST_HEAD(zombies);
+
+	/**
+	 * Do nothing for freeing parent, nrs_hdrr_head resources
+	 */
+	if (res->res_parent == NULL)
+		return;
+
+	node = container_of(res, struct nrs_hdrr_node, hn_res);
+	head = container_of(res->res_parent, struct nrs_hdrr_head, hh_res);
+
+	spin_lock(&head->hh_lock);
+	nrs_hdrr_node_put_locked(head, node, &zombies);
+	spin_unlock(&head->hh_lock);
+
+	nrs_hdrr_zombies_free(&zombies);
+}
+
+static inline __s64 nrs_hdrr_quantum(struct nrs_hdrr_head *head,
+				     struct nrs_hdrr_node *node)
+{
+	return div_u64((__u64)head->hh_quantum * READ_ONCE(node->hn_share),
+		       NRS_HDRR_SHARE_DEFAULT) ?: 1;
+}
+
+static inline struct ptlrpc_nrs_request *
+nrs_hdrr_leaf_first(struct nrs_hdrr_node *leaf)
+{
+	return list_first_entry(&leaf->hn_queue, struct ptlrpc_nrs_request,
+				nr_u.hdrr.hr_list);
+}
+
+/**
+ * Picks the JobID node that dispatches the next request among the active
+ * nodes in \a active, granting quanta and moving nodes to the tail of the
+ * list as needed.
+ *
+ * A pick without dispatch leaves the nodes on the path to the picked JobID
+ * at the head of their lists with enough deficit for its first request, so
+ * the next pick returns the same node, as required for peeking.
+ */
+static struct nrs_hdrr_node *nrs_hdrr_pick(struct nrs_hdrr_head *head,
+					   struct list_head *active)
+{
+	struct nrs_hdrr_node *node;
+	struct nrs_hdrr_node *leaf;
+	__u64 cost;
+
+	for (;;) {
+		node = list_first_entry(active, struct nrs_hdrr_node,
+					hn_active);
+		if (node->hn_key.hk_level == NRS_HDRR_JOBID)
+			leaf = node;
+		else
+			leaf = nrs_hdrr_pick(head, &node->hn_queue);
+		cost = nrs_hdrr_leaf_first(leaf)->nr_u.hdrr.hr_cost;
+
+		if (!node->hn_granted) {
+			node->hn_deficit += nrs_hdrr_quantum(head, node);
+			node->hn_granted = 1;
+		}
+		/* a single active node gets all the bandwidth */
+		if (node->hn_deficit < cost && list_is_singular(active))
+			node->hn_deficit = cost;
+		if (node->hn_deficit >= cost)
+			return leaf;
+
+		node->hn_granted = 0;
+		list_move_tail(&node->hn_active, active);
+	}
+}
+
+/**
+ * Called when getting a request from the HDRR policy for handling, so that
+ * it can be served.
+ *
+ * \param[in] policy the policy being polled
+ * \param[in] peek   when set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval the request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_hdrr_req_get(struct ptlrpc_nrs_policy *policy,
+					    bool peek, bool force)
+{
+	struct nrs_hdrr_head *head = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq;
+	struct nrs_hdrr_node *node;
+	struct nrs_hdrr_node *leaf;
+	__u64 cost;
+
+	if (list_empty(&head->hh_active))
+		return NULL;
+
+	leaf = nrs_hdrr_pick(head, &head->hh_active);
+	nrq = nrs_hdrr_leaf_first(leaf);
+	if (peek)
+		return nrq;
+
+	cost = nrq->nr_u.hdrr.hr_cost;
+	list_del_init(&nrq->nr_u.hdrr.hr_list);
+	for (node = leaf; node != NULL; node = node->hn_parent) {
+		node->hn_deficit -= cost;
+		if (--node->hn_queued == 0) {
+			list_del_init(&node->hn_active);
+			node->hn_deficit = 0;
+			node->hn_granted = 0;
+		}
+	}
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: starting to handle %s request from %s, project %u uid %u jobid %s cost %llu\n",
+	       NRS_POL_NAME_HDRR,
+	       libcfs_idstr(&container_of(nrq, struct ptlrpc_request,
+					  rq_nrq)->rq_peer),
+	       leaf->hn_parent->hn_parent->hn_key.hk_projid,
+	       leaf->hn_parent->hn_key.hk_uid, leaf->hn_key.hk_jobid, cost);
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to an HDRR \a policy instance's set of queued requests
+ *
+ * The request is queued on its JobID node; the nodes that had no queued
+ * requests so far join the tail of the round robin list of their parent,
+ * with no deficit.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to add
+ *
+ * \retval 0 request successfully added
+ */
+static int nrs_hdrr_req_add(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_hdrr_head *head = policy->pol_private;
+	struct nrs_hdrr_node *node;
+
+	node = container_of(nrs_request_resource(nrq), struct nrs_hdrr_node,
+			    hn_res);
+	list_add_tail(&nrq->nr_u.hdrr.hr_list, &node->hn_queue);
+
+	for (; node != NULL; node = node->hn_parent) {
+		if (node->hn_queued++ > 0)
+			continue;
+
+		node->hn_deficit = 0;
+		node->hn_granted = 0;
+		list_add_tail(&node->hn_active,
+			      node->hn_parent != NULL ?
+			      &node->hn_parent->hn_queue : &head->hh_active);
+	}
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from an HDRR \a policy instance's set of queued
+ * requests, without charging its cost.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to remove
+ */
+static void nrs_hdrr_req_del(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_hdrr_node *node;
+
+	node = container_of(nrs_request_resource(nrq), struct nrs_hdrr_node,
+			    hn_res);
+	list_del_init(&nrq->nr_u.hdrr.hr_list);
+
+	for (; node != NULL; node = node->hn_parent) {
+		if (--node->hn_queued > 0)
+			continue;
+
+		list_del_init(&node->hn_active);
+		node->hn_deficit = 0;
+		node->hn_granted = 0;
+	}
+}
+
+/**
+ * Called right after the request \a nrq finishes being handled by HDRR
+ * policy instance \a policy.
+ *
+ * \param[in] policy the policy that handled the request
+ * \param[in] nrq    the request that was handled
+ */
+static void nrs_hdrr_req_stop(struct ptlrpc_nrs_policy *policy,
+			      struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: finished handling %s request from %s, cost %llu\n",
+	       NRS_POL_NAME_HDRR, libcfs_idstr(&req->rq_peer),
+	       nrq->nr_u.hdrr.hr_cost);
+}
+
+/**
+ * debugfs interface
+ */
+
+/**
+ * Retrieves the quantum of HDRR policy instances, in bytes; the quantum is
+ * the deficit granted in each round to a node with the default share.
+ *
+ * For example:
+ *
+ *	1048576
+ */
+static int
+ptlrpc_lprocfs_nrs_hdrr_quantum_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	__u32 quantum;
+	int rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_HDRR,
+				       NRS_CTL_HDRR_RD_QUANTUM, true,
+				       &quantum);
+	/**
+	 * The regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc == -ENODEV && nrs_svc_has_hp(svc))
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+					       NRS_POL_NAME_HDRR,
+					       NRS_CTL_HDRR_RD_QUANTUM, true,
+					       &quantum);
+	if (rc == 0)
+		seq_printf(m, "%u\n", quantum);
+
+	return rc;
+}
+
+/**
+ * Sets the quantum of the HDRR policy instances of a service, in bytes.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_hdrr_quantum=4194304
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_hdrr_quantum_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_REG;
+	__u32 quantum;
+	int rc;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &quantum);
+	if (rc)
+		return rc;
+
+	if (quantum < NRS_HDRR_QUANTUM_MIN || quantum > NRS_HDRR_QUANTUM_MAX)
+		return -ERANGE;
+
+	if (nrs_svc_has_hp(svc))
+		queue |= PTLRPC_NRS_QUEUE_HP;
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_HDRR,
+				       NRS_CTL_HDRR_WR_QUANTUM, false,
+				       &quantum);
+
+	return rc ? rc : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_hdrr_quantum);
+
+/**
+ * Prints the shares configured on HDRR policy instances, one per line as
+ * "{project|uid|jobid} <id> <share>".
+ */
+static int
+ptlrpc_lprocfs_nrs_hdrr_shares_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	int rc;
+
+	seq_printf(m, "default %u\n", NRS_HDRR_SHARE_DEFAULT);
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_HDRR,
+				       NRS_CTL_HDRR_RD_SHARES, true, m);
+	if (rc == -ENODEV && nrs_svc_has_hp(svc))
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+					       NRS_POL_NAME_HDRR,
+					       NRS_CTL_HDRR_RD_SHARES, true, m);
+
+	return rc;
+}
+
+#define LPROCFS_NRS_WR_HDRR_SHARE_MAX_CMD	(LUSTRE_JOBID_SIZE + 32)
+
+/**
+ * Sets the share of a project, UID or JobID on the HDRR policy instances of
+ * a service. The share is relative to NRS_HDRR_SHARE_DEFAULT, the share of
+ * the entities with no configured share; setting it back to the default
+ * removes it, and "clear" removes all the shares.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_hdrr_shares="project 1000 400"
+ * lctl set_param ost.OSS.ost_io.nrs_hdrr_shares="uid 500 50"
+ * lctl set_param ost.OSS.ost_io.nrs_hdrr_shares="jobid dd.0 200"
+ * lctl set_param ost.OSS.ost_io.nrs_hdrr_shares=clear
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_hdrr_shares_seq_write(struct file *file,
+					 const char __user *buffer,
+					 size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_REG;
+	char kernbuf[LPROCFS_NRS_WR_HDRR_SHARE_MAX_CMD];
+	struct nrs_hdrr_share share = { 0 };
+	char *buf = kernbuf;
+	char *level;
+	char *id;
+	char *val;
+	int rc;
+
+	if (count > sizeof(kernbuf) - 1)
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+	buf = strim(kernbuf);
+
+	level = strsep(&buf, " \t");
+	if (strcmp(level, "clear") == 0) {
+		if (buf != NULL)
+			return -EINVAL;
+		share.hs_level = NRS_HDRR_LEVELS;
+		goto set;
+	}
+
+	for (share.hs_level = 0; share.hs_level < NRS_HDRR_LEVELS;
+	     share.hs_level++)
+		if (strcmp(level, nrs_hdrr_level_names[share.hs_level]) == 0)
+			break;
+	if (share.hs_level == NRS_HDRR_LEVELS)
+		return -EINVAL;
+
+	id = strsep(&buf, " \t");
+	val = strsep(&buf, " \t");
+	if (id == NULL || *id == '\0' || val == NULL || buf != NULL)
+		return -EINVAL;
+
+	if (share.hs_level == NRS_HDRR_JOBID) {
+		if (strscpy(share.hs_jobid, id, sizeof(share.hs_jobid)) < 0)
+			return -E2BIG;
+	} else {
+		rc = kstrtouint(id, 0, &share.hs_id);
+		if (rc)
+			return rc;
+	}
+
+	rc = kstrtouint(val, 0, &share.hs_share);
+	if (rc)
+		return rc;
+	if (share.hs_share == 0 || share.hs_share > NRS_HDRR_SHARE_MAX)
+		return -ERANGE;
+set:
+	if (nrs_svc_has_hp(svc))
+		queue |= PTLRPC_NRS_QUEUE_HP;
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_HDRR,
+				       NRS_CTL_HDRR_WR_SHARE, false, &share);
+
+	return rc ? rc : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_hdrr_shares);
+
+/**
+ * Initializes an HDRR policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_hdrr_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct ldebugfs_vars nrs_hdrr_lprocfs_vars[] = {
+		{ .name		= "nrs_hdrr_quantum",
+		  .fops		= &ptlrpc_lprocfs_nrs_hdrr_quantum_fops,
+		  .data		= svc },
+		{ .name		= "nrs_hdrr_shares",
+		  .fops		= &ptlrpc_lprocfs_nrs_hdrr_shares_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (!svc->srv_debugfs_entry)
+		return 0;
+
+	ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_hdrr_lprocfs_vars, NULL);
+
+	return 0;
+}
+
+/**
+ * HDRR policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_hdrr_ops = {
+	.op_policy_start	= nrs_hdrr_start,
+	.op_policy_stop		= nrs_hdrr_stop,
+	.op_policy_ctl		= nrs_hdrr_ctl,
+	.op_res_get		= nrs_hdrr_res_get,
+	.op_res_put		= nrs_hdrr_res_put,
+	.op_req_get		= nrs_hdrr_req_get,
+	.op_req_enqueue		= nrs_hdrr_req_add,
+	.op_req_dequeue		= nrs_hdrr_req_del,
+	.op_req_stop		= nrs_hdrr_req_stop,
+	.op_lprocfs_init	= nrs_hdrr_lprocfs_init,
+};
+
+/**
+ * HDRR policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_hdrr = {
+	.nc_name		= NRS_POL_NAME_HDRR,
+	.nc_ops			= &nrs_hdrr_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} HDRR policy */
+
+/** @} nrs */
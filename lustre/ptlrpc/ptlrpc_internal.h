@@ -34,6 +34,8 @@
 #ifndef PTLRPC_INTERNAL_H
 #define PTLRPC_INTERNAL_H
 
+#include <uapi/linux/lustre/lustre_rpc_trace.h>
+
 #include "../ldlm/ldlm_internal.h"
 #include "heap.h"
 
@@ -52,6 +54,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_crrn;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_hdrr;
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -166,12 +169,17 @@ ptlrpc_nrs_req_get_nolock(struct ptlrpc_service_part *svcpt, bool hp,
 	return ptlrpc_nrs_req_get_nolock0(svcpt, hp, false, force);
 }
 
+/* the peeked request is referenced, see ptlrpc_server_drop_request() */
 static inline struct ptlrpc_request *
 ptlrpc_nrs_req_peek_nolock(struct ptlrpc_service_part *svcpt, bool hp)
 {
 	return ptlrpc_nrs_req_get_nolock0(svcpt, hp, true, false);
 }
 
+bool ptlrpc_nrs_req_direct_pending(struct ptlrpc_service_part *svcpt);
+struct ptlrpc_request *
+ptlrpc_nrs_req_get_direct(struct ptlrpc_service_part *svcpt);
+
 void ptlrpc_nrs_req_del_nolock(struct ptlrpc_request *req);
 bool ptlrpc_nrs_req_pending_nolock(struct ptlrpc_service_part *svcpt, bool hp);
 bool ptlrpc_nrs_req_throttling_nolock(struct ptlrpc_service_part *svcpt,
@@ -282,6 +290,23 @@ void ptlrpc_pinger_wake_up(void);
 void ptlrpc_ping_import_soon(struct obd_import *imp);
 int ping_evictor_wake(struct obd_export *exp);
 
+/* rpc_trace.c */
+struct rpc_trace_log;
+extern struct rpc_trace_log __rcu *rpc_trace_log;
+
+void __ptlrpc_rpc_trace(struct ptlrpc_request *req,
+			enum rpc_trace_event event, __u64 bytes);
+int ptlrpc_rpc_trace_init(void);
+void ptlrpc_rpc_trace_fini(void);
+
+static inline void ptlrpc_rpc_trace(struct ptlrpc_request *req,
+				    enum rpc_trace_event event, __u64 bytes)
+{
+	/* a single test when the trace device is not open */
+	if (unlikely(rcu_access_pointer(rpc_trace_log)))
+		__ptlrpc_rpc_trace(req, event, bytes);
+}
+
 /* sec_null.c */
 int  sptlrpc_null_init(void);
 void sptlrpc_null_fini(void);
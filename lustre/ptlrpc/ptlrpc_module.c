@@ -95,10 +95,14 @@ static __init int ptlrpc_init(void)
 	if (rc)
 		GOTO(err_sptlrpc, rc);
 
+	rc = ptlrpc_rpc_trace_init();
+	if (rc)
+		GOTO(err_nrs, rc);
+
 #ifdef HAVE_SERVER_SUPPORT
 	rc = tgt_mod_init();
 	if (rc)
-		GOTO(err_nrs, rc);
+		GOTO(err_rpc_trace, rc);
 
 	rc = nodemap_mod_init();
 	if (rc)
@@ -108,9 +112,11 @@ static __init int ptlrpc_init(void)
 #ifdef HAVE_SERVER_SUPPORT
 err_tgt:
 	tgt_mod_exit();
+err_rpc_trace:
+#endif
+	ptlrpc_rpc_trace_fini();
 err_nrs:
 	ptlrpc_nrs_fini();
-#endif
 err_sptlrpc:
 	sptlrpc_fini();
 err_ldlm:
@@ -136,6 +142,7 @@ static void __exit ptlrpc_exit(void)
 	nodemap_mod_exit();
 	tgt_mod_exit();
 #endif
+	ptlrpc_rpc_trace_fini();
 	ptlrpc_nrs_fini();
 	sptlrpc_fini();
 	ldlm_exit();
@@ -302,6 +302,7 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 	DEBUG_REQ(D_INFO, req, "add req [%p] to pc [%s+%d]",
 		  req, pc->pc_name, pc->pc_index);
 
+	ptlrpc_rpc_trace(req, RPC_TRACE_QUEUED, 0);
 	ptlrpc_set_add_new_req(pc, req);
 }
 EXPORT_SYMBOL(ptlrpcd_add_req);
@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * RPC trace: the lifecycle events of the client and server RPCs are
+ * logged as struct rpc_trace_entry_v1 in per-CPU circular buffers,
+ * which are read from userspace through the /dev/lustre-rpc-trace
+ * character device. Unlike D_RPCTRACE debug logging nothing is
+ * formatted, and when the device is not open the events cost a single
+ * test of rpc_trace_log.
+ *
+ * The buffers are allocated when the device is opened and freed when it
+ * is closed, a single reader may open the device at a time. Each buffer
+ * has a single producer, the CPU it belongs to with interrupts disabled,
+ * and a single consumer, the reader. Events are dropped, and counted,
+ * when the buffer of a CPU is full. Entries are not ordered across the
+ * buffers, the reader orders them by rte_time.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/circ_buf.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include <obd_support.h>
+#include <lustre_net.h>
+#include <uapi/linux/lustre/lustre_rpc_trace.h>
+
+#include "ptlrpc_internal.h"
+
+static unsigned int rpc_trace_buf_size = 256 << 10;
+module_param(rpc_trace_buf_size, uint, 0644);
+MODULE_PARM_DESC(rpc_trace_buf_size,
+		 "RPC trace buffer size of each CPU in bytes, power of 2");
+
+struct rpc_trace_buf {
+	struct circ_buf		rtb_circ;
+	unsigned int		rtb_drop_count;
+};
+
+struct rpc_trace_log {
+	struct rpc_trace_buf __percpu	*rtl_bufs;
+	unsigned int			 rtl_size;
+};
+
+struct rpc_trace_log __rcu *rpc_trace_log;
+static atomic_t rpc_trace_opened = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(rpc_trace_waitq);
+
+static void rpc_trace_log_free(struct rpc_trace_log *rtl)
+{
+	int cpu;
+
+	if (rtl->rtl_bufs) {
+		for_each_possible_cpu(cpu)
+			kvfree(per_cpu_ptr(rtl->rtl_bufs, cpu)->rtb_circ.buf);
+		free_percpu(rtl->rtl_bufs);
+	}
+	kfree(rtl);
+}
+
+static struct rpc_trace_log *rpc_trace_log_alloc(unsigned int size)
+{
+	struct rpc_trace_log *rtl;
+	struct rpc_trace_buf *rtb;
+	int cpu;
+
+	if (!is_power_of_2(size) ||
+	    size < 2 * sizeof(struct rpc_trace_entry_v1) || size > (1U << 30))
+		return ERR_PTR(-EINVAL);
+
+	rtl = kzalloc(sizeof(*rtl), GFP_KERNEL);
+	if (!rtl)
+		return ERR_PTR(-ENOMEM);
+
+	rtl->rtl_size = size;
+	rtl->rtl_bufs = alloc_percpu(struct rpc_trace_buf);
+	if (!rtl->rtl_bufs)
+		goto out_free;
+
+	for_each_possible_cpu(cpu) {
+		rtb = per_cpu_ptr(rtl->rtl_bufs, cpu);
+		rtb->rtb_circ.buf = kvmalloc_node(size, GFP_KERNEL,
+						  cpu_to_node(cpu));
+		if (!rtb->rtb_circ.buf)
+			goto out_free;
+	}
+
+	return rtl;
+
+out_free:
+	rpc_trace_log_free(rtl);
+
+	return ERR_PTR(-ENOMEM);
+}
+
+static bool rpc_trace_is_empty(struct rpc_trace_log *rtl)
+{
+	struct rpc_trace_buf *rtb;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		rtb = per_cpu_ptr(rtl->rtl_bufs, cpu);
+		/* pairs with the release of the head by the writer */
+		if (CIRC_CNT(smp_load_acquire(&rtb->rtb_circ.head),
+			     rtb->rtb_circ.tail, rtl->rtl_size))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Log the event \a event of the RPC \a req, called through
+ * ptlrpc_rpc_trace() when the trace device is open.
+ *
+ * \param[in] req	the request
+ * \param[in] event	enum rpc_trace_event
+ * \param[in] bytes	bytes of the bulk transfer, if any
+ */
+void __ptlrpc_rpc_trace(struct ptlrpc_request *req,
+			enum rpc_trace_event event, __u64 bytes)
+{
+	struct rpc_trace_entry_v1 *rte;
+	struct rpc_trace_log *rtl;
+	struct rpc_trace_buf *rtb;
+	unsigned long flags;
+	unsigned int head;
+	unsigned int tail;
+	bool wake = false;
+
+	rcu_read_lock();
+	rtl = rcu_dereference(rpc_trace_log);
+	if (!rtl)
+		goto out_rcu;
+
+	local_irq_save(flags);
+	rtb = this_cpu_ptr(rtl->rtl_bufs);
+	head = rtb->rtb_circ.head;
+	tail = READ_ONCE(rtb->rtb_circ.tail);
+
+	if (CIRC_SPACE(head, tail, rtl->rtl_size) < sizeof(*rte)) {
+		rtb->rtb_drop_count++;
+		goto out_irq;
+	}
+
+	rte = (struct rpc_trace_entry_v1 *)&rtb->rtb_circ.buf[head];
+	rte->rte_xid = req->rq_xid;
+	rte->rte_time = ktime_get_ns();
+	rte->rte_bytes = bytes;
+	rte->rte_opc = req->rq_reqmsg ? lustre_msg_get_opc(req->rq_reqmsg) : 0;
+	rte->rte_status = req->rq_status;
+	rte->rte_pid = current->pid;
+	rte->rte_cpu = smp_processor_id();
+	rte->rte_event = event;
+	if (req->rq_srv_req) {
+		rte->rte_peer = req->rq_peer.nid;
+		rte->rte_flags = 0;
+	} else {
+		rte->rte_peer = req->rq_import->imp_connection->c_peer.nid;
+		rte->rte_flags = RPC_TRACE_FL_CLIENT;
+	}
+
+	/* wake the reader up on the first entry of an empty buffer */
+	wake = !CIRC_CNT(head, tail, rtl->rtl_size);
+
+	/* Ensure the entry is stored before we update the head. */
+	smp_store_release(&rtb->rtb_circ.head,
+			  (head + sizeof(*rte)) & (rtl->rtl_size - 1));
+out_irq:
+	local_irq_restore(flags);
+	if (wake && wq_has_sleeper(&rpc_trace_waitq))
+		wake_up(&rpc_trace_waitq);
+out_rcu:
+	rcu_read_unlock();
+}
+
+static int rpc_trace_file_open(struct inode *inode, struct file *filp)
+{
+	struct rpc_trace_log *rtl;
+	int rc;
+
+	rc = nonseekable_open(inode, filp);
+	if (rc)
+		return rc;
+
+	if (atomic_cmpxchg(&rpc_trace_opened, 0, 1))
+		return -EBUSY;
+
+	rtl = rpc_trace_log_alloc(READ_ONCE(rpc_trace_buf_size));
+	if (IS_ERR(rtl)) {
+		atomic_set(&rpc_trace_opened, 0);
+		return PTR_ERR(rtl);
+	}
+
+	filp->private_data = rtl;
+	rcu_assign_pointer(rpc_trace_log, rtl);
+
+	return 0;
+}
+
+static int rpc_trace_file_release(struct inode *inode, struct file *filp)
+{
+	struct rpc_trace_log *rtl = filp->private_data;
+
+	RCU_INIT_POINTER(rpc_trace_log, NULL);
+	/* wait for the events being logged */
+	synchronize_rcu();
+	rpc_trace_log_free(rtl);
+	atomic_set(&rpc_trace_opened, 0);
+
+	return 0;
+}
+
+/*
+ * Copy the entries of the buffers of all the CPUs, in turn, to the user
+ * buffer. Its size must be a multiple of the entry size.
+ */
+static ssize_t rpc_trace_file_read(struct file *filp, char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	const size_t entry_size = sizeof(struct rpc_trace_entry_v1);
+	struct rpc_trace_log *rtl = filp->private_data;
+	struct rpc_trace_buf *rtb;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int nob;
+	size_t size = 0;
+	int cpu;
+	int rc;
+
+	if (!count)
+		return 0;
+
+	if (count & (entry_size - 1))
+		return -EINVAL;
+
+	while (rpc_trace_is_empty(rtl)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		/* the timeout covers the wakeups lost to a stale tail */
+		rc = wait_event_interruptible_timeout(rpc_trace_waitq,
+						      !rpc_trace_is_empty(rtl),
+						      cfs_time_seconds(1));
+		if (rc < 0)
+			return rc;
+	}
+
+	for_each_possible_cpu(cpu) {
+		rtb = per_cpu_ptr(rtl->rtl_bufs, cpu);
+		/* Read the head before the entries it covers. */
+		head = smp_load_acquire(&rtb->rtb_circ.head);
+		tail = rtb->rtb_circ.tail;
+
+		/* entries do not wrap, copy up to the end of the buffer */
+		while (size < count && CIRC_CNT(head, tail, rtl->rtl_size)) {
+			nob = min_t(size_t, count - size,
+				    CIRC_CNT_TO_END(head, tail, rtl->rtl_size));
+			if (copy_to_user(buf + size, &rtb->rtb_circ.buf[tail],
+					 nob))
+				return size ? size : -EFAULT;
+
+			size += nob;
+			tail = (tail + nob) & (rtl->rtl_size - 1);
+			/* Release the space once the entries are copied. */
+			smp_store_release(&rtb->rtb_circ.tail, tail);
+		}
+
+		if (size == count)
+			break;
+	}
+
+	return size;
+}
+
+static unsigned int rpc_trace_file_poll(struct file *filp,
+					struct poll_table_struct *wait)
+{
+	struct rpc_trace_log *rtl = filp->private_data;
+
+	poll_wait(filp, &rpc_trace_waitq, wait);
+
+	return rpc_trace_is_empty(rtl) ? 0 : POLLIN;
+}
+
+static long rpc_trace_ioctl_info(struct rpc_trace_log *rtl, void __user *uarg)
+{
+	const size_t entry_size = sizeof(struct rpc_trace_entry_v1);
+	struct rpc_trace_info_v1 rti = {
+		.rti_version = LUSTRE_RPC_TRACE_VERSION_1,
+		.rti_entry_size = entry_size,
+		.rti_buf_size = rtl->rtl_size,
+		.rti_cpu_count = num_possible_cpus(),
+	};
+	struct rpc_trace_buf *rtb;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		rtb = per_cpu_ptr(rtl->rtl_bufs, cpu);
+		rti.rti_entry_count += CIRC_CNT(READ_ONCE(rtb->rtb_circ.head),
+						rtb->rtb_circ.tail,
+						rtl->rtl_size) / entry_size;
+		rti.rti_drop_count += READ_ONCE(rtb->rtb_drop_count);
+	}
+
+	if (copy_to_user(uarg, &rti, sizeof(rti)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static long rpc_trace_file_ioctl(struct file *filp, unsigned int cmd,
+				 unsigned long arg)
+{
+	struct rpc_trace_log *rtl = filp->private_data;
+
+	switch (cmd) {
+	case LUSTRE_RPC_TRACE_IOCTL_VERSION:
+		return LUSTRE_RPC_TRACE_VERSION_1;
+	case LUSTRE_RPC_TRACE_IOCTL_INFO:
+		return rpc_trace_ioctl_info(rtl, (void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations rpc_trace_fops = {
+	.owner = THIS_MODULE,
+	.open = &rpc_trace_file_open,
+	.release = &rpc_trace_file_release,
+	.unlocked_ioctl = &rpc_trace_file_ioctl,
+	.read = &rpc_trace_file_read,
+	.poll = &rpc_trace_file_poll,
+#ifdef HAVE_NO_LLSEEK
+	.llseek = &no_llseek,
+#endif
+};
+
+static struct miscdevice rpc_trace_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = LUSTRE_RPC_TRACE_DEV_NAME,
+	.fops = &rpc_trace_fops,
+	.mode = 0400,
+};
+
+int ptlrpc_rpc_trace_init(void)
+{
+	BUILD_BUG_ON(!is_power_of_2(sizeof(struct rpc_trace_entry_v1)));
+
+	return misc_register(&rpc_trace_misc);
+}
+
+void ptlrpc_rpc_trace_fini(void)
+{
+	misc_deregister(&rpc_trace_misc);
+}
@@ -1084,12 +1084,17 @@ static void ptlrpc_server_finish_active_request(
 					struct ptlrpc_service_part *svcpt,
 					struct ptlrpc_request *req)
 {
-	spin_lock(&svcpt->scp_req_lock);
-	ptlrpc_nrs_req_stop_nolock(req);
-	svcpt->scp_nreqs_active--;
-	if (req->rq_hp)
-		svcpt->scp_nhreqs_active--;
-	spin_unlock(&svcpt->scp_req_lock);
+	/* see ptlrpc_server_request_get_direct() */
+	if (!req->rq_nrq.nr_started && !req->rq_hp) {
+		atomic_dec(&svcpt->scp_nreqs_active);
+	} else {
+		spin_lock(&svcpt->scp_req_lock);
+		ptlrpc_nrs_req_stop_nolock(req);
+		atomic_dec(&svcpt->scp_nreqs_active);
+		if (req->rq_hp)
+			svcpt->scp_nhreqs_active--;
+		spin_unlock(&svcpt->scp_req_lock);
+	}
 
 	ptlrpc_nrs_req_finalize(req);
 
@@ -1629,7 +1634,7 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 		LCONSOLE_WARN("'%s' is processing requests too slowly, client may timeout. Late by %ds, missed %d early replies (reqs waiting=%d active=%d, at_estimate=%d, delay=%lldms)\n",
 			      svcpt->scp_service->srv_name, -first, counter,
 			      svcpt->scp_nreqs_incoming,
-			      svcpt->scp_nreqs_active,
+			      atomic_read(&svcpt->scp_nreqs_active),
 			      atg,
 			      delay_ms);
 	}
@@ -1904,6 +1909,7 @@ static int ptlrpc_server_request_add(struct ptlrpc_service_part *svcpt,
 	req->rq_svc_thread = NULL;
 	req->rq_session.lc_thread = NULL;
 
+	ptlrpc_rpc_trace(req, RPC_TRACE_NRS_QUEUED, 0);
 	ptlrpc_nrs_req_add(svcpt, req, hp);
 
 	RETURN(0);
@@ -1936,7 +1942,7 @@ static bool ptlrpc_server_allow_high(struct ptlrpc_service_part *svcpt,
 			running += 1;
 	}
 
-	if (svcpt->scp_nreqs_active >= running - 1)
+	if (atomic_read(&svcpt->scp_nreqs_active) >= running - 1)
 		return false;
 
 	if (svcpt->scp_nhreqs_active == 0)
@@ -1981,10 +1987,10 @@ static bool ptlrpc_server_allow_normal(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_nrs_req_throttling_nolock(svcpt, false))
 		return false;
 
-	if (svcpt->scp_nreqs_active < running - 2)
+	if (atomic_read(&svcpt->scp_nreqs_active) < running - 2)
 		return true;
 
-	if (svcpt->scp_nreqs_active >= running - 1)
+	if (atomic_read(&svcpt->scp_nreqs_active) >= running - 1)
 		return false;
 
 	return svcpt->scp_nhreqs_active > 0 || !nrs_svcpt_has_hp(svcpt);
@@ -2013,6 +2019,44 @@ bool ptlrpc_server_request_pending(struct ptlrpc_service_part *svcpt,
 	       ptlrpc_server_normal_pending(svcpt, force);
 }
 
+/**
+ * Fetch a regular request from the per-CPU queues of the NRS head without
+ * ptlrpc_service_part::scp_req_lock, when nothing needs the lock to decide:
+ * no high-priority request is pending and enough threads are idle for the
+ * request not to take a thread reserved for them, see
+ * ptlrpc_server_allow_normal(). Such a request is never started on a
+ * policy, so it is also finished without the lock.
+ * Returns a pointer to fetched request, or NULL to take the locked path.
+ */
+static struct ptlrpc_request *
+ptlrpc_server_request_get_direct(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_request *req;
+
+	if (!ptlrpc_nrs_req_direct_pending(svcpt))
+		return NULL;
+
+	if (unlikely(svcpt->scp_service->srv_req_portal == MDS_REQUEST_PORTAL &&
+		     CFS_FAIL_PRECHECK(OBD_FAIL_PTLRPC_CANCEL_RESEND)))
+		return NULL;
+
+	if (nrs_svcpt_has_hp(svcpt) &&
+	    ptlrpc_nrs_req_pending_nolock(svcpt, true))
+		return NULL;
+
+	if (atomic_inc_return(&svcpt->scp_nreqs_active) >
+	    READ_ONCE(svcpt->scp_nthrs_running) - 2) {
+		atomic_dec(&svcpt->scp_nreqs_active);
+		return NULL;
+	}
+
+	req = ptlrpc_nrs_req_get_direct(svcpt);
+	if (req == NULL)
+		atomic_dec(&svcpt->scp_nreqs_active);
+
+	return req;
+}
+
 /**
  * Fetch a request for processing from queue of unprocessed requests.
  * Favors high-priority requests.
@@ -2025,6 +2069,12 @@ ptlrpc_server_request_get(struct ptlrpc_service_part *svcpt, bool force)
 
 	ENTRY;
 
+	if (!force) {
+		req = ptlrpc_server_request_get_direct(svcpt);
+		if (req != NULL)
+			goto got_direct;
+	}
+
 	spin_lock(&svcpt->scp_req_lock);
 
 	if (ptlrpc_server_high_pending(svcpt, force)) {
@@ -2047,12 +2097,14 @@ ptlrpc_server_request_get(struct ptlrpc_service_part *svcpt, bool force)
 	RETURN(NULL);
 
 got_request:
-	svcpt->scp_nreqs_active++;
+	atomic_inc(&svcpt->scp_nreqs_active);
 	if (req->rq_hp)
 		svcpt->scp_nhreqs_active++;
 
 	spin_unlock(&svcpt->scp_req_lock);
 
+got_direct:
+	ptlrpc_rpc_trace(req, RPC_TRACE_NRS_DEQUEUED, 0);
 	if (likely(req->rq_export))
 		class_export_rpc_inc(req->rq_export);
 
@@ -2295,7 +2347,7 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQQDEPTH_CNTR,
 				    svcpt->scp_nreqs_incoming);
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQACTIVE_CNTR,
-				    svcpt->scp_nreqs_active);
+				    atomic_read(&svcpt->scp_nreqs_active));
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_TIMEOUT,
 				    obd_at_get(obd, &svcpt->scp_at_estimate));
 	}
@@ -2346,7 +2398,9 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		request->rq_session.lc_thread = thread;
 		thread->t_env->le_ses = &request->rq_session;
 	}
+	ptlrpc_rpc_trace(request, RPC_TRACE_HANDLE_START, 0);
 	svc->srv_ops.so_req_handler(request);
+	ptlrpc_rpc_trace(request, RPC_TRACE_HANDLE_END, 0);
 
 	ptlrpc_rqphase_move(request, RQ_PHASE_COMPLETE);
 
@@ -2542,7 +2596,7 @@ static void ptlrpc_check_rqbd_pool(struct ptlrpc_service_part *svcpt)
 
 static inline int ptlrpc_threads_enough(struct ptlrpc_service_part *svcpt)
 {
-	return svcpt->scp_nreqs_active <
+	return atomic_read(&svcpt->scp_nreqs_active) <
 	       svcpt->scp_nthrs_running - 1 -
 	       (svcpt->scp_service->srv_ops.so_hpreq_handler != NULL);
 }
@@ -3562,7 +3616,7 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 		spin_unlock(&svcpt->scp_lock);
 
 		LASSERT(svcpt->scp_nreqs_incoming == 0);
-		LASSERT(svcpt->scp_nreqs_active == 0);
+		LASSERT(atomic_read(&svcpt->scp_nreqs_active) == 0);
 		/*
 		 * history should have been culled by
 		 * ptlrpc_server_finish_request
@@ -3696,6 +3750,8 @@ static int ptlrpc_svcpt_health_check(struct ptlrpc_service_part *svcpt)
 
 	if (request->rq_export)
 		obd = request->rq_export->exp_obd;
+	/* the peeked request is referenced, it may be handled meanwhile */
+	ptlrpc_server_drop_request(request);
 
 	if ((timediff.tv_sec) >
 	    (obd_at_off(obd) ? obd_timeout * 3 / 2 : obd_get_at_max(obd))) {
@@ -85,6 +85,163 @@ MODULE_PARM_DESC(lbug_on_grant_miscount, "LBUG on grant miscount");
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Grant chunks reserved at once for the lockless allocations of a CPU */
+#define TGT_GRANT_POOL_CHUNKS		16
+
+/*
+ * Grant counters are split over the CPUs, so that bulk writes consuming
+ * grant the client already owns, and their commit, do not take the global
+ * tgd_grant_lock:
+ * - changes of tgd_tot_dirty/granted/pending are accumulated in the
+ *   tg_grant_shard of the local CPU, and folded into the totals under
+ *   tgd_grant_lock before the space left is computed;
+ * - each CPU holds a pool of space (tgs_avail) counted in tgd_tot_granted,
+ *   from which new grant is given without tgd_grant_lock.
+ * The granted space thus only grows under tgd_grant_lock, after checking
+ * the space left, which keeps the over-commit guarantees. The pools are
+ * given back whenever statfs data is refreshed, so that they follow the
+ * free space.
+ * Per-export counters are protected by ted_grant_lock. The lock order is
+ * tgd_grant_lock, tgs_lock, ted_grant_lock.
+ */
+static struct tg_grant_shard *tgt_grant_shard_lock(struct tg_grants_data *tgd)
+{
+	struct tg_grant_shard *tgs = raw_cpu_ptr(tgd->tgd_grant_shards);
+
+	spin_lock(&tgs->tgs_lock);
+	return tgs;
+}
+
+/*
+ * Lock the grant counters of the local CPU for an update which does not need
+ * the space left. While they are frozen, tgd_grant_lock is taken as well and
+ * \a locked is set.
+ */
+static struct tg_grant_shard *
+tgt_grant_shard_lock_fast(struct tg_grants_data *tgd, bool *locked)
+{
+	struct tg_grant_shard *tgs = tgt_grant_shard_lock(tgd);
+
+	*locked = false;
+	if (likely(!READ_ONCE(tgd->tgd_grant_frozen)))
+		return tgs;
+
+	spin_unlock(&tgs->tgs_lock);
+	spin_lock(&tgd->tgd_grant_lock);
+	*locked = true;
+	return tgt_grant_shard_lock(tgd);
+}
+
+/* totals can be transiently negative until all the CPUs are folded */
+static inline u64 tgt_grant_tot(u64 tot)
+{
+	return (s64)tot < 0 ? 0 : tot;
+}
+
+/**
+ * Fold the per-CPU grant counters into the grant totals.
+ *
+ * \param[in] tgd	grant data of the target
+ * \param[in] drain	give the space pooled on the CPUs back as well
+ */
+static void tgt_grant_fold(struct tg_grants_data *tgd, bool drain)
+{
+	struct tg_grant_shard *tgs;
+	s64 dirty = 0;
+	s64 granted = 0;
+	s64 pending = 0;
+	int cpu;
+
+	assert_spin_locked(&tgd->tgd_grant_lock);
+
+	for_each_possible_cpu(cpu) {
+		tgs = per_cpu_ptr(tgd->tgd_grant_shards, cpu);
+		spin_lock(&tgs->tgs_lock);
+		dirty += tgs->tgs_dirty;
+		granted += tgs->tgs_granted;
+		pending += tgs->tgs_pending;
+		tgs->tgs_dirty = 0;
+		tgs->tgs_granted = 0;
+		tgs->tgs_pending = 0;
+		if (drain) {
+			granted -= tgs->tgs_avail;
+			tgs->tgs_avail = 0;
+		}
+		spin_unlock(&tgs->tgs_lock);
+	}
+
+	/* granted space only grows under tgd_grant_lock */
+	if (unlikely(granted < 0 && tgd->tgd_tot_granted < -granted)) {
+		CERROR("%s: tot_granted %llu < released grant %lld\n",
+		       container_of(tgd, struct lu_target,
+				    lut_tgd)->lut_obd->obd_name,
+		       tgd->tgd_tot_granted, -granted);
+		if (lbug_on_grant_miscount) {
+			spin_unlock(&tgd->tgd_grant_lock);
+			LBUG();
+		}
+	}
+	tgd->tgd_tot_dirty += dirty;
+	tgd->tgd_tot_granted += granted;
+	tgd->tgd_tot_pending += pending;
+}
+
+/*
+ * Stop the lockless updates of the grant counters, so that the totals are
+ * exact until tgt_grant_thaw(). Callers of tgt_grant_shard_lock() check
+ * tgd_grant_frozen once they hold tgs_lock, so none of them is left when
+ * tgt_grant_fold() has gone through all the CPUs.
+ */
+static void tgt_grant_freeze(struct tg_grants_data *tgd)
+{
+	assert_spin_locked(&tgd->tgd_grant_lock);
+	WRITE_ONCE(tgd->tgd_grant_frozen, true);
+	tgt_grant_fold(tgd, true);
+}
+
+static void tgt_grant_thaw(struct tg_grants_data *tgd)
+{
+	assert_spin_locked(&tgd->tgd_grant_lock);
+	WRITE_ONCE(tgd->tgd_grant_frozen, false);
+}
+
+/**
+ * Get the grant totals of a target, with the per-CPU changes not folded yet.
+ *
+ * The per-CPU counters are read without locking, so the totals are only
+ * approximate while grant is being used. The space pooled on the CPUs is not
+ * reported as granted.
+ *
+ * \param[in] tgd	grant data of the target
+ * \param[out] dirty	dirty data reported by the clients
+ * \param[out] granted	space granted to the exports
+ * \param[out] pending	grant used by the I/Os in progress
+ */
+void tgt_grant_totals(struct tg_grants_data *tgd, u64 *dirty, u64 *granted,
+		      u64 *pending)
+{
+	s64 tot_dirty = READ_ONCE(tgd->tgd_tot_dirty);
+	s64 tot_granted = READ_ONCE(tgd->tgd_tot_granted);
+	s64 tot_pending = READ_ONCE(tgd->tgd_tot_pending);
+	struct tg_grant_shard *tgs;
+	int cpu;
+
+	if (tgd->tgd_grant_shards) {
+		for_each_possible_cpu(cpu) {
+			tgs = per_cpu_ptr(tgd->tgd_grant_shards, cpu);
+			tot_dirty += READ_ONCE(tgs->tgs_dirty);
+			tot_granted += READ_ONCE(tgs->tgs_granted) -
+				       READ_ONCE(tgs->tgs_avail);
+			tot_pending += READ_ONCE(tgs->tgs_pending);
+		}
+	}
+
+	*dirty = max_t(s64, tot_dirty, 0);
+	*granted = max_t(s64, tot_granted, 0);
+	*pending = max_t(s64, tot_pending, 0);
+}
+EXPORT_SYMBOL(tgt_grant_totals);
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 tgt_grant_inflate(struct tg_grants_data *tgd, u64 val)
@@ -212,8 +369,9 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 
 	maxsize = tgd->tgd_osfs.os_blocks << tgd->tgd_blockbits;
 
-	spin_lock(&obd->obd_dev_lock);
 	spin_lock(&tgd->tgd_grant_lock);
+	tgt_grant_freeze(tgd);
+	spin_lock(&obd->obd_dev_lock);
 	exp = obd->obd_self_export;
 	ted = &exp->exp_target_data;
 	CDEBUG(D_CACHE, "%s: processing self export: %ld %ld "
@@ -228,6 +386,7 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 						&tot_granted, maxsize);
 		if (error < 0) {
 			spin_unlock(&obd->obd_dev_lock);
+			tgt_grant_thaw(tgd);
 			spin_unlock(&tgd->tgd_grant_lock);
 			LBUG();
 		}
@@ -241,6 +400,7 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 						&tot_granted, maxsize);
 		if (error < 0) {
 			spin_unlock(&obd->obd_dev_lock);
+			tgt_grant_thaw(tgd);
 			spin_unlock(&tgd->tgd_grant_lock);
 			LBUG();
 		}
@@ -250,6 +410,7 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 	fo_tot_pending = tgd->tgd_tot_pending;
 	fo_tot_dirty = tgd->tgd_tot_dirty;
 	spin_unlock(&obd->obd_dev_lock);
+	tgt_grant_thaw(tgd);
 	spin_unlock(&tgd->tgd_grant_lock);
 
 	if (tot_granted != fo_tot_granted)
@@ -325,6 +486,10 @@ int tgt_statfs_internal(const struct lu_env *env, struct lu_target *lut,
 		osfs->os_namelen = min_t(__u32, osfs->os_namelen, NAME_MAX);
 
 		spin_lock(&tgd->tgd_grant_lock);
+		/* space pooled on the CPUs was reserved against the old statfs
+		 * data, give it back
+		 */
+		tgt_grant_fold(tgd, true);
 		spin_lock(&tgd->tgd_osfs_lock);
 		/* calculate how much space was written while we released the
 		 * tgd_osfs_lock */
@@ -348,7 +513,7 @@ int tgt_statfs_internal(const struct lu_env *env, struct lu_target *lut,
 		}
 		/* similarly, there is some uncertainty on write requests
 		 * between prepare & commit */
-		tgd->tgd_osfs_unstable += tgd->tgd_tot_pending;
+		tgd->tgd_osfs_unstable += tgt_grant_tot(tgd->tgd_tot_pending);
 		spin_unlock(&tgd->tgd_grant_lock);
 
 		/* finally udpate cached statfs data */
@@ -428,7 +593,8 @@ static void tgt_grant_statfs(const struct lu_env *env, struct obd_export *exp,
  *
  * This is done by accessing cached statfs data previously populated by
  * tgt_grant_statfs(), from which we withdraw the space already granted to
- * clients and the reserved space.
+ * clients and the reserved space. The per-CPU grant counters are folded
+ * first, so that the granted space is exact.
  * Caller must hold tgd_grant_lock spinlock.
  *
  * \param[in] exp	export associated with the device for which the amount
@@ -449,6 +615,8 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
 	ENTRY;
 	assert_spin_locked(&tgd->tgd_grant_lock);
 
+	tgt_grant_fold(tgd, false);
+
 	spin_lock(&tgd->tgd_osfs_lock);
 	/* get available space from cached statfs data */
 	left = tgd->tgd_osfs.os_bavail << tgd->tgd_blockbits;
@@ -460,7 +628,7 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
 
 	if (left < tot_granted) {
 		int mask = (left + unstable <
-			    tot_granted - tgd->tgd_tot_pending) ?
+			    tot_granted - tgt_grant_tot(tgd->tgd_tot_pending)) ?
 			    D_ERROR : D_CACHE;
 
 		/* the below message is checked in sanityn.sh test_15 */
@@ -468,8 +636,8 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
 			     "%s: cli %s/%p left=%llu < tot_grant=%llu unstable=%llu pending=%llu dirty=%llu\n",
 			     obd->obd_name, exp->exp_client_uuid.uuid, exp,
 			     left, tot_granted, unstable,
-			     tgd->tgd_tot_pending,
-			     tgd->tgd_tot_dirty);
+			     tgt_grant_tot(tgd->tgd_tot_pending),
+			     tgt_grant_tot(tgd->tgd_tot_dirty));
 		RETURN(0);
 	}
 
@@ -483,7 +651,7 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
 	CDEBUG(D_CACHE,
 	       "%s: cli %s/%p avail=%llu left=%llu unstable=%llu tot_grant=%llu pending=%llu\n",
 	       obd->obd_name, exp->exp_client_uuid.uuid, exp, avail, left,
-	       unstable, tot_granted, tgd->tgd_tot_pending);
+	       unstable, tot_granted, tgt_grant_tot(tgd->tgd_tot_pending));
 
 	RETURN(left);
 }
@@ -496,14 +664,17 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
  * inflate all grant counters passed in the request if the client does not
  * support the grant parameters.
  * We will later calculate the client's new grant and return it.
- * Caller must hold tgd_grant_lock spinlock.
+ * Caller must hold the tgs_lock of \a tgs and ted_grant_lock.
  *
  * \param[in] env	LU environment supplying osfs storage
  * \param[in] exp	export for which we received the request
  * \param[in,out] oa	incoming obdo sent by the client
+ * \param[in] chunk	grant allocation unit
+ * \param[in] tgs	grant counters of the local CPU
  */
 static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
-			       struct obdo *oa, long chunk)
+			       struct obdo *oa, long chunk,
+			       struct tg_grant_shard *tgs)
 {
 	struct tg_export_data	*ted = &exp->exp_target_data;
 	struct obd_device	*obd = exp->exp_obd;
@@ -511,7 +682,8 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	long long		 dirty, dropped;
 	ENTRY;
 
-	assert_spin_locked(&tgd->tgd_grant_lock);
+	assert_spin_locked(&tgs->tgs_lock);
+	assert_spin_locked(&ted->ted_grant_lock);
 
 	if ((oa->o_valid & (OBD_MD_FLBLOCKS|OBD_MD_FLGRANT)) !=
 					(OBD_MD_FLBLOCKS|OBD_MD_FLGRANT)) {
@@ -556,7 +728,10 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	 * on ted_dirty however, but we must check sanity to not assert. */
 	if (dirty > ted->ted_grant + 4 * chunk)
 		dirty = ted->ted_grant + 4 * chunk;
-	tgd->tgd_tot_dirty += dirty - ted->ted_dirty;
+	tgs->tgs_dirty += dirty - ted->ted_dirty;
+	/* ted_grant is part of tot_granted, so this also prevents the
+	 * latter from going negative
+	 */
 	if (ted->ted_grant < dropped) {
 		CDEBUG(D_CACHE,
 		       "%s: cli %s/%p reports %llu dropped > grant %lu\n",
@@ -564,13 +739,7 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 		       ted->ted_grant);
 		dropped = 0;
 	}
-	if (tgd->tgd_tot_granted < dropped) {
-		CERROR("%s: cli %s/%p reports %llu dropped > tot_grant %llu\n",
-		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       dropped, tgd->tgd_tot_granted);
-		dropped = 0;
-	}
-	tgd->tgd_tot_granted -= dropped;
+	tgs->tgs_granted -= dropped;
 	ted->ted_grant -= dropped;
 	ted->ted_dirty = dirty;
 
@@ -578,7 +747,7 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       ted->ted_dirty, ted->ted_pending, ted->ted_grant);
-		spin_unlock(&tgd->tgd_grant_lock);
+		spin_unlock(&ted->ted_grant_lock);
 		LBUG();
 	}
 	EXIT;
@@ -591,7 +760,7 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
  * shrinking). This function proceeds with the shrink request when there is
  * less ungranted space remaining than the amount all of the connected clients
  * would consume if they used their full grant.
- * Caller must hold tgd_grant_lock spinlock.
+ * Caller must hold tgd_grant_lock spinlock and ted_grant_lock.
  *
  * \param[in] exp		export releasing grant space
  * \param[in,out] oa		incoming obdo sent by the client
@@ -607,6 +776,7 @@ static void tgt_grant_shrink(struct obd_export *exp, struct obdo *oa,
 	long			 grant_shrink;
 
 	assert_spin_locked(&tgd->tgd_grant_lock);
+	assert_spin_locked(&ted->ted_grant_lock);
 	LASSERT(exp);
 	if (left_space >= tgd->tgd_tot_granted_clients *
 			  TGT_GRANT_SHRINK_LIMIT(exp))
@@ -703,7 +873,8 @@ static inline u64 tgt_grant_rnb_size(struct obd_export *exp,
  * The OBD_BRW_GRANTED flag will be set in the rnb_flags of each network
  * buffer which has been granted enough space to proceed. Buffers without
  * this flag will fail to be written with -ENOSPC (see tgt_preprw_write().
- * Caller must hold tgd_grant_lock spinlock.
+ * Caller must hold the tgs_lock of \a tgs and ted_grant_lock, and also
+ * tgd_grant_lock unless all the buffers are covered by the export's grant.
  *
  * \param[in] env	LU environment passed by the caller
  * \param[in] exp	export identifying the client which sent the RPC
@@ -713,15 +884,16 @@ static inline u64 tgt_grant_rnb_size(struct obd_export *exp,
  * \param[in] niocount	the number of network buffers in the list
  * \param[in] left	the remaining free space with space already granted
  *			taken out
+ * \param[in] tgs	grant counters of the local CPU
  */
 static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 			    struct obdo *oa, struct niobuf_remote *rnb,
-			    int niocount, u64 *left)
+			    int niocount, u64 *left,
+			    struct tg_grant_shard *tgs)
 {
 	struct tg_export_data	*ted = &exp->exp_target_data;
 	struct obd_device	*obd = exp->exp_obd;
 	struct lu_target	*lut = obd2obt(obd)->obt_lut;
-	struct tg_grants_data	*tgd = &lut->lut_tgd;
 	unsigned long		 ungranted = 0;
 	unsigned long		 granted = 0;
 	int			 i;
@@ -729,7 +901,8 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 
 	ENTRY;
 
-	assert_spin_locked(&tgd->tgd_grant_lock);
+	assert_spin_locked(&tgs->tgs_lock);
+	assert_spin_locked(&ted->ted_grant_lock);
 
 	if (obd->obd_recovering) {
 		/* Replaying write. Grant info have been processed already so no
@@ -848,8 +1021,8 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 	 * happens in tgt_grant_commit() after the writes are done. */
 	ted->ted_grant -= granted;
 	ted->ted_pending += oa->o_grant_used;
-	tgd->tgd_tot_granted += ungranted;
-	tgd->tgd_tot_pending += oa->o_grant_used;
+	tgs->tgs_granted += ungranted;
+	tgs->tgs_pending += oa->o_grant_used;
 
 	CDEBUG(D_CACHE,
 	       "%s: cli %s/%p granted: %lu ungranted: %lu grant: %lu dirty: %lu"
@@ -867,14 +1040,14 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 		       granted, ted->ted_dirty);
 		granted = ted->ted_dirty;
 	}
-	tgd->tgd_tot_dirty -= granted;
+	tgs->tgs_dirty -= granted;
 	ted->ted_dirty -= granted;
 
 	if (ted->ted_dirty < 0 || ted->ted_grant < 0 || ted->ted_pending < 0) {
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       ted->ted_dirty, ted->ted_pending, ted->ted_grant);
-		spin_unlock(&tgd->tgd_grant_lock);
+		spin_unlock(&ted->ted_grant_lock);
 		LBUG();
 	}
 	EXIT;
@@ -884,10 +1057,13 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
  * Allocate additional grant space to a client
  *
  * Calculate how much grant space to return to client, based on how much space
- * is currently free and how much of that is already granted.
- * Caller must hold tgd_grant_lock spinlock.
+ * is currently free and how much of that is already granted, or on how much
+ * space is pooled on the local CPU.
+ * Caller must hold the tgs_lock of \a tgs and ted_grant_lock, and also
+ * tgd_grant_lock unless \a pooled is set.
  *
  * \param[in] exp		export of the client which sent the request
+ * \param[in] tgs		grant counters of the local CPU
  * \param[in] curgrant		current grant claimed by the client
  * \param[in] want		how much grant space the client would like to
  *				have
@@ -898,12 +1074,14 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
  *				and limit how much space is granted back to the
  *				client. Otherwise, the server should try hard to
  *				satisfy the client request.
+ * \param[in] pooled		take the grant from the space pooled on the
+ *				local CPU, \a left being the size of the pool
  *
  * \retval			amount of grant space allocated
  */
-static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
-			    u64 want, u64 left, long chunk,
-			    bool conservative)
+static long tgt_grant_alloc(struct obd_export *exp, struct tg_grant_shard *tgs,
+			    u64 curgrant, u64 want, u64 left, long chunk,
+			    bool conservative, bool pooled)
 {
 	struct obd_device	*obd = exp->exp_obd;
 	struct tg_grants_data	*tgd = &obd2obt(obd)->obt_lut->lut_tgd;
@@ -945,9 +1123,10 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if (obd->obd_recovering)
 		conservative = false;
 
-	if (conservative)
+	if (conservative && !pooled)
 		/* don't grant more than 1/8th of the remaining free space in
-		 * one chunk */
+		 * one chunk, pools already are a fraction of that
+		 */
 		left >>= 3;
 	grant = min(want - curgrant, left);
 	/* round grant up to the next block size */
@@ -971,7 +1150,14 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if (ted->ted_grant + grant > want + chunk)
 		grant = want + chunk - ted->ted_grant;
 
-	tgd->tgd_tot_granted += grant;
+	if (pooled) {
+		/* the pool is not necessarily block aligned */
+		if (grant > left)
+			grant = left;
+		tgs->tgs_avail -= grant;
+	} else {
+		tgs->tgs_granted += grant;
+	}
 	ted->ted_grant += grant;
 
 	if (unlikely(ted->ted_grant < 0 || ted->ted_grant > want + chunk)) {
@@ -979,7 +1165,7 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       ted->ted_grant, want, curgrant);
 		if (lbug_on_grant_miscount) {
-			spin_unlock(&tgd->tgd_grant_lock);
+			spin_unlock(&ted->ted_grant_lock);
 			LBUG();
 		}
 	}
@@ -989,10 +1175,10 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	       " granting: %llu\n", obd->obd_name, exp->exp_client_uuid.uuid,
 	       exp, want, curgrant, grant);
 	CDEBUG(D_CACHE,
-	       "%s: cli %s/%p tot cached:%llu granted:%llu"
+	       "%s: cli %s/%p tot cached:%llu granted:%llu pooled:%llu"
 	       " num_exports: %d\n", obd->obd_name, exp->exp_client_uuid.uuid,
-	       exp, tgd->tgd_tot_dirty, tgd->tgd_tot_granted,
-	       obd->obd_num_exports);
+	       exp, tgt_grant_tot(tgd->tgd_tot_dirty), tgd->tgd_tot_granted,
+	       tgs->tgs_avail, obd->obd_num_exports);
 
 	RETURN(grant);
 }
@@ -1018,6 +1204,7 @@ void tgt_grant_connect(const struct lu_env *env, struct obd_export *exp,
 	struct lu_target	*lut = obd2obt(exp->exp_obd)->obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
 	struct tg_export_data	*ted = &exp->exp_target_data;
+	struct tg_grant_shard	*tgs;
 	u64			 left = 0;
 	u64			 want;
 	long			 chunk;
@@ -1056,7 +1243,10 @@ refresh:
 		goto refresh;
 	}
 
-	tgt_grant_alloc(exp, (u64)ted->ted_grant, want, left, chunk, new_conn);
+	tgs = tgt_grant_shard_lock(tgd);
+	spin_lock(&ted->ted_grant_lock);
+	tgt_grant_alloc(exp, tgs, (u64)ted->ted_grant, want, left, chunk,
+			new_conn, false);
 
 	/* return to client its current grant */
 	if (OCD_HAS_FLAG(data, GRANT_PARAM))
@@ -1066,8 +1256,10 @@ refresh:
 		data->ocd_grant = tgt_grant_deflate(tgd, (u64)ted->ted_grant);
 
 	/* reset dirty accounting */
-	tgd->tgd_tot_dirty -= ted->ted_dirty;
+	tgs->tgs_dirty -= ted->ted_dirty;
 	ted->ted_dirty = 0;
+	spin_unlock(&ted->ted_grant_lock);
+	spin_unlock(&tgs->tgs_lock);
 
 	if (new_conn && OCD_HAS_FLAG(data, GRANT))
 		tgd->tgd_tot_granted_clients++;
@@ -1104,6 +1296,9 @@ void tgt_grant_discard(struct obd_export *exp)
 
 	tgd = &lut->lut_tgd;
 	spin_lock(&tgd->tgd_grant_lock);
+	/* the totals are compared with the export counters below */
+	tgt_grant_freeze(tgd);
+	spin_lock(&ted->ted_grant_lock);
 	if (unlikely(tgd->tgd_tot_granted < ted->ted_grant ||
 		     tgd->tgd_tot_dirty < ted->ted_dirty)) {
 		struct obd_export *e;
@@ -1140,6 +1335,8 @@ void tgt_grant_discard(struct obd_export *exp)
 	}
 	/* tgd_tot_pending is handled in tgt_grant_commit as bulk
 	 * commmits */
+	spin_unlock(&ted->ted_grant_lock);
+	tgt_grant_thaw(tgd);
 	spin_unlock(&tgd->tgd_grant_lock);
 }
 EXPORT_SYMBOL(tgt_grant_discard);
@@ -1162,7 +1359,10 @@ void tgt_grant_prepare_read(const struct lu_env *env,
 {
 	struct lu_target	*lut = obd2obt(exp->exp_obd)->obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
+	struct tg_export_data	*ted = &exp->exp_target_data;
+	struct tg_grant_shard	*tgs;
 	int			 do_shrink;
+	bool			 locked = true;
 	u64			 left = 0;
 
 	ENTRY;
@@ -1192,18 +1392,22 @@ void tgt_grant_prepare_read(const struct lu_env *env,
 
 		/* all set now to proceed with shrinking */
 		do_shrink = 1;
+		tgs = tgt_grant_shard_lock(tgd);
 	} else {
 		/* no grant shrinking request packed in the obdo and
 		 * since we don't grant space back on reads, no point
 		 * in running statfs, so just skip it and process
-		 * incoming grant data directly. */
-		spin_lock(&tgd->tgd_grant_lock);
+		 * incoming grant data directly, without the global grant
+		 * lock.
+		 */
+		tgs = tgt_grant_shard_lock_fast(tgd, &locked);
 		do_shrink = 0;
 	}
+	spin_lock(&ted->ted_grant_lock);
 
 	/* extract incoming grant information provided by the client and
 	 * inflate grant counters if required */
-	tgt_grant_incoming(env, exp, oa, tgt_grant_chunk(exp, lut, NULL));
+	tgt_grant_incoming(env, exp, oa, tgt_grant_chunk(exp, lut, NULL), tgs);
 
 	/* unlike writes, we don't return grants back on reads unless a grant
 	 * shrink request was packed and we decided to turn it down. */
@@ -1214,11 +1418,121 @@ void tgt_grant_prepare_read(const struct lu_env *env,
 
 	if (!exp_grant_param_supp(exp))
 		oa->o_grant = tgt_grant_deflate(tgd, oa->o_grant);
-	spin_unlock(&tgd->tgd_grant_lock);
+	spin_unlock(&ted->ted_grant_lock);
+	spin_unlock(&tgs->tgs_lock);
+	if (locked)
+		spin_unlock(&tgd->tgd_grant_lock);
 	EXIT;
 }
 EXPORT_SYMBOL(tgt_grant_prepare_read);
 
+/**
+ * Reserve space for the grant allocations without tgd_grant_lock.
+ *
+ * The local CPU is given up to TGT_GRANT_POOL_CHUNKS grant chunks, but no
+ * more than its share of 1/8th of the space left, which is what
+ * tgt_grant_alloc() would give to a single client at once.
+ * Caller must hold tgd_grant_lock and the tgs_lock of \a tgs.
+ *
+ * \param[in] tgd	grant data of the target
+ * \param[in] tgs	grant counters of the local CPU
+ * \param[in] left	remaining free space with granted space taken out
+ * \param[in] chunk	grant allocation unit
+ */
+static void tgt_grant_pool_refill(struct tg_grants_data *tgd,
+				  struct tg_grant_shard *tgs, u64 left,
+				  long chunk)
+{
+	u64 refill;
+
+	assert_spin_locked(&tgd->tgd_grant_lock);
+	assert_spin_locked(&tgs->tgs_lock);
+
+	if (tgs->tgs_avail >= chunk)
+		return;
+
+	refill = min_t(u64, TGT_GRANT_POOL_CHUNKS * chunk,
+		       div_u64(left >> 3, num_online_cpus()));
+	refill &= ~((1ULL << tgd->tgd_blockbits) - 1);
+	if (refill < chunk)
+		return;
+
+	tgs->tgs_avail += refill;
+	tgs->tgs_granted += refill;
+}
+
+/**
+ * Process grant information of a bulk write without tgd_grant_lock.
+ *
+ * This is possible when all the network buffers are covered by the grant
+ * the client owns, and new grant can be taken from the space pooled on the
+ * local CPU, which is the usual case of cached writes. Otherwise nothing is
+ * changed and tgt_grant_prepare_write() goes through the locked path.
+ *
+ * \param[in] env	LU environment provided by the caller
+ * \param[in] exp	export of the client which sent the request
+ * \param[in] oa	incoming obdo sent by the client
+ * \param[in] rnb	list of network buffers
+ * \param[in] niocount	number of network buffers in the list
+ * \param[in] chunk	grant allocation unit
+ *
+ * \retval true	if the grant information was processed
+ * \retval false	if tgd_grant_lock is needed
+ */
+static bool tgt_grant_prepare_write_fast(const struct lu_env *env,
+					 struct obd_export *exp,
+					 struct obdo *oa,
+					 struct niobuf_remote *rnb,
+					 int niocount, long chunk)
+{
+	struct tg_export_data	*ted = &exp->exp_target_data;
+	struct obd_device	*obd = exp->exp_obd;
+	struct tg_grants_data	*tgd = &obd2obt(obd)->obt_lut->lut_tgd;
+	struct tg_grant_shard	*tgs;
+	u64			 left = 0;
+	u32			 dropped;
+	bool			 done = false;
+	int			 i;
+
+	if (obd->obd_recovering || !exp_grant_param_supp(exp) ||
+	    oa->o_grant_used == 0 ||
+	    (oa->o_valid & (OBD_MD_FLBLOCKS | OBD_MD_FLGRANT)) !=
+	    (OBD_MD_FLBLOCKS | OBD_MD_FLGRANT) ||
+	    ((oa->o_valid & OBD_MD_FLFLAGS) &&
+	     (oa->o_flags & (OBD_FL_RECOV_RESEND | OBD_FL_SHRINK_GRANT))))
+		return false;
+
+	for (i = 0; i < niocount; i++)
+		if (!(rnb[i].rnb_flags & OBD_BRW_FROM_GRANT))
+			return false;
+
+	tgs = tgt_grant_shard_lock(tgd);
+	if (unlikely(READ_ONCE(tgd->tgd_grant_frozen)) ||
+	    tgs->tgs_avail < chunk)
+		goto out;
+
+	spin_lock(&ted->ted_grant_lock);
+	/* same as tgt_grant_incoming(), the buffers must be covered by the
+	 * grant left once the dropped grant is taken out
+	 */
+	dropped = oa->o_dropped;
+	if (ted->ted_grant < dropped)
+		dropped = 0;
+	if (ted->ted_grant - dropped >= oa->o_grant_used) {
+		tgt_grant_incoming(env, exp, oa, chunk, tgs);
+		tgt_grant_check(env, exp, oa, rnb, niocount, &left, tgs);
+		oa->o_grant = tgt_grant_alloc(exp, tgs, oa->o_grant,
+					      oa->o_undirty, tgs->tgs_avail,
+					      chunk, true, true);
+		done = true;
+	}
+	spin_unlock(&ted->ted_grant_lock);
+out:
+	spin_unlock(&tgs->tgs_lock);
+
+	return done;
+}
+
 /**
  * Process grant information from incoming bulk write request.
  *
@@ -1247,6 +1561,8 @@ void tgt_grant_prepare_write(const struct lu_env *env,
 	struct obd_device	*obd = exp->exp_obd;
 	struct lu_target	*lut = obd2obt(obd)->obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
+	struct tg_export_data	*ted = &exp->exp_target_data;
+	struct tg_grant_shard	*tgs;
 	u64			 left;
 	int			 from_cache;
 	int			 force = 0; /* can use cached data intially */
@@ -1254,6 +1570,9 @@ void tgt_grant_prepare_write(const struct lu_env *env,
 
 	ENTRY;
 
+	if (tgt_grant_prepare_write_fast(env, exp, oa, rnb, niocount, chunk))
+		RETURN_EXIT;
+
 refresh:
 	/* get statfs information from OSD layer */
 	tgt_grant_statfs(env, exp, force, &from_cache);
@@ -1298,32 +1617,42 @@ refresh:
 		}
 	}
 
+	tgs = tgt_grant_shard_lock(tgd);
+	spin_lock(&ted->ted_grant_lock);
+
 	/* extract incoming grant information provided by the client,
 	 * and inflate grant counters if required */
-	tgt_grant_incoming(env, exp, oa, chunk);
+	tgt_grant_incoming(env, exp, oa, chunk, tgs);
 
 	/* check limit */
-	tgt_grant_check(env, exp, oa, rnb, niocount, &left);
+	tgt_grant_check(env, exp, oa, rnb, niocount, &left, tgs);
 
-	if (!(oa->o_valid & OBD_MD_FLGRANT)) {
-		spin_unlock(&tgd->tgd_grant_lock);
-		RETURN_EXIT;
-	}
+	if (!(oa->o_valid & OBD_MD_FLGRANT))
+		GOTO(out, 0);
 
 	/* if OBD_FL_SHRINK_GRANT is set, the client is willing to release some
 	 * grant space. */
 	if ((oa->o_valid & OBD_MD_FLFLAGS) &&
-	    (oa->o_flags & OBD_FL_SHRINK_GRANT))
+	    (oa->o_flags & OBD_FL_SHRINK_GRANT)) {
 		tgt_grant_shrink(exp, oa, left);
-	else
+	} else {
 		/* grant more space back to the client if possible */
-		oa->o_grant = tgt_grant_alloc(exp, oa->o_grant, oa->o_undirty,
-					      left, chunk, true);
+		oa->o_grant = tgt_grant_alloc(exp, tgs, oa->o_grant,
+					      oa->o_undirty, left, chunk,
+					      true, false);
+		/* and reserve some for the next writes on this CPU */
+		if (!obd->obd_recovering)
+			tgt_grant_pool_refill(tgd, tgs, left - oa->o_grant,
+					      chunk);
+	}
 
 	if (!exp_grant_param_supp(exp))
 		oa->o_grant = tgt_grant_deflate(tgd, oa->o_grant);
-	spin_unlock(&tgd->tgd_grant_lock);
 	EXIT;
+out:
+	spin_unlock(&ted->ted_grant_lock);
+	spin_unlock(&tgs->tgs_lock);
+	spin_unlock(&tgd->tgd_grant_lock);
 }
 EXPORT_SYMBOL(tgt_grant_prepare_write);
 
@@ -1350,9 +1679,11 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 	struct lu_target	*lut = obd2obt(exp->exp_obd)->obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
 	struct tg_export_data	*ted = &exp->exp_target_data;
+	struct tg_grant_shard	*tgs;
 	u64			 left = 0;
 	unsigned long		 wanted;
 	unsigned long		 granted;
+	long			 rc;
 	ENTRY;
 
 	if (exp->exp_obd->obd_recovering ||
@@ -1366,21 +1697,23 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 	/* protect all grant counters */
 	spin_lock(&tgd->tgd_grant_lock);
 
+	/* Grab free space from cached statfs data and take out space
+	 * already granted to clients as well as reserved space */
+	left = tgt_grant_space_left(exp);
+
+	tgs = tgt_grant_shard_lock(tgd);
+	spin_lock(&ted->ted_grant_lock);
+
 	/* fail precreate request if there is not enough blocks available for
 	 * writing */
 	if (tgd->tgd_osfs.os_bavail - (ted->ted_grant >> tgd->tgd_blockbits) <
 	    (tgd->tgd_osfs.os_blocks >> 10)) {
-		spin_unlock(&tgd->tgd_grant_lock);
 		CDEBUG(D_RPCTRACE, "%s: not enough space for create %llu\n",
 		       exp->exp_obd->obd_name,
 		       tgd->tgd_osfs.os_bavail * tgd->tgd_osfs.os_blocks);
-		RETURN(-ENOSPC);
+		GOTO(out, rc = -ENOSPC);
 	}
 
-	/* Grab free space from cached statfs data and take out space
-	 * already granted to clients as well as reserved space */
-	left = tgt_grant_space_left(exp);
-
 	/* compute how much space is required to handle the precreation
 	 * request */
 	wanted = *nr * lut->lut_dt_conf.ddp_inodespace;
@@ -1392,8 +1725,7 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 		if (*nr == 0) {
 			/* we really have no space any more for precreation,
 			 * fail the precreate request with ENOSPC */
-			spin_unlock(&tgd->tgd_grant_lock);
-			RETURN(-ENOSPC);
+			GOTO(out, rc = -ENOSPC);
 		}
 		/* compute space needed for the new number of creations */
 		wanted = *nr * lut->lut_dt_conf.ddp_inodespace;
@@ -1405,13 +1737,13 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 		ted->ted_grant -= wanted;
 	} else {
 		/* we need to take some space from the ungranted pool */
-		tgd->tgd_tot_granted += wanted - ted->ted_grant;
+		tgs->tgs_granted += wanted - ted->ted_grant;
 		left -= wanted - ted->ted_grant;
 		ted->ted_grant = 0;
 	}
 	granted = wanted;
 	ted->ted_pending += granted;
-	tgd->tgd_tot_pending += granted;
+	tgs->tgs_pending += granted;
 
 	/* grant more space for precreate purpose if possible. */
 	wanted = OST_MAX_PRECREATE * lut->lut_dt_conf.ddp_inodespace / 2;
@@ -1422,11 +1754,16 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 		 * request */
 		chunk = tgt_grant_chunk(exp, lut, NULL);
 		wanted -= ted->ted_grant;
-		tgt_grant_alloc(exp, ted->ted_grant, wanted, left, chunk,
-				false);
+		tgt_grant_alloc(exp, tgs, ted->ted_grant, wanted, left, chunk,
+				false, false);
 	}
+	rc = granted;
+	EXIT;
+out:
+	spin_unlock(&ted->ted_grant_lock);
+	spin_unlock(&tgs->tgs_lock);
 	spin_unlock(&tgd->tgd_grant_lock);
-	RETURN(granted);
+	return rc;
 }
 EXPORT_SYMBOL(tgt_grant_create);
 
@@ -1443,6 +1780,9 @@ void tgt_grant_commit(struct obd_export *exp, unsigned long pending,
 		      int rc)
 {
 	struct tg_grants_data *tgd = &obd2obt(exp->exp_obd)->obt_lut->lut_tgd;
+	struct tg_export_data *ted = &exp->exp_target_data;
+	struct tg_grant_shard *tgs;
+	bool locked;
 
 	ENTRY;
 
@@ -1451,13 +1791,16 @@ void tgt_grant_commit(struct obd_export *exp, unsigned long pending,
 	if (pending == 0)
 		RETURN_EXIT;
 
-	spin_lock(&tgd->tgd_grant_lock);
 	/* Don't update statfs data for errors raised before commit (e.g.
 	 * bulk transfer failed, ...) since we know those writes have not been
 	 * processed. For other errors hit during commit, we cannot really tell
 	 * whether or not something was written, so we update statfs data.
 	 * In any case, this should not be fatal since we always get fresh
-	 * statfs data before failing a request with ENOSPC */
+	 * statfs data before failing a request with ENOSPC.
+	 * This is done before releasing the grant, so that
+	 * tgt_grant_space_left() can count the written space twice, but never
+	 * miss it.
+	 */
 	if (rc == 0) {
 		spin_lock(&tgd->tgd_osfs_lock);
 		/* Take pending out of cached statfs data */
@@ -1471,33 +1814,28 @@ void tgt_grant_commit(struct obd_export *exp, unsigned long pending,
 		spin_unlock(&tgd->tgd_osfs_lock);
 	}
 
-	if (exp->exp_target_data.ted_pending < pending) {
+	/* tot_granted and tot_pending include ted_pending of all the exports,
+	 * so checking the latter is enough
+	 */
+	tgs = tgt_grant_shard_lock_fast(tgd, &locked);
+	spin_lock(&ted->ted_grant_lock);
+	if (ted->ted_pending < pending) {
 		CERROR("%s: cli %s/%p ted_pending(%lu) < grant_used(%lu)\n",
 		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       exp->exp_target_data.ted_pending, pending);
-		spin_unlock(&tgd->tgd_grant_lock);
-		LBUG();
-	}
-	exp->exp_target_data.ted_pending -= pending;
-
-	if (tgd->tgd_tot_granted < pending) {
-		CERROR("%s: cli %s/%p tot_granted(%llu) < grant_used(%lu)\n",
-		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       tgd->tgd_tot_granted, pending);
-		spin_unlock(&tgd->tgd_grant_lock);
+		       ted->ted_pending, pending);
+		spin_unlock(&ted->ted_grant_lock);
+		spin_unlock(&tgs->tgs_lock);
+		if (locked)
+			spin_unlock(&tgd->tgd_grant_lock);
 		LBUG();
 	}
-	tgd->tgd_tot_granted -= pending;
-
-	if (tgd->tgd_tot_pending < pending) {
-		CERROR("%s: cli %s/%p tot_pending(%llu) < grant_used(%lu)\n",
-		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       tgd->tgd_tot_pending, pending);
+	ted->ted_pending -= pending;
+	tgs->tgs_granted -= pending;
+	tgs->tgs_pending -= pending;
+	spin_unlock(&ted->ted_grant_lock);
+	spin_unlock(&tgs->tgs_lock);
+	if (locked)
 		spin_unlock(&tgd->tgd_grant_lock);
-		LBUG();
-	}
-	tgd->tgd_tot_pending -= pending;
-	spin_unlock(&tgd->tgd_grant_lock);
 	EXIT;
 }
 EXPORT_SYMBOL(tgt_grant_commit);
@@ -1590,10 +1928,11 @@ ssize_t tot_dirty_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct obd_device *obd = container_of(kobj, struct obd_device,
 					      obd_kset.kobj);
-	struct tg_grants_data *tgd;
+	u64 dirty, granted, pending;
 
-	tgd = &obd2obt(obd)->obt_lut->lut_tgd;
-	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_dirty);
+	tgt_grant_totals(&obd2obt(obd)->obt_lut->lut_tgd, &dirty, &granted,
+			 &pending);
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", dirty);
 }
 EXPORT_SYMBOL(tot_dirty_show);
 
@@ -1612,10 +1951,11 @@ ssize_t tot_granted_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct obd_device *obd = container_of(kobj, struct obd_device,
 					      obd_kset.kobj);
-	struct tg_grants_data *tgd;
+	u64 dirty, granted, pending;
 
-	tgd = &obd2obt(obd)->obt_lut->lut_tgd;
-	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_granted);
+	tgt_grant_totals(&obd2obt(obd)->obt_lut->lut_tgd, &dirty, &granted,
+			 &pending);
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", granted);
 }
 EXPORT_SYMBOL(tot_granted_show);
 
@@ -1634,10 +1974,11 @@ ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct obd_device *obd = container_of(kobj, struct obd_device,
 					      obd_kset.kobj);
-	struct tg_grants_data *tgd;
+	u64 dirty, granted, pending;
 
-	tgd = &obd2obt(obd)->obt_lut->lut_tgd;
-	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_pending);
+	tgt_grant_totals(&obd2obt(obd)->obt_lut->lut_tgd, &dirty, &granted,
+			 &pending);
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", pending);
 }
 EXPORT_SYMBOL(tot_pending_show);
 
@@ -412,6 +412,7 @@ int tgt_client_alloc(struct obd_export *exp)
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_nodemap_member);
 	spin_lock_init(&exp->exp_target_data.ted_fmd_lock);
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_fmd_list);
+	spin_lock_init(&exp->exp_target_data.ted_grant_lock);
 
 	OBD_ALLOC_PTR(exp->exp_target_data.ted_lcd);
 	if (exp->exp_target_data.ted_lcd == NULL)
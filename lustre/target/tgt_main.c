@@ -537,6 +537,14 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	tgd->tgd_tot_granted = 0;
 	tgd->tgd_tot_pending = 0;
 	tgd->tgd_grant_compat_disable = 0;
+	tgd->tgd_grant_frozen = false;
+	tgd->tgd_grant_shards = alloc_percpu(struct tg_grant_shard);
+	if (!tgd->tgd_grant_shards)
+		GOTO(out_put, rc = -ENOMEM);
+	for_each_possible_cpu(i)
+		spin_lock_init(&per_cpu_ptr(tgd->tgd_grant_shards,
+					    i)->tgs_lock);
+	spin_lock_init(&obd->obd_self_export->exp_target_data.ted_grant_lock);
 
 	/* populate cached statfs data */
 	osfs = &tgt_th_info(env)->tti_u.osfs;
@@ -558,7 +566,7 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 
 	OBD_ALLOC(lut->lut_client_bitmap, LR_MAX_CLIENTS >> 3);
 	if (lut->lut_client_bitmap == NULL)
-		RETURN(-ENOMEM);
+		GOTO(out_put, rc = -ENOMEM);
 
 	memset(&attr, 0, sizeof(attr));
 	attr.la_valid = LA_MODE;
@@ -638,6 +646,8 @@ out_put:
 	if (lut->lut_client_bitmap != NULL)
 		OBD_FREE(lut->lut_client_bitmap, LR_MAX_CLIENTS >> 3);
 	lut->lut_client_bitmap = NULL;
+	free_percpu(tgd->tgd_grant_shards);
+	tgd->tgd_grant_shards = NULL;
 	if (lut->lut_reply_data != NULL)
 		dt_object_put(env, lut->lut_reply_data);
 	lut->lut_reply_data = NULL;
@@ -701,6 +711,8 @@ void tgt_fini(const struct lu_env *env, struct lu_target *lut)
 		dt_object_put(env, lut->lut_last_rcvd);
 		lut->lut_last_rcvd = NULL;
 	}
+	free_percpu(lut->lut_tgd.tgd_grant_shards);
+	lut->lut_tgd.tgd_grant_shards = NULL;
 	EXIT;
 }
 EXPORT_SYMBOL(tgt_fini);
@@ -150,6 +150,65 @@ out_put:
 	return rc;
 }
 
+/* number of split update records added to the update llog at once */
+#define SUB_UPDATES_BATCH	4
+
+/**
+ * Add a batch of split update records to the update llog
+ *
+ * The cookies of the records which were added are linked to the
+ * sub thandle, even if adding the rest of the batch fails.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ctxt	update llog context
+ * \param[in] sub_th	sub transaction handle
+ * \param[in] count	number of records in \a recs
+ * \param[in] recs	update records being written
+ *
+ * \retval		0 if writing succeeds
+ * \retval		negative errno if writing fails
+ */
+static int sub_updates_write_batch(const struct lu_env *env,
+				   struct llog_ctxt *ctxt,
+				   struct sub_thandle *sub_th, int count,
+				   struct llog_rec_hdr **recs)
+{
+	struct sub_thandle_cookie *stc[SUB_UPDATES_BATCH] = { NULL };
+	struct llog_cookie cookies[SUB_UPDATES_BATCH];
+	int rc = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		OBD_ALLOC_PTR(stc[i]);
+		if (stc[i] == NULL)
+			GOTO(out_free, rc = -ENOMEM);
+		INIT_LIST_HEAD(&stc[i]->stc_list);
+	}
+
+	memset(cookies, 0, sizeof(cookies));
+	rc = llog_add_arr(env, ctxt->loc_handle, count, recs, cookies,
+			  sub_th->st_sub_th);
+
+	for (i = 0; i < count; i++) {
+		CDEBUG(D_INFO, "%s: Add update log "DFID".%u: rc = %d\n",
+		       sub_th->st_dt->dd_lu_dev.ld_obd->obd_name,
+		       PLOGID(&cookies[i].lgc_lgl), cookies[i].lgc_index, rc);
+
+		if (cookies[i].lgc_index == 0)
+			continue;
+		stc[i]->stc_cookie = cookies[i];
+		list_add(&stc[i]->stc_list, &sub_th->st_cookie_list);
+		stc[i] = NULL;
+	}
+
+out_free:
+	for (i = 0; i < count; i++)
+		if (stc[i] != NULL)
+			OBD_FREE_PTR(stc[i]);
+
+	return rc;
+}
+
 /**
  * write update to sub device
  *
@@ -171,7 +230,10 @@ static int sub_updates_write(const struct lu_env *env,
 {
 	struct dt_device *dt = sub_th->st_dt;
 	struct llog_ctxt *ctxt;
-	struct llog_update_record *lur = NULL;
+	struct llog_update_record *lur;
+	struct llog_rec_hdr *recs[SUB_UPDATES_BATCH];
+	char *buf = NULL;
+	int nr = 0;
 	__u32 update_count = 0;
 	__u32 param_count = 0;
 	__u32 last_update_count = 0;
@@ -237,11 +299,14 @@ static int sub_updates_write(const struct lu_env *env,
 		GOTO(llog_put, rc);
 	}
 
-	/* Split the records into chunk_size update record */
-	OBD_ALLOC_LARGE(lur, ctxt->loc_chunk_size);
-	if (lur == NULL)
+	/* Split the records into chunk_size update records, which are added
+	 * to the update llog by batches of SUB_UPDATES_BATCH records
+	 */
+	OBD_ALLOC_LARGE(buf, SUB_UPDATES_BATCH * ctxt->loc_chunk_size);
+	if (buf == NULL)
 		GOTO(llog_put, rc = -ENOMEM);
 
+	lur = (struct llog_update_record *)buf;
 	memcpy(lur, &record->lur_hdr, sizeof(record->lur_hdr));
 	lur->lur_update_rec.ur_update_count = 0;
 	lur->lur_update_rec.ur_param_count = 0;
@@ -287,38 +352,29 @@ static int sub_updates_write(const struct lu_env *env,
 
 		update_records_dump(&lur->lur_update_rec, D_INFO, true);
 
-		OBD_ALLOC_PTR(stc);
-		if (stc == NULL)
-			GOTO(llog_put, rc = -ENOMEM);
-		INIT_LIST_HEAD(&stc->stc_list);
-
-		rc = llog_add(env, ctxt->loc_handle, &lur->lur_hdr,
-			      &stc->stc_cookie, sub_th->st_sub_th);
-
-		CDEBUG(D_INFO, "%s: Add update log "DFID".%u: rc = %d\n",
-			dt->dd_lu_dev.ld_obd->obd_name,
-			PLOGID(&stc->stc_cookie.lgc_lgl),
-			stc->stc_cookie.lgc_index, rc);
-
-		if (rc > 0) {
-			list_add(&stc->stc_list, &sub_th->st_cookie_list);
-			rc = 0;
-		} else {
-			OBD_FREE_PTR(stc);
-			GOTO(llog_put, rc);
+		recs[nr++] = &lur->lur_hdr;
+		if (nr == SUB_UPDATES_BATCH || eof) {
+			rc = sub_updates_write_batch(env, ctxt, sub_th, nr,
+						     recs);
+			if (rc < 0)
+				GOTO(llog_put, rc);
+			nr = 0;
 		}
 
 		last_update_count = update_count;
 		last_param_count = param_count;
 		start = cur;
+		lur = (struct llog_update_record *)(buf +
+						    nr * ctxt->loc_chunk_size);
+		memcpy(lur, &record->lur_hdr, sizeof(record->lur_hdr));
 		lur->lur_update_rec.ur_update_count = 0;
 		lur->lur_update_rec.ur_param_count = 0;
 		lur->lur_update_rec.ur_flags |= UPDATE_RECORD_CONTINUE;
 	} while (!eof);
 
 llog_put:
-	if (lur != NULL)
-		OBD_FREE_LARGE(lur, ctxt->loc_chunk_size);
+	if (buf != NULL)
+		OBD_FREE_LARGE(buf, SUB_UPDATES_BATCH * ctxt->loc_chunk_size);
 	llog_ctxt_put(ctxt);
 
 	RETURN(rc);
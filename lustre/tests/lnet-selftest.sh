@@ -32,6 +32,8 @@ lst_TESTS=${lst_TESTS:-"write read ping"}
 # "full" -> LST_BRW_CHECK_FULL
 # "simple" -> LST_BRW_CHECK_SIMPLE
 lst_CHECK=${lst_CHECK:-"full"}
+# checksum type of the stream test
+lst_CKSUM=${lst_CKSUM:-"crc32c"}
 
 lst_FROM=${lst_FROM:-"cs"}
 
@@ -134,6 +136,10 @@ test_smoke_sub () {
 							" $check size=$s";;
 						ping)
 							echo -n $t;;
+						stream)
+							echo -n "$t size=$s" \
+							"read=50" \
+							"cksum=$lst_CKSUM";;
 						*) error Unknonwn LST test;;
 					esac
 					echo
@@ -198,6 +204,12 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+test_stream () {
+	lst_TESTS="stream" lst_SIZES="${lst_STREAM_SIZES:-64k-16M 16M}" \
+		test_smoke
+}
+run_test stream "lst streaming bulk test with checksums"
+
 complete_test $SECONDS
 _restore_mount
 check_and_cleanup_lustre
@@ -678,6 +678,42 @@ test_9() {
 }
 run_test 9 "Replicate recursive directory removal"
 
+test_10() {
+	init_src
+	init_changelog
+
+	local i
+	local j
+
+	for i in 1 2 3 4; do
+		mkdir $DIR/$tdir/d$i
+		for j in 1 2 3 4; do
+			mkdir $DIR/$tdir/d$i/d$i$j
+			createmany -o $DIR/$tdir/d$i/d$i$j/f 20 > /dev/null
+			dd if=/dev/urandom of=$DIR/$tdir/d$i/d$i$j/data \
+				bs=64k count=$((i * j)) 2> /dev/null
+			ln $DIR/$tdir/d$i/d$i$j/f0 $DIR/$tdir/d$i/d$i$j/l0
+			unlinkmany $DIR/$tdir/d$i/d$i$j/f 10 10 > /dev/null
+			chmod 600 $DIR/$tdir/d$i/d$i$j/f1
+		done
+		mv $DIR/$tdir/d$i/d${i}1 $DIR/$tdir/d$i/m${i}1
+		rm -rf $DIR/$tdir/d$i/d${i}2
+		createmany -o $DIR/$tdir/d$i/m${i}1/g 10 > /dev/null
+	done
+
+	local LRSYNC_LOG=$(generate_logname "lrsync_log")
+	$LRSYNC -s $DIR -t $TGT -t $TGT2 -m $MDT0 -u $CL_USER -l $LREPL_LOG \
+		-D $LRSYNC_LOG --threads 8
+
+	check_diff ${DIR}/$tdir $TGT/$tdir
+	check_diff ${DIR}/$tdir $TGT2/$tdir
+
+	fini_changelog
+	cleanup_src_tgt
+	return 0
+}
+run_test 10 "Replicate with multiple worker threads"
+
 cd $ORIG_PWD
 complete_test $SECONDS
 check_and_cleanup_lustre
@@ -3494,6 +3494,176 @@ test_232() {
 }
 run_test 232 "Test setting ToS value"
 
+lnet_stats_bytes() {
+	$LNETCTL stats show |
+		awk '/send_length:/ || /recv_length:/ { sum += $2 }
+		     END { print sum + 0 }'
+}
+
+# user + nice + system + irq + softirq ticks of all CPUs
+cpu_busy_ticks() {
+	awk '/^cpu / { print $2 + $3 + $4 + $7 + $8 }' /proc/stat
+}
+
+test_233() {
+	[[ ${NETTYPE} == tcp* ]] || skip "Need tcp NETTYPE"
+
+	# sends to a local NID always go through the loopback LND, so this
+	# needs a remote node
+	setup_health_test false || return $?
+
+	local param=/sys/module/ksocklnd/parameters/zc_msg_zerocopy
+
+	if [[ ! -f $param ]]; then
+		cleanup_health_test || return $?
+		skip "ksocklnd without MSG_ZEROCOPY support"
+	fi
+
+	local hz=$(getconf CLK_TCK)
+	local zc bytes0 bytes1 ticks0 ticks1
+
+	do_rpc_nodes $HOSTNAME,$RNODE load_module \
+		../lnet/selftest/lnet_selftest ||
+			error "Failed to load lnet-selftest module"
+
+	for zc in 0 1; do
+		echo $zc > $param
+
+		bytes0=$(lnet_stats_bytes)
+		ticks0=$(cpu_busy_ticks)
+		$LSTSH -H -f $HOSTNAME -t $RNODE -m write -D 10 -n 1 ||
+			error "lst failed with zc_msg_zerocopy=$zc"
+		ticks1=$(cpu_busy_ticks)
+		bytes1=$(lnet_stats_bytes)
+
+		awk -v zc=$zc -v b=$((bytes1 - bytes0)) \
+		    -v t=$((ticks1 - ticks0)) -v hz=$hz 'BEGIN {
+			gb = b / 2^30
+			printf("zc_msg_zerocopy=%d: %.2f GiB, %.1f MiB/s, ",
+			       zc, gb, b / 2^20 / 10)
+			printf("%.3f CPU seconds/GiB\n",
+			       gb > 0 ? t / hz / gb : 0)
+		}'
+		(( bytes1 > bytes0 )) ||
+			error "no data moved with zc_msg_zerocopy=$zc"
+	done
+
+	cleanup_health_test || return $?
+}
+run_test 233 "socklnd CPU per GiB with and without MSG_ZEROCOPY"
+
+test_234() {
+	[[ ${NETTYPE} == tcp* ]] || skip "Need tcp NETTYPE"
+
+	setup_health_test false || return $?
+
+	local params=/sys/module/ksocklnd/parameters
+	local busy_poll=$(cat $params/busy_poll)
+	local usecs p99 polls
+	local -A p99s
+
+	stack_trap "[[ ! -e $params/busy_poll ]] ||
+		echo $busy_poll > $params/busy_poll"
+
+	do_rpc_nodes $HOSTNAME,$RNODE load_module \
+		../lnet/selftest/lnet_selftest ||
+			error "Failed to load lnet-selftest module"
+
+	for usecs in 0 50; do
+		echo $usecs > $params/busy_poll
+		echo 0 > $params/rx_latency
+
+		$LSTSH -H -f $HOSTNAME -t $RNODE -m ping -D 10 -n 1 ||
+			error "lst failed with busy_poll=$usecs"
+
+		cat $params/rx_latency
+		# lower bound of the bucket holding the 99th percentile
+		p99=$(awk '/^[0-9]/ { usec[n] = $1; cnt[n++] = $2; sum += $2 }
+			   END {
+				for (i = 0; i < n; i++) {
+					acc += cnt[i]
+					if (sum > 0 && acc >= sum * 0.99) {
+						print usec[i]
+						exit
+					}
+				}
+			   }' $params/rx_latency)
+		echo "busy_poll=$usecs: p99 scheduler wakeup >= $p99 usecs"
+		[[ -n $p99 ]] || error "no receives with busy_poll=$usecs"
+		p99s[$usecs]=$p99
+
+		polls=$(awk '/^busy_poll_(hits|misses):/ { n += $2 }
+			     END { print n + 0 }' $params/rx_latency)
+		if (( usecs == 0 )); then
+			(( polls == 0 )) ||
+				error "$polls busy polls with busy_poll=0"
+		else
+			(( polls > 0 )) ||
+				error "no busy polls with busy_poll=$usecs"
+		fi
+	done
+
+	# polling must not push wakeups out by more than one log2 bucket
+	(( ${p99s[50]} <= 2 * ${p99s[0]} || ${p99s[50]} <= 1 )) ||
+		error "p99 ${p99s[50]} usecs with busy_poll, ${p99s[0]} without"
+
+	cleanup_health_test || return $?
+}
+run_test 234 "socklnd busy poll scheduler wakeup latency"
+
+test_235() {
+	setup_health_test true || return $?
+
+	local nid rtt val total
+	local -A sends
+
+	(( ${#LNIDS[@]} > 1 )) || skip "Need more than one local NI"
+
+	val=$($LNETCTL global show | awk '/select_policy/{print $NF}')
+	[[ $val -eq 0 ]] || error "Expect select_policy 0 found $val"
+	stack_trap "[[ ! -d /sys/module/lnet ]] ||
+		do_lnetctl set select_policy $val"
+
+	do_lnetctl set select_policy 2 &&
+		error "select_policy 2 should have failed"
+	do_lnetctl set select_policy 1 ||
+		error "Failed to set select_policy"
+	$LNETCTL global show | grep -q "select_policy: 1" ||
+		error "select_policy is not 1"
+
+	do_rpc_nodes $HOSTNAME,$RNODE load_module \
+		../lnet/selftest/lnet_selftest ||
+			error "Failed to load lnet-selftest module"
+
+	for nid in ${LNIDS[@]}; do
+		sends[$nid]=$(get_ni_stat $nid send_count)
+	done
+
+	$LSTSH -H -f $HOSTNAME -t $RNODE -m write -s 1M -D 10 -n 1 ||
+		error "lst failed with select_policy=1"
+
+	# every local NI was tried and has a latency estimate
+	total=0
+	for nid in ${LNIDS[@]}; do
+		rtt=$($LNETCTL net show -v 3 |
+		      awk '/nid:/{ nid = $NF }
+			   /rtt_us:/{ if (nid == "'$nid'") print $NF }')
+		sends[$nid]=$(( $(get_ni_stat $nid send_count) - sends[$nid] ))
+		total=$((total + sends[$nid]))
+		echo "$nid rtt_us $rtt sends ${sends[$nid]}"
+		[[ -n $rtt && $rtt -gt 0 ]] || error "no rtt_us for $nid"
+	done
+
+	# the NIs are weighted by latency, but none is starved
+	for nid in ${LNIDS[@]}; do
+		(( sends[$nid] * 20 >= total )) ||
+			error "$nid sent ${sends[$nid]} of $total messages"
+	done
+
+	cleanup_health_test || return $?
+}
+run_test 235 "latency select policy spreads traffic over NIs"
+
 ### Test that linux route is added for each ni
 test_250() {
 	local skip_param
@@ -4102,6 +4272,50 @@ test_402() {
 }
 run_test 402 "Destination net rule should not panic"
 
+udsp_stat() {
+	awk -v name="$1:" '$1 == name { print $2 }' \
+		/sys/kernel/debug/lnet/udsp_stats
+}
+
+test_403() {
+	local stats=/sys/kernel/debug/lnet/udsp_stats
+	local npeers=300
+	local nid
+	local i
+
+	reinit_dlc || return $?
+
+	[[ -r $stats ]] || skip "no $stats"
+
+	for ((i = 0; i < npeers; i++)); do
+		nid=10.40.$((i / 200)).$((i % 200 + 1))@tcp
+		do_lnetctl peer add --prim $nid || error "Failed to add $nid"
+	done
+
+	echo 0 > $stats
+	do_lnetctl udsp add --dst 10.40.0.[1-99]@tcp --priority 2 ||
+		error "Failed to add UDSP rule"
+	cat $stats
+
+	check_peer_udsp_prio "" "10.40.0.5@tcp" "-1" "2"
+	check_peer_udsp_prio "" "10.40.0.150@tcp" "-1" "-1"
+	check_peer_udsp_prio "" "10.40.1.5@tcp" "-1" "-1"
+
+	(( $(udsp_stat lpni_matched) == 99 )) ||
+		error "expected 99 peer NIs matched"
+	(( $(udsp_stat slow_matches) == 0 )) ||
+		error "rule not compiled"
+	(( $(udsp_stat lock_breaks) > 0 )) ||
+		error "net lock not released over $npeers peers"
+
+	do_lnetctl udsp del --idx 0 ||
+		error "Failed to delete UDSP rule"
+	check_peer_udsp_prio "" "10.40.0.5@tcp" "-1" "-1"
+
+	return 0
+}
+run_test 403 "UDSP rule applied to the matched peers only"
+
 test_500() {
 	reinit_dlc || return $?
 
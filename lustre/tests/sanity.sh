@@ -9173,6 +9173,34 @@ test_56eg() {
 }
 run_test 56eg "lfs find -xattr"
 
+test_56eh() {
+	local dir=$DIR/$tdir
+	local serial
+	local threaded
+	local t
+
+	$LFS find --help 2>&1 | grep -q -- "--threads" ||
+		skip "lfs find does not support --threads"
+
+	test_mkdir -c $MDSCOUNT $dir
+	for i in $(seq 4); do
+		setup_56 $dir/d$i $NUMFILES $NUMDIRS "-c 1" "-c $MDSCOUNT"
+	done
+
+	serial=$($LFS find $dir -type f -size -1M | sort | md5sum)
+	for t in 2 4 16; do
+		threaded=$($LFS find $dir --threads $t -type f -size -1M |
+			   sort | md5sum)
+		[[ "$threaded" == "$serial" ]] ||
+			error "lfs find --threads $t output differs"
+
+		(( $($LFS find $dir --threads $t -maxdepth 2 | wc -l) ==
+		   $($LFS find $dir -maxdepth 2 | wc -l) )) ||
+			error "lfs find --threads $t -maxdepth 2 differs"
+	done
+}
+run_test 56eh "lfs find --threads matches the single threaded walk"
+
 test_57a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	# note test will not do anything if MDS is not local
@@ -9631,6 +9659,32 @@ test_60j() {
 }
 run_test 60j "llog_reader reports corruptions"
 
+test_60k() {
+	[ -f /sys/module/libcfs/parameters/libcfs_debug_deferred ] ||
+		skip "no deferred debug log formatting"
+
+	local old_debug=$($LCTL get_param -n debug)
+	local old_deferred=$($LCTL get_param -n debug_deferred)
+
+	stack_trap "$LCTL set_param debug='$old_debug'"
+	stack_trap "$LCTL set_param debug_deferred=$old_deferred"
+	stack_trap "rm -f $TMP/$tfile.log"
+
+	$LCTL set_param debug=+rpctrace debug_deferred=1
+	$LCTL clear
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 conv=fsync ||
+		error "dd failed"
+	cancel_lru_locks osc
+	$LCTL dk > $TMP/$tfile.log
+
+	grep -q "Completed RPC pname:cluuid:pid:xid:nid:opc:job" \
+		$TMP/$tfile.log || error "no RPC messages in the debug log"
+	grep "RPC req@" $TMP/$tfile.log | grep "%" &&
+		error "deferred RPC messages not formatted"
+	true
+}
+run_test 60k "deferred debug log formatting"
+
 test_61a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -10076,6 +10130,46 @@ test_64i() {
 }
 run_test 64i "shrink on reconnect"
 
+test_64j() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OSTs with nodsh"
+
+	local nproc=8
+	local pids=()
+	local i
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	stack_trap "rm -rf $DIR/$tdir"
+
+	# small cached writes consume grant owned by the client, and are
+	# accounted without the global grant lock on the OST
+	for ((i = 0; i < nproc; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=4k count=512 \
+			2>/dev/null &
+		pids+=($!)
+	done
+	for i in ${pids[@]}; do
+		wait $i || error "dd $i failed"
+	done
+	sync
+
+	# grant is released by the commit callbacks
+	wait_update_facet ost1 \
+		"$LCTL get_param -n obdfilter.*OST0000*.tot_pending" 0 30 ||
+		error "tot_pending not released after sync"
+
+	# statfs runs tgt_grant_sanity_check() on the OST
+	$LFS df $DIR > /dev/null || error "lfs df failed"
+
+	local testid=$(echo $TESTNAME | tr '_' ' ')
+
+	do_facet ost1 dmesg | tac | sed "/$testid/,$ d" |
+		grep -E "tot_(granted|pending|dirty) [0-9]+ (!=|>|<)" &&
+		error "grant accounting mismatch" || true
+}
+run_test 64j "grant accounting of parallel cached writes"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -12003,6 +12097,60 @@ test_101m()
 }
 run_test 101m "read ahead for small file and last stripe of the file"
 
+test_101n() {
+	local file=$DIR/$tfile
+	local chunk=$((64 * 1024))
+	local old_predict
+	local base
+	local off
+	local out
+	local pred
+
+	old_predict=$($LCTL get_param -n llite.*.read_ahead_predict |
+		      head -n 1) || skip "no readahead predictors"
+	$LCTL set_param llite.*.read_ahead_predict=all
+	stack_trap "$LCTL set_param llite.*.read_ahead_predict='$old_predict'"
+
+	$LFS setstripe -c 1 -i 0 $file || error "setstripe $file failed"
+	stack_trap "rm -f $file"
+	dd if=/dev/zero of=$file bs=1M count=64 || error "write $file failed"
+	cancel_lru_locks osc
+
+	# 3 reads per 2MiB cycle, each by a new open of the file
+	for ((base = 0; base < 32 * 1048576; base += 2097152)); do
+		for off in 0 262144 393216; do
+			dd if=$file of=/dev/null bs=$chunk count=1 \
+				skip=$(((base + off) / chunk)) 2>/dev/null ||
+				error "read $file at $((base + off)) failed"
+		done
+	done
+	out=$($LFS ra_stats $file) || error "ra_stats $file failed"
+	echo "$out"
+	grep -q "pattern: multi_stride" <<< "$out" ||
+		error "multi_stride pattern not detected"
+	pred=$(awk '/^predictions:/ { print $2 }' <<< "$out")
+	(( pred > 0 )) || error "multi_stride reads were not predicted"
+
+	# shuffled 1MiB records, each read in 4 pieces
+	cancel_lru_locks osc
+	for base in 39 35 44 32 41 37 46 34 43 33; do
+		for off in 0 1 2 3; do
+			dd if=$file of=/dev/null bs=256k count=1 \
+				skip=$((base * 4 + off)) 2>/dev/null ||
+				error "read $file record $base failed"
+		done
+	done
+	out=$($LFS ra_stats $file) || error "ra_stats $file failed"
+	echo "$out"
+	grep -q "pattern: record" <<< "$out" ||
+		error "record pattern not detected"
+	grep -q "record_bytes: 1048576" <<< "$out" ||
+		error "wrong record size"
+	(( $(awk '/^predictions:/ { print $2 }' <<< "$out") > pred )) ||
+		error "records were not predicted"
+}
+run_test 101n "readahead predicts multi-stride and record reads"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -14197,6 +14345,41 @@ test_119m() {
 }
 run_test 119m "Test DIO readv/writev: exercise iter duplication"
 
+test_119n() {
+	[ "$ost1_FSTYPE" == ldiskfs ] || skip "ldiskfs only test"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local list=$(comma_list $(osts_nodes))
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+
+	save_lustre_params $(get_facets OST) \
+		"osd-ldiskfs.*.read_cache_enable" > $p
+	save_lustre_params $(get_facets OST) \
+		"osd-ldiskfs.*.writethrough_cache_enable" >> $p
+	stack_trap "restore_lustre_params < $p; rm -f $p" EXIT
+
+	# bulk IO goes through the OSD direct IO pages
+	set_osd_param $list '' read_cache_enable 0
+	set_osd_param $list '' writethrough_cache_enable 0
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=32 ||
+		error "cannot create $TMP/$tfile"
+	stack_trap "rm -f $TMP/$tfile"
+
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=16M oflag=direct ||
+		error "direct write of $DIR/$tfile failed"
+	# partial and unaligned bulks
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=12K seek=1001 skip=1001 count=7 \
+		conv=notrunc || error "write of $DIR/$tfile failed"
+	cancel_lru_locks osc
+
+	cmp $TMP/$tfile $DIR/$tfile || error "$DIR/$tfile is corrupted"
+	dd if=$DIR/$tfile of=/dev/null bs=16M iflag=direct ||
+		error "direct read of $DIR/$tfile failed"
+}
+run_test 119n "bulk IO with the OSD page cache disabled"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -16511,6 +16694,45 @@ test_133h() {
 }
 run_test 133h "Proc files should end with newlines"
 
+test_133i() {
+	[ "$ost1_FSTYPE" == ldiskfs ] || skip "ldiskfs only test"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local param="osd-ldiskfs.$FSNAME-OST0000.brw_stats"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	do_facet ost1 $LCTL set_param $param=0 || error "cannot clear $param"
+
+	# several MB per RPC, so mapping and IO of a write overlap
+	dd if=/dev/zero of=$DIR/$tfile bs=4M count=8 oflag=direct ||
+		error "dd to $DIR/$tfile failed"
+
+	local stats=$(do_facet ost1 $LCTL get_param -n $param)
+	local maps
+	local waits
+	local frags
+
+	echo "$stats" | grep -A 6 "commit map|wait msec"
+	# a 0 msec sample is still counted, so check every write was timed
+	read maps waits < <(echo "$stats" |
+		awk '/commit map\|wait msec/ { found = 1; next }
+		     found && /^[0-9]+:/ { m += $2; w += $6 }
+		     found && /^$/ { exit }
+		     END { print m + 0, w + 0 }')
+	(( maps >= 8 && waits >= 8 )) ||
+		error "$maps map and $waits wait times for 8 writes in $param"
+
+	# the mapped ranges of a 4MB write are submitted as separate bios
+	echo "$stats" | grep -A 6 "disk fragmented I/Os"
+	frags=$(echo "$stats" |
+		awk '/disk fragmented I\/Os/ { found = 1; next }
+		     found && /^[0-9]+:/ && $1 + 0 > 1 { n += $6 }
+		     found && /^$/ { exit }
+		     END { print n + 0 }')
+	(( frags > 0 )) || error "no write with several bios in $param"
+}
+run_test 133i "Verifying OST write commit map/wait stats"
+
 test_134a() {
 	remote_mds_nodsh && skip "remote MDS with nodsh"
 	[[ $MDS1_VERSION -lt $(version_code 2.7.54) ]] &&
@@ -19212,6 +19434,51 @@ test_160u() { # LU-17400
 }
 run_test 160u "changelog rename record type name and sname strings are correct"
 
+changelog_batch_stat() {
+	local stats=mdd.$FSNAME-MDT0000.changelog_batch_stats
+
+	do_facet mds1 $LCTL get_param -n $stats |
+		awk -v name="$1:" '$1 == name { print $2 }'
+}
+
+test_160v() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	(( MDS1_VERSION >= $(version_code 2.15.64) )) ||
+		skip "need MDS >= 2.15.64 for changelog_batch_stats"
+	[[ "$mds1_FSTYPE" == "ldiskfs" ]] ||
+		skip "changelog group commit is only done on ldiskfs"
+
+	local batches
+	local recs
+	local i
+
+	changelog_register || error "changelog_register failed"
+	test_mkdir -i 0 -c 1 $DIR/$tdir || error "mkdir $tdir failed"
+	for i in {1..8}; do
+		mkdir $DIR/$tdir/d$i || error "mkdir d$i failed"
+	done
+
+	batches=$(changelog_batch_stat batches)
+	recs=$(changelog_batch_stat batch_records)
+
+	#define OBD_FAIL_LLOG_CAT_ADD_DELAY	0x131e
+	do_facet mds1 $LCTL set_param fail_loc=0x131e fail_val=10
+	for i in {1..8}; do
+		createmany -o $DIR/$tdir/d$i/f 50 > /dev/null &
+	done
+	wait
+	do_facet mds1 $LCTL set_param fail_loc=0 fail_val=0
+
+	batches=$(( $(changelog_batch_stat batches) - batches ))
+	recs=$(( $(changelog_batch_stat batch_records) - recs ))
+	echo "$recs changelog records with $batches header writes"
+	(( recs >= 400 )) || error "only $recs changelog records added"
+	(( batches < recs )) ||
+		error "$recs records needed $batches header writes"
+}
+run_test 160v "concurrent changelog records share header writes"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -19890,6 +20157,47 @@ test_165f() {
 }
 run_test 165f "ofd_access_log_reader --exit-on-close works"
 
+test_165g() {
+	local trace="/tmp/${tfile}.rpc_trace"
+	local file="${DIR}/${tfile}"
+	local event
+	local line
+	local rc
+
+	do_facet ost1 "test -c /dev/lustre-rpc-trace" ||
+		skip "RPC trace unsupported"
+
+	$LFS setstripe -c 1 -i 0 "${file}" || error "setstripe failed"
+	do_facet ost1 rpc_trace_reader --info || error "rpc_trace_reader --info"
+
+	do_facet ost1 rpc_trace_reader > "${trace}" &
+	stack_trap "rm -f ${trace}"
+	sleep 2
+
+	dd if=/dev/zero of="${file}" bs=1M count=4 oflag=direct ||
+		error "cannot write '${file}'"
+
+	sleep 2
+	do_facet ost1 killall -INT rpc_trace_reader
+	wait
+	rc=$?
+	((rc == 0)) || error "rpc_trace_reader exited with rc = '${rc}'"
+
+	# the OST_WRITE RPCs have every server event
+	line=$(grep -m 1 " server .* opc 4 status 0:" "${trace}")
+	echo "${line}"
+	[[ -n "${line}" ]] || { cat "${trace}"; error "no OST_WRITE timeline"; }
+
+	for event in arrived nrs_queued nrs_dequeued handle_start bulk_start \
+		     bulk_end reply_sent handle_end; do
+		[[ "${line} " =~ " ${event} " ]] ||
+			error "no ${event} event in OST_WRITE timeline"
+	done
+	[[ "${line}" =~ "bulk_end "[0-9]+" 1048576B" ]] ||
+		error "wrong OST_WRITE bulk size"
+}
+run_test 165g "rpc_trace_reader prints the RPC timelines"
+
 test_169() {
 	# do directio so as not to populate the page cache
 	log "creating a 10 Mb file"
@@ -20124,6 +20432,62 @@ test_180c() { # LU-2598
 }
 run_test 180c "test huge bulk I/O size on obdfilter, don't LASSERT"
 
+test_180d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local nodes=$(comma_list $(facet_active_host ost1) $HOSTNAME)
+	local ost_nid=$(do_facet ost1 $LCTL list_nids | head -n 1)
+	local count=${RPC_RATE_COUNT:-20000}
+	local maxthr=$(nproc)
+	local thr t0 t1 rate
+	local rate1=0
+
+	do_rpc_nodes $nodes load_module obdecho/obdecho &&
+		stack_trap "do_nodes $nodes rmmod obdecho" EXIT ||
+		error "failed to load module obdecho"
+
+	# getattr RPCs from an echo client to an obdecho target on the OSS
+	do_facet ost1 "$LCTL attach obdecho echo_srv echo_srv_UUID" ||
+		error "cannot attach obdecho on ost1"
+	stack_trap "do_facet ost1 $LCTL --device echo_srv detach" EXIT
+	do_facet ost1 "$LCTL --device echo_srv setup" ||
+		error "cannot setup obdecho on ost1"
+	stack_trap "do_facet ost1 $LCTL --device echo_srv cleanup" EXIT
+
+	$LCTL add_uuid echo_UUID $ost_nid || error "cannot add echo_UUID"
+	stack_trap "$LCTL del_uuid echo_UUID" EXIT
+	$LCTL attach osc echo_osc echo_osc_UUID || error "cannot attach osc"
+	stack_trap "$LCTL --device echo_osc detach" EXIT
+	$LCTL --device echo_osc setup echo_srv_UUID echo_UUID ||
+		error "cannot setup osc"
+	stack_trap "$LCTL --device echo_osc cleanup" EXIT
+	$LCTL attach echo_client echo_ecc echo_ecc_UUID ||
+		error "cannot attach echo_client"
+	stack_trap "$LCTL --device echo_ecc detach" EXIT
+	$LCTL --device echo_ecc setup echo_osc ||
+		error "cannot setup echo_client"
+	stack_trap "$LCTL --device echo_ecc cleanup" EXIT
+
+	for ((thr = 1; thr <= maxthr; thr *= 2)); do
+		t0=$(date +%s.%N)
+		$LCTL --threads $thr q echo_ecc test_getattr $count q ||
+			error "test_getattr with $thr threads failed"
+		t1=$(date +%s.%N)
+		rate=$(awk "BEGIN { printf \"%d\", \
+			$thr * $count / ($t1 - $t0) }")
+		echo "threads: $thr RPCs: $((thr * count)) rate: $rate RPC/s"
+		(( thr == 1 )) && rate1=$rate
+	done
+
+	(( OST1_VERSION >= $(version_code 2.15.64) )) || return 0
+	# service threads no longer serialize on scp_req_lock to get the
+	# requests, so more client threads must not lower the RPC rate
+	(( maxthr == 1 || rate * 10 >= rate1 * 9 )) ||
+		error "$((thr / 2)) threads: $rate < 1 thread: $rate1 RPC/s"
+}
+run_test 180d "RPC rate scaling against obdecho"
+
 test_181() { # bug 22177
 	test_mkdir $DIR/$tdir
 	# create enough files to index the directory
@@ -21210,6 +21574,50 @@ test_205i() {
 }
 run_test 205i "check job_xattr parameter accepts and rejects values correctly"
 
+test_205j() {
+	local job_stats="mdt.$FSNAME-MDT0000.job_stats"
+	local -a cli_params
+	local p50 p99 p999
+
+	(( $MDS1_VERSION >= $(version_code 2.15.64) )) ||
+		skip "need MDS >= 2.15.64 for job_stats latency percentiles"
+
+	cli_params=( $($LCTL get_param jobid_name jobid_var) )
+	$LCTL set_param jobid_var=nodelocal jobid_name=205j.%e.%u
+	stack_trap "$LCTL set_param ${cli_params[*]}" EXIT
+
+	mkdir_on_mdt0 $DIR/$tdir || error "failed to create dir"
+	stack_trap "rm -rf $DIR/$tdir"
+	do_facet mds1 $LCTL set_param $job_stats=clear
+
+	createmany -o $DIR/$tdir/$tfile- 100 || error "createmany failed"
+
+	read p50 p99 p999 < <(do_facet mds1 $LCTL get_param -n $job_stats |
+		awk '/job_id:.*205j.createmany/ { found = 1; next }
+		     /job_id:/ { found = 0 }
+		     found && /^  open:/ {
+			for (i = 1; i < NF; i++)
+				if ($i ~ /^p[0-9]+:$/)
+					pct[$i] = $(i + 1) + 0
+			print pct["p50:"], pct["p99:"], pct["p999:"]
+		     }')
+
+	[[ -n "$p999" ]] || error "no latency percentiles for open"
+	(( p50 > 0 && p50 <= p99 && p99 <= p999 )) ||
+		error "bad open percentiles p50=$p50 p99=$p99 p999=$p999"
+	# reported values are the upper bounds of log2 buckets
+	(( (p99 & (p99 - 1)) == 0 )) || error "p99=$p99 not a power of two"
+	! do_facet mds1 $LCTL get_param -n $job_stats | grep -q "hist:" ||
+		error "job_stats should only print the latency percentiles"
+
+	verify_yaml_available || return 0
+	do_facet mds1 $LCTL get_param -n $job_stats | verify_yaml ||
+		error "job_stats with percentiles is not valid YAML"
+	do_facet mds1 "lljobstat -n 1 -i 0 -c 1000 -m -s p99" | verify_yaml ||
+		error "lljobstat --sort p99 output is not valid YAML"
+}
+run_test 205j "job_stats reports latency percentiles per operation"
+
 # LU-1480, LU-1773 and LU-1657
 test_206() {
 	mkdir -p $DIR/$tdir
@@ -27292,6 +27700,45 @@ run_test 300ui "overstripe is not supported on one MDT system"
 	do_nodes $mdts $LCTL set_param -n \
 		lod.$FSNAME-MDT*.max_stripes_per_mdt=$max_stripes_per_mdt
 
+update_log_batches() {
+	do_facet mds1 $LCTL get_param -n $1 |
+		awk '{ for (i = 1; i < NF; i++)
+			if ($i == "batches:") n += $(i + 1) }
+		     END { print n + 0 }'
+}
+
+test_300v() {
+	(( MDSCOUNT >= 2 )) || skip "needs >= 2 MDTs"
+	(( MDS1_VERSION >= $(version_code 2.15.64) )) ||
+		skip "need MDS >= 2.15.64 for update_log_stats"
+	large_xattr_enabled || skip_env "ea_inode feature disabled"
+	(( $(max_xattr_size) >= 40000 )) || skip_env "max_easize too small"
+
+	local stats=lod.$FSNAME-MDT0000-mdtlov.update_log_stats
+	local value
+	local before
+	local after
+
+	value=$(head -c 40000 /dev/zero | tr '\0' 'v')
+	$LFS mkdir -i 0 -c $MDSCOUNT $DIR/$tdir || error "mkdir $tdir failed"
+	before=$(update_log_batches $stats)
+
+	# the update record of this xattr on every stripe is several chunks
+	setfattr -n user.big -v $value $DIR/$tdir || error "setfattr failed"
+	[[ "$(get_xattr_value user.big $DIR/$tdir)" == "$value" ]] ||
+		error "wrong user.big value"
+
+	after=$(update_log_batches $stats)
+	do_facet mds1 $LCTL get_param $stats
+	(( after > before )) ||
+		error "split update record not batched: $before -> $after"
+
+	verify_yaml_available || return 0
+	do_facet mds1 $LCTL get_param -n $stats | verify_yaml ||
+		error "update_log_stats is not valid YAML"
+}
+run_test 300v "split update records are added to the update log in batches"
+
 prepare_remote_file() {
 	mkdir $DIR/$tdir/src_dir ||
 		error "create remote source failed"
@@ -31712,6 +32159,18 @@ test_807() {
 	check_lsom_data $DIR/$tdir/single_dd "(1)"
 	check_lsom_data $DIR/$tfile "(2)"
 
+	echo "Test SOM for many files synced by several threads"
+	for ((i = 0; i < 32; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/many_$i bs=4k \
+			count=$((i + 1)) 2>/dev/null ||
+			error "write $tdir/many_$i failed"
+	done
+	do_nodes "$CLIENTS" "sync ; sleep 5 ; sync"
+	$LSOM_SYNC -u $cl_user -m $FSNAME-MDT0000 --threads 4 $MOUNT
+	for ((i = 0; i < 32; i++)); do
+		check_lsom_data $DIR/$tdir/many_$i "(3)"
+	done
+
 	rm -rf $DIR/$tdir
 	# Deregistration step
 	changelog_deregister || error "changelog_deregister failed"
@@ -32370,6 +32829,52 @@ test_842() {
 }
 run_test 842 "Measure ldlm_extent performance"
 
+test_843() {
+	local now=$(date +%s)
+
+	load_module ec/ec || error "load_module ec failed"
+
+	# Results of the encode benchmark are left in dmesg
+	log "STAMP $now" > /dev/kmsg
+	load_module kunit/ec_test ||
+		error "ec_test failed, see dmesg for the mismatch"
+
+	dmesg | sed -n -e "1,/STAMP $now/d" -e '/ec_test:/p'
+	rmmod -v ec_test ||
+		error "rmmod failed (may trigger a failure in a later test)"
+}
+run_test 843 "Verify and measure erasure code encode implementations"
+
+test_844() {
+	local mds1=$(facet_host mds1)
+	local now=$(date +%s)
+
+	# Results of the lookup benchmark are left in dmesg
+	do_node $mds1 "echo STAMP $now > /dev/kmsg"
+	do_rpc_nodes $mds1 load_module kunit/ldlm_res_bench bench_secs=3 ||
+		error "$mds1 load_module ldlm_res_bench failed"
+
+	do_node $mds1 dmesg | sed -n -e "1,/STAMP $now/d" \
+		-e '/ldlm_res_bench:/p'
+	do_node $mds1 rmmod -v ldlm_res_bench ||
+		error "rmmod failed (may trigger a failure in a later test)"
+}
+run_test 844 "Measure ldlm resource lookup under contention"
+
+test_845() {
+	local now=$(date +%s)
+
+	# Results of the lookup benchmark are left in dmesg
+	log "STAMP $now" > /dev/kmsg
+	load_module kunit/fld_cache_bench bench_secs=3 ||
+		error "fld_cache_bench failed, see dmesg for the mismatch"
+
+	dmesg | sed -n -e "1,/STAMP $now/d" -e '/fld_cache_bench:/p'
+	rmmod -v fld_cache_bench ||
+		error "rmmod failed (may trigger a failure in a later test)"
+}
+run_test 845 "Verify and measure FLD cache lookups with 10k ranges"
+
 test_850() {
 	local dir=$DIR/$tdir
 	local file=$dir/$tfile
@@ -32685,6 +33190,39 @@ test_907() {
 }
 run_test 907 "write rpc error during unlink"
 
+test_908() {
+	grep -q io_uring_setup /proc/kallsyms ||
+		skip "Client OS does not support io_uring I/O engine"
+	io_uring_probe || skip "kernel does not support io_uring fully"
+	which fio || skip_env "no fio installed"
+	fio --enghelp | grep -q io_uring ||
+		skip_env "fio does not support io_uring I/O engine"
+	$LCTL get_param -n llite.*.nowait_io > /dev/null ||
+		skip "client does not support nowait_io"
+
+	local file=$DIR/$tfile
+	local nowait=$($LCTL get_param -n llite.*.nowait_io | head -n1)
+
+	stack_trap "$LCTL set_param -n llite.*.nowait_io=$nowait" EXIT
+	$LFS setstripe -c $OSTCOUNT $file || error "setstripe $file failed"
+
+	# DIO is submitted inline, buffered I/O falls back to the io_uring
+	# workers, both must return the data written
+	for val in 1 0; do
+		$LCTL set_param llite.*.nowait_io=$val
+		for direct in 1 0; do
+			echo "nowait_io=$val direct=$direct"
+			fio --name=randwrite --ioengine=io_uring \
+				--direct=$direct --bs=$PAGE_SIZE --iodepth=32 \
+				--size=16M --filename=$file --rw=randwrite \
+				--verify=crc32c --do_verify=1 ||
+				error "fio nowait_io=$val direct=$direct failed"
+		done
+	done
+	rm -f $file || error "rm -f $file failed"
+}
+run_test 908 "io_uring DIO with inline non-blocking submission"
+
 complete_test $SECONDS
 [ -f $EXT2_DEV ] && rm $EXT2_DEV || true
 check_and_cleanup_lustre
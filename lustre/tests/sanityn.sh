@@ -5117,6 +5117,149 @@ test_77r() { #LU-14976
 }
 run_test 77r "Change type of tbf policy at run time"
 
+# overwrite $1 with O_DIRECT writes of 16 RPCs each for $2 seconds, as $3
+hdrr_stream() {
+	local file=$1
+	local end=$((SECONDS + $2))
+	local myRUNAS="$3"
+
+	while (( SECONDS < end )); do
+		$myRUNAS dd if=/dev/zero of=$file bs=64M count=1 \
+			oflag=direct conv=notrunc 2>/dev/null || return 1
+	done
+}
+
+# number of writes completed by job $1 on OST0000
+hdrr_write_rpcs() {
+	do_facet ost1 $LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.job_stats |
+		awk -v job=$1 '$2 == "job_id:" { found = ($3 == job) }
+			       found && $1 == "write:" { n = $4 }
+			       END { print n + 0 }'
+}
+
+test_77s() {
+	local oss=$(comma_list $(osts_nodes))
+	local shares
+	local rc=0
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_policies="hdrr" ||
+		rc=$?
+	[[ $rc -eq 3 ]] && skip "no NRS exists"
+	[[ $rc -ne 0 ]] && skip "hdrr policy is not supported"
+	stack_trap "do_nodes $oss $LCTL set_param \
+		ost.OSS.ost_io.nrs_policies=fifo" EXIT
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_hdrr_quantum=65536 ||
+		error "failed to set hdrr quantum"
+	do_nodes $oss $LCTL set_param \
+		ost.OSS.ost_io.nrs_hdrr_shares="project 0 400" \
+		ost.OSS.ost_io.nrs_hdrr_shares="uid $RUNAS_ID 50" \
+		ost.OSS.ost_io.nrs_hdrr_shares="jobid dd.$RUNAS_ID 200" ||
+		error "failed to set hdrr shares"
+	do_nodes $oss $LCTL set_param \
+		ost.OSS.ost_io.nrs_hdrr_shares="uid $RUNAS_ID 0" &&
+		error "share 0 should be rejected"
+
+	shares=$(do_facet ost1 $LCTL get_param -n \
+		 ost.OSS.ost_io.nrs_hdrr_shares)
+	echo "$shares"
+	grep -q "^project 0 400$" <<< "$shares" ||
+		error "project share is missing"
+	grep -q "^uid $RUNAS_ID 50$" <<< "$shares" ||
+		error "uid share is missing"
+
+	echo "policy: hdrr, as root"
+	nrs_write_read
+	echo "policy: hdrr, as $RUNAS_ID"
+	nrs_write_read "$RUNAS"
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_hdrr_shares=clear ||
+		error "failed to clear hdrr shares"
+	shares=$(do_facet ost1 $LCTL get_param -n \
+		 ost.OSS.ost_io.nrs_hdrr_shares)
+	[[ "$shares" == "default 100" ]] ||
+		error "shares not cleared: $shares"
+	nrs_write_read
+
+	# With fewer I/O threads than RPCs in flight, requests queue up in
+	# the policy and the UIDs get the OST in proportion to their shares.
+	local dir=$DIR/$tdir
+	local secs=20
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local jobid_var
+	local threads
+	local pids
+	local pid
+	local root
+	local user
+	local alone
+
+	threads=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.threads_min)
+	(( threads <= 16 )) ||
+		skip_env "$threads ost_io threads would not queue requests"
+
+	jobid_var=$($LCTL get_param -n jobid_var)
+	if [[ $jobid_var != procname_uid ]]; then
+		set_persistent_param_and_check client \
+			"jobid_var" "$FSNAME.sys.jobid_var" procname_uid
+		stack_trap "set_persistent_param_and_check client \
+			jobid_var $FSNAME.sys.jobid_var $jobid_var"
+	fi
+
+	save_lustre_params client "osc.*OST0000*.max_rpcs_in_flight" > $p
+	save_lustre_params ost1 "ost.OSS.ost_io.threads_max" >> $p
+	stack_trap "restore_lustre_params < $p; rm -f $p"
+	$LCTL set_param osc.*OST0000*.max_rpcs_in_flight=64
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.threads_max=$threads
+
+	do_nodes $oss $LCTL set_param \
+		ost.OSS.ost_io.nrs_hdrr_shares="uid 0 300" \
+		ost.OSS.ost_io.nrs_hdrr_shares="uid $RUNAS_ID 100" ||
+		error "failed to set hdrr uid shares"
+	stack_trap "do_nodes $oss $LCTL set_param \
+		ost.OSS.ost_io.nrs_hdrr_shares=clear"
+
+	mkdir $dir || error "mkdir $dir failed"
+	stack_trap "rm -rf $dir"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	chmod 777 $dir
+
+	# two writers per UID, 32 RPCs in flight for each UID
+	do_facet ost1 $LCTL set_param obdfilter.*.job_stats=clear
+	pids=()
+	hdrr_stream $dir/root1 $secs & pids+=($!)
+	hdrr_stream $dir/root2 $secs & pids+=($!)
+	hdrr_stream $dir/user1 $secs "$RUNAS" & pids+=($!)
+	hdrr_stream $dir/user2 $secs "$RUNAS" & pids+=($!)
+	for pid in ${pids[@]}; do
+		wait $pid || error "weighted writer failed"
+	done
+
+	root=$(hdrr_write_rpcs dd.0)
+	user=$(hdrr_write_rpcs dd.$RUNAS_ID)
+	echo "weighted 300:100, writes: root $root, $RUNAS_ID $user"
+	(( root > 0 && user > 0 )) || error "both UIDs must make progress"
+	# all writes are the same size, so this is also the bandwidth ratio
+	(( root * 10 >= user * 20 && root * 10 <= user * 45 )) ||
+		error "write ratio $root:$user is not about 300:100"
+
+	# the idle UID leaves its share to the active one
+	do_facet ost1 $LCTL set_param obdfilter.*.job_stats=clear
+	pids=()
+	hdrr_stream $dir/user1 $secs "$RUNAS" & pids+=($!)
+	hdrr_stream $dir/user2 $secs "$RUNAS" & pids+=($!)
+	for pid in ${pids[@]}; do
+		wait $pid || error "single writer failed"
+	done
+
+	alone=$(hdrr_write_rpcs dd.$RUNAS_ID)
+	echo "$RUNAS_ID alone, writes: $alone"
+	(( alone * 10 >= (root + user) * 6 )) ||
+		error "$RUNAS_ID alone: $alone writes, both: $((root + user))"
+}
+run_test 77s "check HDRR NRS policy"
+
 test_78() { #LU-6673
 	local rc
 
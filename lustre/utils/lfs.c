@@ -125,6 +125,7 @@ static int lfs_ladvise(int argc, char **argv);
 static int lfs_getsom(int argc, char **argv);
 static int lfs_heat_get(int argc, char **argv);
 static int lfs_heat_set(int argc, char **argv);
+static int lfs_ra_stats(int argc, char **argv);
 static int lfs_mirror(int argc, char **argv);
 static inline int lfs_mirror_resync(int argc, char **argv);
 static inline int lfs_mirror_verify(int argc, char **argv);
@@ -398,8 +399,8 @@ command_t cmdlist[] = {
 	 "     [[!] --projid <projid>] [[!] --size|-s [+-]N[bkMGTPE]]\n"
 	 "     [[!] --stripe-count|-c [+-]<stripes>]\n"
 	 "     [[!] --stripe-index|-i <index,...>]\n"
-	 "     [[!] --stripe-size|-S [+-]N[kMGT]] [[!] --type|-t <filetype>]\n"
-	 "     [[!] --uid|-u|--user|-U <uid>|<uname>]\n"
+	 "     [[!] --stripe-size|-S [+-]N[kMGT]] [--threads <n>]\n"
+	 "     [[!] --type|-t <filetype>] [[!] --uid|-u|--user|-U <uid>|<uname>]\n"
 	 "\t !: used before an option indicates 'NOT' requested attribute\n"
 	 "\t -: used before a value indicates less than requested value\n"
 	 "\t +: used before a value indicates more than requested value\n"
@@ -549,6 +550,9 @@ command_t cmdlist[] = {
 	 "\t--clear|-c:	Clear file heat for given files\n"
 	 "\t--off|-o:	Turn off file heat for given files\n"
 	 "\t--on|-O:	Turn on file heat for given files\n"},
+	{"ra_stats", lfs_ra_stats, 0,
+	 "To get the read pattern and readahead statistics of files.\n"
+	 "usage: ra_stats <file> ...\n"},
 	{"pcc", lfs_pcc, pcc_cmdlist,
 	 "lfs commands used to interact with PCC features:\n"
 	 "lfs pcc attach - attach given files to Persistent Client Cache\n"
@@ -3502,7 +3506,8 @@ enum {
 	LFS_STATS_INTERVAL_OPT,
 	LFS_LINKS_OPT,
 	LFS_ATTRS_OPT,
-	LFS_XATTRS_MATCH_OPT
+	LFS_XATTRS_MATCH_OPT,
+	LFS_THREADS_OPT
 };
 
 #ifndef LCME_USER_MIRROR_FLAGS
@@ -5415,6 +5420,8 @@ static int lfs_find(int argc, char **argv)
 	{ .val = 'S',	.name = "stripe_size",	.has_arg = required_argument },
 	{ .val = 't',	.name = "type",		.has_arg = required_argument },
 	{ .val = 'T',	.name = "mdt-count",	.has_arg = required_argument },
+	{ .val = LFS_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "uid",		.has_arg = required_argument },
 	{ .val = 'U',	.name = "user",		.has_arg = required_argument },
 /* getstripe { .val = 'v', .name = "verbose",	.has_arg = no_argument }, */
@@ -6147,6 +6154,17 @@ err_free:
 				goto err;
 			}
 			break;
+		case LFS_THREADS_OPT:
+			errno = 0;
+			param.fp_threads = strtoul(optarg, &endptr, 0);
+			if (errno != 0 || *endptr != '\0' ||
+			    param.fp_threads == 0) {
+				fprintf(stderr, "error: bad threads '%s'\n",
+					optarg);
+				ret = -1;
+				goto err;
+			}
+			break;
 		case LFS_FIND_PERM:
 			param.fp_exclude_perm = !!neg_opt;
 			param.fp_perm_sign = LFS_FIND_PERM_EXACT;
@@ -11514,6 +11532,71 @@ next:
 	return rc;
 }
 
+static const char *const ra_pattern_names[] = LU_RA_PATTERN_NAMES;
+
+static int lfs_ra_stats(int argc, char **argv)
+{
+	struct lu_ra_stats stats;
+	int rc = 0, rc2;
+	char *path;
+	int fd;
+	int i;
+
+	if (argc <= 1)
+		return CMD_HELP;
+
+	optind = 1;
+	while (optind < argc) {
+		path = argv[optind++];
+
+		fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "%s: cannot open file '%s': %s\n",
+				argv[0], path, strerror(errno));
+			rc2 = -errno;
+			goto next;
+		}
+
+		rc2 = llapi_ra_stats_get(fd, &stats);
+		close(fd);
+		if (rc2 < 0) {
+			fprintf(stderr,
+				"%s: cannot get readahead stats of file '%s': %s\n",
+				argv[0], path, strerror(-rc2));
+			goto next;
+		}
+
+		if (argc > 2)
+			printf("%s:\n", path);
+		printf("pattern: %s\n", stats.lrs_pattern < LU_RA_PATTERN_MAX ?
+		       ra_pattern_names[stats.lrs_pattern] : "unknown");
+		if (stats.lrs_pattern == LU_RA_PATTERN_MULTI_STRIDE) {
+			printf("strides:");
+			for (i = 0; i < stats.lrs_period &&
+				    i < LU_RA_STRIDES_MAX; i++)
+				printf(" %lld",
+				       (long long)stats.lrs_strides[i]);
+			printf("\n");
+		} else if (stats.lrs_pattern == LU_RA_PATTERN_RECORD) {
+			printf("record_bytes: %llu\n",
+			       (unsigned long long)stats.lrs_record_bytes);
+		}
+		printf("requests: %llu\n",
+		       (unsigned long long)stats.lrs_requests);
+		printf("hits: %llu\n", (unsigned long long)stats.lrs_hits);
+		printf("misses: %llu\n", (unsigned long long)stats.lrs_misses);
+		printf("predictions: %llu\n",
+		       (unsigned long long)stats.lrs_predictions);
+		printf("predicted_pages: %llu\n",
+		       (unsigned long long)stats.lrs_predicted_pages);
+next:
+		if (rc == 0 && rc2 < 0)
+			rc = rc2;
+	}
+
+	return rc;
+}
+
 static int lfs_heat_set(int argc, char **argv)
 {
 	struct option long_opts[] = {
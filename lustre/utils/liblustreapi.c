@@ -1889,10 +1889,20 @@ retry_getfileinfo:
 	return ret;
 }
 
+struct find_worker;
+static int find_work_queue(struct find_worker *wk, const char *path,
+			   unsigned int depth, unsigned char type);
+
+/*
+ * Walk the tree below @path calling @sem_init and @sem_fini on each entry.
+ * Without @wk subdirectories are descended into recursively; with @wk they
+ * are queued for the parallel find walker instead, and the walk only covers
+ * the entries of @path itself.
+ */
 static int llapi_semantic_traverse(char *path, int size, int parent,
 				   semantic_func_t sem_init,
 				   semantic_func_t sem_fini, void *data,
-				   struct dirent64 *de)
+				   struct dirent64 *de, struct find_worker *wk)
 {
 	struct find_param *param = (struct find_param *)data;
 	struct dirent64 *dent;
@@ -2022,8 +2032,13 @@ static int llapi_semantic_traverse(char *path, int size, int parent,
 					  __func__, dent->d_name, dent->d_type);
 			break;
 		case DT_DIR:
-			rc = llapi_semantic_traverse(path, size, d, sem_init,
-						     sem_fini, data, dent);
+			if (wk)
+				rc = find_work_queue(wk, path, param->fp_depth,
+						     dent->d_type);
+			else
+				rc = llapi_semantic_traverse(path, size, d,
+							     sem_init, sem_fini,
+							     data, dent, NULL);
 			if (rc != 0 && ret == 0)
 				ret = rc;
 			if (rc < 0 && rc != -EALREADY &&
@@ -2089,7 +2104,7 @@ static int param_callback(char *path, semantic_func_t sem_init,
 	param->fp_depth = 0;
 
 	ret = llapi_semantic_traverse(buf, 2 * PATH_MAX, -1, sem_init,
-				      sem_fini, param, NULL);
+				      sem_fini, param, NULL, NULL);
 out:
 	find_param_fini(param);
 	free(buf);
@@ -4910,7 +4925,7 @@ static int printf_format_timestamp(char *seq, char *buffer, size_t size,
 				   int *wrote, struct find_param *param)
 {
 	struct statx_timestamp ts = { 0, 0 };
-	struct tm *tm;
+	struct tm tm;
 	time_t t;
 	int rc = 0;
 	char *fmt = "%c";  /* Print in ctime format by default */
@@ -4968,8 +4983,9 @@ static int printf_format_timestamp(char *seq, char *buffer, size_t size,
 	if (rc) {
 		/* Found valid format, print to buffer */
 		t = ts.tv_sec;
-		tm = localtime(&t);
-		*wrote = strftime(buffer, size, fmt, tm);
+		/* may be called from several lfs find threads at once */
+		localtime_r(&t, &tm);
+		*wrote = strftime(buffer, size, fmt, &tm);
 	}
 
 	return rc;
@@ -6379,10 +6395,355 @@ static void validate_printf_str(struct find_param *param)
 	}
 }
 
+/*
+ * Parallel directory walker for llapi_find() with fp_threads > 1.
+ *
+ * Each worker thread owns a queue of directories still to be read and a
+ * private copy of the find_param, so the find_check_* helpers and the
+ * per-file layout buffers are never shared.  A worker reads one directory
+ * at a time: files are checked and printed right away, subdirectories are
+ * pushed on the tail of its own queue and popped again from the tail, so
+ * each worker walks its part of the tree depth first.  A worker running out
+ * of work steals from the head of another queue, i.e. the oldest and
+ * usually largest subtree, which quickly spreads the walk of DNE striped
+ * directories and remote subdirectories over all threads and thus MDTs.
+ *
+ * Matching entries are printed as they are found, so the output order is
+ * not deterministic, but the set of entries printed is the same as with
+ * the single threaded walk.
+ */
+#define FIND_MAX_THREADS	256
+
+struct find_work {
+	struct find_work	*fw_next;
+	struct find_work	*fw_prev;
+	unsigned int		 fw_depth;
+	/* d_type returned by readdir() of the parent, DT_UNKNOWN for root */
+	unsigned char		 fw_type;
+	char			 fw_path[];
+};
+
+struct find_walk;
+
+struct find_worker {
+	pthread_mutex_t		 fwk_lock;
+	/* oldest work, stolen by the other workers */
+	struct find_work	*fwk_head;
+	/* newest work, taken by this worker */
+	struct find_work	*fwk_tail;
+	struct find_walk	*fwk_walk;
+	struct find_param	 fwk_param;
+	/* -xattr buffers and match state, the compiled patterns are shared */
+	struct xattr_match_info	 fwk_xmi;
+	pthread_t		 fwk_thread;
+	int			 fwk_index;
+	int			 fwk_rc;
+	bool			 fwk_started;
+	char			*fwk_buf;
+};
+
+struct find_walk {
+	pthread_mutex_t		 fwl_lock;
+	pthread_cond_t		 fwl_cond;
+	/* work items queued and not yet taken by a worker */
+	unsigned long		 fwl_queued;
+	/* work items queued or being processed */
+	unsigned long		 fwl_pending;
+	bool			 fwl_stop;
+	int			 fwl_nr;
+	semantic_func_t		*fwl_init;
+	semantic_func_t		*fwl_fini;
+	struct find_worker	*fwl_workers;
+};
+
+static int find_work_queue(struct find_worker *wk, const char *path,
+			   unsigned int depth, unsigned char type)
+{
+	struct find_walk *walk = wk->fwk_walk;
+	struct find_work *fw;
+	size_t len = strlen(path);
+
+	fw = malloc(sizeof(*fw) + len + 1);
+	if (fw == NULL)
+		return -ENOMEM;
+
+	fw->fw_depth = depth;
+	fw->fw_type = type;
+	memcpy(fw->fw_path, path, len + 1);
+
+	pthread_mutex_lock(&wk->fwk_lock);
+	fw->fw_next = NULL;
+	fw->fw_prev = wk->fwk_tail;
+	if (wk->fwk_tail)
+		wk->fwk_tail->fw_next = fw;
+	else
+		wk->fwk_head = fw;
+	wk->fwk_tail = fw;
+
+	pthread_mutex_lock(&walk->fwl_lock);
+	walk->fwl_pending++;
+	walk->fwl_queued++;
+	pthread_mutex_unlock(&walk->fwl_lock);
+	pthread_mutex_unlock(&wk->fwk_lock);
+
+	pthread_cond_signal(&walk->fwl_cond);
+
+	return 0;
+}
+
+static struct find_work *find_work_take(struct find_worker *wk, bool steal)
+{
+	struct find_work *fw;
+
+	pthread_mutex_lock(&wk->fwk_lock);
+	if (steal) {
+		fw = wk->fwk_head;
+		if (fw) {
+			wk->fwk_head = fw->fw_next;
+			if (wk->fwk_head)
+				wk->fwk_head->fw_prev = NULL;
+			else
+				wk->fwk_tail = NULL;
+		}
+	} else {
+		fw = wk->fwk_tail;
+		if (fw) {
+			wk->fwk_tail = fw->fw_prev;
+			if (wk->fwk_tail)
+				wk->fwk_tail->fw_next = NULL;
+			else
+				wk->fwk_head = NULL;
+		}
+	}
+	if (fw) {
+		pthread_mutex_lock(&wk->fwk_walk->fwl_lock);
+		wk->fwk_walk->fwl_queued--;
+		pthread_mutex_unlock(&wk->fwk_walk->fwl_lock);
+	}
+	pthread_mutex_unlock(&wk->fwk_lock);
+
+	return fw;
+}
+
+/* Take work from our own queue first, then from the other workers */
+static struct find_work *find_work_get(struct find_worker *wk)
+{
+	struct find_walk *walk = wk->fwk_walk;
+	struct find_work *fw;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&walk->fwl_lock);
+		while (!walk->fwl_stop && walk->fwl_queued == 0)
+			pthread_cond_wait(&walk->fwl_cond, &walk->fwl_lock);
+		if (walk->fwl_stop) {
+			pthread_mutex_unlock(&walk->fwl_lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&walk->fwl_lock);
+
+		fw = find_work_take(wk, false);
+		for (i = 1; fw == NULL && i < walk->fwl_nr; i++)
+			fw = find_work_take(&walk->fwl_workers[
+					(wk->fwk_index + i) % walk->fwl_nr],
+					    true);
+		if (fw)
+			return fw;
+		/* somebody else took it first, wait for more work */
+	}
+}
+
+static void find_work_done(struct find_walk *walk, struct find_work *fw,
+			   bool stop)
+{
+	free(fw);
+
+	pthread_mutex_lock(&walk->fwl_lock);
+	if (--walk->fwl_pending == 0 || stop) {
+		walk->fwl_stop = true;
+		pthread_cond_broadcast(&walk->fwl_cond);
+	}
+	pthread_mutex_unlock(&walk->fwl_lock);
+}
+
+static int find_worker_xattr_init(struct find_worker *wk)
+{
+	struct xattr_match_info *xmi = wk->fwk_param.fp_xattr_match_info;
+	struct xattr_match_info *wxmi = &wk->fwk_xmi;
+
+	*wxmi = *xmi;
+	wxmi->xattr_regex_matched = NULL;
+	wxmi->xattr_name_buf = NULL;
+	wxmi->xattr_value_buf = NULL;
+	wk->fwk_param.fp_xattr_match_info = wxmi;
+
+	wxmi->xattr_regex_matched = calloc(xmi->xattr_regex_count,
+					   sizeof(bool));
+	wxmi->xattr_name_buf = malloc(XATTR_LIST_MAX);
+	/* room to add a '\0' to a value, see xattr_match_info_append() */
+	wxmi->xattr_value_buf = malloc(XATTR_SIZE_MAX + 1);
+	if (wxmi->xattr_regex_matched == NULL ||
+	    wxmi->xattr_name_buf == NULL || wxmi->xattr_value_buf == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void find_worker_xattr_fini(struct find_worker *wk)
+{
+	free(wk->fwk_xmi.xattr_regex_matched);
+	free(wk->fwk_xmi.xattr_name_buf);
+	free(wk->fwk_xmi.xattr_value_buf);
+}
+
+static void *find_worker_main(void *arg)
+{
+	struct find_worker *wk = arg;
+	struct find_walk *walk = wk->fwk_walk;
+	struct find_param *param = &wk->fwk_param;
+	struct find_work *fw;
+
+	while ((fw = find_work_get(wk)) != NULL) {
+		struct dirent64 de = { .d_type = fw->fw_type };
+		char *name;
+		bool stop;
+		int rc;
+
+		snprintf(wk->fwk_buf, 2 * PATH_MAX, "%s", fw->fw_path);
+		name = strrchr(fw->fw_path, '/');
+		snprintf(de.d_name, sizeof(de.d_name), "%s",
+			 name ? name + 1 : fw->fw_path);
+
+		param->fp_depth = fw->fw_depth;
+		rc = llapi_semantic_traverse(wk->fwk_buf, 2 * PATH_MAX, -1,
+					     walk->fwl_init, walk->fwl_fini,
+					     param, fw->fw_depth ? &de : NULL,
+					     wk);
+		if (rc != 0 && wk->fwk_rc == 0)
+			wk->fwk_rc = rc;
+
+		stop = rc < 0 && rc != -EALREADY && param->fp_stop_on_error;
+		find_work_done(walk, fw, stop);
+	}
+
+	return NULL;
+}
+
+static int find_walk_parallel(char *path, semantic_func_t sem_init,
+			      semantic_func_t sem_fini,
+			      struct find_param *param)
+{
+	struct find_walk walk = {
+		.fwl_lock = PTHREAD_MUTEX_INITIALIZER,
+		.fwl_cond = PTHREAD_COND_INITIALIZER,
+		.fwl_init = sem_init,
+		.fwl_fini = sem_fini,
+	};
+	struct find_worker *wk;
+	struct find_work *fw;
+	int ret = 0;
+	int rc;
+	int i;
+
+	if (strlen(path) > PATH_MAX) {
+		ret = -EINVAL;
+		llapi_error(LLAPI_MSG_ERROR, ret,
+			    "Path name '%s' is too long", path);
+		return ret;
+	}
+
+	walk.fwl_nr = param->fp_threads > FIND_MAX_THREADS ?
+		      FIND_MAX_THREADS : param->fp_threads;
+	walk.fwl_workers = calloc(walk.fwl_nr, sizeof(*walk.fwl_workers));
+	if (walk.fwl_workers == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < walk.fwl_nr; i++) {
+		wk = &walk.fwl_workers[i];
+		pthread_mutex_init(&wk->fwk_lock, NULL);
+		wk->fwk_walk = &walk;
+		wk->fwk_index = i;
+		wk->fwk_param = *param;
+		/* layout buffers and target indexes are private to a worker */
+		wk->fwk_param.fp_lmd = NULL;
+		wk->fwk_param.fp_lmv_md = NULL;
+		wk->fwk_param.fp_obd_indexes = NULL;
+		wk->fwk_param.fp_mdt_indexes = NULL;
+	}
+
+	for (i = 0; i < walk.fwl_nr; i++) {
+		wk = &walk.fwl_workers[i];
+		wk->fwk_buf = malloc(2 * PATH_MAX);
+		if (wk->fwk_buf == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		if (param->fp_xattr_match_info) {
+			ret = find_worker_xattr_init(wk);
+			if (ret)
+				goto out;
+		}
+
+		ret = common_param_init(&wk->fwk_param, path);
+		if (ret)
+			goto out;
+	}
+
+	ret = find_work_queue(&walk.fwl_workers[0], path, 0, DT_UNKNOWN);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < walk.fwl_nr; i++) {
+		wk = &walk.fwl_workers[i];
+		rc = pthread_create(&wk->fwk_thread, NULL, find_worker_main,
+				    wk);
+		if (rc) {
+			ret = -rc;
+			llapi_error(LLAPI_MSG_ERROR, ret,
+				    "cannot start find thread %d", i);
+			/* carry on with the threads already running */
+			if (i > 0)
+				break;
+			goto out;
+		}
+		wk->fwk_started = true;
+	}
+	ret = 0;
+
+	for (i = 0; i < walk.fwl_nr; i++) {
+		wk = &walk.fwl_workers[i];
+		if (!wk->fwk_started)
+			continue;
+		pthread_join(wk->fwk_thread, NULL);
+		if (wk->fwk_rc != 0 && ret == 0)
+			ret = wk->fwk_rc;
+	}
+
+out:
+	for (i = 0; i < walk.fwl_nr; i++) {
+		wk = &walk.fwl_workers[i];
+		/* left over if the walk was stopped on error */
+		while ((fw = find_work_take(wk, true)) != NULL)
+			free(fw);
+		find_param_fini(&wk->fwk_param);
+		free(wk->fwk_param.fp_mdt_indexes);
+		find_worker_xattr_fini(wk);
+		free(wk->fwk_buf);
+		pthread_mutex_destroy(&wk->fwk_lock);
+	}
+	free(walk.fwl_workers);
+
+	return ret < 0 ? ret : 0;
+}
+
 int llapi_find(char *path, struct find_param *param)
 {
 	if (param->fp_format_printf_str)
 		validate_printf_str(param);
+	if (param->fp_threads > 1)
+		return find_walk_parallel(path, cb_find_init, cb_common_fini,
+					  param);
 	return param_callback(path, cb_find_init, cb_common_fini, param);
 }
 
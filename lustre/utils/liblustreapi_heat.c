@@ -76,3 +76,25 @@ int llapi_heat_set(int fd, __u64 flags)
 	}
 	return 0;
 }
+
+/*
+ * Get the read pattern and readahead statistics of a file
+ *
+ * \param fd       File to get readahead statistics.
+ * \param stats    Buffer to save the statistics.
+ *
+ * \retval 0 on success.
+ * \retval -errno on failure.
+ */
+int llapi_ra_stats_get(int fd, struct lu_ra_stats *stats)
+{
+	int rc;
+
+	rc = ioctl(fd, LL_IOC_RA_STATS_GET, stats);
+	if (rc < 0) {
+		llapi_error(LLAPI_MSG_ERROR, -errno,
+			    "cannot get readahead statistics");
+		return -errno;
+	}
+	return 0;
+}
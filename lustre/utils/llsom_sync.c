@@ -37,6 +37,7 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <assert.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -58,6 +59,13 @@
 #define REC_MIN_AGE	600
 #define DEF_CACHE_SIZE	(256 * 1048576) /* 256MB */
 #define ONE_MB 0x100000
+/* records updated before the changelog is cleared */
+#define LSOM_BATCH_MAX	1024
+#define LSOM_MAX_THREADS 64
+/* cached records per hash bucket */
+#define LSOM_HASH_LOAD	4
+#define LSOM_HASH_SHIFT_MIN 6
+#define LSOM_HASH_SHIFT_MAX 24
 
 struct options {
 	const char	*o_chlg_user;
@@ -70,6 +78,7 @@ struct options {
 	int		 o_min_age;
 	unsigned long	 o_cached_fid_hiwm; /* high watermark */
 	unsigned long	 o_batch_sync_cnt;
+	int		 o_threads;
 };
 
 struct options opt;
@@ -82,17 +91,26 @@ struct fid_rec {
 	__u64			fr_index;
 };
 
-static const int fid_hash_shift = 6;
-
-#define FID_HASH_ENTRIES	(1 << fid_hash_shift)
+#define FID_HASH_ENTRIES	(1UL << head.lh_hash_shift)
 #define FID_ON_HASH(f)		(!hlist_unhashed(&(f)->fr_node))
 
 struct lsom_head {
 	struct hlist_head	*lh_hash;
+	unsigned int		 lh_hash_shift;
 	struct list_head	 lh_list; /* ordered list by record index */
 	unsigned long		 lh_cached_count;
 } head;
 
+/* Records updated concurrently by the update threads */
+struct lsom_batch {
+	pthread_mutex_t		  lb_lock;
+	struct fid_rec		**lb_recs;
+	int			 *lb_rcs;
+	int			  lb_count;
+	int			  lb_next;
+	int			  lb_root_fd;
+};
+
 static void usage(char *prog)
 {
 	printf("\nUsage: %s [options] -u <userid> -m <mdtdev> <mntpt>\n"
@@ -102,6 +120,7 @@ static void usage(char *prog)
 	       "\t-a, --min-age, min age before a record is processed.\n"
 	       "\t-c, --max-cache, percentage of the memroy used for cache.\n"
 	       "\t-s, --sync, data sync when update LSOM xattr\n"
+	       "\t-t, --threads, number of threads updating LSOM xattrs\n"
 	       "\t-v, --verbose, produce more verbose ouput\n",
 	       prog);
 	exit(0);
@@ -124,7 +143,7 @@ static void fid_hash_add(struct fid_rec *f)
 	assert(!FID_ON_HASH(f));
 	hlist_add_head(&f->fr_node,
 		       &head.lh_hash[llapi_fid_hash(&f->fr_fid,
-					      fid_hash_shift)]);
+						    head.lh_hash_shift)]);
 }
 
 static struct fid_rec *fid_hash_find(const lustre_fid *fid)
@@ -133,7 +152,7 @@ static struct fid_rec *fid_hash_find(const lustre_fid *fid)
 	struct hlist_node *entry, *next;
 	struct fid_rec *f;
 
-	hash_list = &head.lh_hash[llapi_fid_hash(fid, fid_hash_shift)];
+	hash_list = &head.lh_hash[llapi_fid_hash(fid, head.lh_hash_shift)];
 	hlist_for_each_entry_safe(f, entry, next, hash_list, fr_node) {
 		assert(FID_ON_HASH(f));
 		if (fid_eq(fid, &f->fr_fid))
@@ -143,19 +162,38 @@ static struct fid_rec *fid_hash_find(const lustre_fid *fid)
 	return NULL;
 }
 
-static int lsom_setup(void)
+/*
+ * Split the cache budget between the hash table and the FID records, so
+ * that the lookups stay short however many FIDs are cached.
+ */
+static int lsom_setup(unsigned long long cache_size)
 {
-	int i;
+	unsigned long long hash_size;
+	unsigned long i;
 
 	/* set llapi message level */
 	llapi_msg_set_level(opt.o_verbose);
 
 	memset(&head, 0, sizeof(head));
+	head.lh_hash_shift = LSOM_HASH_SHIFT_MIN;
+	while (head.lh_hash_shift < LSOM_HASH_SHIFT_MAX &&
+	       (LSOM_HASH_LOAD << (head.lh_hash_shift + 1)) <=
+	       cache_size / sizeof(struct fid_rec))
+		head.lh_hash_shift++;
+
+	hash_size = sizeof(struct hlist_head) * FID_HASH_ENTRIES;
+	opt.o_cached_fid_hiwm = cache_size > hash_size ?
+		(cache_size - hash_size) / sizeof(struct fid_rec) : 1;
+	opt.o_batch_sync_cnt = opt.o_cached_fid_hiwm / 2 ?: 1;
+	llapi_printf(LLAPI_MSG_DEBUG,
+		     "FID cache: %lu records, %lu hash buckets\n",
+		     opt.o_cached_fid_hiwm, FID_HASH_ENTRIES);
+
 	head.lh_hash = malloc(sizeof(struct hlist_head) * FID_HASH_ENTRIES);
 	if (head.lh_hash == NULL) {
 		llapi_err_noerrno(LLAPI_MSG_ERROR,
-				 "failed to alloc memory for hash (%zu).",
-				 sizeof(struct hlist_head) * FID_HASH_ENTRIES);
+				 "failed to alloc memory for hash (%llu).",
+				 hash_size);
 		return -ENOMEM;
 	}
 
@@ -171,22 +209,22 @@ static void lsom_cleanup(void)
 	free(head.lh_hash);
 }
 
-static int lsom_update_one(struct fid_rec *f)
+/* Update the LSOM of one file, open relative to the root of the mount */
+static int lsom_update_one(int root_fd, struct fid_rec *f)
 {
 	struct stat st;
 	int fd;
 	int rc = 0;
 
-	fd = llapi_open_by_fid(opt.o_mntpt, &f->fr_fid,
-			       O_RDONLY | O_NOATIME);
+	fd = llapi_open_by_fid_at(root_fd, &f->fr_fid, O_RDONLY | O_NOATIME);
 	if (fd < 0) {
-		rc = -errno;
+		rc = fd;
 
 		/* The file may be deleted, clean the corresponding
 		 * changelog record and ignore this error.
 		 */
 		if (rc == -ENOENT)
-			goto clean_up;
+			return 0;
 
 		llapi_error(LLAPI_MSG_ERROR, rc,
 			    "llapi_open_by_fid for " DFID " failed",
@@ -208,8 +246,10 @@ static int lsom_update_one(struct fid_rec *f)
 
 	rc = fstat(fd, &st);
 	if (rc < 0) {
+		rc = -errno;
 		llapi_error(LLAPI_MSG_ERROR, rc, "failed to stat FID: " DFID,
 			    PFID(&f->fr_fid));
+		close(fd);
 		return rc;
 	}
 
@@ -226,76 +266,172 @@ static int lsom_update_one(struct fid_rec *f)
 		     (unsigned long long)f->fr_index,
 		     PFID(&f->fr_fid), st.st_size, st.st_blocks);
 
-clean_up:
-	rc = llapi_changelog_clear(opt.o_mdtname,
-				   opt.o_chlg_user, f->fr_index);
-	if (rc)
-		llapi_error(LLAPI_MSG_ERROR, rc,
-			    "failed to clear changelog record: %s:%llu",
-			    opt.o_chlg_user, (unsigned long long)f->fr_index);
-	return rc;
+	return 0;
 }
 
+static void *lsom_update_thread(void *arg)
+{
+	struct lsom_batch *lb = arg;
+	int i;
+
+	while (1) {
+		pthread_mutex_lock(&lb->lb_lock);
+		i = lb->lb_next++;
+		pthread_mutex_unlock(&lb->lb_lock);
+		if (i >= lb->lb_count)
+			break;
+
+		lb->lb_rcs[i] = lsom_update_one(lb->lb_root_fd,
+						lb->lb_recs[i]);
+	}
+
+	return NULL;
+}
+
+/* Update all the records of the batch with up to o_threads threads */
+static void lsom_update_batch(struct lsom_batch *lb)
+{
+	pthread_t threads[LSOM_MAX_THREADS];
+	int nthreads = opt.o_threads;
+	int started;
+	int rc;
+	int i;
+
+	if (nthreads > lb->lb_count)
+		nthreads = lb->lb_count;
+
+	lb->lb_next = 0;
+	/* the calling thread takes its share of the batch too */
+	for (started = 0; started < nthreads - 1; started++) {
+		rc = pthread_create(&threads[started], NULL,
+				    lsom_update_thread, lb);
+		if (rc) {
+			llapi_error(LLAPI_MSG_WARN, -rc,
+				    "cannot start update thread");
+			break;
+		}
+	}
+
+	lsom_update_thread(lb);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/*
+ * Update the LSOM of the first \a count records of the list, in batches
+ * of LSOM_BATCH_MAX. After each batch, the changelog is cleared up to the
+ * last record before the first failure, which keeps the changelog clear
+ * count down to one per batch.
+ */
 static int lsom_start_update(int count)
 {
+	struct fid_rec *recs[LSOM_BATCH_MAX];
+	int rcs[LSOM_BATCH_MAX];
+	struct lsom_batch lb = {
+		.lb_lock = PTHREAD_MUTEX_INITIALIZER,
+		.lb_recs = recs,
+		.lb_rcs = rcs,
+	};
+	struct fid_rec *f;
 	int rc = 0;
-	int i = 0;
+	int done;
+	int i;
 
 	llapi_printf(LLAPI_MSG_INFO, "Start to sync %d records.\n", count);
 
-	while (i < count) {
-		struct fid_rec *f;
+	rc = llapi_root_path_open(opt.o_mntpt, &lb.lb_root_fd);
+	if (rc) {
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot open root of '%s'",
+			    opt.o_mntpt);
+		return rc;
+	}
+
+	while (count > 0 && !list_empty(&head.lh_list)) {
+		lb.lb_count = 0;
+		list_for_each_entry(f, &head.lh_list, fr_link) {
+			if (lb.lb_count == count ||
+			    lb.lb_count == LSOM_BATCH_MAX)
+				break;
+			recs[lb.lb_count++] = f;
+		}
+		count -= lb.lb_count;
+
+		lsom_update_batch(&lb);
+
+		/* the list is sorted by record index */
+		for (done = 0; done < lb.lb_count && rcs[done] == 0; done++)
+			;
+		if (done < lb.lb_count)
+			rc = rcs[done];
+
+		if (done > 0) {
+			__u64 index = recs[done - 1]->fr_index;
+			int rc2;
+
+			rc2 = llapi_changelog_clear(opt.o_mdtname,
+						    opt.o_chlg_user, index);
+			if (rc2) {
+				llapi_error(LLAPI_MSG_ERROR, rc2,
+					    "failed to clear changelog record: %s:%llu",
+					    opt.o_chlg_user,
+					    (unsigned long long)index);
+				rc = rc ?: rc2;
+			}
+		}
 
-		f = list_first_entry(&head.lh_list, struct fid_rec, fr_link);
-		rc = lsom_update_one(f);
-		if (rc == 0) {
+		/*
+		 * The records updated after a failure are cleared from the
+		 * changelog with the next batch, or updated once more after
+		 * a restart, which is harmless.
+		 */
+		for (i = 0; i < lb.lb_count; i++) {
+			if (rcs[i])
+				continue;
+			f = recs[i];
 			list_del_init(&f->fr_link);
 			fid_hash_del(f);
 			free(f);
 			head.lh_cached_count--;
-			i++;
-		} else {
-			goto out;
 		}
+
+		if (rc)
+			break;
 	}
 
-out:
+	close(lb.lb_root_fd);
+
 	return rc;
 }
 
 static int lsom_check_sync(void)
 {
-	int rc = 0;
-	int count;
+	int count = 0;
 
-repeated:
-	count = 0;
 	if (list_empty(&head.lh_list))
 		return 0;
 
-	if (head.lh_cached_count > opt.o_cached_fid_hiwm)
+	if (head.lh_cached_count > opt.o_cached_fid_hiwm) {
 		count = opt.o_batch_sync_cnt;
-	else {
+	} else {
 		struct fid_rec *f;
 		time_t now;
 
-		/* When the first record in the list was not being
-		 * processed for a long time (more than o_min_age),
-		 * pop the record, start to handle it immediately.
+		/* Records which were not processed for a long time (more
+		 * than o_min_age) are handled immediately, all together.
 		 */
 		now = time(NULL);
-		f = list_first_entry(&head.lh_list, struct fid_rec, fr_link);
-		if (now > ((f->fr_time >> 30) + opt.o_min_age))
-			count = 1;
+		list_for_each_entry(f, &head.lh_list, fr_link) {
+			if (now <= ((f->fr_time >> 30) + opt.o_min_age))
+				break;
+			count++;
+		}
 	}
 
 	if (count > 0)
-		rc = lsom_start_update(count);
-
-	if (rc == 0 && count == 1)
-		goto repeated;
+		return lsom_start_update(count);
 
-	return rc;
+	return 0;
 }
 
 static void lsom_sort_record_list(struct fid_rec *f)
@@ -407,6 +543,7 @@ int main(int argc, char **argv)
 		{ "max-cache", required_argument, NULL, 'c'},
 		{ "verbose", no_argument, NULL, 'v'},
 		{ "sync", no_argument, NULL, 's'},
+		{ "threads", required_argument, NULL, 't'},
 		{ "help", no_argument, NULL, 'h' },
 		{ NULL }
 	};
@@ -416,8 +553,9 @@ int main(int argc, char **argv)
 	opt.o_verbose = LLAPI_MSG_INFO;
 	opt.o_intv = CHLG_POLL_INTV;
 	opt.o_min_age = REC_MIN_AGE;
+	opt.o_threads = 1;
 
-	while ((c = getopt_long(argc, argv, "u:hm:dsi:a:c:v", options, NULL))
+	while ((c = getopt_long(argc, argv, "u:hm:dsi:a:c:t:v", options, NULL))
 	       != EOF) {
 		switch (c) {
 		default:
@@ -480,6 +618,16 @@ int main(int argc, char **argv)
 		case 's':
 			opt.o_data_sync = true;
 			break;
+		case 't':
+			opt.o_threads = atoi(optarg);
+			if (opt.o_threads < 1 ||
+			    opt.o_threads > LSOM_MAX_THREADS) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -t %s", optarg);
+				return rc;
+			}
+			break;
 		}
 	}
 
@@ -515,10 +663,7 @@ int main(int argc, char **argv)
 		setbuf(stdout, NULL);
 	}
 
-	opt.o_cached_fid_hiwm = cache_size / sizeof(struct fid_rec);
-	opt.o_batch_sync_cnt = opt.o_cached_fid_hiwm / 2;
-
-	rc = lsom_setup();
+	rc = lsom_setup(cache_size);
 	if (rc < 0)
 		return rc;
 
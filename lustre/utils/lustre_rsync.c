@@ -100,6 +100,17 @@
  *    If moving out of .lustrerepl
  *      move out all its children in .lustrerepl.
  *      [pfid,tfid,name] tracked from (1) is used for this.
+ *
+ * With --threads, the main thread reads the changelog and queues the
+ * records, and a pool of worker threads replicates them. Each record is
+ * tagged with keys derived from its FIDs and names. A record only starts
+ * once no earlier record that is still queued or running shares a key
+ * with it, where keys only used for lookup (the parent FID of a create)
+ * may be shared. Renames and directory removals change the paths of a
+ * whole subtree, so they wait for all earlier records and block all
+ * later ones. The records before the oldest unfinished one are cleared
+ * from the changelog and saved to the statuslog, so a restart never
+ * skips a record that was not replicated.
  */
 
 #include <assert.h>
@@ -117,13 +128,17 @@
 #include <limits.h>
 #include <utime.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <sys/xattr.h>
 #include <linux/types.h>
 
+#include <libcfs/util/list.h>
 #include <libcfs/util/string.h>
 #include <lustre/lustreapi.h>
 #include "lustre_rsync.h"
 #include "callvpe.h"
+#include "lstddef.h"
 
 #define REPLICATE_STATUS_VER 1
 #define CLEAR_INTERVAL 100
@@ -131,6 +146,14 @@
 
 #define TYPE_STR_LEN 16
 
+#define LR_MAX_THREADS 256
+/* records queued ahead of the workers, per worker thread */
+#define LR_QUEUE_PER_THREAD 32
+/* Buckets of the table of keys used by queued records */
+#define LR_KEY_BUCKETS 1024
+/* bytes moved by one copy_file_range() call */
+#define LR_COPY_CHUNK (16 << 20)
+
 #define DEFAULT_MDT "-MDT0000"
 #define SPECIAL_DIR ".lustrerepl"
 #define RSYNC "rsync"
@@ -177,6 +200,61 @@ struct lr_parent_child_list {
 	struct lr_parent_child_list *pc_next;
 };
 
+#define LR_WORK_MAX_KEYS 6
+
+struct lr_work_key {
+	__u64 lk_hash;
+	bool lk_excl;	/* the record changes what the key names */
+	struct lr_work *lk_work;
+	struct lr_key_queue *lk_queue;
+	struct list_head lk_link;	/* on lk_queue->lq_users */
+};
+
+/* Records queued or running that use a key, in changelog order */
+struct lr_key_queue {
+	struct lr_key_queue *lq_hnext;
+	__u64 lq_hash;
+	int lq_nexcl;	/* users that change what the key names */
+	struct list_head lq_users;
+};
+
+/* A changelog record waiting for or being replicated by a worker thread */
+struct lr_work {
+	struct lr_work *lw_next;
+	unsigned int lw_running:1;
+	unsigned int lw_barrier:1;
+	int lw_nkeys;
+	struct lr_work_key lw_keys[LR_WORK_MAX_KEYS];
+	/* record fields, copied to the lr_info of the worker */
+	long long lw_recno;
+	unsigned int lw_is_extended:1;
+	enum changelog_rec_type lw_type;
+	char lw_tfid[LR_FID_STR_LEN];
+	char lw_pfid[LR_FID_STR_LEN];
+	char lw_sfid[LR_FID_STR_LEN];
+	char lw_spfid[LR_FID_STR_LEN];
+	char lw_sname[NAME_MAX + 1];
+	char lw_name[NAME_MAX + 1];
+};
+
+/* Records read from the changelog and not replicated yet */
+struct lr_sched {
+	pthread_mutex_t ls_lock;
+	/* signalled when a record is queued or has completed */
+	pthread_cond_t ls_cond;
+	/* in changelog order */
+	struct lr_work *ls_head;
+	struct lr_work *ls_tail;
+	/* keys of the records on the list above */
+	struct lr_key_queue *ls_keys[LR_KEY_BUCKETS];
+	int ls_queued;
+	int ls_max_queued;
+	/* last record read from the changelog */
+	long long ls_last_read;
+	unsigned int ls_eof:1;
+	unsigned int ls_abort:1;
+};
+
 struct lustre_rsync_status *status;
 char *statuslog;  /* Name of the status log file */
 int logbackedup;
@@ -186,6 +264,7 @@ int debug;      /* Flag to turn debugging information on and off */
 int verbose;    /* Verbose output */
 long long rec_count; /* No of changelog records that were processed */
 int errors;
+pthread_mutex_t errors_lock = PTHREAD_MUTEX_INITIALIZER;
 int dryrun;
 int use_rsync;  /* Flag to turn on use of rsync to copy data */
 long long rsync_threshold = DEFAULT_RSYNC_THRESHOLD;
@@ -193,13 +272,21 @@ int quit;       /* Flag to stop processing the changelog; set on the
 		 * receipt of a signal
 		 */
 int abort_on_err;
+int nthreads = 1; /* No of worker threads replicating records */
+char lr_zero_fid[LR_FID_STR_LEN]; /* DFID of a zero FID */
 
 char rsync[PATH_MAX + 128];
 char rsync_ver[PATH_MAX * 2];
 struct lr_parent_child_list *parents;
+pthread_mutex_t parents_lock = PTHREAD_MUTEX_INITIALIZER;
 
 FILE *debug_log;
 
+struct lr_sched lr_sched = {
+	.ls_lock = PTHREAD_MUTEX_INITIALIZER,
+	.ls_cond = PTHREAD_COND_INITIALIZER,
+};
+
 /* Command line options */
 struct option long_opts[] = {
 	{ .val = 'l',	.name = "statuslog",	.has_arg = required_argument },
@@ -215,6 +302,7 @@ struct option long_opts[] = {
 	{ .val = 'c',	.name = "cl-clear",	.has_arg = required_argument },
 	{ .val = 'd',	.name = "debug",	.has_arg = required_argument },
 	{ .val = 'D',	.name = "debuglog",	.has_arg = required_argument },
+	{ .val = 'j',	.name = "threads",	.has_arg = required_argument },
 	{ .val = 'n',	.name = "start-recno",	.has_arg = required_argument },
 	{ .val = 'r',	.name = "use-rsync",	.has_arg = no_argument },
 	{ .val = 'y',	.name = "rsync-threshold",
@@ -232,6 +320,7 @@ void lr_usage(void)
 		"options:\n"
 		"\t--xattr <yes|no> replicate EAs\n"
 		"\t--abort-on-err   abort at first err\n"
+		"\t--threads <n>    replicate with n worker threads\n"
 		"\t--verbose\n"
 		"\t--dry-run        don't write anything\n");
 }
@@ -265,6 +354,14 @@ void *lr_grow_buf(void *buf, int size)
 	return ptr;
 }
 
+/* Count an error, the workers can fail concurrently */
+void lr_error(void)
+{
+	pthread_mutex_lock(&errors_lock);
+	errors++;
+	pthread_mutex_unlock(&errors_lock);
+}
+
 /* Use rsync to replicate file data */
 int lr_rsync_data(struct lr_info *info)
 {
@@ -293,10 +390,10 @@ int lr_rsync_data(struct lr_info *info)
 	    st_src.st_size != st_dest.st_size) {
 		/*
 		 * XXX spawning off an rsync for every data sync and
-		 * waiting synchronously is bad for performance.
+		 * waiting synchronously is bad for performance, use
+		 * --threads to run several of them at once.
 		 * librsync could possibly used here. But it does not
-		 * seem to be of production grade. Multi-threaded
-		 * replication is also to be considered.
+		 * seem to be of production grade.
 		 */
 		char *args[] = {
 			rsync,
@@ -347,6 +444,8 @@ int lr_copy_data(struct lr_info *info)
 	int bufsize;
 	int rsize;
 	int rc = 0;
+	ssize_t csize;
+	off_t copied = 0;
 	struct stat st_src;
 	struct stat st_dest;
 
@@ -376,6 +475,30 @@ int lr_copy_data(struct lr_info *info)
 		rc = -errno;
 		goto out;
 	}
+
+	/*
+	 * Let the kernel move the data, this avoids the copy through
+	 * user space and may be offloaded by the target filesystem. Fall
+	 * back to read/write if the target does not support it.
+	 */
+	while (1) {
+		csize = copy_file_range(fd_src, NULL, fd_dest, NULL,
+					LR_COPY_CHUNK, 0);
+		if (csize > 0) {
+			copied += csize;
+			continue;
+		}
+		if (csize == 0)
+			goto out_sync;
+		if (copied == 0 && (errno == EXDEV || errno == ENOSYS ||
+				    errno == EINVAL || errno == EOPNOTSUPP))
+			break;
+		rc = -errno;
+		goto out_sync;
+	}
+	lr_debug(DTRACE, "copy_file_range %s failed: %s, using read/write\n",
+		 info->dest, strerror(errno));
+
 	bufsize = st_dest.st_blksize;
 
 	if (info->bufsize < bufsize) {
@@ -412,6 +535,7 @@ int lr_copy_data(struct lr_info *info)
 			buf += wsize;
 		} while (rsize > 0);
 	}
+out_sync:
 	fsync(fd_dest);
 
 out:
@@ -516,7 +640,7 @@ int lr_copy_xattr(struct lr_info *info)
 					fprintf(stderr, "cannot replicate xattrs from '%s' to '%s': %s\n",
 						info->src, info->dest,
 						strerror(errno));
-					errors++;
+					lr_error();
 				}
 				rc = 0;
 			}
@@ -672,8 +796,10 @@ int lr_add_pc(const char *pfid, const char *tfid, const char *name)
 	if (len >= sizeof(p->pc_log.pcl_name))
 		goto out_err;
 
+	pthread_mutex_lock(&parents_lock);
 	p->pc_next = parents;
 	parents = p;
+	pthread_mutex_unlock(&parents_lock);
 	return 0;
 
 out_err:
@@ -681,6 +807,7 @@ out_err:
 	return -E2BIG;
 }
 
+/* Called with parents_lock held */
 void lr_cascade_move(const char *fid, const char *dest, struct lr_info *info)
 {
 	struct lr_parent_child_list *curr, *prev;
@@ -704,7 +831,7 @@ void lr_cascade_move(const char *fid, const char *dest, struct lr_info *info)
 			if (rc == -1) {
 				fprintf(stderr, "Error renaming file %s to %s: %d\n",
 					info->src, d, errno);
-				errors++;
+				lr_error();
 			}
 			if (curr == parents)
 				parents = curr->pc_next;
@@ -725,6 +852,7 @@ int lr_remove_pc(const char *pfid, const char *tfid)
 {
 	struct lr_parent_child_list *curr, *prev;
 
+	pthread_mutex_lock(&parents_lock);
 	for (prev = curr = parents; curr; prev = curr, curr = curr->pc_next) {
 		if (strcmp(curr->pc_log.pcl_pfid, pfid) == 0 &&
 		    strcmp(curr->pc_log.pcl_tfid, tfid) == 0) {
@@ -736,6 +864,7 @@ int lr_remove_pc(const char *pfid, const char *tfid)
 			break;
 		}
 	}
+	pthread_mutex_unlock(&parents_lock);
 	return 0;
 }
 
@@ -999,9 +1128,11 @@ int lr_move(struct lr_info *info)
 		if (special_src)
 			rc1 = lr_remove_pc(info->spfid, info->sfid);
 
-		if (!special_dest)
+		if (!special_dest) {
+			pthread_mutex_lock(&parents_lock);
 			lr_cascade_move(info->sfid, info->dest, info);
-		else
+			pthread_mutex_unlock(&parents_lock);
+		} else
 			rc1 = lr_add_pc(info->pfid, info->sfid, info->name);
 
 		lr_debug(DINFO, "move: %s [to] %s rc1=%d, errno=%d\n",
@@ -1301,6 +1432,7 @@ int lr_write_log(void)
 		return -1;
 	}
 
+	pthread_mutex_lock(&parents_lock);
 	for (curr = parents; curr; curr = curr->pc_next) {
 		size = write(fd, &curr->pc_log, sizeof(curr->pc_log));
 		if (size != sizeof(curr->pc_log)) {
@@ -1310,6 +1442,7 @@ int lr_write_log(void)
 			break;
 		}
 	}
+	pthread_mutex_unlock(&parents_lock);
 	close(fd);
 	return rc;
 }
@@ -1428,15 +1561,15 @@ out:
 }
 
 /*
- * Clear changelogs every CLEAR_INTERVAL records or at the end of
- * processing.
+ * Clear changelogs up to \a recno every CLEAR_INTERVAL records or at the
+ * end of processing. All the records up to \a recno must be replicated.
  */
-int lr_clear_cl(struct lr_info *info, int force)
+int lr_clear_cl(long long recno, int force)
 {
 	char		mdt_device[LR_NAME_MAXLEN + 1];
 	int		rc = 0;
 
-	if (force || info->recno > status->ls_last_recno + CLEAR_INTERVAL) {
+	if (force || recno > status->ls_last_recno + CLEAR_INTERVAL) {
 		if (!noclear && !dryrun) {
 			/*
 			 * llapi_changelog_clear modifies the mdt
@@ -1447,16 +1580,15 @@ int lr_clear_cl(struct lr_info *info, int force)
 				 status->ls_mdt_device);
 			rc = llapi_changelog_clear(mdt_device,
 						   status->ls_registration,
-						   info->recno);
+						   recno);
 			if (rc)
 				printf("Changelog clear (%s, %s, %lld) returned %d\n",
 				       status->ls_mdt_device,
-				       status->ls_registration, info->recno,
-				       rc);
+				       status->ls_registration, recno, rc);
 		}
 
 		if (!rc && !dryrun) {
-			status->ls_last_recno = info->recno;
+			status->ls_last_recno = recno;
 			lr_write_log();
 		}
 	}
@@ -1531,6 +1663,8 @@ void lr_print_status(struct lr_info *info)
 		printf("Clear changelog after use: no\n");
 	if (use_rsync)
 		printf("Using rsync: %s (%s)\n", rsync, rsync_ver);
+	if (nthreads > 1)
+		printf("Worker threads: %d\n", nthreads);
 }
 
 void lr_print_failure(struct lr_info *info, int rc)
@@ -1541,18 +1675,427 @@ void lr_print_failure(struct lr_info *info, int rc)
 		info->tfid, info->pfid, info->name);
 }
 
+/* Replicate one changelog record to all of the targets */
+int lr_apply(struct lr_info *info)
+{
+	int rc = 0;
+
+	lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name);
+
+	switch (info->type) {
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+		rc = lr_create(info);
+		break;
+	case CL_RMDIR:
+	case CL_UNLINK:
+		rc = lr_remove(info);
+		break;
+	case CL_RENAME:
+		rc = lr_move(info);
+		break;
+	case CL_HARDLINK:
+		rc = lr_link(info);
+		break;
+	case CL_TRUNC:
+	case CL_SETATTR:
+		rc = lr_setattr(info);
+		break;
+	case CL_SETXATTR:
+		rc = lr_setxattr(info);
+		break;
+	default:
+		/* Nothing needs to be done for other entries */
+		break;
+	}
+
+	lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name, rc);
+
+	return rc;
+}
+
+/* Does the record change anything on the targets? */
+bool lr_needs_apply(enum changelog_rec_type type)
+{
+	switch (type) {
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+	case CL_RMDIR:
+	case CL_UNLINK:
+	case CL_RENAME:
+	case CL_HARDLINK:
+	case CL_TRUNC:
+	case CL_SETATTR:
+	case CL_SETXATTR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* FNV-1a hash of a FID, and of the name in that directory if given */
+__u64 lr_key_hash(const char *fid, const char *name)
+{
+	__u64 hash = 0xcbf29ce484222325ULL;
+	const char *c;
+
+	for (c = fid; *c; c++)
+		hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+	if (!name)
+		return hash;
+
+	hash = (hash ^ '/') * 0x100000001b3ULL;
+	for (c = name; *c; c++)
+		hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+	return hash;
+}
+
+void lr_work_add_key(struct lr_work *work, const char *fid, const char *name,
+		     bool excl)
+{
+	if (fid[0] == '\0' || strcmp(fid, lr_zero_fid) == 0)
+		return;
+
+	assert(work->lw_nkeys < LR_WORK_MAX_KEYS);
+	work->lw_keys[work->lw_nkeys].lk_hash = lr_key_hash(fid, name);
+	work->lw_keys[work->lw_nkeys].lk_excl = excl;
+	work->lw_keys[work->lw_nkeys].lk_work = work;
+	work->lw_nkeys++;
+}
+
+/*
+ * A hash collision only makes two independent records run one after the
+ * other, so the keys need not be exact.
+ */
+void lr_work_set_keys(struct lr_work *work)
+{
+	switch (work->lw_type) {
+	case CL_RENAME:
+	case CL_RMDIR:
+		/* the paths of a whole subtree change */
+		work->lw_barrier = 1;
+		break;
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+	case CL_UNLINK:
+	case CL_HARDLINK:
+		lr_work_add_key(work, work->lw_tfid, NULL, true);
+		lr_work_add_key(work, work->lw_pfid, work->lw_name, true);
+		lr_work_add_key(work, work->lw_pfid, NULL, false);
+		break;
+	default:
+		lr_work_add_key(work, work->lw_tfid, NULL, true);
+		break;
+	}
+}
+
+/* Drop the keys of \a work from the key table. Called with ls_lock held. */
+void lr_work_unlink_keys(struct lr_work *work)
+{
+	struct lr_key_queue **pqueue;
+	struct lr_key_queue *queue;
+	struct lr_work_key *key;
+	int i;
+
+	for (i = 0; i < work->lw_nkeys; i++) {
+		key = &work->lw_keys[i];
+		queue = key->lk_queue;
+		if (!queue)
+			continue;
+
+		list_del(&key->lk_link);
+		key->lk_queue = NULL;
+		if (key->lk_excl)
+			queue->lq_nexcl--;
+		if (!list_empty(&queue->lq_users))
+			continue;
+
+		pqueue = &lr_sched.ls_keys[queue->lq_hash % LR_KEY_BUCKETS];
+		while (*pqueue != queue)
+			pqueue = &(*pqueue)->lq_hnext;
+		*pqueue = queue->lq_hnext;
+		free(queue);
+	}
+}
+
+/*
+ * Add the keys of \a work, a record about to be queued, to the key table.
+ * Called with ls_lock held.
+ */
+int lr_work_link_keys(struct lr_work *work)
+{
+	struct lr_key_queue *queue;
+	struct lr_work_key *key;
+	int i;
+
+	for (i = 0; i < work->lw_nkeys; i++) {
+		key = &work->lw_keys[i];
+		queue = lr_sched.ls_keys[key->lk_hash % LR_KEY_BUCKETS];
+		while (queue && queue->lq_hash != key->lk_hash)
+			queue = queue->lq_hnext;
+		if (!queue) {
+			queue = calloc(1, sizeof(*queue));
+			if (!queue) {
+				lr_work_unlink_keys(work);
+				return -ENOMEM;
+			}
+			queue->lq_hash = key->lk_hash;
+			INIT_LIST_HEAD(&queue->lq_users);
+			queue->lq_hnext =
+				lr_sched.ls_keys[key->lk_hash % LR_KEY_BUCKETS];
+			lr_sched.ls_keys[key->lk_hash % LR_KEY_BUCKETS] = queue;
+		}
+
+		list_add_tail(&key->lk_link, &queue->lq_users);
+		key->lk_queue = queue;
+		if (key->lk_excl)
+			queue->lq_nexcl++;
+	}
+
+	return 0;
+}
+
+/*
+ * Can \a work run, i.e. does no earlier record queued or running use one
+ * of its keys in a conflicting way? Only the records sharing a key with
+ * \a work are looked at. Called with ls_lock held.
+ */
+bool lr_work_ready(const struct lr_work *work)
+{
+	const struct lr_work_key *key;
+	const struct lr_work_key *prev;
+	int i;
+
+	for (i = 0; i < work->lw_nkeys; i++) {
+		key = &work->lw_keys[i];
+		prev = list_first_entry(&key->lk_queue->lq_users,
+					struct lr_work_key, lk_link);
+		if (prev == key)
+			continue;
+		/* an earlier user, and one of the two is exclusive */
+		if (key->lk_excl)
+			return false;
+		if (key->lk_queue->lq_nexcl == 0)
+			continue;
+
+		/* shared, only an earlier exclusive user conflicts */
+		list_for_each_entry(prev, &key->lk_queue->lq_users, lk_link) {
+			if (prev == key)
+				break;
+			if (prev->lk_excl)
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Find the oldest queued record that does not depend on an earlier
+ * record still queued or running. Called with ls_lock held.
+ */
+struct lr_work *lr_work_pick(void)
+{
+	struct lr_work *work;
+
+	for (work = lr_sched.ls_head; work; work = work->lw_next) {
+		if (work->lw_barrier)
+			return work == lr_sched.ls_head && !work->lw_running ?
+			       work : NULL;
+		if (!work->lw_running && lr_work_ready(work))
+			return work;
+	}
+	return NULL;
+}
+
+/* Called with ls_lock held */
+void lr_work_del(struct lr_work *work)
+{
+	struct lr_work **pwork = &lr_sched.ls_head;
+	struct lr_work *prev = NULL;
+
+	while (*pwork != work) {
+		prev = *pwork;
+		pwork = &prev->lw_next;
+	}
+	*pwork = work->lw_next;
+	if (lr_sched.ls_tail == work)
+		lr_sched.ls_tail = prev;
+	lr_sched.ls_queued--;
+	lr_work_unlink_keys(work);
+	free(work);
+}
+
+/*
+ * Clear the changelog up to \a recno, read from the queue under ls_lock.
+ * Runs outside of ls_lock so that the other threads are not held up by
+ * the clear and the status log write, and serializes the clears.
+ */
+void lr_work_clear(long long recno)
+{
+	static pthread_mutex_t clear_lock = PTHREAD_MUTEX_INITIALIZER;
+
+	pthread_mutex_lock(&clear_lock);
+	lr_clear_cl(recno, 0);
+	pthread_mutex_unlock(&clear_lock);
+}
+
+/*
+ * Last record such that it and all the records before it are replicated.
+ * Called with ls_lock held.
+ */
+long long lr_work_done_recno(void)
+{
+	if (lr_sched.ls_head)
+		return lr_sched.ls_head->lw_recno - 1;
+	return lr_sched.ls_last_read;
+}
+
+/* Queue a record read from the changelog for the workers */
+int lr_work_queue(struct lr_info *info)
+{
+	struct lr_work *work;
+	long long recno;
+	int rc;
+
+	pthread_mutex_lock(&lr_sched.ls_lock);
+	if (lr_sched.ls_abort) {
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+		return -ECANCELED;
+	}
+	if (!lr_needs_apply(info->type)) {
+		lr_sched.ls_last_read = info->recno;
+		recno = lr_work_done_recno();
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+		lr_work_clear(recno);
+		return 0;
+	}
+	pthread_mutex_unlock(&lr_sched.ls_lock);
+
+	work = calloc(1, sizeof(*work));
+	if (!work)
+		return -ENOMEM;
+
+	work->lw_recno = info->recno;
+	work->lw_is_extended = info->is_extended;
+	work->lw_type = info->type;
+	memcpy(work->lw_tfid, info->tfid, sizeof(work->lw_tfid));
+	memcpy(work->lw_pfid, info->pfid, sizeof(work->lw_pfid));
+	memcpy(work->lw_sfid, info->sfid, sizeof(work->lw_sfid));
+	memcpy(work->lw_spfid, info->spfid, sizeof(work->lw_spfid));
+	memcpy(work->lw_sname, info->sname, sizeof(work->lw_sname));
+	memcpy(work->lw_name, info->name, sizeof(work->lw_name));
+	lr_work_set_keys(work);
+
+	pthread_mutex_lock(&lr_sched.ls_lock);
+	while (lr_sched.ls_queued >= lr_sched.ls_max_queued &&
+	       !lr_sched.ls_abort)
+		pthread_cond_wait(&lr_sched.ls_cond, &lr_sched.ls_lock);
+	if (lr_sched.ls_abort) {
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+		free(work);
+		return -ECANCELED;
+	}
+
+	rc = lr_work_link_keys(work);
+	if (rc) {
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+		free(work);
+		return rc;
+	}
+
+	if (lr_sched.ls_tail)
+		lr_sched.ls_tail->lw_next = work;
+	else
+		lr_sched.ls_head = work;
+	lr_sched.ls_tail = work;
+	lr_sched.ls_queued++;
+	lr_sched.ls_last_read = work->lw_recno;
+	pthread_cond_broadcast(&lr_sched.ls_cond);
+	pthread_mutex_unlock(&lr_sched.ls_lock);
+
+	return 0;
+}
+
+/* Worker thread, replicates queued records until the reader is done */
+void *lr_worker(void *arg)
+{
+	struct lr_info *info = arg;
+	struct lr_work *work;
+	long long recno;
+	int rc;
+
+	pthread_mutex_lock(&lr_sched.ls_lock);
+	while (!lr_sched.ls_abort) {
+		work = lr_work_pick();
+		if (!work) {
+			if (lr_sched.ls_eof && !lr_sched.ls_head)
+				break;
+			pthread_cond_wait(&lr_sched.ls_cond, &lr_sched.ls_lock);
+			continue;
+		}
+		work->lw_running = 1;
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+
+		info->recno = work->lw_recno;
+		info->is_extended = work->lw_is_extended;
+		info->type = work->lw_type;
+		memcpy(info->tfid, work->lw_tfid, sizeof(info->tfid));
+		memcpy(info->pfid, work->lw_pfid, sizeof(info->pfid));
+		memcpy(info->sfid, work->lw_sfid, sizeof(info->sfid));
+		memcpy(info->spfid, work->lw_spfid, sizeof(info->spfid));
+		memcpy(info->sname, work->lw_sname, sizeof(info->sname));
+		memcpy(info->name, work->lw_name, sizeof(info->name));
+
+		rc = lr_apply(info);
+
+		pthread_mutex_lock(&lr_sched.ls_lock);
+		if (rc && rc != -ENOENT) {
+			lr_print_failure(info, rc);
+			lr_error();
+			if (abort_on_err)
+				lr_sched.ls_abort = 1;
+		}
+		lr_work_del(work);
+		recno = lr_work_done_recno();
+		pthread_cond_broadcast(&lr_sched.ls_cond);
+		pthread_mutex_unlock(&lr_sched.ls_lock);
+
+		lr_work_clear(recno);
+		pthread_mutex_lock(&lr_sched.ls_lock);
+	}
+	pthread_mutex_unlock(&lr_sched.ls_lock);
+
+	return NULL;
+}
+
 /* Replicate filesystem operations from src_path to target_path */
 int lr_replicate(void)
 {
+	static const struct lu_fid zero_fid;
 	void *changelog_priv = NULL;
 	struct lr_info *info;
 	struct lr_info *ext = NULL;
+	struct lr_info **worker_info = NULL;
+	pthread_t *workers = NULL;
+	struct lr_work *work;
+	int nworkers = 0;
 	time_t start;
 	int xattr_not_supp;
 	int i;
 	int rc;
 
 	start = time(NULL);
+	snprintf(lr_zero_fid, sizeof(lr_zero_fid), DFID, PFID(&zero_fid));
 
 	info = calloc(1, sizeof(struct lr_info));
 	if (!info)
@@ -1629,9 +2172,34 @@ int lr_replicate(void)
 		goto out;
 	}
 
-	while (!quit && lr_parse_line(changelog_priv, info) == 0) {
-		rc = 0;
+	worker_info = calloc(nthreads, sizeof(*worker_info));
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!worker_info || !workers) {
+		rc = -ENOMEM;
+		goto out;
+	}
 
+	lr_sched.ls_max_queued = nthreads * LR_QUEUE_PER_THREAD;
+	lr_sched.ls_last_read = status->ls_last_recno;
+	for (nworkers = 0; nworkers < nthreads; nworkers++) {
+		worker_info[nworkers] = calloc(1, sizeof(struct lr_info));
+		if (!worker_info[nworkers]) {
+			rc = -ENOMEM;
+			break;
+		}
+		rc = pthread_create(&workers[nworkers], NULL, lr_worker,
+				    worker_info[nworkers]);
+		if (rc) {
+			fprintf(stderr, "Error starting worker thread: %s\n",
+				strerror(rc));
+			free(worker_info[nworkers]);
+			worker_info[nworkers] = NULL;
+			rc = -rc;
+			break;
+		}
+	}
+
+	while (!rc && !quit && lr_parse_line(changelog_priv, info) == 0) {
 		if (info->type == CL_RENAME && !info->is_extended) {
 			/*
 			 * Newer rename operations extends changelog to store
@@ -1655,62 +2223,24 @@ int lr_replicate(void)
 		if (dryrun)
 			continue;
 
-		lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name);
-
-		switch (info->type) {
-		case CL_CREATE:
-		case CL_MKDIR:
-		case CL_MKNOD:
-		case CL_SOFTLINK:
-			rc = lr_create(info);
-			break;
-		case CL_RMDIR:
-		case CL_UNLINK:
-			rc = lr_remove(info);
-			break;
-		case CL_RENAME:
-			rc = lr_move(info);
-			break;
-		case CL_HARDLINK:
-			rc = lr_link(info);
-			break;
-		case CL_TRUNC:
-		case CL_SETATTR:
-			rc = lr_setattr(info);
-			break;
-		case CL_SETXATTR:
-			rc = lr_setxattr(info);
-			break;
-		case CL_CLOSE:
-		case CL_EXT:
-		case CL_OPEN:
-		case CL_GETXATTR:
-		case CL_DN_OPEN:
-		case CL_LAYOUT:
-		case CL_MARK:
-			/*
-			 * Nothing needs to be done for these entries
-			 * fallthrough
-			 */
-			fallthrough;
-		default:
+		rc = lr_work_queue(info);
+		if (rc == -ECANCELED) {
+			/* stopped by abort_on_err */
+			rc = 0;
 			break;
 		}
+	}
 
-		lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name, rc);
+	/* Let the workers finish the queued records */
+	pthread_mutex_lock(&lr_sched.ls_lock);
+	lr_sched.ls_eof = 1;
+	if (rc || quit)
+		lr_sched.ls_abort = 1;
+	pthread_cond_broadcast(&lr_sched.ls_cond);
+	pthread_mutex_unlock(&lr_sched.ls_lock);
 
-		if (rc && rc != -ENOENT) {
-			lr_print_failure(info, rc);
-			errors++;
-			if (abort_on_err)
-				break;
-		}
-		lr_clear_cl(info, 0);
-	}
+	for (i = 0; i < nworkers; i++)
+		pthread_join(workers[i], NULL);
 
 	llapi_changelog_fini(&changelog_priv);
 
@@ -1718,16 +2248,28 @@ int lr_replicate(void)
 		printf("Errors: %d\n", errors);
 
 	/* Clear changelog records used so far */
-	lr_clear_cl(info, 1);
+	lr_clear_cl(lr_work_done_recno(), 1);
 
 	if (verbose) {
 		printf("lustre_rsync took %ld seconds\n", time(NULL) - start);
 		printf("Changelog records consumed: %lld\n", rec_count);
 	}
 
-	rc = 0;
-
 out:
+	/* records left by abort_on_err or an interruption */
+	while ((work = lr_sched.ls_head) != NULL)
+		lr_work_del(work);
+
+	for (i = 0; worker_info && i < nthreads; i++) {
+		if (!worker_info[i])
+			continue;
+		free(worker_info[i]->buf);
+		free(worker_info[i]->xlist);
+		free(worker_info[i]->xvalue);
+		free(worker_info[i]);
+	}
+	free(worker_info);
+	free(workers);
 	if (changelog_priv)
 		free(changelog_priv);
 	if (ext)
@@ -1755,7 +2297,7 @@ int main(int argc, char *argv[])
 	if ((rc = lr_init_status()) != 0)
 		return rc;
 
-	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:",
+	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:j:",
 				 long_opts, NULL)) >= 0) {
 		switch (rc) {
 		case 'a':
@@ -1858,6 +2400,15 @@ int main(int argc, char *argv[])
 				return -1;
 			}
 			break;
+		case 'j':
+			nthreads = atoi(optarg);
+			if (nthreads < 1 || nthreads > LR_MAX_THREADS) {
+				fprintf(stderr,
+					"error: %s: --threads must be between 1 and %d\n",
+					argv[0], LR_MAX_THREADS);
+				return -1;
+			}
+			break;
 		default:
 			fprintf(stderr, "error: %s: option '%s' unrecognized.\n",
 				argv[0], argv[optind - 1]);
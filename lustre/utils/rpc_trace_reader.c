@@ -0,0 +1,392 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/utils/rpc_trace_reader.c
+ *
+ * Read the RPC lifecycle events from /dev/lustre-rpc-trace (see
+ * linux/lustre/lustre_rpc_trace.h and lustre/ptlrpc/rpc_trace.c) and
+ * print a timeline per RPC, on the client or server side, once it is
+ * complete. The events of each CPU are buffered separately by the
+ * kernel, so a timeline is only printed after one more read of all the
+ * buffers has completed following its last event.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <linux/lnet/nidstr.h>
+#include <linux/lustre/lustre_rpc_trace.h>
+#include <libcfs/util/list.h>
+
+#include "lstddef.h"
+
+#define ERROR(fmt, args...) \
+	fprintf(stderr, "%s: "fmt, program_invocation_short_name, ##args)
+
+#define RTR_HASH_BITS	12
+#define RTR_MAX_EVENTS	16
+#define RTR_READ_ENTRIES	16384
+
+struct rtr_event {
+	__u64	re_time;
+	__u64	re_bytes;
+	__u16	re_event;
+};
+
+struct rtr_timeline {
+	struct list_head	rt_hash;
+	/* linkage into rtr_timelines, in order of the first event read */
+	struct list_head	rt_list;
+	__u64			rt_xid;
+	struct lnet_nid		rt_peer;
+	__u16			rt_flags;
+	__u32			rt_opc;
+	__s32			rt_status;
+	/* read pass of the last event, 0 while incomplete */
+	unsigned int		rt_done_pass;
+	unsigned int		rt_count;
+	struct rtr_event	rt_events[RTR_MAX_EVENTS];
+};
+
+static struct list_head rtr_hash[1 << RTR_HASH_BITS];
+static struct list_head rtr_timelines = LIST_HEAD_INIT(rtr_timelines);
+static volatile sig_atomic_t rtr_stop;
+static __u64 rtr_timeout_ns = 60ULL * 1000000000ULL;
+
+static const char *const rtr_event_names[] = {
+	[RPC_TRACE_QUEUED]		= "queued",
+	[RPC_TRACE_SENT]		= "sent",
+	[RPC_TRACE_ARRIVED]		= "arrived",
+	[RPC_TRACE_NRS_QUEUED]		= "nrs_queued",
+	[RPC_TRACE_NRS_DEQUEUED]	= "nrs_dequeued",
+	[RPC_TRACE_HANDLE_START]	= "handle_start",
+	[RPC_TRACE_HANDLE_END]		= "handle_end",
+	[RPC_TRACE_BULK_START]		= "bulk_start",
+	[RPC_TRACE_BULK_END]		= "bulk_end",
+	[RPC_TRACE_REPLY_SENT]		= "reply_sent",
+	[RPC_TRACE_REPLY_RECEIVED]	= "reply_received",
+};
+
+static const char *rtr_event_name(unsigned int event)
+{
+	if (event >= ARRAY_SIZE(rtr_event_names) || !rtr_event_names[event])
+		return "unknown";
+
+	return rtr_event_names[event];
+}
+
+static bool rtr_event_is_last(const struct rpc_trace_entry_v1 *rte)
+{
+	if (rte->rte_flags & RPC_TRACE_FL_CLIENT)
+		return rte->rte_event == RPC_TRACE_REPLY_RECEIVED;
+
+	return rte->rte_event == RPC_TRACE_HANDLE_END;
+}
+
+static unsigned int rtr_hash_index(__u64 xid, const struct lnet_nid *nid)
+{
+	__u64 key = xid ^ nid->nid_addr[0] ^ nid->nid_addr[3];
+
+	key *= 0x9e37fffffffc0001ULL;
+
+	return key >> (64 - RTR_HASH_BITS);
+}
+
+static struct rtr_timeline *rtr_timeline_find(
+				const struct rpc_trace_entry_v1 *rte)
+{
+	struct list_head *head;
+	struct rtr_timeline *rt;
+
+	head = &rtr_hash[rtr_hash_index(rte->rte_xid, &rte->rte_peer)];
+	list_for_each_entry(rt, head, rt_hash) {
+		if (rt->rt_xid == rte->rte_xid &&
+		    rt->rt_flags == rte->rte_flags &&
+		    !memcmp(&rt->rt_peer, &rte->rte_peer, sizeof(rt->rt_peer)))
+			return rt;
+	}
+
+	rt = calloc(1, sizeof(*rt));
+	if (!rt)
+		return NULL;
+
+	rt->rt_xid = rte->rte_xid;
+	rt->rt_peer = rte->rte_peer;
+	rt->rt_flags = rte->rte_flags;
+	list_add(&rt->rt_hash, head);
+	list_add_tail(&rt->rt_list, &rtr_timelines);
+
+	return rt;
+}
+
+static int rtr_event_cmp(const void *a, const void *b)
+{
+	const struct rtr_event *ea = a;
+	const struct rtr_event *eb = b;
+
+	if (ea->re_time != eb->re_time)
+		return ea->re_time < eb->re_time ? -1 : 1;
+
+	return (int)ea->re_event - (int)eb->re_event;
+}
+
+static void rtr_timeline_print(struct rtr_timeline *rt)
+{
+	__u64 start;
+	unsigned int i;
+
+	qsort(rt->rt_events, rt->rt_count, sizeof(rt->rt_events[0]),
+	      &rtr_event_cmp);
+	start = rt->rt_events[0].re_time;
+
+	printf("x%llu %s %s opc %u status %d%s:",
+	       (unsigned long long)rt->rt_xid,
+	       rt->rt_flags & RPC_TRACE_FL_CLIENT ? "client" : "server",
+	       libcfs_nidstr(&rt->rt_peer), rt->rt_opc, rt->rt_status,
+	       rt->rt_done_pass ? "" : " incomplete");
+
+	/* microseconds from the first event */
+	for (i = 0; i < rt->rt_count; i++) {
+		struct rtr_event *re = &rt->rt_events[i];
+
+		printf(" %s %llu", rtr_event_name(re->re_event),
+		       (unsigned long long)(re->re_time - start) / 1000);
+		if (re->re_event == RPC_TRACE_BULK_START ||
+		    re->re_event == RPC_TRACE_BULK_END)
+			printf(" %lluB", (unsigned long long)re->re_bytes);
+	}
+	printf("\n");
+}
+
+static void rtr_timeline_put(struct rtr_timeline *rt)
+{
+	rtr_timeline_print(rt);
+	list_del(&rt->rt_hash);
+	list_del(&rt->rt_list);
+	free(rt);
+}
+
+static void rtr_entry_add(const struct rpc_trace_entry_v1 *rte,
+			  unsigned int pass)
+{
+	struct rtr_timeline *rt;
+	struct rtr_event *re;
+
+	rt = rtr_timeline_find(rte);
+	if (!rt) {
+		ERROR("cannot allocate timeline of x%llu\n",
+		      (unsigned long long)rte->rte_xid);
+		return;
+	}
+
+	/* the opcode is unknown until the request is unpacked */
+	if (rte->rte_opc)
+		rt->rt_opc = rte->rte_opc;
+	rt->rt_status = rte->rte_status;
+	if (rtr_event_is_last(rte))
+		rt->rt_done_pass = pass;
+
+	if (rt->rt_count == RTR_MAX_EVENTS)
+		return;
+
+	re = &rt->rt_events[rt->rt_count++];
+	re->re_time = rte->rte_time;
+	re->re_bytes = rte->rte_bytes;
+	re->re_event = rte->rte_event;
+}
+
+static void rtr_entry_print(const struct rpc_trace_entry_v1 *rte)
+{
+	printf("%llu.%09llu cpu %u pid %u x%llu %s %s opc %u status %d %s",
+	       (unsigned long long)rte->rte_time / 1000000000,
+	       (unsigned long long)rte->rte_time % 1000000000,
+	       rte->rte_cpu, rte->rte_pid, (unsigned long long)rte->rte_xid,
+	       rte->rte_flags & RPC_TRACE_FL_CLIENT ? "client" : "server",
+	       libcfs_nidstr(&rte->rte_peer), rte->rte_opc, rte->rte_status,
+	       rtr_event_name(rte->rte_event));
+	if (rte->rte_bytes)
+		printf(" %lluB", (unsigned long long)rte->rte_bytes);
+	printf("\n");
+}
+
+/*
+ * Print the timelines completed before the previous pass, and those
+ * without events for rtr_timeout_ns, or all of them when \a all is set.
+ */
+static void rtr_flush(unsigned int pass, __u64 now, bool all)
+{
+	struct rtr_timeline *rt;
+	struct rtr_timeline *tmp;
+	__u64 last;
+
+	list_for_each_entry_safe(rt, tmp, &rtr_timelines, rt_list) {
+		last = rt->rt_events[rt->rt_count - 1].re_time;
+		if (all || (rt->rt_done_pass && rt->rt_done_pass < pass) ||
+		    now - last > rtr_timeout_ns)
+			rtr_timeline_put(rt);
+	}
+	fflush(stdout);
+}
+
+static int rtr_info(int fd)
+{
+	struct rpc_trace_info_v1 rti;
+
+	if (ioctl(fd, LUSTRE_RPC_TRACE_IOCTL_INFO, &rti) < 0) {
+		ERROR("cannot get trace info: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	printf("version: %#x\n", rti.rti_version);
+	printf("entry_size: %u\n", rti.rti_entry_size);
+	printf("buf_size: %u\n", rti.rti_buf_size);
+	printf("cpu_count: %u\n", rti.rti_cpu_count);
+	printf("entry_count: %llu\n", (unsigned long long)rti.rti_entry_count);
+	printf("drop_count: %llu\n", (unsigned long long)rti.rti_drop_count);
+
+	return 0;
+}
+
+static void rtr_signal(int signo)
+{
+	rtr_stop = 1;
+}
+
+static void usage(void)
+{
+	printf("Usage: %s [OPTIONS]\n"
+	       "Print the timelines of the RPCs from %s.\n"
+	       "  -d, --device=PATH    trace device path\n"
+	       "  -i, --info           print the trace buffer information\n"
+	       "  -r, --raw            print the events as they are read\n"
+	       "  -t, --timeout=SECS   print incomplete timelines after SECS\n"
+	       "  -h, --help           display this help and exit\n",
+	       program_invocation_short_name,
+	       "/dev/"LUSTRE_RPC_TRACE_DEV_NAME);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ .name = "device", .has_arg = required_argument, .val = 'd' },
+		{ .name = "help", .has_arg = no_argument, .val = 'h' },
+		{ .name = "info", .has_arg = no_argument, .val = 'i' },
+		{ .name = "raw", .has_arg = no_argument, .val = 'r' },
+		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
+		{ .name = NULL },
+	};
+	const char *device = "/dev/"LUSTRE_RPC_TRACE_DEV_NAME;
+	struct rpc_trace_entry_v1 *buf;
+	struct sigaction sa = {
+		.sa_handler = &rtr_signal,
+	};
+	unsigned int pass = 0;
+	bool info = false;
+	bool raw = false;
+	__u64 now = 0;
+	ssize_t count;
+	ssize_t i;
+	int rc = 0;
+	int fd;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "d:hirt:", options, NULL)) != -1) {
+		switch (c) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case 'i':
+			info = true;
+			break;
+		case 'r':
+			raw = true;
+			break;
+		case 't':
+			rtr_timeout_ns = strtoull(optarg, NULL, 0) *
+					 1000000000ULL;
+			break;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(rtr_hash); i++)
+		INIT_LIST_HEAD(&rtr_hash[i]);
+
+	fd = open(device, O_RDONLY);
+	if (fd < 0) {
+		ERROR("cannot open '%s': %s\n", device, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (ioctl(fd, LUSTRE_RPC_TRACE_IOCTL_VERSION) !=
+	    LUSTRE_RPC_TRACE_VERSION_1) {
+		ERROR("'%s': unsupported trace version\n", device);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	if (info) {
+		rc = rtr_info(fd);
+		close(fd);
+		return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	buf = calloc(RTR_READ_ENTRIES, sizeof(*buf));
+	if (!buf) {
+		ERROR("cannot allocate read buffer\n");
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	/* no SA_RESTART, so the signals interrupt read() */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (!rtr_stop) {
+		count = read(fd, buf, RTR_READ_ENTRIES * sizeof(*buf));
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR("cannot read '%s': %s\n", device,
+			      strerror(errno));
+			rc = -errno;
+			break;
+		}
+
+		pass++;
+		for (i = 0; i < count / sizeof(*buf); i++) {
+			if (buf[i].rte_time > now)
+				now = buf[i].rte_time;
+			if (raw)
+				rtr_entry_print(&buf[i]);
+			else
+				rtr_entry_add(&buf[i], pass);
+		}
+
+		if (raw)
+			fflush(stdout);
+		else
+			rtr_flush(pass, now, false);
+	}
+
+	rtr_flush(pass, now, true);
+	free(buf);
+	close(fd);
+
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}